@@ -0,0 +1,111 @@
+import time
+
+# Must match lib/gina_protocol/clock_sync.h.
+WINDOW = 8
+MAX_RTT_US = 5_000_000
+MAX_DRIFT_PPM = 100.0
+DRIFT_SPAN_US = 30_000_000
+STEP_US = 20_000
+STEP_SAMPLES = 2
+INTERVAL = 1.0  # Seconds between exchanges.
+
+WRAP = 1 << 32
+
+
+def now_us() -> int:
+    """
+    :return: Laptop monotonic time in wrapping uint32 microseconds, like the boards.
+    """
+    return (time.monotonic_ns() // 1000) % WRAP
+
+
+def signed32(value: int) -> int:
+    value %= WRAP
+    return value - WRAP if value >= 1 << 31 else value
+
+
+class ClockSync:
+    """
+    Offset and drift of a remote clock from two-way exchanges; the same
+    minimum-delay filter as ClockSync in clock_sync.h.
+    """
+
+    def __init__(self):
+        self.reset()
+        self.steps = 0
+
+    def reset(self):
+        self.samples = []  # (local_us, offset_us, delay_us), oldest first.
+        self.best = None
+        self.anchor = None
+        self.drift = 0.0
+        self.drift_known = False
+        self.outliers = 0
+
+    def synced(self) -> bool:
+        return self.best is not None
+
+    def add(self, t1: int, t2: int, t3: int, t4: int) -> bool:
+        """
+        Add one exchange: t1 sent and t4 received on the local clock, t2 received
+        and t3 answered on the remote clock.
+        :return: False if the sample was discarded.
+        """
+        round_trip = (t4 - t1) % WRAP
+        hold = (t3 - t2) % WRAP
+        if round_trip > MAX_RTT_US or hold > round_trip + STEP_US:
+            return False
+
+        local = (t1 + round_trip // 2) % WRAP
+        delay = max(round_trip - hold, 0)
+        d1 = (t2 - t1) % WRAP
+        d2 = (t3 - t4) % WRAP
+        offset = (d1 - int(signed32(d1 - d2) / 2)) % WRAP
+
+        if self.synced():
+            error = abs(signed32(offset - self.offset_us(local)))
+            if error > STEP_US + delay // 2:
+                self.outliers += 1
+                if self.outliers < STEP_SAMPLES:
+                    return False
+                self.reset()
+                self.steps += 1
+        self.outliers = 0
+
+        self.samples = self.samples[-(WINDOW - 1) :] + [(local, offset, delay)]
+        self.choose(local)
+        return True
+
+    def choose(self, now: int):
+        def cost(sample):
+            return sample[2] / 2 + ((now - sample[0]) % WRAP) * MAX_DRIFT_PPM / 1e6
+
+        self.best = min(self.samples, key=cost)
+        if self.anchor is None:
+            self.anchor = self.best
+            return
+        span = (self.best[0] - self.anchor[0]) % WRAP
+        if span < DRIFT_SPAN_US or span >= 1 << 31:
+            return
+        limit = MAX_DRIFT_PPM / 1e6
+        measured = min(max(signed32(self.best[1] - self.anchor[1]) / span, -limit), limit)
+        self.drift = self.drift + (measured - self.drift) / 4 if self.drift_known else measured
+        self.drift_known = True
+        self.anchor = self.best
+
+    def offset_us(self, local: int) -> int:
+        """
+        :return: Remote - local at local (modulo 2^32).
+        """
+        return (self.best[1] + int(self.drift * signed32(local - self.best[0]))) % WRAP
+
+    def to_remote(self, local: int) -> int:
+        return (local + self.offset_us(local)) % WRAP
+
+    def uncertainty_us(self, local: int) -> int:
+        age = abs(signed32(local - self.best[0]))
+        drift_ppm = MAX_DRIFT_PPM / 10 if self.drift_known else MAX_DRIFT_PPM
+        return self.best[2] // 2 + int(age * drift_ppm / 1e6)
+
+    def drift_ppm(self) -> float:
+        return self.drift * 1e6
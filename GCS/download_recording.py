@@ -0,0 +1,114 @@
+"""
+Downloads the MCU's onboard test recording over USB serial and converts it to CSV.
+
+Usage:
+    python download_recording.py /dev/tty.usbserial-0001 logs/recording [capture]
+Writes logs/recording.bin (raw file) and logs/recording.csv (one row per record).
+Pass "capture" to fetch the pre-trigger ignition capture instead.
+"""
+
+import base64
+import csv
+import struct
+import sys
+
+import serial
+
+# Must match RecordingHeader / Record in MCU/src/recorder.h.
+RECORDING_MAGIC = 0x43455247
+HEADER_FORMAT = "<IHHII"
+RECORD_FORMAT = "<IBBHi"
+RECORD_TYPES = {
+    1: "PRESSURE",  # id: first sensor channel of the pair (0 = fuel/ox).
+    2: "LOAD",
+    3: "VALVE",
+    4: "IGNITER",
+    5: "MARKER",
+    6: "REDLINE_CONFIG",
+    7: "REDLINE_TRIP",
+}
+
+
+def download(
+    port: str, command: str = "CMD:REC_DUMP", baudrate: int = 115200, timeout: float = 10.0
+) -> bytes:
+    """
+    Requests a recording and collects the base64 dump lines.
+    :param port: MCU USB serial port.
+    :param command: CMD:REC_DUMP (full recording) or CMD:CAP_DUMP (capture).
+    :param baudrate: MCU USB serial baudrate.
+    :param timeout: Seconds to wait for any line before giving up.
+    :return: Raw recording file contents.
+    """
+    with serial.Serial(port, baudrate, timeout=timeout) as connection:
+        connection.write((command + "\n").encode())
+        size = None
+        data = bytearray()
+        while True:
+            line = connection.readline().decode(errors="ignore").strip()
+            if not line:
+                raise TimeoutError("MCU stopped responding during dump.")
+            # Debug prints may be interleaved; only REC: lines matter.
+            if not line.startswith("REC:"):
+                continue
+            body = line[4:]
+            if body == "NONE":
+                raise FileNotFoundError("MCU has no recording.")
+            if body.startswith("BEGIN:"):
+                size = int(body[6:])
+                data.clear()
+            elif body == "END":
+                break
+            elif size is not None:
+                offset, encoded = body.split(":", 1)
+                if int(offset) != len(data):
+                    raise ValueError(f"Missing dump data at offset {len(data)}.")
+                data += base64.b64decode(encoded)
+
+    if size is None or len(data) != size:
+        raise ValueError(f"Expected {size} bytes, got {len(data)}.")
+    return bytes(data)
+
+
+def to_rows(data: bytes):
+    """
+    Decodes a recording file into rows.
+    :param data: Raw recording file contents.
+    :return: Generator of (timestamp_us, type, id, value_a, value_b).
+    """
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, record_size, rate_hz, start_us = struct.unpack_from(
+        HEADER_FORMAT, data
+    )
+    if magic != RECORDING_MAGIC:
+        raise ValueError("Not a GINA recording.")
+    print(f"Recording v{version}, PT rate {rate_hz} Hz, started at {start_us} us.")
+
+    for offset in range(header_size, len(data) - record_size + 1, record_size):
+        timestamp_us, record_type, record_id, value_a, value_b = struct.unpack_from(
+            RECORD_FORMAT, data, offset
+        )
+        yield (
+            timestamp_us,
+            RECORD_TYPES.get(record_type, str(record_type)),
+            record_id,
+            value_a,
+            value_b,
+        )
+
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (3, 4):
+        print(__doc__)
+        sys.exit(1)
+
+    port, output = sys.argv[1], sys.argv[2]
+    capture = len(sys.argv) == 4 and sys.argv[3] == "capture"
+    recording = download(port, "CMD:CAP_DUMP" if capture else "CMD:REC_DUMP")
+    with open(output + ".bin", "wb") as f:
+        f.write(recording)
+    with open(output + ".csv", "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["timestamp_us", "type", "id", "value_a", "value_b"])
+        writer.writerows(to_rows(recording))
+    print(f"Wrote {output}.bin and {output}.csv")
@@ -0,0 +1,57 @@
+from dataclasses import dataclass, fields
+
+# Stage order of the "LAT:" line, see lib/gina_protocol/command_trace.h.
+STAGES = ("home", "radio", "away", "uart", "queue", "execute", "confirm")
+
+
+@dataclass
+class CommandLatency:
+    sequence: int
+    # Microseconds; None where the boards could not measure it.
+    home: int | None
+    radio: int | None
+    away: int | None
+    uart: int | None
+    queue: int | None
+    execute: int | None
+    confirm: int | None
+    telemetry_sequence: int
+
+    def stages(self) -> dict[str, int | None]:
+        return {stage: getattr(self, stage) for stage in STAGES}
+
+    def total(self) -> int | None:
+        """
+        :return: Serial line in to confirming telemetry out, or None if a stage is unknown.
+        """
+        values = self.stages().values()
+        return None if None in values else sum(values)
+
+
+def decode_latency(line: str) -> CommandLatency:
+    """
+    Decode a "LAT:<seq>:<home>:<radio>:<away>:<uart>:<queue>:<execute>:<confirm>:<tlm_seq>"
+    line printed by Lora Home.
+    :param line: Serial line without newline.
+    :return: Decoded latency.
+    :raises ValueError: On a malformed line.
+    """
+    values = [int(v) for v in line[4:].split(":")]
+    if len(values) != len(fields(CommandLatency)):
+        raise ValueError(f"Latency line has {len(values)} fields, expected {len(fields(CommandLatency))}.")
+    sequence, *stages, telemetry_sequence = values
+    return CommandLatency(sequence, *[None if v < 0 else v for v in stages], telemetry_sequence)
+
+
+def format_latency(latency: CommandLatency) -> str:
+    """
+    :return: One-line breakdown in milliseconds, e.g. "#5 home 0.2 + radio 41.0 + ... = 63.1 ms".
+    """
+    parts = [f"{stage} {'?' if value is None else f'{value / 1000:.1f}'}" for stage, value in latency.stages().items()]
+    total = latency.total()
+    return (
+        f"#{latency.sequence} "
+        + " + ".join(parts)
+        + (f" = {total / 1000:.1f} ms" if total is not None else " ms")
+        + f" (TLM #{latency.telemetry_sequence})"
+    )
@@ -15,7 +15,7 @@ from PyQt6.QtWidgets import (
     QLabel,
 )
 from PyQt6.QtGui import QColor, QPalette, QFont
-from PyQt6.QtCore import QThread, Qt
+from PyQt6.QtCore import QThread, QTimer, Qt
 
 from ui import (
     IgnitionButton,
@@ -26,9 +26,15 @@ from ui import (
     ThrustGraph,
     ValveSwitch,
     HeartbeatLabel,
+    LatencyHistogram,
     QHLine,
 )
+from clock_sync import INTERVAL as CLOCK_SYNC_INTERVAL, ClockSync, now_us
+from latency import decode_latency, format_latency
+from packets import SERIAL_COMMAND, SERIAL_LOG, SERIAL_SAMPLES, SERIAL_TELEMETRY, decode_sample_block
 from serial_monitor import SerialMonitor
+from telemetry import decode_frame, decode_line, decode_link_stats
+from udp_monitor import UdpMonitor
 from utils import g_to_N
 
 LOG_FILE = open("logs/log.txt", "a")
@@ -83,7 +89,17 @@ class ControlPanel(QWidget):
         self.serial_port_path = "/dev/tty.usbserial-0001"  # Hardcoded.
         self.serial_baudrate = "115200"
 
+        # Lora Home's clock, and its offset to the MCU clock once its radio
+        # sync is up. Over UDP the monitor syncs to the MCU directly.
+        self.home_clock = ClockSync()
+        self.home_mcu_offset = None
+
         self.initUI()
+        self.startUdpMonitor()
+
+        self.clock_timer = QTimer(self)
+        self.clock_timer.timeout.connect(self.sendTimeSync)
+        self.clock_timer.start(int(CLOCK_SYNC_INTERVAL * 1000))
 
     def initUI(self):
         self.setWindowTitle("GINA Control Panel")
@@ -122,6 +138,21 @@ class ControlPanel(QWidget):
         self.heartbeat_label_ = HeartbeatLabel(self)
         left_layout.addWidget(self.heartbeat_label_)
 
+        # Which transport carries telemetry and commands right now.
+        self.link_label = QLabel("Link: LoRa", self)
+        self.link_label.setStyleSheet("color: white;")
+        left_layout.addWidget(self.link_label)
+
+        # LoRa telemetry delivery and signal, from Home's "LNK:" line.
+        self.radio_stats_label = QLabel("LoRa: no statistics yet", self)
+        self.radio_stats_label.setStyleSheet("color: white;")
+        left_layout.addWidget(self.radio_stats_label)
+
+        # Where laptop time maps onto the MCU clock, and how well.
+        self.clock_label = QLabel("Clock: not synced", self)
+        self.clock_label.setStyleSheet("color: white;")
+        left_layout.addWidget(self.clock_label)
+
         important_btns_layout = QHBoxLayout()
         important_btns_layout.setContentsMargins(0, 30, 0, 0)
         important_btns_layout.addWidget(
@@ -199,6 +230,7 @@ class ControlPanel(QWidget):
 
         self.pressure_graph = PressureGraph(self)
         self.thrust_graph = ThrustGraph(self)
+        self.latency_histogram = LatencyHistogram(self)
 
         right_panel = QFrame()
         right_layout = QVBoxLayout()
@@ -210,6 +242,7 @@ class ControlPanel(QWidget):
         right_layout.addWidget(self.serial_terminal)
         right_layout.addWidget(self.pressure_graph)
         right_layout.addWidget(self.thrust_graph)
+        right_layout.addWidget(self.latency_histogram)
 
         splitter = QSplitter(Qt.Orientation.Horizontal)
         splitter.addWidget(left_btn_panel)
@@ -269,10 +302,119 @@ class ControlPanel(QWidget):
 
         # Connects a slot (callback function) to the monitor data-received signal.
         self.serial_monitor.data_received.connect(self.displaySerialData)
+        self.serial_monitor.time_sync_received.connect(self.handleTimeSync)
         # Connects start signal to running function.
         self.serial_monitor_thread.started.connect(self.serial_monitor.run)
         self.serial_monitor_thread.start()
 
+    def startUdpMonitor(self):
+        """
+        Listen for the MCU over WiFi/UDP. Runs for the whole session; LoRa
+        stays the fallback whenever UDP goes quiet.
+        """
+        self.udp_monitor = None
+        self.udp_link_up = False
+        try:
+            self.udp_monitor = UdpMonitor()
+        except OSError as e:
+            self.serial_terminal.append(f"UDP EXCEPTION: {e}. WiFi link disabled.")
+            return
+
+        self.udp_monitor_thread = QThread()
+        self.udp_monitor.moveToThread(self.udp_monitor_thread)
+        self.udp_monitor.packet_received.connect(self.displayUdpPacket)
+        self.udp_monitor.command_acked.connect(self.udpCommandAcked)
+        self.udp_monitor.command_failed.connect(self.udpCommandFailed)
+        self.udp_monitor_thread.started.connect(self.udp_monitor.run)
+        self.udp_monitor_thread.start()
+
+        self.link_timer = QTimer(self)
+        self.link_timer.timeout.connect(self.updateLinkHealth)
+        self.link_timer.start(250)
+
+    def udpHealthy(self) -> bool:
+        return self.udp_monitor is not None and self.udp_monitor.healthy()
+
+    def updateLinkHealth(self):
+        """
+        Report failover between UDP and LoRa.
+        """
+        healthy = self.udpHealthy()
+        if healthy != self.udp_link_up:
+            self.udp_link_up = healthy
+            message = (
+                f"WiFi/UDP link up ({self.udp_monitor.mcu_address}); full-rate plots."
+                if healthy
+                else "WiFi/UDP link lost; falling back to LoRa."
+            )
+            self.serial_terminal.append(message)
+            write_log(message)
+        self.link_label.setText("Link: WiFi/UDP" if healthy else "Link: LoRa")
+
+    def serialTime(self, characters: int) -> int:
+        """
+        :return: Microseconds a line of this length spends on the wire (8N1).
+        """
+        try:
+            return int(characters * 10 * 1e6 / int(self.serial_baudrate))
+        except (ValueError, ZeroDivisionError):
+            return 0
+
+    def sendTimeSync(self):
+        """
+        Start one time exchange with Lora Home, and log where the MCU clock is.
+        """
+        if self.serial_connection.is_open:
+            line = f"SYNC:{now_us()}\n"
+            self.serial_connection.write(line.encode())
+
+        mcu = self.mcuTime()
+        if mcu is None:
+            self.clock_label.setText("Clock: not synced")
+            return
+        write_log(f"GCS CLK:{mcu[0]}:{mcu[1]}")
+        source = "UDP" if self.udpHealthy() and self.udp_monitor.clock.synced() else "LoRa"
+        self.clock_label.setText(f"Clock: MCU via {source}, +/-{mcu[1] / 1000:.2f} ms")
+
+    def handleTimeSync(self, line: str, receive_us: int):
+        """
+        Add a "SYNC:<t1>:<t2>:<t3>:<mcu_offset>" reply from Lora Home.
+        :param line: Reply line.
+        :param receive_us: Local time the line was read.
+        """
+        write_log(line)
+        try:
+            t1, t2, t3, offset = line[5:].split(":")
+            t1, t2, t3 = int(t1), int(t2), int(t3)
+        except ValueError:
+            self.serial_terminal.append(f"Bad time sync line: {line}")
+            return
+        # Home stamps the request's last byte and the reply's first; the line
+        # times themselves are known, not delay.
+        request_length = len(f"SYNC:{t1}\n")
+        t1 += self.serialTime(request_length)
+        t4 = receive_us - self.serialTime(len(line) + 2)
+        self.home_clock.add(t1, t2, t3, t4)
+        self.home_mcu_offset = None if offset == "-" else int(offset)
+
+    def mcuTime(self, local_us: int | None = None) -> tuple[int, int] | None:
+        """
+        Convert laptop time to the MCU clock, over UDP if it is synced, else
+        through Lora Home.
+        :param local_us: clock_sync.now_us() time; defaults to now.
+        :return: (MCU time in us, uncertainty in us), or None if not synced.
+        """
+        if local_us is None:
+            local_us = now_us()
+        if self.udpHealthy() and self.udp_monitor.clock.synced():
+            clock = self.udp_monitor.clock
+            return clock.to_remote(local_us), clock.uncertainty_us(local_us)
+        if self.home_clock.synced() and self.home_mcu_offset is not None:
+            home_us = self.home_clock.to_remote(local_us)
+            # Home's own radio hop adds its error on top; it reports it in "CLK:".
+            return (home_us + self.home_mcu_offset) % (1 << 32), self.home_clock.uncertainty_us(local_us)
+        return None
+
     def sendUserCommand(self):
         """
         Write a string over serial to Lora Home (UTF-8 encoded)
@@ -287,31 +429,124 @@ class ControlPanel(QWidget):
 
     def transmitMessage(self, message: str):
         """
-        Transmit a message over serial.
+        Transmit a command over WiFi/UDP if that link is up, otherwise over
+        serial to Lora Home. UDP commands are retried until the MCU ACKs them,
+        then fall back to Lora Home. Aborts go over both at once.
         :param message: Message to transmit.
         """
+        if self.udpHealthy():
+            self.udp_monitor.send_command(message.strip())
+            self.serial_terminal.append(f'Sent "{repr(message)}" over WiFi/UDP.')
+            if message != COMMANDS["CLOSE_ALL"]:
+                return
+
+        self.writeSerial(message)
+
+    def writeSerial(self, message: str):
+        """
+        Write a command line to Lora Home.
+        :param message: Message to write, with its newline.
+        """
         if self.serial_connection.is_open:
             self.serial_connection.write(message.encode())
             self.serial_terminal.append(f'Wrote "{repr(message)}" to serial.')
         else:
             self.serial_terminal.append("Not connected.")
 
+    def udpCommandAcked(self, text: str):
+        write_log("UDP ACK " + text)
+        self.serial_terminal.append(f'MCU acknowledged "{text}" over WiFi/UDP.')
+
+    def udpCommandFailed(self, text: str):
+        """
+        No ACK for a UDP command after every retry; resend it over LoRa.
+        Aborts already went over LoRa.
+        :param text: Command without its newline.
+        """
+        message = text + "\n"
+        self.serial_terminal.append(f'No UDP ACK for "{text}".')
+        if message != COMMANDS["CLOSE_ALL"]:
+            self.writeSerial(message)
+
     def displaySerialData(self, data: str):
         write_log(data)
-        if data.startswith("T"):
+        if data.startswith("TLM:"):
+            try:
+                telemetry = decode_line(data)
+            except ValueError as e:
+                self.serial_terminal.append(f"Bad telemetry: {e}")
+                return
+            # UDP carries the same frames and full-rate samples; plotting both
+            # would interleave two time bases.
+            if self.udpHealthy():
+                return
+            self.pressure_graph.update(telemetry.psi_fuel, telemetry.psi_ox)
+            self.thrust_graph.update(g_to_N(telemetry.load_g))
+            self.serial_terminal.append(
+                f"LoRa Home: #{telemetry.sequence} fuel {telemetry.psi_fuel} psi, "
+                f"ox {telemetry.psi_ox} psi, load {telemetry.load_g} g"
+            )
+        elif data.startswith("LAT:"):
+            try:
+                latency = decode_latency(data)
+            except ValueError as e:
+                self.serial_terminal.append(f"Bad latency line: {e}")
+                return
+            self.latency_histogram.update(latency)
+            self.serial_terminal.append("Latency: " + format_latency(latency))
+        elif data.startswith("T"):
+            # Legacy "T<fuel>,<ox>,<load>" text telemetry.
             psi_fuel, psi_ox, load = [d.strip() for d in data[1:].split(",")]
             self.pressure_graph.update(int(psi_fuel), int(psi_ox))
             self.thrust_graph.update(g_to_N(int(load)))
             self.serial_terminal.append("LoRa Home: " + data)
+        elif data.startswith("CLK:"):
+            # Home's radio clock estimate; kept in the log only.
+            return
         elif data.startswith("HBT:"):
             self.heartbeat_label_.update_heartbeat(f"{data[4:]}s")
+        elif data.startswith("LNK:"):
+            try:
+                stats = decode_link_stats(data)
+            except ValueError as e:
+                self.serial_terminal.append(f"Bad link statistics: {e}")
+                return
+            self.radio_stats_label.setText(
+                f"LoRa: {stats.frame_rate_hz:.1f} Hz, {stats.loss_percent():.1f}% lost "
+                f"({stats.lost}/{stats.received + stats.lost}), {stats.crc_failed} CRC, "
+                f"RSSI {stats.rssi_dbm:.0f} dBm, SNR {stats.snr_db:.1f} dB"
+            )
         else:
             self.serial_terminal.append("Debug: " + data)
 
+    def displayUdpPacket(self, packet_type: int, payload: bytes):
+        """
+        Handle one packet from the MCU over WiFi/UDP.
+        :param packet_type: SERIAL_* type.
+        :param payload: Packet payload.
+        """
+        try:
+            if packet_type == SERIAL_SAMPLES:
+                self.pressure_graph.update_many(decode_sample_block(payload))
+            elif packet_type == SERIAL_TELEMETRY:
+                write_log("UDP TLM:" + payload.hex().upper())
+                telemetry = decode_frame(payload)
+                self.thrust_graph.update(g_to_N(telemetry.load_g))
+            elif packet_type == SERIAL_LOG:
+                text = payload.decode(errors="ignore")
+                write_log("UDP " + text)
+                self.serial_terminal.append("MCU (WiFi): " + text)
+        except ValueError as e:
+            self.serial_terminal.append(f"Bad UDP packet: {e}")
+
     def closeEvent(self, event):
         """
         Ensures serial connection closes before program terminates.
         """
+        if self.udp_monitor:
+            self.udp_monitor.stop()
+            self.udp_monitor_thread.quit()
+            self.udp_monitor_thread.wait()
         self.serial_monitor.stop()
         self.serial_monitor_thread.quit()
         self.serial_monitor_thread.wait()  # Waits for the thread to finish executing.
@@ -0,0 +1,113 @@
+import binascii
+import struct
+
+# Must match lib/gina_protocol/serial_packet.h and sample_block.h.
+SERIAL_TELEMETRY = 1
+SERIAL_COMMAND = 2
+SERIAL_LOG = 3
+SERIAL_KEEPALIVE = 6
+SERIAL_SAMPLES = 7
+SERIAL_TRACED_COMMAND = 8
+SERIAL_TIME_REQUEST = 10
+SERIAL_TIME_REPLY = 11
+SERIAL_COMMAND_ACK = 13
+
+SAMPLE_BLOCK_HEADER_FORMAT = "<BBII"
+SAMPLE_BLOCK_HEADER_SIZE = struct.calcsize(SAMPLE_BLOCK_HEADER_FORMAT)
+
+
+def cobs_encode(data: bytes) -> bytes:
+    """
+    COBS-encode data (no delimiter).
+    :param data: Raw bytes.
+    :return: Encoded bytes, free of zeros.
+    """
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out.append(len(block) + 1)
+            out += block
+            block = bytearray()
+            continue
+        block.append(byte)
+        if len(block) == 254:
+            out.append(255)
+            out += block
+            block = bytearray()
+    out.append(len(block) + 1)
+    out += block
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    """
+    Decode one COBS frame (delimiter stripped).
+    :param data: Encoded bytes.
+    :return: Raw bytes.
+    :raises ValueError: On a malformed frame.
+    """
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        block = data[i : i + code - 1]
+        if code == 0 or len(block) != code - 1 or 0 in block:
+            raise ValueError("Malformed COBS frame.")
+        out += block
+        i += code - 1
+        # A full block (0xFF) has no implied zero; neither does the last block.
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_packet(packet_type: int, payload: bytes = b"") -> bytes:
+    """
+    Build one packet as the MCU expects it: COBS(type, payload, CRC-16 LE), 0x00.
+    :param packet_type: SERIAL_* type.
+    :param payload: Payload bytes.
+    :return: Datagram bytes.
+    """
+    raw = bytes([packet_type]) + payload
+    raw += struct.pack("<H", binascii.crc_hqx(raw, 0xFFFF))
+    return cobs_encode(raw) + b"\x00"
+
+
+def decode_packet(datagram: bytes) -> tuple[int, bytes]:
+    """
+    Decode one packet.
+    :param datagram: Encoded bytes, with or without the trailing 0x00.
+    :return: (type, payload).
+    :raises ValueError: On a malformed frame or failed CRC.
+    """
+    raw = cobs_decode(datagram.rstrip(b"\x00"))
+    if len(raw) < 3:
+        raise ValueError("Packet too short.")
+    (crc,) = struct.unpack("<H", raw[-2:])
+    if crc != binascii.crc_hqx(raw[:-2], 0xFFFF):
+        raise ValueError("Packet failed CRC.")
+    return raw[0], raw[1:-2]
+
+
+def decode_sample_block(payload: bytes) -> list[tuple[int, list[float]]]:
+    """
+    Decode a SERIAL_SAMPLES block.
+    :param payload: Packet payload.
+    :return: (timestamp_us, [value per channel]) per scan, in 1.0 units.
+    :raises ValueError: On a bad length.
+    """
+    if len(payload) < SAMPLE_BLOCK_HEADER_SIZE:
+        raise ValueError("Sample block too short.")
+    channels, count, timestamp_us, period_us = struct.unpack_from(SAMPLE_BLOCK_HEADER_FORMAT, payload)
+    if len(payload) != SAMPLE_BLOCK_HEADER_SIZE + 2 * channels * count:
+        raise ValueError(f"Sample block is {len(payload)} bytes for {count} x {channels} values.")
+    values = struct.unpack_from(f"<{channels * count}h", payload, SAMPLE_BLOCK_HEADER_SIZE)
+    return [
+        (
+            (timestamp_us + i * period_us) & 0xFFFFFFFF,
+            [v / 10 for v in values[i * channels : (i + 1) * channels]],
+        )
+        for i in range(count)
+    ]
@@ -2,6 +2,8 @@ import serial
 
 from PyQt6.QtCore import pyqtSignal, QObject
 
+from clock_sync import now_us
+
 
 class SerialMonitor(QObject):
     """
@@ -9,6 +11,8 @@ class SerialMonitor(QObject):
     """
 
     data_received = pyqtSignal(str)
+    # "SYNC:" replies from Lora Home, with the time they were read.
+    time_sync_received = pyqtSignal(str, int)
 
     def __init__(self, serial_connection: serial.Serial):
         super().__init__()
@@ -25,6 +29,10 @@ class SerialMonitor(QObject):
                         .decode(errors="ignore")
                         .strip()
                     )
+                    # Stamped here rather than on the GUI thread, which may be busy.
+                    if line.startswith("SYNC:"):
+                        self.time_sync_received.emit(line, now_us())
+                        continue
                     # Sends signal with data.
                     self.data_received.emit(line)
                 except Exception as e:
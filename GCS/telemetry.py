@@ -0,0 +1,87 @@
+import binascii
+import struct
+from dataclasses import dataclass
+
+# Must match TelemetryFrame in lib/gina_protocol/telemetry_frame.h.
+FRAME_TELEMETRY = 0xA1
+FRAME_FORMAT = "<BHIhhiBH"
+FRAME_SIZE = struct.calcsize(FRAME_FORMAT)
+
+STATUS_FIRING = 1 << 0
+STATUS_RECORDING = 1 << 1
+STATUS_LOAD_STALE = 1 << 2
+STATUS_REDLINE = 1 << 3
+STATUS_PRESSURE_STALE = 1 << 4
+STATUS_UDP_LINK = 1 << 5
+
+
+@dataclass
+class Telemetry:
+    sequence: int
+    timestamp_us: int
+    psi_fuel: float
+    psi_ox: float
+    load_g: int
+    status: int
+
+
+def decode_frame(frame: bytes) -> Telemetry:
+    """
+    Decode one binary telemetry frame.
+    :param frame: Raw frame bytes.
+    :return: Decoded telemetry.
+    :raises ValueError: On bad length, type or CRC.
+    """
+    if len(frame) != FRAME_SIZE:
+        raise ValueError(f"Telemetry frame is {len(frame)} bytes, expected {FRAME_SIZE}.")
+    fields = struct.unpack(FRAME_FORMAT, frame)
+    if fields[0] != FRAME_TELEMETRY:
+        raise ValueError(f"Unknown frame type {fields[0]:#04x}.")
+    if fields[-1] != binascii.crc_hqx(frame[:-2], 0xFFFF):
+        raise ValueError("Telemetry frame failed CRC.")
+
+    _, sequence, timestamp_us, fuel_x10, ox_x10, load_g, status, _ = fields
+    return Telemetry(sequence, timestamp_us, fuel_x10 / 10, ox_x10 / 10, load_g, status)
+
+
+def decode_line(line: str) -> Telemetry:
+    """
+    Decode a "TLM:<hex>" line printed by Lora Home.
+    :param line: Serial line without newline.
+    :return: Decoded telemetry.
+    """
+    return decode_frame(bytes.fromhex(line[4:]))
+
+
+@dataclass
+class LinkStats:
+    received: int
+    lost: int
+    late: int
+    crc_failed: int
+    resets: int
+    frame_rate_hz: float
+    rssi_dbm: float
+    snr_db: float
+    min_rssi_dbm: float
+    min_snr_db: float
+
+    def loss_percent(self) -> float:
+        expected = self.received + self.lost
+        return 100 * self.lost / expected if expected else 0.0
+
+
+def decode_link_stats(line: str) -> LinkStats:
+    """
+    Decode a "LNK:<received>:<lost>:<late>:<crc_failed>:<resets>:<rate_hz>:<rssi>:<snr>:<min_rssi>:<min_snr>"
+    line printed by Lora Home after each heartbeat.
+    :param line: Serial line without newline.
+    :return: Decoded statistics.
+    :raises ValueError: On a malformed line.
+    """
+    values = line[4:].split(":")
+    if len(values) != 10:
+        raise ValueError(f"Link stats line has {len(values)} fields, expected 10.")
+    counts = [int(v) for v in values[:5]]
+    signal = [float(v) for v in values[5:]]
+    return LinkStats(*counts, *signal)
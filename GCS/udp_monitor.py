@@ -0,0 +1,173 @@
+import random
+import socket
+import threading
+import time
+
+from PyQt6.QtCore import pyqtSignal, QObject
+
+import struct
+
+from clock_sync import INTERVAL as CLOCK_SYNC_INTERVAL, ClockSync, now_us
+from packets import (
+    SERIAL_COMMAND_ACK,
+    SERIAL_KEEPALIVE,
+    SERIAL_TIME_REPLY,
+    SERIAL_TIME_REQUEST,
+    SERIAL_TRACED_COMMAND,
+    decode_packet,
+    encode_packet,
+)
+
+# Must match GCS_UDP_PORT in MCU/src/server.h.
+UDP_PORT = 5005
+# Keepalives go here until the MCU answers; a fixed address also works.
+BROADCAST_ADDRESS = "255.255.255.255"
+KEEPALIVE_INTERVAL = 0.25  # Seconds; SERVER_KEEPALIVE_MS on the MCU.
+# The link counts as down after this long without a packet (SERVER_TIMEOUT_MS).
+LINK_TIMEOUT = 1.0
+# Commands are resent this often until the MCU ACKs them, then handed back
+# for LoRa. WiFi round trips are a few ms; the MCU only runs each sequence once.
+COMMAND_RETRY_INTERVAL = 0.1  # Seconds.
+COMMAND_ATTEMPTS = 5
+
+
+class UdpMonitor(QObject):
+    """
+    Worker thread for the WiFi/UDP link to the MCU. Announces the GCS with
+    keepalives, learns the MCU's address from its replies and signals every
+    valid packet to the GUI thread. Also keeps the MCU clock (self.clock),
+    synced once a second over the same socket, and retries commands until
+    the MCU acknowledges them.
+    """
+
+    packet_received = pyqtSignal(int, bytes)
+    # Command text, once the MCU has it or once every attempt went unanswered.
+    command_acked = pyqtSignal(str)
+    command_failed = pyqtSignal(str)
+
+    def __init__(self, port: int = UDP_PORT, mcu_address: str = BROADCAST_ADDRESS):
+        super().__init__()
+        self.port = port
+        self.default_address = mcu_address
+        self.mcu_address = None
+        self.last_packet_time = 0.0
+        self.bad_packets = 0
+        self._running = True
+        self._lock = threading.Lock()
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        self.socket.bind(("", port))
+        self.socket.settimeout(COMMAND_RETRY_INTERVAL)
+        try:
+            self.own_addresses = set(socket.gethostbyname_ex(socket.gethostname())[2])
+        except OSError:
+            self.own_addresses = set()
+        self.own_addresses.add("127.0.0.1")
+        self.clock = ClockSync()
+        # Random start, so the MCU's record of handled sequences from an
+        # earlier session does not swallow new commands.
+        self.command_sequence = random.getrandbits(16)
+        # sequence -> [text, last send time, attempts]
+        self.pending_commands = {}
+        self._pending_lock = threading.Lock()
+
+    def healthy(self) -> bool:
+        """
+        :return: True if the MCU was heard from within LINK_TIMEOUT.
+        """
+        return time.monotonic() - self.last_packet_time < LINK_TIMEOUT
+
+    def send(self, packet_type: int, payload: bytes = b"") -> bool:
+        """
+        Send one packet to the MCU (broadcast until it has answered).
+        :return: False if the socket refused it.
+        """
+        address = self.mcu_address if self.healthy() and self.mcu_address else self.default_address
+        try:
+            with self._lock:
+                self.socket.sendto(encode_packet(packet_type, payload), (address, self.port))
+        except OSError:
+            return False
+        return True
+
+    def send_command(self, text: str):
+        """
+        Send a command and keep resending it until the MCU ACKs it. Ends in
+        command_acked or command_failed.
+        :param text: "CMD:..." line without the newline.
+        """
+        with self._pending_lock:
+            sequence = self.command_sequence
+            self.command_sequence = (sequence + 1) & 0xFFFF
+            self.pending_commands[sequence] = [text, time.monotonic(), 1]
+        self._send_command(sequence, text)
+
+    def _send_command(self, sequence: int, text: str):
+        self.send(SERIAL_TRACED_COMMAND, struct.pack("<H", sequence) + text.encode())
+
+    def _retry_commands(self, now: float):
+        """
+        Resend unacknowledged commands; give up after COMMAND_ATTEMPTS.
+        """
+        retries = []
+        with self._pending_lock:
+            for sequence, pending in list(self.pending_commands.items()):
+                text, sent, attempts = pending
+                if now - sent < COMMAND_RETRY_INTERVAL:
+                    continue
+                if attempts >= COMMAND_ATTEMPTS:
+                    del self.pending_commands[sequence]
+                    self.command_failed.emit(text)
+                    continue
+                pending[1] = now
+                pending[2] = attempts + 1
+                retries.append((sequence, text))
+        for sequence, text in retries:
+            self._send_command(sequence, text)
+
+    def run(self):
+        last_keepalive = 0.0
+        last_time_request = 0.0
+        while self._running:
+            now = time.monotonic()
+            self._retry_commands(now)
+            if now - last_keepalive >= KEEPALIVE_INTERVAL:
+                self.send(SERIAL_KEEPALIVE)
+                last_keepalive = now
+            if self.healthy() and now - last_time_request >= CLOCK_SYNC_INTERVAL:
+                self.send(SERIAL_TIME_REQUEST, struct.pack("<I", now_us()))
+                last_time_request = now
+
+            try:
+                datagram, (address, _) = self.socket.recvfrom(2048)
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+            receive_us = now_us()
+
+            try:
+                packet_type, payload = decode_packet(datagram)
+            except ValueError:
+                self.bad_packets += 1
+                continue
+            # Our own broadcast keepalives loop back.
+            if address in self.own_addresses:
+                continue
+
+            self.mcu_address = address
+            self.last_packet_time = time.monotonic()
+            if packet_type == SERIAL_TIME_REPLY and len(payload) == 12:
+                self.clock.add(*struct.unpack("<III", payload), receive_us)
+            elif packet_type == SERIAL_COMMAND_ACK and len(payload) == 2:
+                with self._pending_lock:
+                    pending = self.pending_commands.pop(struct.unpack("<H", payload)[0], None)
+                if pending:
+                    self.command_acked.emit(pending[0])
+            elif packet_type != SERIAL_KEEPALIVE:
+                self.packet_received.emit(packet_type, payload)
+
+    def stop(self):
+        self._running = False
+        self.socket.close()
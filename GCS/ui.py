@@ -1,6 +1,8 @@
 import time
 from enum import Enum
 
+import numpy as np
+
 from PyQt6.QtCore import Qt
 
 from PyQt6.QtWidgets import (
@@ -13,7 +15,9 @@ from PyQt6.QtWidgets import (
     QHBoxLayout,
     QFrame,
 )
-from pyqtgraph import PlotWidget
+from pyqtgraph import PlotWidget, mkPen
+
+from latency import STAGES, CommandLatency
 
 
 class QHLine(QFrame):
@@ -251,6 +255,24 @@ class PressureGraph(PlotWidget):
         self.fuel_curve.setData(self.time, self.psi_fuel_data)
         self.ox_curve.setData(self.time, self.psi_ox_data)
 
+    def update_many(self, samples: list[tuple[int, list[float]]]) -> None:
+        """
+        Append a block of full-rate samples and redraw once.
+        :param samples: (timestamp_us, [fuel, ox, ...]) per scan, oldest first.
+        """
+        if not samples:
+            return
+        # The newest scan is "now"; earlier ones keep their MCU spacing.
+        current_time = time.time() - self.start_time
+        last_us = samples[-1][0]
+        for timestamp_us, values in samples:
+            self.time.append(current_time - ((last_us - timestamp_us) & 0xFFFFFFFF) / 1e6)
+            self.psi_fuel_data.append(values[0])
+            self.psi_ox_data.append(values[1] if len(values) > 1 else 0)
+
+        self.fuel_curve.setData(self.time, self.psi_fuel_data)
+        self.ox_curve.setData(self.time, self.psi_ox_data)
+
 
 class ThrustGraph(PlotWidget):
     def __init__(self, parent=None):
@@ -279,3 +301,51 @@ class ThrustGraph(PlotWidget):
         self.time.append(current_time)
         self.load_data.append(load_data)
         self.plot(self.time, self.load_data, name="Thrust (N)", pen="g")
+
+
+class LatencyHistogram(PlotWidget):
+    """
+    Per-stage command latency, one step curve per stage on log-spaced bins.
+    """
+
+    BINS_MS = np.logspace(-2, 4, 61)  # 10 us to 10 s.
+    COLORS = ("w", "r", "y", "c", "b", "m", "g")
+
+    def __init__(self, parent=None):
+        super().__init__(parent)
+        self.setTitle("Command Latency")
+        self.setLabel("left", "Commands")
+        self.setLabel("bottom", "Latency (ms)")
+        self.setLogMode(x=True, y=False)
+        self.setStyleSheet(
+            """
+            color: white;
+            border: 1px solid #373838;
+            """
+        )
+        self.legend = self.addLegend(offset=(1, -1), labelTextSize="7pt")
+        self.samples = {stage: [] for stage in STAGES + ("total",)}
+        self.curves = {
+            stage: self.plot(name=stage, pen=mkPen(color, width=1 + (stage == "total")), stepMode="center")
+            for stage, color in zip(self.samples, self.COLORS + ("#ff8800",))
+        }
+
+    def reset(self) -> None:
+        for values in self.samples.values():
+            values.clear()
+        self.update_curves()
+
+    def update(self, latency: CommandLatency) -> None:
+        for stage, value in latency.stages().items():
+            if value is not None:
+                self.samples[stage].append(value / 1000)
+        total = latency.total()
+        if total is not None:
+            self.samples["total"].append(total / 1000)
+        self.update_curves()
+
+    def update_curves(self) -> None:
+        for stage, values in self.samples.items():
+            # Out-of-range values land in the end bins rather than vanishing.
+            counts, _ = np.histogram(np.clip(values, self.BINS_MS[0], self.BINS_MS[-1]), self.BINS_MS)
+            self.curves[stage].setData(self.BINS_MS, counts)
@@ -10,16 +10,28 @@
  */
 
 #include <Arduino.h>
+#include <command_trace.h>
+#include <command_window.h>
 #include <heltec_unofficial.h>
+#include <profiler.h>
+#include <radio_link.h>
+#include <radio_packet.h>
+#include <telemetry_batch.h>
+#include <telemetry_frame.h>
+#include <uart_link.h>
 
 // Function headers.
 void sendCommand(String);
-void transmit(String);
-void processPacket(String packet);
-
-// Radio packet header.
-constexpr const char *PACKET_ID = "DC=";
-constexpr const int PACKET_ID_LENGTH = 3;
+void forwardCommand(const char *text, uint16_t sequence);
+void on_radio_transmit(const uint8_t *data, size_t length, uint32_t start_us);
+void report_latency(const CommandTiming &timing);
+void transmit(String, TxPriority, uint32_t delay_ms = 0);
+void read_mcu_link();
+void queue_telemetry(const TelemetryFrame &frame);
+void flush_telemetry();
+void processPacket(String packet, uint32_t arrival_us);
+void heard_home();
+void read_usb_serial();
 
 // Reception.
 unsigned long last_reception_time = 0; // Last reception time.
@@ -27,30 +39,61 @@ const unsigned long ping_timer = 8000; // Ping timer (how long to wait before cl
 
 bool idle = false;
 
-// Radio interrupt flag.
-static volatile bool received_flag;
-bool transmitting = false;
+// Serial2 wire to the MCU: COBS/CRC packets (telemetry, logs, commands). The
+// MCU leads baud negotiation; this end follows.
+#define MCU_LINK_RX_PIN 19
+#define MCU_LINK_TX_PIN 20
+UartLink mcu_link(UART_NUM_2, UART_LINK_FOLLOWER);
 
-/**
- * @brief Stupid function that's needed. radio.available() should work.
- *
- */
-void set_flag(void)
+// Telemetry batching. Frames are collected and sent as one delta-encoded
+// packet at the start of every TDMA downlink slot, sized to fit it. One slot
+// carries one batch, fewer frames than the MCU's 20 Hz at STANDBY, so each
+// batch holds the newest frames that fit and replaces one still waiting in
+// the TX queue. Telemetry is thinned to what the link carries, never delayed.
+TelemetryBatchEncoder telemetry_batch;
+TelemetryFrame telemetry_frames[TELEMETRY_BATCH_MAX_FRAMES]; // Oldest first.
+size_t telemetry_count = 0;
+TdmaSlot last_slot = TDMA_SLOT_BEACON;
+
+// PHY profile Home last switched us to (see phy_profile.h).
+PhyProfileId last_profile = PHY_STANDBY;
+
+// Whether mcu_link has the MCU clock; radio_link passes it on to Home.
+bool mcu_clock_synced = false;
+
+// Numbered radio commands: duplicates dropped, delivered to the MCU in order,
+// acknowledged selectively (see command_window.h). Every telemetry batch
+// repeats the latest ACK, so standalone ACKs are only sent once.
+CommandReceiver command_receiver;
+
+// Latency tracing (command_trace.h): when each command arrived, when its ACK
+// went on air and when it was written to the MCU, by sequence.
+struct CommandTrace
 {
-    if (transmitting)
-    {
-        transmitting = false;
-        return;
-    }
-    received_flag = true;
-}
+    bool active;
+    uint16_t sequence;
+    uint32_t rx_us;
+    uint32_t ack_tx_us;
+    uint32_t forward_us;
+};
+CommandTrace command_traces[COMMAND_TRACE_SLOTS];
+
+// Non-blocking radio with a priority TX queue.
+RadioLink radio_link(radio);
+
+// Timing of loop(), the radio and the MCU link (profiler.h), printed on "STATS"
+// over USB serial; "STATS_RESET" clears it.
+ProfileSection profile_loop("loop");
+char usb_line[32];
+size_t usb_fill = 0;
 
 void setup()
 {
     heltec_setup(); // Brings up serial at 115200 bps and powers on display.
 
-    // Wired Serial setup. RX: 19. TX: 20.
-    Serial2.begin(115200, SERIAL_8N1, 19, 20);
+    // Wired link to the MCU. Never blocks loop().
+    if (!mcu_link.begin(MCU_LINK_RX_PIN, MCU_LINK_TX_PIN))
+        Serial.println(F("MCU UART link failed to start."));
 
     // Initialize Radio (SX1262) with default settings.
     Serial.print(F("[SX1262] Initializing ... "));
@@ -74,49 +117,69 @@ void setup()
         }
     }
 
-    // Initializing callback.
-    radio.setPacketReceivedAction(set_flag);
-
-    // Non-blocking. Will automatically fill packet if received. Overwrites
-    // buffer each packet.
-    radio.startReceive();
+    // Non-blocking. The radio task copies every packet into the RX queue as
+    // soon as it arrives. Transmits only in Away's TDMA slots, once a beacon
+    // has been heard.
+    radio_link.begin(TDMA_AWAY);
+    radio_link.on_transmit(on_radio_transmit);
+    telemetry_batch.set_max_bytes(radio_link.slot_capacity(TDMA_SLOT_DOWNLINK));
 }
 
 void loop()
 {
+    ProfileScope scope(profile_loop);
     heltec_loop(); // Must be called to scan the button, hanmdle sleep, etc.
 
     unsigned long now = millis();
 
-    // If there's a packet in the buffer.
-    if (received_flag)
+    // Finishes/starts transmissions.
+    radio_link.service();
+
+    // Drains packets queued by the radio task since the last iteration.
+    RxPacket packet;
+    while (radio_link.receive(packet))
     {
-        received_flag = false;
-        Serial.println("Radio is available.");
-        String data;
-        int state = radio.readData(data);
-        Serial.println("Data: " + data);
-        if (state == RADIOLIB_ERR_NONE)
-            processPacket(data);
-        else
+        // Home's beacon (already used by radio_link for timing); it also
+        // counts as hearing from Home.
+        if (tdma_beacon_valid(packet.data, packet.length))
         {
-            Serial.print(F("Failed to read data from radio buffer, code "));
-            Serial.println(state);
+            heard_home();
+            continue;
         }
+
+        // RxPacket data is NUL-terminated.
+        String data = String((const char *)packet.data);
+        Serial.println("Data: " + data);
+        processPacket(data, packet.arrival_us);
     }
 
-    // Checks for telemetry.
-    if (Serial2.available())
+    // Home switches profiles; radio_link falls back to standby on its own.
+    if (radio_link.profile() != last_profile)
     {
-        String message = Serial2.readStringUntil('\n');
+        last_profile = radio_link.profile();
+        Serial.println("PHY " + String(PHY_PROFILES[last_profile].name) + ".");
+    }
 
-        // If it's telemetry, transmit.
-        if (message.startsWith("T"))
-        {
-            Serial.println("Telemetry received: " + message);
-            transmit(message);
-        }
+    // Checks for telemetry.
+    read_mcu_link();
+    read_usb_serial();
+
+    // Hands the current MCU offset to radio_link for the next TimeSyncFrame.
+    ClockSync mcu_clock = mcu_link.clock();
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    radio_link.set_reference(mcu_clock.offset_us(now_us), mcu_clock.synced());
+    if (mcu_clock.synced() != mcu_clock_synced)
+    {
+        mcu_clock_synced = mcu_clock.synced();
+        if (mcu_clock_synced)
+            Serial.println("Synced to MCU clock (delay " + String(mcu_clock.delay_us()) + " us).");
+        else
+            Serial.println("Lost MCU clock.");
     }
+    TdmaSlot slot = radio_link.slot();
+    if (slot == TDMA_SLOT_DOWNLINK && last_slot != TDMA_SLOT_DOWNLINK)
+        flush_telemetry();
+    last_slot = slot;
 
     now = millis();
     // If nothing has been heard for 3+ seconds, close valves.
@@ -135,49 +198,69 @@ void loop()
  * @brief Called after receiving a packet.
  *
  * @param packet
+ * @param arrival_us RX-done time, for latency tracing.
  */
-void processPacket(String packet)
+void processPacket(String packet, uint32_t arrival_us)
 {
     // If it's not our packet, return.
-    if (!packet.startsWith(PACKET_ID))
+    const char *message;
+    size_t length;
+    RadioPacketStatus status = radio_packet_message(packet.c_str(), message, length);
+    if (status == RADIO_PACKET_FOREIGN)
         return;
 
-    last_reception_time = millis();
-    String message = packet.substring(PACKET_ID_LENGTH);
-
-    // Finds index of first '\n' (expected last for one packet).
-    int newline_index = message.indexOf('\n', 0);
-    if (newline_index == -1) // Continues to next packet if newline exists.
+    heard_home();
+    if (status == RADIO_PACKET_UNTERMINATED)
     {
         Serial.println("Packet did not contain newline.");
         return;
     }
 
-    // Crops newline character.
-    message = message.substring(0, newline_index);
-
-    // If CMD message (requires ACK).
-    if (message.startsWith("CMD:"))
+    // If CMD message (requires ACK): CMD:V1:OPEN#<sequence>:<base>:<session>.
+    if (strncmp(message, "CMD:", 4) == 0)
     {
-        int id_index = message.indexOf('#');
-        int packet_count = (message.substring(id_index + 1)).toInt();
-        // Crops header and #. CMD:V1:OPEN_ALL#5 -> V1:OPEN_ALL
-        String command = message.substring(0, id_index);
-        sendCommand(command);
+        // Crops the sequence numbers. CMD:V1:OPEN#5:4:77 -> CMD:V1:OPEN
+        RadioCommand command;
+        if (!radio_packet_parse_command(message, length, command))
+        {
+            Serial.println("Malformed command: " + String(message).substring(0, length));
+            return;
+        }
         idle = false;
 
-        String acknowledgement = "ACK:#" + String(packet_count) + '\n';
+        uint16_t sequence = command.sequence;
+        CommandVerdict verdict = command_receiver.receive(sequence, command.base, command.session, command.text);
+        if (verdict == COMMAND_DUPLICATE)
+            Serial.println("Duplicate #" + String(sequence) + ", re-acknowledging.");
+        else if (verdict == COMMAND_REJECTED)
+            Serial.println("Command #" + String(sequence) + " outside the window, dropped.");
+        if (verdict == COMMAND_ACCEPTED || verdict == COMMAND_URGENT)
+            command_traces[sequence % COMMAND_TRACE_SLOTS] = {true, sequence, arrival_us, 0, 0};
+        // Aborts do not wait for earlier commands to fill in.
+        if (verdict == COMMAND_URGENT)
+            forwardCommand(command.text, sequence);
+
+        // Forwards every command that is now in order.
+        char text[COMMAND_TEXT_MAX];
+        uint16_t in_order;
+        while (command_receiver.pop(text, &in_order))
+            forwardCommand(text, in_order);
 
-        // Transmit acknowledgement 3 times.
-        transmit(acknowledgement);
-        delay(200);
-        transmit(acknowledgement);
-        delay(200);
-        transmit(acknowledgement);
-        delay(200);
+        CommandAck ack = command_receiver.ack();
+        transmit("ACK:#" + String(ack.cumulative) + ":" + String(ack.mask), TX_PRIORITY_CONTROL);
     }
 }
 
+/**
+ * @brief Resets the link-loss timer and tells the MCU, whose deadman
+ * (MCU/src/deadman.h) safes the stand on its own if these stop.
+ */
+void heard_home()
+{
+    last_reception_time = millis();
+    mcu_link.send(SERIAL_HEARTBEAT, NULL, 0);
+}
+
 /**
  * @brief Writes commands to MCU.
  *
@@ -185,39 +268,182 @@ void processPacket(String packet)
  */
 void sendCommand(String command)
 {
-    // Writes and adds a newline. NOTE: Serial2 is wired TX/RX.
-    Serial2.println(command);
-    Serial.println("Wrote " + command + " to serial2.");
+    // One CRC-checked packet; the MCU drops it if it arrives corrupted.
+    if (mcu_link.send_text(SERIAL_COMMAND, command.c_str()))
+        Serial.println("Wrote " + command + " to MCU.");
+    else
+        Serial.println("Failed to write " + command + " to MCU.");
 }
 
 /**
- * @brief Transmits radio message.
+ * @brief Writes a radio command to the MCU, tagged with its sequence number
+ * so the MCU's CommandTiming can be matched to it.
  *
- * @param message
+ * @param text
+ * @param sequence
  */
-void transmit(String message)
+void forwardCommand(const char *text, uint16_t sequence)
 {
-    String packet = PACKET_ID + message + '\n';
-
-    transmitting = true;
-
-    int state = radio.transmit(packet);
-    if (state == RADIOLIB_ERR_NONE)
+    uint8_t payload[sizeof(sequence) + COMMAND_TEXT_MAX];
+    size_t length = strlen(text);
+    memcpy(payload, &sequence, sizeof(sequence));
+    memcpy(payload + sizeof(sequence), text, length);
+    if (!mcu_link.send(SERIAL_TRACED_COMMAND, payload, sizeof(sequence) + length))
     {
-        Serial.println("Successfully transmitted " + packet);
+        Serial.println("Failed to write " + String(text) + " to MCU.");
+        return;
     }
-    else if (state == RADIOLIB_ERR_PACKET_TOO_LONG)
+    Serial.println("Wrote " + String(text) + " to MCU.");
+
+    CommandTrace &trace = command_traces[sequence % COMMAND_TRACE_SLOTS];
+    if (trace.active && trace.sequence == sequence)
+        trace.forward_us = (uint32_t)esp_timer_get_time();
+}
+
+/**
+ * @brief radio_link hook: the first ACK on air after a command marks the end
+ * of Away's hold time.
+ *
+ * @param data
+ * @param length
+ * @param start_us
+ */
+void on_radio_transmit(const uint8_t *data, size_t length, uint32_t start_us)
+{
+    const char *ack = "DC=ACK:#";
+    if (length < strlen(ack) || memcmp(data, ack, strlen(ack)) != 0)
+        return;
+    for (CommandTrace &trace : command_traces)
+        if (trace.active && trace.ack_tx_us == 0)
+            trace.ack_tx_us = start_us;
+}
+
+/**
+ * @brief The MCU has run a traced command: sends the extended ACK with every
+ * stage Away knows.
+ *
+ * @param timing
+ */
+void report_latency(const CommandTiming &timing)
+{
+    CommandTrace &trace = command_traces[timing.trace % COMMAND_TRACE_SLOTS];
+    if (!trace.active || trace.sequence != timing.trace || trace.forward_us == 0)
+        return;
+    trace.active = false;
+
+    // Serial2 round trip minus the MCU's own time, halved.
+    uint32_t serial_us = (uint32_t)esp_timer_get_time() - trace.forward_us;
+    uint32_t mcu_us = timing.queue_us + timing.execute_us + timing.confirm_us;
+    uint32_t uart_us = serial_us > mcu_us ? (serial_us - mcu_us) / 2 : 0;
+    long hold_us = trace.ack_tx_us ? (long)(trace.ack_tx_us - trace.rx_us) : -1;
+
+    char message[128];
+    CommandAck ack = command_receiver.ack();
+    snprintf(message, sizeof(message), "ACK:#%u:%u:LAT:%u:%ld:%lu:%lu:%lu:%lu:%lu:%u", ack.cumulative, ack.mask,
+             timing.trace, hold_us, (unsigned long)(trace.forward_us - trace.rx_us), (unsigned long)uart_us,
+             (unsigned long)timing.queue_us, (unsigned long)timing.execute_us, (unsigned long)timing.confirm_us,
+             timing.telemetry_sequence);
+    transmit(message, TX_PRIORITY_CONTROL);
+}
+
+/**
+ * @brief Drains packets the link task has already received and CRC-checked.
+ * Valid telemetry frames are forwarded over the radio as-is.
+ *
+ */
+void read_mcu_link()
+{
+    SerialPacket packet;
+    while (mcu_link.receive(packet))
     {
-        // the supplied packet was longer than 256 bytes
-        Serial.println(F("Packet too long!"));
+        if (packet.type == SERIAL_TELEMETRY)
+        {
+            if (telemetry_frame_valid(packet.payload, packet.length))
+                queue_telemetry(*(const TelemetryFrame *)packet.payload);
+            else
+                Serial.println("Telemetry frame failed CRC.");
+        }
+        else if (packet.type == SERIAL_LOG)
+        {
+            Serial.print("MCU: ");
+            Serial.println((const char *)packet.payload);
+        }
+        else if (packet.type == SERIAL_COMMAND_RESULT && packet.length == sizeof(CommandTiming))
+        {
+            CommandTiming timing;
+            memcpy(&timing, packet.payload, sizeof(timing));
+            report_latency(timing);
+        }
     }
-    else
+}
+
+/**
+ * @brief Bench commands over USB serial, assembled without blocking.
+ *
+ */
+void read_usb_serial()
+{
+    while (Serial.available())
     {
-        // some other error occurred
-        Serial.print(F("Failed transmission, code "));
-        Serial.println(state);
+        char c = Serial.read();
+        if (c != '\n')
+        {
+            if (usb_fill < sizeof(usb_line) - 1)
+                usb_line[usb_fill++] = c;
+            continue;
+        }
+        usb_line[usb_fill] = '\0';
+        usb_fill = 0;
+
+        String message = String(usb_line);
+        message.trim();
+        if (message == "STATS")
+            profiler_print(Serial);
+        else if (message == "STATS_RESET")
+            profiler_reset_all();
     }
+}
+
+/**
+ * @brief Keeps a frame for the next batch, dropping the oldest if more
+ * arrived than any batch could carry.
+ *
+ * @param frame
+ */
+void queue_telemetry(const TelemetryFrame &frame)
+{
+    if (telemetry_count == TELEMETRY_BATCH_MAX_FRAMES)
+        memmove(telemetry_frames, telemetry_frames + 1, --telemetry_count * sizeof(TelemetryFrame));
+    telemetry_frames[telemetry_count++] = frame;
+}
 
-    // Begin receiving again. NOTE: DO NOT REMOVE.
-    radio.startReceive();
-}
\ No newline at end of file
+/**
+ * @brief Transmits the newest frames that fit the downlink slot, in place of
+ * a batch still waiting. Older frames are dropped.
+ *
+ */
+void flush_telemetry()
+{
+    // The schedule comes from Home's beacon and may have changed.
+    telemetry_batch.set_max_bytes(radio_link.slot_capacity(TDMA_SLOT_DOWNLINK));
+    telemetry_batch.add_latest(telemetry_frames, telemetry_count);
+    telemetry_count = 0;
+
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = telemetry_batch.finish(packet, command_receiver.ack());
+    if (length > 0)
+        radio_link.send_latest(packet, length, TX_PRIORITY_TELEMETRY);
+}
+
+/**
+ * @brief Queues a radio message. Returns immediately.
+ *
+ * @param message
+ * @param priority
+ * @param delay_ms Earliest send time, relative to now.
+ */
+void transmit(String message, TxPriority priority, uint32_t delay_ms)
+{
+    String packet = RADIO_PACKET_ID + message + '\n';
+    radio_link.send(packet, priority, delay_ms);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file test_command_receiver.cpp
+ * @brief Away's side of the command window: duplicate suppression, in-order
+ * delivery and resynchronisation.
+ */
+#include <command_window.h>
+#include <unity.h>
+
+static CommandReceiver receiver;
+static char text[COMMAND_TEXT_MAX];
+
+void setUp()
+{
+    receiver = CommandReceiver();
+}
+
+void tearDown()
+{
+}
+
+void test_delivers_in_order()
+{
+    TEST_ASSERT_FALSE(receiver.ack().valid);
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(500, 500, 1, "CMD:V1:OPEN"));
+    uint16_t sequence;
+    TEST_ASSERT_TRUE(receiver.pop(text, &sequence));
+    TEST_ASSERT_EQUAL_STRING("CMD:V1:OPEN", text);
+    TEST_ASSERT_EQUAL_UINT32(500, sequence);
+    TEST_ASSERT_FALSE(receiver.pop(text));
+
+    CommandAck ack = receiver.ack();
+    TEST_ASSERT_TRUE(ack.valid);
+    TEST_ASSERT_EQUAL_UINT32(500, ack.cumulative);
+    TEST_ASSERT_EQUAL_UINT32(0, ack.mask);
+}
+
+void test_holds_out_of_order_until_gap_fills()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    receiver.pop(text);
+
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(502, 501, 1, "CMD:V1:CLOSE"));
+    TEST_ASSERT_FALSE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_UINT32(500, receiver.ack().cumulative);
+    TEST_ASSERT_EQUAL_HEX16(0x2, receiver.ack().mask);
+
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(501, 501, 1, "CMD:V2:OPEN"));
+    TEST_ASSERT_TRUE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_STRING("CMD:V2:OPEN", text);
+    TEST_ASSERT_TRUE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_STRING("CMD:V1:CLOSE", text);
+    TEST_ASSERT_EQUAL_UINT32(502, receiver.ack().cumulative);
+}
+
+void test_delivers_aborts_at_once()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    receiver.pop(text);
+
+    // 501..504 still on the way; the abort beyond the ordinary window does
+    // not wait for them.
+    TEST_ASSERT_EQUAL_INT(COMMAND_URGENT, receiver.receive(505, 501, 1, "CMD:CLOSE_ALL"));
+    TEST_ASSERT_EQUAL_INT(COMMAND_DUPLICATE, receiver.receive(505, 501, 1, "CMD:CLOSE_ALL"));
+    TEST_ASSERT_FALSE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_HEX16(0x10, receiver.ack().mask);
+
+    // In-order delivery skips it once the gap fills.
+    for (uint16_t sequence = 501; sequence <= 504; sequence++)
+        receiver.receive(sequence, 501, 1, "CMD:V2:OPEN");
+    uint16_t sequence;
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(receiver.pop(text, &sequence));
+    TEST_ASSERT_EQUAL_UINT32(504, sequence);
+    TEST_ASSERT_FALSE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_UINT32(505, receiver.ack().cumulative);
+    TEST_ASSERT_EQUAL_HEX16(0, receiver.ack().mask);
+}
+
+void test_suppresses_duplicates()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    // Retransmit of a held command, then of a delivered one.
+    TEST_ASSERT_EQUAL_INT(COMMAND_DUPLICATE, receiver.receive(500, 500, 1, "CMD:V1:OPEN"));
+    receiver.pop(text);
+    TEST_ASSERT_EQUAL_INT(COMMAND_DUPLICATE, receiver.receive(500, 500, 1, "CMD:V1:OPEN"));
+    TEST_ASSERT_FALSE(receiver.pop(text));
+}
+
+void test_rejects_outside_window_and_long_text()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    TEST_ASSERT_EQUAL_INT(COMMAND_REJECTED, receiver.receive(500 + COMMAND_WINDOW, 500, 1, "CMD:V1:CLOSE"));
+
+    char long_text[COMMAND_TEXT_MAX + 1];
+    memset(long_text, 'A', COMMAND_TEXT_MAX);
+    long_text[COMMAND_TEXT_MAX] = '\0';
+    TEST_ASSERT_EQUAL_INT(COMMAND_REJECTED, receiver.receive(501, 500, 1, long_text));
+}
+
+void test_resyncs_on_new_session()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    receiver.pop(text);
+
+    // Home rebooted and drew a new session and start sequence.
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(20, 20, 2, "CMD:V2:OPEN"));
+    TEST_ASSERT_TRUE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_STRING("CMD:V2:OPEN", text);
+    TEST_ASSERT_EQUAL_UINT32(20, receiver.ack().cumulative);
+}
+
+void test_resyncs_when_base_passes_delivered()
+{
+    receiver.receive(500, 500, 1, "CMD:V1:OPEN");
+    receiver.pop(text);
+
+    // Home gave up on 501..509: its base moved past anything delivered.
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(510, 510, 1, "CMD:V1:CLOSE"));
+    TEST_ASSERT_TRUE(receiver.pop(text));
+    TEST_ASSERT_EQUAL_STRING("CMD:V1:CLOSE", text);
+}
+
+void test_sequence_wraps()
+{
+    receiver.receive(65535, 65535, 1, "CMD:V1:OPEN");
+    TEST_ASSERT_EQUAL_INT(COMMAND_ACCEPTED, receiver.receive(0, 65535, 1, "CMD:V1:CLOSE"));
+    uint16_t sequence = 1;
+    receiver.pop(text, &sequence);
+    TEST_ASSERT_EQUAL_UINT32(65535, sequence);
+    receiver.pop(text, &sequence);
+    TEST_ASSERT_EQUAL_UINT32(0, sequence);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.ack().cumulative);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_delivers_in_order);
+    RUN_TEST(test_holds_out_of_order_until_gap_fills);
+    RUN_TEST(test_delivers_aborts_at_once);
+    RUN_TEST(test_suppresses_duplicates);
+    RUN_TEST(test_rejects_outside_window_and_long_text);
+    RUN_TEST(test_resyncs_on_new_session);
+    RUN_TEST(test_resyncs_when_base_passes_delivered);
+    RUN_TEST(test_sequence_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+/**
+ * @file test_telemetry_batch.cpp
+ * @brief Delta-encoded telemetry batches: round trips, gaps, size limits and
+ * corruption.
+ */
+#include <telemetry_batch.h>
+#include <unity.h>
+
+static TelemetryFrame frame_at(uint16_t sequence, uint32_t timestamp_us)
+{
+    TelemetryFrame frame = {};
+    frame.sequence = sequence;
+    frame.timestamp_us = timestamp_us;
+    frame.fuel_psi_x10 = 4000 + sequence % 17;
+    frame.ox_psi_x10 = -120 - sequence % 13;
+    frame.load_g = 12000 + sequence * 3;
+    frame.status = sequence % 5 == 0 ? STATUS_RECORDING | STATUS_FIRING : STATUS_RECORDING;
+    telemetry_frame_seal(frame);
+    return frame;
+}
+
+static void assert_frames_equal(const TelemetryFrame &expected, const TelemetryFrame &actual)
+{
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &actual, sizeof(TelemetryFrame));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_round_trip_with_ack()
+{
+    TelemetryBatchEncoder encoder;
+    TelemetryFrame frames[5];
+    for (uint16_t i = 0; i < 5; i++)
+    {
+        frames[i] = frame_at(100 + i, 1000000 + i * 50000);
+        TEST_ASSERT_TRUE(encoder.add(frames[i]));
+    }
+
+    CommandAck ack = {true, 1234, 0x5};
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = encoder.finish(packet, ack);
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TELEMETRY_BATCH, packet[0]);
+    // Steady rate: far smaller than five full frames.
+    TEST_ASSERT_TRUE(length < 5 * sizeof(TelemetryFrame));
+    TEST_ASSERT_EQUAL_size_t(0, encoder.count());
+
+    TelemetryFrame decoded[TELEMETRY_BATCH_MAX_FRAMES];
+    CommandAck decoded_ack = {};
+    TEST_ASSERT_EQUAL_size_t(5, telemetry_batch_decode(packet, length, decoded, TELEMETRY_BATCH_MAX_FRAMES, &decoded_ack));
+    for (size_t i = 0; i < 5; i++)
+        assert_frames_equal(frames[i], decoded[i]);
+    TEST_ASSERT_TRUE(decoded_ack.valid);
+    TEST_ASSERT_EQUAL_UINT32(1234, decoded_ack.cumulative);
+    TEST_ASSERT_EQUAL_UINT32(0x5, decoded_ack.mask);
+}
+
+void test_round_trip_with_gaps_and_jitter()
+{
+    // Skipped sequences, uneven intervals, a wrap and large jumps.
+    TelemetryFrame frames[] = {
+        frame_at(65530, 4294000000u), frame_at(65533, 4294049000u), frame_at(2, 4294100500u),
+        frame_at(3, 205000u),         frame_at(3000, 999000000u),
+    };
+    frames[2].load_g = -2000000;
+    frames[3].fuel_psi_x10 = -32768;
+    telemetry_frame_seal(frames[2]);
+    telemetry_frame_seal(frames[3]);
+
+    TelemetryBatchEncoder encoder;
+    size_t count = sizeof(frames) / sizeof(frames[0]);
+    for (size_t i = 0; i < count; i++)
+        TEST_ASSERT_TRUE(encoder.add(frames[i]));
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = encoder.finish(packet);
+
+    TelemetryFrame decoded[TELEMETRY_BATCH_MAX_FRAMES];
+    CommandAck ack = {true, 1, 1};
+    TEST_ASSERT_EQUAL_size_t(count, telemetry_batch_decode(packet, length, decoded, TELEMETRY_BATCH_MAX_FRAMES, &ack));
+    for (size_t i = 0; i < count; i++)
+        assert_frames_equal(frames[i], decoded[i]);
+    TEST_ASSERT_FALSE(ack.valid);
+}
+
+void test_respects_max_bytes()
+{
+    TelemetryBatchEncoder encoder(64);
+    uint16_t added = 0;
+    while (encoder.add(frame_at(added, added * 50000u)))
+        added++;
+    TEST_ASSERT_TRUE(added > 1);
+    TEST_ASSERT_TRUE(encoder.size() <= 64);
+
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = encoder.finish(packet);
+    TEST_ASSERT_TRUE(length <= 64);
+    TelemetryFrame decoded[TELEMETRY_BATCH_MAX_FRAMES];
+    TEST_ASSERT_EQUAL_size_t(added, telemetry_batch_decode(packet, length, decoded, TELEMETRY_BATCH_MAX_FRAMES));
+}
+
+void test_full_packet_stays_in_limits()
+{
+    TelemetryBatchEncoder encoder;
+    uint16_t added = 0;
+    while (encoder.add(frame_at(added, added * 50000u)))
+        added++;
+    TEST_ASSERT_TRUE(added <= TELEMETRY_BATCH_MAX_FRAMES);
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    TEST_ASSERT_TRUE(encoder.finish(packet) <= TELEMETRY_BATCH_MAX_BYTES);
+}
+
+void test_add_latest_keeps_the_newest()
+{
+    TelemetryFrame frames[TELEMETRY_BATCH_MAX_FRAMES];
+    for (uint16_t i = 0; i < TELEMETRY_BATCH_MAX_FRAMES; i++)
+        frames[i] = frame_at(100 + i, i * 50000u);
+
+    TelemetryBatchEncoder encoder(64);
+    size_t added = encoder.add_latest(frames, TELEMETRY_BATCH_MAX_FRAMES);
+    TEST_ASSERT_TRUE(added > 1 && added < TELEMETRY_BATCH_MAX_FRAMES);
+
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = encoder.finish(packet);
+    TEST_ASSERT_TRUE(length <= 64);
+    TelemetryFrame decoded[TELEMETRY_BATCH_MAX_FRAMES];
+    TEST_ASSERT_EQUAL_size_t(added, telemetry_batch_decode(packet, length, decoded, TELEMETRY_BATCH_MAX_FRAMES));
+    assert_frames_equal(frames[TELEMETRY_BATCH_MAX_FRAMES - 1], decoded[added - 1]);
+    assert_frames_equal(frames[TELEMETRY_BATCH_MAX_FRAMES - added], decoded[0]);
+
+    // All of them when they fit.
+    TEST_ASSERT_EQUAL_size_t(3, encoder.add_latest(frames, 3));
+}
+
+void test_empty_batch_finishes_to_nothing()
+{
+    TelemetryBatchEncoder encoder;
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    TEST_ASSERT_EQUAL_size_t(0, encoder.finish(packet));
+}
+
+void test_rejects_corruption_and_short_output()
+{
+    TelemetryBatchEncoder encoder;
+    for (uint16_t i = 0; i < 8; i++)
+        encoder.add(frame_at(i, i * 50000u));
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = encoder.finish(packet);
+
+    TelemetryFrame decoded[TELEMETRY_BATCH_MAX_FRAMES];
+    for (size_t byte = 0; byte < length; byte++)
+    {
+        packet[byte] ^= 0x10;
+        TEST_ASSERT_EQUAL_size_t(0, telemetry_batch_decode(packet, length, decoded, TELEMETRY_BATCH_MAX_FRAMES));
+        packet[byte] ^= 0x10;
+    }
+    TEST_ASSERT_EQUAL_size_t(0, telemetry_batch_decode(packet, length - 1, decoded, TELEMETRY_BATCH_MAX_FRAMES));
+    TEST_ASSERT_EQUAL_size_t(0, telemetry_batch_decode(packet, length, decoded, 4));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_with_ack);
+    RUN_TEST(test_round_trip_with_gaps_and_jitter);
+    RUN_TEST(test_respects_max_bytes);
+    RUN_TEST(test_full_packet_stays_in_limits);
+    RUN_TEST(test_add_latest_keeps_the_newest);
+    RUN_TEST(test_empty_batch_finishes_to_nothing);
+    RUN_TEST(test_rejects_corruption_and_short_output);
+    return UNITY_END();
+}
@@ -11,7 +11,15 @@
 
 #include <Arduino.h>
 // #include <RadioLib.h>
+#include <command_trace.h>
+#include <command_window.h>
 #include <heltec_unofficial.h>
+#include <profiler.h>
+#include <radio_link.h>
+#include <radio_packet.h>
+#include <telemetry_batch.h>
+#include <telemetry_frame.h>
+#include <telemetry_stats.h>
 // https://registry.platformio.org/libraries/jgromes/RadioLib/examples/SX126x/SX126x_Transmit_Blocking/SX126x_Transmit_Blocking.ino
 // https://registry.platformio.org/libraries/ropg/Heltec_ESP32_LoRa_v3
 // https://registry.platformio.org/libraries/thingpulse/ESP8266%20and%20ESP32%20OLED%20driver%20for%20SSD1306%20displays/installation
@@ -19,47 +27,66 @@
 // https://github.com/HelTecAutomation/Heltec_ESP32
 
 // Function Headers
-void processPacket(String packet);
-String formatCommand(String command);
-void transmit(String packet);
+void processPacket(String packet, uint32_t arrival_us);
+void on_radio_transmit(const uint8_t *data, size_t length, uint32_t start_us);
+void report_latency(uint16_t sequence, const char *fields);
+void processFrame(const uint8_t *data, size_t length);
+void processBatch(const uint8_t *data, size_t length);
+String formatCommand(const OutgoingCommand &command);
+void transmit(String packet, TxPriority priority);
+TxPriority commandPriority(String command);
+void printSchedule();
+void printLinkStats(unsigned long elapsed_ms);
+void printClockStats();
+void answerTimeSync(const char *line, uint32_t receive_us);
 
-// Header for radio packets.
-constexpr const char *PACKET_ID = "DC=";
-constexpr const int PACKET_ID_LENGTH = 3;
+// Commands go out through a sliding window; each one is retransmitted on an
+// RTT-derived timeout until Away acknowledges it (see command_window.h).
+CommandSender command_sender;
 
-int packet_count = 0;
-bool transmitting = false;
-String current_command = "";
+// Latency tracing (command_trace.h). Each command's line time rides with it
+// in command_sender as its tag, since aborts overtake the queue.
+struct CommandTrace
+{
+    bool active;
+    bool retransmitted; // No radio leg (Karn).
+    uint16_t sequence;
+    uint32_t line_us;
+    uint32_t tx_us;
+    uint32_t ack_us;
+};
+CommandTrace command_traces[COMMAND_TRACE_SLOTS];
 
-// Transmission interval.
-unsigned long last_transmission_time = 0;        // Last transmission time.
-const unsigned long transmission_interval = 500; // Milliseconds.
+// Control panel input, assembled without blocking so beacons stay on time.
+char serial_line[128];
+size_t serial_fill = 0;
+bool serial_overflow = false; // The line in progress is too long; discard it.
 
-// Ping interval (automatic valve closure).
-const unsigned long ping_interval = 4000; // Milliseconds.
+// PHY profile: picked from the RSSI/SNR of Away's packets unless the control
+// panel pins one ("PHY:STANDBY", "PHY:BURN", "PHY:AUTO"). Requests are spaced
+// out so a declined or fallen-back switch is not retried every frame.
+PhySelector phy_selector;
+PhyProfileId phy_pinned = PHY_PROFILE_COUNT; // PHY_PROFILE_COUNT: automatic.
+PhyProfileId last_profile = PHY_STANDBY;
+unsigned long last_phy_request_time = 0;
+const unsigned long phy_request_interval = 10000; // Milliseconds.
 
 // Reception.
 unsigned long last_reception_time = 0;         // Last reception time.
 unsigned long last_heartbeat_message_time = 0; // Last heartbeat message.
 const unsigned long heartbeat_interval = 5000; // Milliseconds.
 
-// Radio interrupt flag.
-static volatile bool received_flag;
-bool transmitting_flag = false;
+// Delivered/lost/corrupted telemetry and signal quality, printed as "LNK:"
+// after every heartbeat.
+TelemetryStats telemetry_stats;
 
-/**
- * @brief Stupid function that we need. radio.available() should work. I love broken libraries.
- *
- */
-void set_flag(void)
-{
-    if (transmitting_flag)
-    {
-        transmitting_flag = false;
-        return;
-    }
-    received_flag = true;
-}
+// Timing of loop() and the radio (profiler.h): "STATS" prints it, "STATS_RESET"
+// clears it.
+ProfileSection profile_loop("loop");
+
+// Non-blocking radio with a priority TX queue. Home is the TDMA master: its
+// beacon every frame also keeps Away's valve-closing timer from firing.
+RadioLink radio_link(radio);
 
 void setup()
 {
@@ -87,45 +114,122 @@ void setup()
         }
     }
 
-    // Sets callback.
-    radio.setPacketReceivedAction(set_flag);
+    // Non-blocking. The radio task copies every packet into the RX queue as
+    // soon as it arrives.
+    radio_link.begin(TDMA_HOME);
+    radio_link.on_transmit(on_radio_transmit);
+    printSchedule();
 
-    // Non-blocking. Will automatically fill packet if received. Overwrites
-    // buffer each packet.
-    radio.startReceive();
+    // Random session and first sequence, so Away resynchronises after a reset.
+    command_sender.begin(esp_random(), esp_random());
+    command_sender.set_frame_ms(radio_link.schedule().frame_ms());
 }
 
 void loop()
 {
+    ProfileScope scope(profile_loop);
     heltec_loop(); // Must be called to scan the button, hanmdle sleep, etc.
 
     unsigned long now = millis();
 
-    // If there's a packet in the buffer.
-    if (received_flag)
+    // Finishes/starts transmissions.
+    radio_link.service();
+
+    // Drains packets queued by the radio task since the last iteration.
+    RxPacket packet;
+    while (radio_link.receive(packet))
     {
-        received_flag = false;
-        String data;
-        int state = radio.readData(data);
-        if (state == RADIOLIB_ERR_NONE)
-            processPacket(data);
+        // Another master's beacon; nothing for the control panel.
+        if (tdma_beacon_valid(packet.data, packet.length))
+            continue;
+
+        phy_selector.sample(packet.rssi, packet.snr);
+        telemetry_stats.signal(packet.rssi, packet.snr);
+        // Away's PHY handshake/keepalive and time sync, already handled by
+        // radio_link.
+        if (phy_ack_valid(packet.data, packet.length) || time_sync_frame_valid(packet.data, packet.length))
+            continue;
+
+        // Packets may be binary (telemetry frames), so check bytes first.
+        if (telemetry_frame_valid(packet.data, packet.length))
+        {
+            processFrame(packet.data, packet.length);
+        }
+        else if (packet.length > 0 && packet.data[0] == FRAME_TELEMETRY_BATCH)
+        {
+            processBatch(packet.data, packet.length);
+        }
+        else if (packet.length > 0 && packet.data[0] == FRAME_TELEMETRY)
+        {
+            telemetry_stats.crc_failed();
+        }
         else
         {
-            Serial.print(F("Failed to read data from radio buffer, code "));
-            Serial.println(state);
+            // RxPacket data is NUL-terminated.
+            processPacket(String((const char *)packet.data), packet.arrival_us);
         }
     }
 
     // If serial was written by control panel UI.
-    if (Serial.available())
+    while (Serial.available())
     {
         // Get serial command. NOTE: Must end with '\n'.
-        String message = Serial.readStringUntil('\n');
-        // If command message, transmit.
+        char c = Serial.read();
+        if (c != '\n')
+        {
+            if (serial_fill < sizeof(serial_line) - 1)
+                serial_line[serial_fill++] = c;
+            else
+                serial_overflow = true;
+            continue;
+        }
+        serial_line[serial_fill] = '\0';
+        serial_fill = 0;
+        // A cut-off CMD:SEQ_ADD or SYNC: must not be acted on.
+        if (serial_overflow)
+        {
+            serial_overflow = false;
+            Serial.println("WARNING: Line longer than " + String(sizeof(serial_line) - 1) + " characters. Dropped.");
+            continue;
+        }
+
+        // Time sync from the GCS; answered at once, without the String work.
+        if (strncmp(serial_line, "SYNC:", 5) == 0)
+        {
+            answerTimeSync(serial_line, (uint32_t)esp_timer_get_time());
+            continue;
+        }
+
+        // If command message, queue it behind any still in flight (aborts go
+        // ahead).
+        String message = String(serial_line);
+        message.trim();
         if (message.startsWith("CMD:"))
         {
-            current_command = message;
-            transmitting = true;
+            uint32_t evicted = command_sender.evicted();
+            if (!command_sender.push(message.c_str(), (uint32_t)esp_timer_get_time()))
+                Serial.println("WARNING: Command queue full or command too long. Dropped " + message);
+            if (command_sender.evicted() != evicted)
+                Serial.println("WARNING: Command queue full. Dropped the newest queued command for " + message);
+        }
+        else if (message.startsWith("PHY:"))
+        {
+            String name = message.substring(4);
+            phy_pinned = PHY_PROFILE_COUNT;
+            for (int profile = 0; profile < PHY_PROFILE_COUNT; profile++)
+                if (name == PHY_PROFILES[profile].name)
+                    phy_pinned = (PhyProfileId)profile;
+            // An explicit choice goes out now.
+            last_phy_request_time = now - phy_request_interval;
+            Serial.println("PHY: " + String(phy_pinned < PHY_PROFILE_COUNT ? PHY_PROFILES[phy_pinned].name : "AUTO"));
+        }
+        else if (message == "STATS")
+        {
+            profiler_print(Serial);
+        }
+        else if (message == "STATS_RESET")
+        {
+            profiler_reset_all();
         }
         else
         {
@@ -133,26 +237,37 @@ void loop()
         }
     }
 
-    now = millis(); // Accurate time.
-    if (transmitting)
+    // Follows profile changes, including fallbacks radio_link made itself.
+    PhyProfileId profile = radio_link.profile();
+    if (profile != last_profile)
     {
-        // Only transmits *commands* every X milliseconds.
-        if (now - last_transmission_time >= transmission_interval)
-        {
-            String packet = formatCommand(current_command);
-            transmit(packet);
-            last_transmission_time = now;
-        }
+        last_profile = profile;
+        phy_selector.reset();
+        command_sender.set_frame_ms(radio_link.schedule().frame_ms());
+        printSchedule();
     }
-    else
+    PhyProfileId wanted = phy_pinned < PHY_PROFILE_COUNT ? phy_pinned : phy_selector.choose(profile);
+    if (wanted != profile && !radio_link.profile_pending() && now - last_phy_request_time >= phy_request_interval)
     {
-        // Only transmits *pings* ever second.
-        if (now - last_transmission_time >= ping_interval)
-        {
-            String packet = String(PACKET_ID) + "PING\n";
-            transmit(packet);
-            last_transmission_time = now;
-        }
+        last_phy_request_time = now;
+        if (radio_link.request_profile(wanted))
+            Serial.println("Requesting PHY " + String(PHY_PROFILES[wanted].name) + " (RSSI " +
+                           String(phy_selector.rssi_dbm(), 1) + " dBm, SNR " + String(phy_selector.snr_db(), 1) +
+                           " dB).");
+    }
+
+    now = millis(); // Accurate time.
+    // New commands and any whose retransmit timeout expired. They wait in the
+    // TX queue for the next uplink slot.
+    OutgoingCommand command;
+    while (command_sender.poll(now, command))
+    {
+        CommandTrace &trace = command_traces[command.sequence % COMMAND_TRACE_SLOTS];
+        if (!command.retransmit)
+            trace = {true, false, command.sequence, command.tag, 0, 0};
+        else if (trace.active && trace.sequence == command.sequence)
+            trace.retransmitted = true;
+        transmit(formatCommand(command), commandPriority(command.text));
     }
 
     // Last heard from.
@@ -162,6 +277,8 @@ void loop()
     {
         // Heart beat.
         Serial.println("HBT: " + String(seconds_ago / 1000));
+        printLinkStats(now - last_heartbeat_message_time);
+        printClockStats();
         last_heartbeat_message_time = now;
     }
 }
@@ -170,47 +287,47 @@ void loop()
  * @brief Called after receiving a packet.
  *
  * @param packet
+ * @param arrival_us RX-done time, for latency tracing.
  */
-void processPacket(String packet)
+void processPacket(String packet, uint32_t arrival_us)
 {
     // If it's our packet.
-    if (!packet.startsWith(PACKET_ID))
+    const char *text;
+    size_t length;
+    RadioPacketStatus status = radio_packet_message(packet.c_str(), text, length);
+    if (status == RADIO_PACKET_FOREIGN)
         return;
 
     last_reception_time = millis();
-    // Crops header.
-    String message = packet.substring(PACKET_ID_LENGTH);
-
-    // Finds index of first '\n' (expected last index).
-    int newline_index = message.indexOf('\n', 0);
-    if (newline_index == -1) // Continues to next packet if newline.
+    if (status == RADIO_PACKET_UNTERMINATED)
     {
         Serial.println("Packet did not contain newline.");
         return;
     }
 
-    // Crops newline character.
-    message = message.substring(0, newline_index);
+    // Crops header and newline.
+    String message = packet.substring(RADIO_PACKET_ID_LENGTH, RADIO_PACKET_ID_LENGTH + length);
 
-    // If ACK message.
-    if (message.startsWith("ACK:"))
+    // If ACK message: "ACK:#<cumulative>:<mask>".
+    CommandAck ack;
+    if (radio_packet_parse_ack(message.c_str(), ack))
     {
-        // Crops ACK: header.
-        String acknowledgement = message.substring(4);
-        int id_index = acknowledgement.indexOf('#');
-        int local_count = (acknowledgement.substring(id_index + 1)).toInt();
-        // If ACK count is equal to the one previously sent.
-        if (local_count == packet_count)
+        for (CommandTrace &trace : command_traces)
+            if (trace.active && trace.tx_us != 0 && trace.ack_us == 0 &&
+                command_ack_covers(ack, trace.sequence))
+                trace.ack_us = arrival_us;
+        if (command_sender.acknowledge(ack, millis()) > 0)
         {
-            transmitting = false;
-            packet_count++;
             Serial.print("Received acknowledgement: ");
-            Serial.println(message);
+            Serial.print(message);
+            Serial.println(" (RTO " + String(command_sender.rtt().rto_ms()) + " ms)");
         }
-    }
-    else if (message.startsWith("T"))
-    {
-        Serial.println(message);
+
+        // Extended ACK: Away and the MCU are done with the command.
+        int lat_index = message.indexOf(":LAT:");
+        unsigned sequence;
+        if (lat_index != -1 && sscanf(message.c_str() + lat_index + 5, "%u", &sequence) == 1)
+            report_latency(sequence, message.c_str() + lat_index + 5);
     }
     else // Just prints all messages to control panel for now.
     {
@@ -219,44 +336,219 @@ void processPacket(String packet)
 }
 
 /**
- * @brief Returns a formatted packet for commands.
+ * @brief radio_link hook: starts the command's retransmit timer and stamps
+ * the first transmission of each traced command (packet
+ * "DC=CMD:...#<sequence>:<base>:<session>\n"). Runs from radio_link.service()
+ * in loop(), like command_sender's other calls.
  *
- * @param command
- * @return String
+ * @param data Not NUL-terminated.
+ * @param length
+ * @param start_us
  */
-String formatCommand(String command)
+void on_radio_transmit(const uint8_t *data, size_t length, uint32_t start_us)
 {
-    return String(PACKET_ID) + command + '#' + packet_count + '\n';
+    const char *command = "DC=CMD:";
+    if (length < strlen(command) || memcmp(data, command, strlen(command)) != 0)
+        return;
+    const uint8_t *hash = (const uint8_t *)memchr(data, '#', length);
+    if (hash == NULL)
+        return;
+
+    uint16_t sequence = 0;
+    for (const uint8_t *digit = hash + 1; digit < data + length && isdigit(*digit); digit++)
+        sequence = sequence * 10 + (*digit - '0');
+    command_sender.transmitted(sequence, millis());
+    CommandTrace &trace = command_traces[sequence % COMMAND_TRACE_SLOTS];
+    if (trace.active && trace.sequence == sequence && trace.tx_us == 0)
+        trace.tx_us = start_us;
 }
 
 /**
- * @brief NOTE: Longer messages may take too long to send, which causes
- * erroneous behavior.
+ * @brief Completes a trace from an extended ACK and prints
+ * "LAT:<seq>:<home>:<radio>:<away>:<uart>:<queue>:<execute>:<confirm>:<tlm_seq>".
  *
- * @param command
+ * @param sequence
+ * @param fields "<seq>:<hold>:<away>:<uart>:<queue>:<execute>:<confirm>:<tlm_seq>".
  */
-void transmit(String packet)
+void report_latency(uint16_t sequence, const char *fields)
 {
-    transmitting_flag = true;
+    CommandTrace &trace = command_traces[sequence % COMMAND_TRACE_SLOTS];
+    if (!trace.active || trace.sequence != sequence)
+        return;
+    trace.active = false;
 
-    // Blocking, so control loop will wait for entire packet.
-    int state = radio.transmit(packet);
-    if (state == RADIOLIB_ERR_NONE)
+    unsigned seq, telemetry_sequence;
+    long hold_us, away_us, uart_us, queue_us, execute_us, confirm_us;
+    if (sscanf(fields, "%u:%ld:%ld:%ld:%ld:%ld:%ld:%u", &seq, &hold_us, &away_us, &uart_us, &queue_us, &execute_us,
+               &confirm_us, &telemetry_sequence) != 8)
+        return;
+
+    long home_us = trace.tx_us ? (long)(trace.tx_us - trace.line_us) : -1;
+    long radio_us = -1;
+    if (!trace.retransmitted && trace.tx_us && trace.ack_us && hold_us >= 0)
     {
-        Serial.println("ransmitted " + packet);
+        long round_trip_us = (long)(trace.ack_us - trace.tx_us);
+        if (round_trip_us >= hold_us)
+            radio_us = (round_trip_us - hold_us) / 2;
     }
-    else if (state == RADIOLIB_ERR_PACKET_TOO_LONG)
+    Serial.printf("LAT:%u:%ld:%ld:%ld:%ld:%ld:%ld:%ld:%u\n", seq, home_us, radio_us, away_us, uart_us, queue_us,
+                  execute_us, confirm_us, telemetry_sequence);
+}
+
+/**
+ * @brief Forwards a validated telemetry frame to the control panel as
+ * "TLM:<hex>". Duplicates and stragglers are counted and dropped.
+ *
+ * @param data
+ * @param length
+ */
+void processFrame(const uint8_t *data, size_t length)
+{
+    last_reception_time = millis();
+
+    TelemetryFrame frame;
+    memcpy(&frame, data, sizeof(frame));
+    if (!telemetry_stats.frame(frame))
+        return;
+
+    char line[5 + 2 * sizeof(TelemetryFrame) + 1] = "TLM:";
+    for (size_t i = 0; i < length; i++)
+        sprintf(&line[4 + 2 * i], "%02X", data[i]);
+    Serial.println(line);
+}
+
+/**
+ * @brief Unpacks a delta-encoded telemetry batch into individual frames.
+ *
+ * @param data
+ * @param length
+ */
+void processBatch(const uint8_t *data, size_t length)
+{
+    TelemetryFrame frames[TELEMETRY_BATCH_MAX_FRAMES];
+    CommandAck ack;
+    size_t count = telemetry_batch_decode(data, length, frames, TELEMETRY_BATCH_MAX_FRAMES, &ack);
+    if (count == 0)
     {
-        // The supplied packet was longer than 256 bytes.
-        Serial.println(F("Packet too long!"));
+        Serial.println("Telemetry batch failed CRC.");
+        telemetry_stats.crc_failed();
+        return;
     }
+
+    // Covers standalone ACKs that were lost.
+    if (command_sender.acknowledge(ack, millis()) > 0)
+        Serial.println("Received acknowledgement in telemetry: ACK:#" + String(ack.cumulative) + ":" + String(ack.mask));
+
+    for (size_t i = 0; i < count; i++)
+        processFrame((const uint8_t *)&frames[i], sizeof(TelemetryFrame));
+}
+
+/**
+ * @brief Returns a formatted packet for commands:
+ * "DC=CMD:V1:OPEN#<sequence>:<base>:<session>".
+ *
+ * @param command
+ * @return String
+ */
+String formatCommand(const OutgoingCommand &command)
+{
+    char packet[RADIO_PACKET_ID_LENGTH + COMMAND_TEXT_MAX + 20];
+    radio_packet_format_command(command, packet, sizeof(packet));
+    return String(packet);
+}
+
+/**
+ * @brief Aborts (command_is_abort()) jump ahead of everything but ACKs.
+ *
+ * @param command
+ * @return TxPriority
+ */
+TxPriority commandPriority(String command)
+{
+    if (command_is_abort(command.c_str()))
+        return TX_PRIORITY_CONTROL;
+    return TX_PRIORITY_COMMAND;
+}
+
+/**
+ * @brief Prints the PHY profile and the TDMA schedule it gives.
+ *
+ */
+void printSchedule()
+{
+    const PhyProfile &phy = PHY_PROFILES[radio_link.profile()];
+    const TdmaSchedule &schedule = radio_link.schedule();
+    Serial.printf("PHY %s (SF%u, %.0f kHz, CR 4/%u). TDMA frame %u ms: beacon %u, uplink %u, ACK %u, downlink %u ms.\n",
+                  phy.name, phy.spreading_factor, phy.bandwidth_khz, phy.coding_rate, (unsigned)schedule.frame_ms(),
+                  schedule.slot_ms[TDMA_SLOT_BEACON], schedule.slot_ms[TDMA_SLOT_UPLINK],
+                  schedule.slot_ms[TDMA_SLOT_ACK], schedule.slot_ms[TDMA_SLOT_DOWNLINK]);
+}
+
+/**
+ * @brief Prints running telemetry counts and this heartbeat's rate and signal:
+ * "LNK:<received>:<lost>:<late>:<crc_failed>:<resets>:<rate_hz>:<rssi>:<snr>:<min_rssi>:<min_snr>".
+ * crc_failed covers the radio's CRC and header errors and the frame/batch CRCs.
+ *
+ * @param elapsed_ms Since the last report.
+ */
+void printLinkStats(unsigned long elapsed_ms)
+{
+    TelemetryWindow window = telemetry_stats.take_window(elapsed_ms);
+    RadioLinkStats radio_stats = radio_link.stats();
+    uint32_t crc_failed = radio_stats.crc_errors + radio_stats.rx_errors + telemetry_stats.crc_failures();
+    Serial.printf("LNK:%lu:%lu:%lu:%lu:%lu:%.1f:%.1f:%.1f:%.1f:%.1f\n", (unsigned long)telemetry_stats.received(),
+                  (unsigned long)telemetry_stats.lost(), (unsigned long)telemetry_stats.late(),
+                  (unsigned long)crc_failed, (unsigned long)telemetry_stats.resets(), window.frame_rate_hz,
+                  window.rssi_dbm, window.snr_db, window.min_rssi_dbm, window.min_snr_db);
+}
+
+/**
+ * @brief Prints the Home -> Away clock estimate:
+ * "CLK:<mcu_synced>:<delay_us>:<uncertainty_us>:<drift_ppm>:<steps>".
+ *
+ */
+void printClockStats()
+{
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    uint32_t reference_us;
+    bool synced = radio_link.to_reference(now_us, reference_us);
+    ClockSync clock = radio_link.clock();
+    Serial.printf("CLK:%d:%lu:%lu:%.2f:%lu\n", synced, (unsigned long)clock.delay_us(),
+                  (unsigned long)clock.uncertainty_us(now_us), clock.drift_ppm(), (unsigned long)clock.steps());
+}
+
+/**
+ * @brief Answers "SYNC:<t1>" from the GCS with
+ * "SYNC:<t1>:<t2>:<t3>:<mcu_offset>", t2/t3 on this board's clock and
+ * mcu_offset (MCU - Home, modulo 2^32) or "-" until the radio sync is up.
+ *
+ * @param line
+ * @param receive_us When the line's newline arrived.
+ */
+void answerTimeSync(const char *line, uint32_t receive_us)
+{
+    unsigned long origin_us;
+    if (sscanf(line + 5, "%lu", &origin_us) != 1)
+        return;
+
+    uint32_t transmit_us = (uint32_t)esp_timer_get_time();
+    uint32_t reference_us;
+    if (radio_link.to_reference(transmit_us, reference_us))
+        Serial.printf("SYNC:%lu:%lu:%lu:%lu\n", origin_us, (unsigned long)receive_us, (unsigned long)transmit_us,
+                      (unsigned long)(reference_us - transmit_us));
     else
-    {
-        // Some other error occurred.
-        Serial.print(F("Failed transmission, code "));
-        Serial.println(state);
-    }
+        Serial.printf("SYNC:%lu:%lu:%lu:-\n", origin_us, (unsigned long)receive_us, (unsigned long)transmit_us);
+}
 
-    // Begin receiving again. NOTE: DO NOT REMOVE.
-    radio.startReceive();
-}
\ No newline at end of file
+/**
+ * @brief Queues a packet for transmission. Returns immediately; the radio
+ * sends it from radio_link.service().
+ *
+ * @param packet
+ * @param priority
+ */
+void transmit(String packet, TxPriority priority)
+{
+    // No echo: the GCS reads this port, and radio_link reports drops.
+    radio_link.send(packet, priority);
+}
@@ -0,0 +1,269 @@
+/**
+ * @file test_command_sender.cpp
+ * @brief Home's side of the command window: numbering, queueing, ACKs and
+ * retransmit timers.
+ */
+#include <command_window.h>
+#include <unity.h>
+
+static CommandSender sender;
+
+void setUp()
+{
+    sender = CommandSender();
+    sender.begin(77, 1000);
+}
+
+void tearDown()
+{
+}
+
+static CommandAck ack_of(uint16_t cumulative, uint16_t mask = 0)
+{
+    CommandAck ack;
+    ack.valid = true;
+    ack.cumulative = cumulative;
+    ack.mask = mask;
+    return ack;
+}
+
+void test_numbers_commands_in_order()
+{
+    TEST_ASSERT_TRUE(sender.push("CMD:V1:OPEN"));
+    TEST_ASSERT_TRUE(sender.push("CMD:V1:CLOSE"));
+
+    OutgoingCommand out;
+    TEST_ASSERT_TRUE(sender.poll(0, out));
+    TEST_ASSERT_EQUAL_UINT32(1000, out.sequence);
+    TEST_ASSERT_EQUAL_UINT32(1000, out.base);
+    TEST_ASSERT_EQUAL_UINT32(77, out.session);
+    TEST_ASSERT_FALSE(out.retransmit);
+    TEST_ASSERT_EQUAL_STRING("CMD:V1:OPEN", out.text);
+
+    TEST_ASSERT_TRUE(sender.poll(0, out));
+    TEST_ASSERT_EQUAL_UINT32(1001, out.sequence);
+    TEST_ASSERT_EQUAL_STRING("CMD:V1:CLOSE", out.text);
+    TEST_ASSERT_FALSE(sender.poll(0, out));
+}
+
+void test_window_limits_in_flight()
+{
+    for (size_t i = 0; i < COMMAND_WINDOW + 2; i++)
+        TEST_ASSERT_TRUE(sender.push("CMD:PING"));
+
+    OutgoingCommand out;
+    size_t sent = 0;
+    while (sender.poll(0, out))
+        sent++;
+    TEST_ASSERT_EQUAL_size_t(COMMAND_WINDOW, sent);
+    TEST_ASSERT_EQUAL_size_t(2, sender.queued());
+
+    // One ACK frees one slot for the next queued command.
+    TEST_ASSERT_EQUAL_size_t(1, sender.acknowledge(ack_of(1000), 10));
+    TEST_ASSERT_TRUE(sender.poll(10, out));
+    TEST_ASSERT_EQUAL_UINT32(1000 + COMMAND_WINDOW, out.sequence);
+    TEST_ASSERT_EQUAL_UINT32(1001, out.base);
+}
+
+void test_queue_rejects_overflow_and_bad_text()
+{
+    for (size_t i = 0; i < COMMAND_QUEUE_LENGTH; i++)
+        TEST_ASSERT_TRUE(sender.push("CMD:PING"));
+    TEST_ASSERT_FALSE(sender.push("CMD:PING"));
+
+    sender.begin(77, 1000);
+    char text[COMMAND_TEXT_MAX + 1];
+    memset(text, 'A', COMMAND_TEXT_MAX);
+    text[COMMAND_TEXT_MAX] = '\0';
+    TEST_ASSERT_FALSE(sender.push(text));
+    TEST_ASSERT_FALSE(sender.push(""));
+}
+
+void test_aborts_overtake_the_queue()
+{
+    for (size_t i = 0; i < COMMAND_WINDOW; i++)
+        TEST_ASSERT_TRUE(sender.push("CMD:PING", i));
+    OutgoingCommand out;
+    while (sender.poll(0, out))
+        ;
+    for (size_t i = COMMAND_WINDOW; i < COMMAND_WINDOW + COMMAND_QUEUE_LENGTH; i++)
+        TEST_ASSERT_TRUE(sender.push("CMD:PING", i));
+    TEST_ASSERT_FALSE(sender.push("CMD:PING"));
+
+    // Full queue and window: the abort evicts the newest ping, goes first
+    // and takes an extra window slot.
+    TEST_ASSERT_TRUE(sender.push("CMD:CLOSE_ALL", 99));
+    TEST_ASSERT_EQUAL_UINT32(1, sender.evicted());
+    TEST_ASSERT_EQUAL_size_t(COMMAND_QUEUE_LENGTH, sender.queued());
+    TEST_ASSERT_TRUE(sender.poll(0, out));
+    TEST_ASSERT_EQUAL_STRING("CMD:CLOSE_ALL", out.text);
+    TEST_ASSERT_EQUAL_UINT32(1000 + COMMAND_WINDOW, out.sequence);
+    TEST_ASSERT_EQUAL_UINT32(99, out.tag);
+    TEST_ASSERT_FALSE(sender.poll(0, out));
+
+    // The pings keep their order behind it.
+    sender.acknowledge(ack_of(1000 + COMMAND_WINDOW), 10);
+    TEST_ASSERT_TRUE(sender.poll(10, out));
+    TEST_ASSERT_EQUAL_STRING("CMD:PING", out.text);
+    TEST_ASSERT_EQUAL_UINT32(COMMAND_WINDOW, out.tag);
+}
+
+void test_full_of_aborts_refuses_more()
+{
+    for (size_t i = 0; i < COMMAND_QUEUE_LENGTH; i++)
+        TEST_ASSERT_TRUE(sender.push("CMD:CLOSE_VALVES"));
+    TEST_ASSERT_FALSE(sender.push("CMD:CLOSE_ALL"));
+    TEST_ASSERT_EQUAL_UINT32(0, sender.evicted());
+
+    // At most COMMAND_ABORT_SLOTS beyond the window.
+    OutgoingCommand out;
+    size_t sent = 0;
+    while (sender.poll(0, out))
+        sent++;
+    TEST_ASSERT_EQUAL_size_t(COMMAND_QUEUE_LENGTH < COMMAND_WINDOW + COMMAND_ABORT_SLOTS
+                                 ? COMMAND_QUEUE_LENGTH
+                                 : COMMAND_WINDOW + COMMAND_ABORT_SLOTS,
+                             sent);
+}
+
+void test_selective_ack_holds_the_gap()
+{
+    sender.push("CMD:V1:OPEN");
+    sender.push("CMD:V2:OPEN");
+    sender.push("CMD:V3:OPEN");
+    OutgoingCommand out;
+    while (sender.poll(0, out))
+        ;
+
+    // 1000 delivered, 1002 held: 1001 is the only one left to resend.
+    TEST_ASSERT_EQUAL_size_t(2, sender.acknowledge(ack_of(1000, 0x2), 100));
+    TEST_ASSERT_EQUAL_size_t(2, sender.in_flight());
+    TEST_ASSERT_TRUE(sender.poll(100 + COMMAND_RTO_MAX_MS, out));
+    TEST_ASSERT_EQUAL_UINT32(1001, out.sequence);
+    TEST_ASSERT_TRUE(out.retransmit);
+    TEST_ASSERT_FALSE(sender.poll(100 + COMMAND_RTO_MAX_MS, out));
+
+    TEST_ASSERT_EQUAL_size_t(1, sender.acknowledge(ack_of(1002), 5000));
+    TEST_ASSERT_TRUE(sender.idle());
+}
+
+void test_retransmit_backs_off()
+{
+    sender.push("CMD:V1:OPEN");
+    OutgoingCommand out;
+    TEST_ASSERT_TRUE(sender.poll(0, out));
+    TEST_ASSERT_TRUE(sender.transmitted(out.sequence, 0));
+
+    TEST_ASSERT_FALSE(sender.poll(COMMAND_RTO_INITIAL_MS - 1, out));
+    TEST_ASSERT_TRUE(sender.poll(COMMAND_RTO_INITIAL_MS, out));
+    TEST_ASSERT_TRUE(out.retransmit);
+    // The second retry waits twice as long.
+    uint32_t sent_ms = COMMAND_RTO_INITIAL_MS;
+    sender.transmitted(out.sequence, sent_ms);
+    TEST_ASSERT_FALSE(sender.poll(sent_ms + 2 * COMMAND_RTO_INITIAL_MS - 1, out));
+    TEST_ASSERT_TRUE(sender.poll(sent_ms + 2 * COMMAND_RTO_INITIAL_MS, out));
+    TEST_ASSERT_EQUAL_UINT32(2, sender.retransmits());
+}
+
+void test_timer_starts_on_air()
+{
+    sender.push("CMD:V1:OPEN");
+    OutgoingCommand out;
+    TEST_ASSERT_TRUE(sender.poll(0, out));
+
+    // Waiting in the TX queue for the uplink slot is not a lost command.
+    TEST_ASSERT_FALSE(sender.poll(2 * COMMAND_RTO_INITIAL_MS, out));
+    TEST_ASSERT_TRUE(sender.transmitted(out.sequence, 2000));
+    TEST_ASSERT_FALSE(sender.transmitted(out.sequence, 2000));
+    TEST_ASSERT_FALSE(sender.poll(2000 + COMMAND_RTO_INITIAL_MS - 1, out));
+    TEST_ASSERT_TRUE(sender.poll(2000 + COMMAND_RTO_INITIAL_MS, out));
+
+    // One dropped from the TX queue goes again after the longest timeout.
+    TEST_ASSERT_FALSE(sender.poll(2500 + COMMAND_RTO_MAX_MS - 1, out));
+    TEST_ASSERT_TRUE(sender.poll(2500 + COMMAND_RTO_MAX_MS, out));
+    TEST_ASSERT_EQUAL_UINT32(2, sender.retransmits());
+}
+
+void test_bounds_follow_the_frame()
+{
+    sender.set_frame_ms(3040);
+    TEST_ASSERT_EQUAL_UINT32(3040, sender.rtt().rto_ms());
+    TEST_ASSERT_EQUAL_UINT32(4 * 3040, sender.rtt().max_ms());
+
+    // A fast ACK cannot pull the timeout below half a frame.
+    sender.push("CMD:V1:OPEN");
+    OutgoingCommand out;
+    sender.poll(0, out);
+    sender.transmitted(out.sequence, 0);
+    sender.acknowledge(ack_of(1000), 10);
+    TEST_ASSERT_EQUAL_UINT32(3040 / 2, sender.rtt().rto_ms());
+}
+
+void test_ignores_stale_and_future_acks()
+{
+    sender.push("CMD:V1:OPEN");
+    OutgoingCommand out;
+    sender.poll(0, out);
+
+    CommandAck invalid = ack_of(1000);
+    invalid.valid = false;
+    TEST_ASSERT_EQUAL_size_t(0, sender.acknowledge(invalid, 10));
+    // Never sent.
+    TEST_ASSERT_EQUAL_size_t(0, sender.acknowledge(ack_of(1001), 10));
+    // From before a reset.
+    TEST_ASSERT_EQUAL_size_t(0, sender.acknowledge(ack_of(500), 10));
+    TEST_ASSERT_EQUAL_size_t(1, sender.in_flight());
+}
+
+void test_rtt_from_first_sends_only()
+{
+    sender.push("CMD:V1:OPEN");
+    sender.push("CMD:V2:OPEN");
+    OutgoingCommand out;
+    sender.poll(0, out);
+    sender.poll(0, out);
+    sender.transmitted(1000, 20);
+    sender.transmitted(1001, 20);
+    sender.acknowledge(ack_of(1000), 120);
+    TEST_ASSERT_EQUAL_UINT32(1, sender.rtt().samples());
+    // Measured from air time, not from poll().
+    TEST_ASSERT_EQUAL_UINT32(100, sender.rtt().srtt_ms());
+
+    // Karn: 1001 was resent, so its ACK gives no sample.
+    TEST_ASSERT_TRUE(sender.poll(COMMAND_RTO_MAX_MS, out));
+    sender.transmitted(out.sequence, COMMAND_RTO_MAX_MS);
+    sender.acknowledge(ack_of(1001), COMMAND_RTO_MAX_MS + 50);
+    TEST_ASSERT_EQUAL_UINT32(1, sender.rtt().samples());
+}
+
+void test_sequence_wraps()
+{
+    sender.begin(77, 65535);
+    sender.push("CMD:V1:OPEN");
+    sender.push("CMD:V1:CLOSE");
+    OutgoingCommand out;
+    sender.poll(0, out);
+    sender.poll(0, out);
+    TEST_ASSERT_EQUAL_UINT32(0, out.sequence);
+    TEST_ASSERT_EQUAL_UINT32(65535, out.base);
+    TEST_ASSERT_EQUAL_size_t(2, sender.acknowledge(ack_of(0), 10));
+    TEST_ASSERT_TRUE(sender.idle());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_numbers_commands_in_order);
+    RUN_TEST(test_window_limits_in_flight);
+    RUN_TEST(test_queue_rejects_overflow_and_bad_text);
+    RUN_TEST(test_aborts_overtake_the_queue);
+    RUN_TEST(test_full_of_aborts_refuses_more);
+    RUN_TEST(test_selective_ack_holds_the_gap);
+    RUN_TEST(test_retransmit_backs_off);
+    RUN_TEST(test_timer_starts_on_air);
+    RUN_TEST(test_bounds_follow_the_frame);
+    RUN_TEST(test_ignores_stale_and_future_acks);
+    RUN_TEST(test_rtt_from_first_sends_only);
+    RUN_TEST(test_sequence_wraps);
+    return UNITY_END();
+}
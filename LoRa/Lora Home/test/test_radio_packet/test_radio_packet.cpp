@@ -0,0 +1,107 @@
+/**
+ * @file test_radio_packet.cpp
+ * @brief Text framing of commands and ACKs on the radio, as processPacket()
+ * and formatCommand() use it on both LoRa boards.
+ */
+#include <radio_packet.h>
+#include <unity.h>
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_command_round_trip()
+{
+    OutgoingCommand command = {65535, 65533, 4321, false, "CMD:SEQ_ADD:6000:V2:CLOSE", 0};
+    char packet[RADIO_PACKET_ID_LENGTH + COMMAND_TEXT_MAX + 20];
+    size_t length = radio_packet_format_command(command, packet, sizeof(packet));
+    TEST_ASSERT_EQUAL_STRING("DC=CMD:SEQ_ADD:6000:V2:CLOSE#65535:65533:4321\n", packet);
+    TEST_ASSERT_EQUAL_size_t(strlen(packet), length);
+
+    const char *message;
+    size_t message_length;
+    TEST_ASSERT_EQUAL_INT(RADIO_PACKET_OK, radio_packet_message(packet, message, message_length));
+    TEST_ASSERT_EQUAL_size_t(length - RADIO_PACKET_ID_LENGTH - 1, message_length);
+
+    RadioCommand parsed;
+    TEST_ASSERT_TRUE(radio_packet_parse_command(message, message_length, parsed));
+    TEST_ASSERT_EQUAL_STRING("CMD:SEQ_ADD:6000:V2:CLOSE", parsed.text);
+    TEST_ASSERT_EQUAL_UINT32(65535, parsed.sequence);
+    TEST_ASSERT_EQUAL_UINT32(65533, parsed.base);
+    TEST_ASSERT_EQUAL_UINT32(4321, parsed.session);
+}
+
+void test_format_refuses_short_buffer()
+{
+    OutgoingCommand command = {1, 1, 1, false, "CMD:V1:OPEN", 0};
+    char packet[16];
+    // Hidden from the optimizer, so -Wformat-truncation does not flag the
+    // truncation this test is about.
+    volatile size_t size = sizeof(packet);
+    TEST_ASSERT_EQUAL_size_t(0, radio_packet_format_command(command, packet, size));
+}
+
+void test_message_foreign_and_unterminated()
+{
+    const char *message;
+    size_t length;
+    TEST_ASSERT_EQUAL_INT(RADIO_PACKET_FOREIGN, radio_packet_message("XY=CMD:V1:OPEN#1:1:1\n", message, length));
+    TEST_ASSERT_EQUAL_INT(RADIO_PACKET_FOREIGN, radio_packet_message("DC-CMD:V1:OPEN#1:1:1\n", message, length));
+    TEST_ASSERT_EQUAL_INT(RADIO_PACKET_UNTERMINATED, radio_packet_message("DC=CMD:V1:OP", message, length));
+}
+
+void test_parse_command_rejects_malformed()
+{
+    RadioCommand command;
+    const char *bad[] = {"CMD:V1:OPEN", "CMD:V1:OPEN#", "CMD:V1:OPEN#1:2", "CMD:V1:OPEN#a:b:c"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        TEST_ASSERT_FALSE(radio_packet_parse_command(bad[i], strlen(bad[i]), command));
+
+    // Text longer than any command the window can hold.
+    char text[COMMAND_TEXT_MAX + 16];
+    memset(text, 'A', COMMAND_TEXT_MAX);
+    strcpy(text + COMMAND_TEXT_MAX, "#1:1:1");
+    TEST_ASSERT_FALSE(radio_packet_parse_command(text, strlen(text), command));
+}
+
+void test_parse_command_stops_at_length()
+{
+    // A '#' past the message (e.g. after the newline) must not count.
+    const char *packet = "CMD:V1:OPEN\n#1:2:3";
+    RadioCommand command;
+    TEST_ASSERT_FALSE(radio_packet_parse_command(packet, 11, command));
+}
+
+void test_parse_ack()
+{
+    CommandAck ack;
+    TEST_ASSERT_TRUE(radio_packet_parse_ack("ACK:#1200:5", ack));
+    TEST_ASSERT_TRUE(ack.valid);
+    TEST_ASSERT_EQUAL_UINT32(1200, ack.cumulative);
+    TEST_ASSERT_EQUAL_UINT32(5, ack.mask);
+
+    // Extensions after the mask are ignored.
+    TEST_ASSERT_TRUE(radio_packet_parse_ack("ACK:#7:0:T=123", ack));
+    TEST_ASSERT_EQUAL_UINT32(7, ack.cumulative);
+
+    TEST_ASSERT_FALSE(radio_packet_parse_ack("ACK:V1:OPEN", ack));
+    TEST_ASSERT_FALSE(ack.valid);
+    TEST_ASSERT_FALSE(radio_packet_parse_ack("ACK:#12", ack));
+    TEST_ASSERT_FALSE(radio_packet_parse_ack("CMD:V1:OPEN", ack));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_command_round_trip);
+    RUN_TEST(test_format_refuses_short_buffer);
+    RUN_TEST(test_message_foreign_and_unterminated);
+    RUN_TEST(test_parse_command_rejects_malformed);
+    RUN_TEST(test_parse_command_stops_at_length);
+    RUN_TEST(test_parse_ack);
+    return UNITY_END();
+}
@@ -0,0 +1,31 @@
+/**
+ * @file airtime.h
+ * @brief LoRa time on air, standing in for RadioLib's getTimeOnAir().
+ */
+#pragma once
+
+#include <math.h>
+#include <phy_profile.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// RadioLib's SX126x defaults: 8-symbol preamble, explicit header, CRC on.
+const int AIRTIME_PREAMBLE_SYMBOLS = 8;
+// RadioLib turns on low data rate optimisation above this symbol length.
+const float AIRTIME_LDRO_SYMBOL_MS = 16.0f;
+
+/**
+ * @brief Time on air of a packet (SX1261/2 datasheet, section 6.1.4).
+ *
+ * @param length Payload bytes.
+ */
+inline uint32_t lora_airtime_us(const PhyProfile &phy, size_t length)
+{
+    const float symbol_us = (1u << phy.spreading_factor) * 1000.0f / phy.bandwidth_khz;
+    const int ldro = symbol_us > AIRTIME_LDRO_SYMBOL_MS * 1000 ? 1 : 0;
+    const int bits = 8 * (int)length + 16 - 4 * phy.spreading_factor + 8 + 20;
+    const int per_block = 4 * (phy.spreading_factor - 2 * ldro);
+    const int blocks = bits > 0 ? (bits + per_block - 1) / per_block : 0;
+    const float symbols = AIRTIME_PREAMBLE_SYMBOLS + 4.25f + 8 + blocks * phy.coding_rate;
+    return (uint32_t)ceilf(symbols * symbol_us);
+}
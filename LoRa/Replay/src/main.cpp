@@ -0,0 +1,235 @@
+/**
+ * @file main.cpp
+ * @brief Replays recorded GCS sessions through the Home/Away packet handling
+ * on a simulated radio link and reports throughput, queue depths and
+ * latency.
+ *
+ *   program [--speed 1|10|max] [--phy STANDBY|BURN] [--loss <percent>]
+ *           [--seed <n>] [--fanout <n>] [--max-gap <s>] [--no-batch] <log>...
+ */
+#include "replay_log.h"
+#include "replay_metrics.h"
+#include "sim_boards.h"
+#include "sim_radio.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// Replay time per loop() of both boards.
+const uint64_t REPLAY_TICK_US = 1000;
+// Wall-clock pacing is checked this often (replay time).
+const uint64_t REPLAY_PACE_US = 10000;
+// After the last event, run until everything is delivered, at most this long.
+const uint64_t REPLAY_DRAIN_US = 60000000;
+
+struct ReplayOptions
+{
+    double speed = 0; // 0: as fast as possible.
+    PhyProfileId phy = PHY_STANDBY;
+    float loss = 0;
+    uint32_t seed = 1;
+    uint32_t fanout = 1;
+    uint64_t max_gap_us = 10000000;
+    bool batching = true;
+};
+
+static void usage()
+{
+    fprintf(stderr, "usage: program [--speed 1|10|max] [--phy STANDBY|BURN] [--loss <percent>] [--seed <n>]\n"
+                    "               [--fanout <n>] [--max-gap <s>] [--no-batch] <log>...\n");
+}
+
+/**
+ * @return Index of the first log path in argv, 0 on a bad option.
+ */
+static int parse_options(int argc, char **argv, ReplayOptions &options)
+{
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        const char *name = argv[i];
+        if (strcmp(name, "--no-batch") == 0)
+        {
+            options.batching = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return 0;
+        const char *value = argv[++i];
+        if (strcmp(name, "--speed") == 0)
+            options.speed = strcmp(value, "max") == 0 ? 0 : atof(value);
+        else if (strcmp(name, "--phy") == 0)
+        {
+            options.phy = PHY_PROFILE_COUNT;
+            for (int profile = 0; profile < PHY_PROFILE_COUNT; profile++)
+                if (strcmp(value, PHY_PROFILES[profile].name) == 0)
+                    options.phy = (PhyProfileId)profile;
+            if (options.phy == PHY_PROFILE_COUNT)
+                return 0;
+        }
+        else if (strcmp(name, "--loss") == 0)
+            options.loss = atof(value) / 100;
+        else if (strcmp(name, "--seed") == 0)
+            options.seed = strtoul(value, NULL, 0);
+        else if (strcmp(name, "--fanout") == 0)
+            options.fanout = strtoul(value, NULL, 0);
+        else if (strcmp(name, "--max-gap") == 0)
+            options.max_gap_us = (uint64_t)(atof(value) * 1e6);
+        else
+            return 0;
+    }
+    return i < argc ? i : 0;
+}
+
+static void print_latency(const char *name, LatencyLog &log)
+{
+    printf("  %-18s n=%-6zu p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f ms\n", name, log.count(),
+           log.percentile(0.50) / 1000.0, log.percentile(0.90) / 1000.0, log.percentile(0.99) / 1000.0,
+           log.max() / 1000.0);
+}
+
+static void print_depth(const char *name, const DepthGauge &gauge)
+{
+    printf("  %-18s mean %6.2f  max %3zu\n", name, gauge.mean(), gauge.max());
+}
+
+int main(int argc, char **argv)
+{
+    ReplayOptions options;
+    int first_log = parse_options(argc, argv, options);
+    if (first_log == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    ReplayLog log(options.max_gap_us, options.fanout);
+    for (int i = first_log; i < argc; i++)
+    {
+        if (!log.load(argv[i]))
+        {
+            fprintf(stderr, "Cannot open %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    const std::vector<ReplayEvent> &events = log.events();
+    if (events.empty())
+    {
+        fprintf(stderr, "No telemetry or commands in the logs.\n");
+        return 1;
+    }
+
+    ReplayMetrics metrics;
+    SimRadio home_radio, away_radio;
+    home_radio.begin(TDMA_HOME, options.phy, 0);
+    away_radio.begin(TDMA_AWAY, options.phy, 0);
+    SimAir air(home_radio, away_radio, options.loss, options.seed);
+    SimHome home(home_radio, metrics);
+    SimAway away(away_radio, metrics, options.batching);
+    home.begin(options.seed, options.seed * 7919);
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point wall_start = Clock::now();
+    double max_lag_s = 0;
+    const uint64_t last_event_us = events.back().time_us;
+    const uint64_t frame_us = home_radio.schedule().frame_ms() * 1000ull;
+    size_t next = 0;
+    uint64_t now_us = 0;
+    for (;; now_us += REPLAY_TICK_US)
+    {
+        for (; next < events.size() && events[next].time_us <= now_us; next++)
+        {
+            if (events[next].type == REPLAY_TELEMETRY)
+                away.telemetry(events[next].frame, now_us);
+            else
+                home.command(events[next].text, now_us);
+        }
+
+        home.loop(now_us);
+        away.loop(now_us);
+        air.service(now_us);
+
+        metrics.home_tx_queue.sample(home_radio.queued());
+        metrics.away_tx_queue.sample(away_radio.queued());
+        metrics.command_window.sample(home.sender().in_flight() + home.sender().queued());
+
+        // Two frames so the last batch goes out, then until nothing is pending.
+        if (next == events.size() && now_us >= last_event_us + 2 * frame_us)
+        {
+            bool drained = home.sender().idle() && home_radio.queued() == 0 && away_radio.queued() == 0;
+            if (drained || now_us >= last_event_us + REPLAY_DRAIN_US)
+                break;
+        }
+
+        if (options.speed > 0 && now_us % REPLAY_PACE_US == 0)
+        {
+            double target_s = now_us / 1e6 / options.speed;
+            double wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+            if (wall_s < target_s)
+                std::this_thread::sleep_for(std::chrono::duration<double>(target_s - wall_s));
+            else if (wall_s - target_s > max_lag_s)
+                max_lag_s = wall_s - target_s;
+        }
+    }
+    double wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+
+    const ReplayLogStats &input = log.stats();
+    const TelemetryStats &telemetry = home.telemetry();
+    const CommandSender &sender = home.sender();
+    SimRadioStats home_stats = home_radio.stats();
+    SimRadioStats away_stats = away_radio.stats();
+    const SimAirStats &air_stats = air.stats();
+    double replay_s = now_us / 1e6;
+    char speed[16] = "max";
+    if (options.speed > 0)
+        snprintf(speed, sizeof(speed), "%gx", options.speed);
+
+    printf("Input: %u logs, %u lines (%u telemetry, %u commands, %u sessions, %u skipped, %u malformed)\n",
+           input.files, input.lines, input.telemetry_lines, input.command_lines, input.sessions, input.skipped,
+           input.malformed);
+    printf("  parsed in %.1f ms: %.0f lines/s, %.1f MB/s; %.0f s of idle time clipped\n", input.parse_s * 1e3,
+           input.lines / input.parse_s, input.bytes / input.parse_s / 1e6, input.gaps_clipped_us / 1e6);
+    printf("Replay: %.1f s in %.2f s wall (%.1fx real time, asked %s), max lag %.0f ms\n", replay_s, wall_s,
+           replay_s / wall_s, speed, max_lag_s * 1e3);
+    printf("  PHY %s, TDMA frame %u ms (beacon %u, uplink %u, ack %u, downlink %u), loss %.1f %%, %s\n",
+           PHY_PROFILES[options.phy].name, (unsigned)home_radio.schedule().frame_ms(),
+           home_radio.schedule().slot_ms[TDMA_SLOT_BEACON], home_radio.schedule().slot_ms[TDMA_SLOT_UPLINK],
+           home_radio.schedule().slot_ms[TDMA_SLOT_ACK], home_radio.schedule().slot_ms[TDMA_SLOT_DOWNLINK],
+           options.loss * 100, options.batching ? "batched telemetry" : "one frame per packet");
+
+    // Sequence gaps double count when a stale packet resets the count.
+    printf("Telemetry: %u frames queued, %u delivered, %u lost (%u in sequence gaps), %u late, %u resets, "
+           "%u CRC failures\n",
+           metrics.frames_queued, telemetry.received(), metrics.frames_queued - telemetry.received(),
+           telemetry.lost(), telemetry.late(), telemetry.resets(), telemetry.crc_failures());
+    printf("  %.2f frames per packet (max %zu)\n", metrics.batch_frames.mean(), metrics.batch_frames.max());
+    print_latency("latency", metrics.telemetry_us);
+
+    printf("Commands: %u given, %u refused (queue full), %u delivered, %u acknowledged, %u retransmits, %u "
+           "link-loss closes\n",
+           metrics.commands_given, metrics.commands_refused, metrics.commands_delivered, metrics.commands_acked,
+           sender.retransmits(), metrics.link_loss_closes);
+    print_latency("to Away", metrics.command_delivery_us);
+    print_latency("acknowledged", metrics.command_ack_us);
+
+    printf("Queues:\n");
+    print_depth("Home TX", metrics.home_tx_queue);
+    print_depth("Away TX", metrics.away_tx_queue);
+    print_depth("command window", metrics.command_window);
+
+    printf("Packet handling (wall time):\n");
+    printf("  %-18s %8llu packets %8.0f ns/packet\n", "Home RX", (unsigned long long)metrics.home_rx.packets,
+           metrics.home_rx.ns_per_packet());
+    printf("  %-18s %8llu packets %8.0f ns/packet\n", "Away RX", (unsigned long long)metrics.away_rx.packets,
+           metrics.away_rx.ns_per_packet());
+
+    printf("Air: %u delivered, %u lost, %u collided; Home %u sent (%.1f %% duty), %u dropped; "
+           "Away %u sent (%.1f %% duty), %u dropped, %u superseded; %u RX overflows\n",
+           air_stats.delivered, air_stats.lost, air_stats.collisions, home_stats.tx_sent,
+           home_stats.airtime_us / 1e4 / replay_s, home_stats.tx_dropped, away_stats.tx_sent,
+           away_stats.airtime_us / 1e4 / replay_s, away_stats.tx_dropped, away_stats.tx_superseded,
+           home_stats.rx_dropped + away_stats.rx_dropped);
+    return 0;
+}
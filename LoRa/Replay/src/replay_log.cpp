@@ -0,0 +1,196 @@
+/**
+ * @file replay_log.cpp
+ * @brief GCS log parsing.
+ */
+#include "replay_log.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Days since 1970-01-01 of a civil date (proleptic Gregorian).
+ */
+static int64_t days_from_civil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = (unsigned)(year - era * 400);
+    const unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+/**
+ * @brief Parses "[YYYY-MM-DDTHH:MM:SS.ffffffZ]: ".
+ *
+ * @param text Set to the logged line after the prefix.
+ * @return false if the line has no timestamp.
+ */
+static bool parse_prefix(const char *line, int64_t &wall_us, const char *&text)
+{
+    int year, month, day, hour, minute, second, consumed = 0;
+    unsigned micros;
+    if (sscanf(line, "[%d-%d-%dT%d:%d:%d.%6uZ]: %n", &year, &month, &day, &hour, &minute, &second, &micros,
+               &consumed) != 7 ||
+        consumed == 0)
+        return false;
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    wall_us = seconds * 1000000 + micros;
+    text = line + consumed;
+    return true;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+ReplayLog::ReplayLog(uint64_t max_gap_us, uint32_t fanout) : max_gap_us_(max_gap_us), fanout_(fanout ? fanout : 1)
+{
+}
+
+bool ReplayLog::load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t first = events_.size();
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        stats_.bytes += strlen(line);
+        line[strcspn(line, "\r\n")] = '\0';
+        stats_.lines++;
+        parse_line(line);
+    }
+    fclose(file);
+
+    // Fanned-out frames may run past the next logged line.
+    std::stable_sort(events_.begin() + first, events_.end(),
+                     [](const ReplayEvent &a, const ReplayEvent &b) { return a.time_us < b.time_us; });
+    stats_.parse_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats_.files++;
+    return true;
+}
+
+void ReplayLog::parse_line(const char *line)
+{
+    int64_t wall_us;
+    const char *text;
+    if (!parse_prefix(line, wall_us, text))
+    {
+        // Continuation of a multi-line message, or a blank line.
+        if (line[0] != '\0')
+            stats_.malformed++;
+        return;
+    }
+
+    // Advance the timeline; logs may go backwards between files or sessions.
+    if (started_)
+    {
+        int64_t elapsed_us = wall_us - last_wall_us_;
+        if (elapsed_us < 0)
+            elapsed_us = 0;
+        if ((uint64_t)elapsed_us > max_gap_us_)
+        {
+            stats_.gaps_clipped_us += elapsed_us - max_gap_us_;
+            elapsed_us = max_gap_us_;
+        }
+        now_us_ += elapsed_us;
+    }
+    started_ = true;
+    last_wall_us_ = wall_us;
+
+    int fuel, ox, load;
+    char end;
+    const char *command = strstr(text, "DC=CMD:");
+    if (strncmp(text, "TLM:", 4) == 0 || strncmp(text, "UDP TLM:", 8) == 0)
+    {
+        const char *hex = strchr(text, ':') + 1;
+        uint8_t data[sizeof(TelemetryFrame)];
+        size_t length = 0;
+        for (; length < sizeof(data) && hex_value(hex[0]) >= 0 && hex_value(hex[1]) >= 0; hex += 2)
+            data[length++] = hex_value(hex[0]) << 4 | hex_value(hex[1]);
+        if (*hex != '\0' || !telemetry_frame_valid(data, length))
+        {
+            stats_.malformed++;
+            return;
+        }
+        TelemetryFrame frame;
+        memcpy(&frame, data, sizeof(frame));
+        stats_.telemetry_lines++;
+        add_frame(frame);
+    }
+    else if (text[0] == 'T' && sscanf(text + 1, "%d,%d,%d%c", &fuel, &ox, &load, &end) == 3)
+    {
+        TelemetryFrame frame = {};
+        frame.fuel_psi_x10 = telemetry_fixed16(fuel, 10);
+        frame.ox_psi_x10 = telemetry_fixed16(ox, 10);
+        frame.load_g = load;
+        frame.status = STATUS_RECORDING;
+        stats_.telemetry_lines++;
+        add_legacy_frame(frame);
+    }
+    else if (command)
+    {
+        ReplayEvent event = {};
+        event.time_us = now_us_;
+        event.type = REPLAY_COMMAND;
+        // Drop the old numbering; Home's sender assigns its own.
+        command += 3;
+        size_t length = strcspn(command, "#");
+        if (length == 0 || length >= COMMAND_TEXT_MAX)
+        {
+            stats_.malformed++;
+            return;
+        }
+        memcpy(event.text, command, length);
+        event.text[length] = '\0';
+        stats_.command_lines++;
+        events_.push_back(event);
+    }
+    else if (strcmp(text, "REOPENED GCS") == 0)
+    {
+        stats_.sessions++;
+    }
+    else
+    {
+        stats_.skipped++;
+    }
+}
+
+void ReplayLog::add_frame(const TelemetryFrame &frame)
+{
+    ReplayEvent event;
+    event.time_us = now_us_;
+    event.type = REPLAY_TELEMETRY;
+    event.frame = frame;
+    event.text[0] = '\0';
+    events_.push_back(event);
+}
+
+void ReplayLog::add_legacy_frame(TelemetryFrame frame)
+{
+    // Legacy lines carry no sequence or MCU time. Lines closer together than
+    // the fan-out push later frames back rather than interleaving them.
+    uint64_t time_us = now_us_ > next_legacy_us_ ? now_us_ : next_legacy_us_;
+    for (uint32_t i = 0; i < fanout_; i++, time_us += REPLAY_TELEMETRY_INTERVAL_US)
+    {
+        frame.sequence = next_sequence_++;
+        frame.timestamp_us = (uint32_t)time_us;
+        telemetry_frame_seal(frame);
+        add_frame(frame);
+        events_.back().time_us = time_us;
+    }
+    next_legacy_us_ = time_us;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file replay_log.h
+ * @brief Reads GCS session logs (GCS/logs/) into a timeline of the
+ * traffic the radios carried.
+ *
+ * Each log line is "[<UTC ISO time>]: <serial line>". The lines that matter:
+ *   T<fuel>,<ox>,<load>   legacy ASCII telemetry (PSI, PSI, grams)
+ *   TLM:<hex>, UDP TLM:<hex>  binary TelemetryFrames, replayed as captured
+ *   ...DC=CMD:<text>[#...]   a command Home sent, renumbered on replay
+ *   REOPENED GCS          a new session
+ * Heartbeats, pings, ACKs and status lines are what the replay itself
+ * produces, so they are counted and skipped.
+ */
+#pragma once
+
+#include <command_window.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <telemetry_frame.h>
+#include <vector>
+
+// MCU telemetry interval at the default 20 Hz, for fanned-out frames.
+const uint32_t REPLAY_TELEMETRY_INTERVAL_US = 50000;
+
+enum ReplayEventType : uint8_t
+{
+    REPLAY_TELEMETRY, // A frame reached Away from the MCU.
+    REPLAY_COMMAND    // The control panel gave Home a command.
+};
+
+struct ReplayEvent
+{
+    uint64_t time_us; // Replay time, from the first line.
+    ReplayEventType type;
+    TelemetryFrame frame;        // REPLAY_TELEMETRY.
+    char text[COMMAND_TEXT_MAX]; // REPLAY_COMMAND, without the window numbers.
+};
+
+struct ReplayLogStats
+{
+    uint32_t files;
+    uint32_t lines;
+    uint32_t telemetry_lines;
+    uint32_t command_lines;
+    uint32_t sessions;
+    uint32_t skipped;   // Heartbeats, pings, ACKs, status lines.
+    uint32_t malformed; // No timestamp, bad hex or a frame failing its CRC.
+    uint64_t bytes;
+    uint64_t gaps_clipped_us; // Idle time cut from the timeline.
+    double parse_s;           // Wall time spent reading and parsing.
+};
+
+class ReplayLog
+{
+public:
+    /**
+     * @param max_gap_us Longer silences (e.g. between sessions) shrink to
+     * this, so a 1x replay does not idle for hours.
+     * @param fanout Frames per legacy telemetry line, REPLAY_TELEMETRY_INTERVAL_US
+     * apart: those logs are at about 0.7 Hz, the MCU now sends 20 Hz.
+     * Captured TLM frames are replayed one for one.
+     */
+    ReplayLog(uint64_t max_gap_us, uint32_t fanout);
+
+    /**
+     * @brief Appends a log; files follow each other on the timeline.
+     *
+     * @return false if it could not be opened.
+     */
+    bool load(const char *path);
+
+    const std::vector<ReplayEvent> &events() const { return events_; }
+    const ReplayLogStats &stats() const { return stats_; }
+
+private:
+    void parse_line(const char *line);
+    void add_frame(const TelemetryFrame &frame);
+    void add_legacy_frame(TelemetryFrame frame);
+
+    uint64_t max_gap_us_;
+    uint32_t fanout_;
+    std::vector<ReplayEvent> events_;
+    ReplayLogStats stats_ = {};
+    // Wall time of the previous line and where it landed on the timeline.
+    bool started_ = false;
+    int64_t last_wall_us_ = 0;
+    uint64_t now_us_ = 0;
+    uint64_t next_legacy_us_ = 0;
+    uint16_t next_sequence_ = 0;
+};
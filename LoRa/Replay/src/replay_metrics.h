@@ -0,0 +1,103 @@
+/**
+ * @file replay_metrics.h
+ * @brief What a replay measures: latencies, queue depths and CPU time spent
+ * handling packets.
+ */
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Every sample kept, so percentiles are exact. Host-only.
+ */
+class LatencyLog
+{
+public:
+    void add(uint64_t us) { samples_.push_back(us); }
+    size_t count() const { return samples_.size(); }
+
+    /**
+     * @param quantile 0..1.
+     * @return 0 if empty.
+     */
+    uint64_t percentile(double quantile)
+    {
+        if (samples_.empty())
+            return 0;
+        std::sort(samples_.begin(), samples_.end());
+        size_t index = (size_t)(quantile * (samples_.size() - 1) + 0.5);
+        return samples_[index];
+    }
+
+    uint64_t max() { return percentile(1.0); }
+
+private:
+    std::vector<uint64_t> samples_;
+};
+
+/**
+ * @brief Depth of a queue, sampled every replay tick.
+ */
+class DepthGauge
+{
+public:
+    void sample(size_t depth)
+    {
+        total_ += depth;
+        samples_++;
+        if (depth > max_)
+            max_ = depth;
+    }
+
+    double mean() const { return samples_ ? (double)total_ / samples_ : 0; }
+    size_t max() const { return max_; }
+
+private:
+    uint64_t total_ = 0;
+    uint64_t samples_ = 0;
+    size_t max_ = 0;
+};
+
+/**
+ * @brief Wall time spent in one packet handler.
+ */
+struct HandlerTime
+{
+    uint64_t packets = 0;
+    uint64_t ns = 0;
+
+    double ns_per_packet() const { return packets ? (double)ns / packets : 0; }
+};
+
+struct ReplayMetrics
+{
+    // Replay time each telemetry sequence reached Away, and each command
+    // sequence was given to Home; indexed by the 16-bit sequence.
+    std::vector<uint64_t> frame_queued_us = std::vector<uint64_t>(65536);
+    std::vector<uint64_t> command_given_us = std::vector<uint64_t>(65536);
+
+    // Replay time: frame reached Away -> decoded at Home.
+    LatencyLog telemetry_us;
+    // Replay time: command given to Home -> delivered to the MCU by Away,
+    // and -> acknowledged at Home.
+    LatencyLog command_delivery_us;
+    LatencyLog command_ack_us;
+
+    DepthGauge home_tx_queue;
+    DepthGauge away_tx_queue;
+    DepthGauge command_window; // In flight plus queued in CommandSender.
+    DepthGauge batch_frames;   // Frames per telemetry packet sent.
+
+    HandlerTime home_rx;
+    HandlerTime away_rx;
+
+    uint32_t frames_queued = 0;
+    uint32_t commands_given = 0;
+    uint32_t commands_refused = 0; // CommandSender queue full, or evicted for an abort.
+    uint32_t commands_delivered = 0;
+    uint32_t commands_acked = 0;
+    uint32_t link_loss_closes = 0; // Away's CMD:CLOSE_VALVES after silence.
+};
@@ -0,0 +1,235 @@
+/**
+ * @file sim_boards.cpp
+ * @brief Home and Away loop() logic on the simulated link.
+ */
+#include "sim_boards.h"
+#include <chrono>
+#include <radio_packet.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef std::chrono::steady_clock HandlerClock;
+
+static uint64_t elapsed_ns(HandlerClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(HandlerClock::now() - start).count();
+}
+
+/**
+ * @brief As commandPriority() on Home: aborts skip the queue.
+ */
+static TxPriority command_priority(const char *text)
+{
+    return command_is_abort(text) ? TX_PRIORITY_CONTROL : TX_PRIORITY_COMMAND;
+}
+
+void SimHome::command(const char *text, uint64_t now_us)
+{
+    metrics_.commands_given++;
+    uint32_t evicted = sender_.evicted();
+    if (sender_.push(text, (uint32_t)given_us_.size()))
+        given_us_.push_back(now_us);
+    else
+        metrics_.commands_refused++;
+    // Evicted for an abort: never sent either.
+    metrics_.commands_refused += sender_.evicted() - evicted;
+}
+
+void SimHome::loop(uint64_t now_us)
+{
+    SimRxPacket packet;
+    while (radio_.receive(packet))
+    {
+        HandlerClock::time_point start = HandlerClock::now();
+        handle(packet, now_us);
+        metrics_.home_rx.ns += elapsed_ns(start);
+        metrics_.home_rx.packets++;
+    }
+
+    TxPacket sent;
+    while (radio_.transmitted(sent))
+        transmitted(sent, now_us);
+
+    uint32_t now_ms = (uint32_t)(now_us / 1000);
+    OutgoingCommand command;
+    while (sender_.poll(now_ms, command))
+    {
+        if (!command.retransmit)
+        {
+            metrics_.command_given_us[command.sequence] = given_us_[command.tag];
+            unacked_.push_back(command.sequence);
+        }
+        char text[RADIO_PACKET_ID_LENGTH + COMMAND_TEXT_MAX + 20];
+        size_t length = radio_packet_format_command(command, text, sizeof(text));
+        radio_.send((const uint8_t *)text, length, command_priority(command.text), now_us);
+    }
+}
+
+void SimHome::handle(const SimRxPacket &packet, uint64_t now_us)
+{
+    // Another master's beacon; Home never hears its own.
+    if (tdma_beacon_valid(packet.data, packet.length))
+        return;
+
+    if (telemetry_frame_valid(packet.data, packet.length))
+    {
+        TelemetryFrame frame;
+        memcpy(&frame, packet.data, sizeof(frame));
+        if (stats_.frame(frame))
+            metrics_.telemetry_us.add(now_us - metrics_.frame_queued_us[frame.sequence]);
+        return;
+    }
+
+    if (packet.length > 0 && packet.data[0] == FRAME_TELEMETRY_BATCH)
+    {
+        TelemetryFrame frames[TELEMETRY_BATCH_MAX_FRAMES];
+        CommandAck ack;
+        size_t count = telemetry_batch_decode(packet.data, packet.length, frames, TELEMETRY_BATCH_MAX_FRAMES, &ack);
+        if (count == 0)
+        {
+            stats_.crc_failed();
+            return;
+        }
+        acknowledge(ack, now_us);
+        for (size_t i = 0; i < count; i++)
+            if (stats_.frame(frames[i]))
+                metrics_.telemetry_us.add(now_us - metrics_.frame_queued_us[frames[i].sequence]);
+        return;
+    }
+
+    const char *message;
+    size_t length;
+    CommandAck ack;
+    if (radio_packet_message((const char *)packet.data, message, length) == RADIO_PACKET_OK &&
+        radio_packet_parse_ack(message, ack))
+        acknowledge(ack, now_us);
+}
+
+/**
+ * @brief As on_radio_transmit() on Home.
+ */
+void SimHome::transmitted(const TxPacket &packet, uint64_t now_us)
+{
+    char text[TX_PACKET_MAX_BYTES + 1];
+    memcpy(text, packet.data, packet.length);
+    text[packet.length] = '\0';
+    const char *message;
+    size_t length;
+    RadioCommand command;
+    if (radio_packet_message(text, message, length) == RADIO_PACKET_OK && strncmp(message, "CMD:", 4) == 0 &&
+        radio_packet_parse_command(message, length, command))
+        sender_.transmitted(command.sequence, (uint32_t)(now_us / 1000));
+}
+
+void SimHome::acknowledge(const CommandAck &ack, uint64_t now_us)
+{
+    if (sender_.acknowledge(ack, (uint32_t)(now_us / 1000)) == 0)
+        return;
+    for (size_t i = 0; i < unacked_.size();)
+    {
+        if (!command_ack_covers(ack, unacked_[i]))
+        {
+            i++;
+            continue;
+        }
+        metrics_.command_ack_us.add(now_us - metrics_.command_given_us[unacked_[i]]);
+        metrics_.commands_acked++;
+        unacked_.erase(unacked_.begin() + i);
+    }
+}
+
+SimAway::SimAway(SimRadio &radio, ReplayMetrics &metrics, bool batching)
+    : radio_(radio), metrics_(metrics), batching_(batching)
+{
+}
+
+void SimAway::telemetry(const TelemetryFrame &frame, uint64_t now_us)
+{
+    metrics_.frames_queued++;
+    metrics_.frame_queued_us[frame.sequence] = now_us;
+    if (!batching_)
+    {
+        if (radio_.send((const uint8_t *)&frame, sizeof(frame), TX_PRIORITY_TELEMETRY, now_us))
+            metrics_.batch_frames.sample(1);
+        return;
+    }
+    if (frame_count_ == TELEMETRY_BATCH_MAX_FRAMES)
+        memmove(frames_, frames_ + 1, --frame_count_ * sizeof(TelemetryFrame));
+    frames_[frame_count_++] = frame;
+}
+
+void SimAway::loop(uint64_t now_us)
+{
+    SimRxPacket packet;
+    while (radio_.receive(packet))
+    {
+        HandlerClock::time_point start = HandlerClock::now();
+        handle(packet, now_us);
+        metrics_.away_rx.ns += elapsed_ns(start);
+        metrics_.away_rx.packets++;
+    }
+
+    TdmaSlot slot = radio_.slot(now_us);
+    if (slot == TDMA_SLOT_DOWNLINK && last_slot_ != TDMA_SLOT_DOWNLINK)
+        flush(now_us);
+    last_slot_ = slot;
+
+    if (now_us - last_reception_us_ >= SIM_AWAY_SILENCE_MS * 1000ull && !idle_)
+    {
+        metrics_.link_loss_closes++;
+        idle_ = true;
+    }
+}
+
+void SimAway::handle(const SimRxPacket &packet, uint64_t now_us)
+{
+    if (tdma_beacon_valid(packet.data, packet.length))
+    {
+        last_reception_us_ = now_us;
+        return;
+    }
+
+    const char *message;
+    size_t length;
+    RadioPacketStatus status = radio_packet_message((const char *)packet.data, message, length);
+    if (status == RADIO_PACKET_FOREIGN)
+        return;
+    last_reception_us_ = now_us;
+    if (status == RADIO_PACKET_UNTERMINATED)
+        return;
+
+    RadioCommand command;
+    if (strncmp(message, "CMD:", 4) != 0 || !radio_packet_parse_command(message, length, command))
+        return;
+    idle_ = false;
+    if (receiver_.receive(command.sequence, command.base, command.session, command.text) == COMMAND_URGENT)
+    {
+        metrics_.command_delivery_us.add(now_us - metrics_.command_given_us[command.sequence]);
+        metrics_.commands_delivered++;
+    }
+
+    char text[COMMAND_TEXT_MAX];
+    uint16_t sequence;
+    while (receiver_.pop(text, &sequence))
+    {
+        metrics_.command_delivery_us.add(now_us - metrics_.command_given_us[sequence]);
+        metrics_.commands_delivered++;
+    }
+
+    CommandAck ack = receiver_.ack();
+    char reply[32];
+    int reply_length = snprintf(reply, sizeof(reply), "%sACK:#%u:%u\n", RADIO_PACKET_ID, ack.cumulative, ack.mask);
+    radio_.send((const uint8_t *)reply, reply_length, TX_PRIORITY_CONTROL, now_us);
+}
+
+void SimAway::flush(uint64_t now_us)
+{
+    batch_.set_max_bytes(radio_.slot_capacity(TDMA_SLOT_DOWNLINK));
+    size_t frames = batch_.add_latest(frames_, frame_count_);
+    frame_count_ = 0;
+
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    size_t length = batch_.finish(packet, receiver_.ack());
+    if (length > 0 && radio_.send_latest(packet, length, TX_PRIORITY_TELEMETRY, now_us))
+        metrics_.batch_frames.sample(frames);
+}
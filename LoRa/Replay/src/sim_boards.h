@@ -0,0 +1,96 @@
+/**
+ * @file sim_boards.h
+ * @brief The packet handling of Lora Home and Lora Away, on SimRadio.
+ *
+ * These follow loop(), processPacket(), processBatch() and the telemetry
+ * batching in the two src/main.cpp files, calling the same lib/gina_protocol
+ * code (CommandSender/CommandReceiver, TelemetryBatchEncoder, radio_packet.h,
+ * TelemetryStats). Serial output, the display, PHY selection and latency
+ * tracing are left out. Keep them in step when the boards change.
+ */
+#pragma once
+
+#include "replay_metrics.h"
+#include "sim_radio.h"
+#include <command_window.h>
+#include <telemetry_batch.h>
+#include <telemetry_stats.h>
+#include <vector>
+
+// Away closes the valves after this long without hearing Home (ping_timer).
+const uint32_t SIM_AWAY_SILENCE_MS = 8000;
+
+class SimHome
+{
+public:
+    SimHome(SimRadio &radio, ReplayMetrics &metrics) : radio_(radio), metrics_(metrics) {}
+
+    void begin(uint16_t session, uint16_t first_sequence)
+    {
+        sender_.begin(session, first_sequence);
+        sender_.set_frame_ms(radio_.schedule().frame_ms());
+    }
+
+    /**
+     * @brief A "CMD:..." line from the control panel.
+     */
+    void command(const char *text, uint64_t now_us);
+
+    /**
+     * @brief One loop(): drains the RX queue, starts the retransmit timers of
+     * commands that went on air, then sends new and timed-out commands.
+     */
+    void loop(uint64_t now_us);
+
+    const CommandSender &sender() const { return sender_; }
+    const TelemetryStats &telemetry() const { return stats_; }
+
+private:
+    void handle(const SimRxPacket &packet, uint64_t now_us);
+    void transmitted(const TxPacket &packet, uint64_t now_us);
+    void acknowledge(const CommandAck &ack, uint64_t now_us);
+
+    SimRadio &radio_;
+    ReplayMetrics &metrics_;
+    CommandSender sender_;
+    TelemetryStats stats_;
+    // When each command was given, by the tag pushed with it.
+    std::vector<uint64_t> given_us_;
+    // Numbered, not yet acknowledged.
+    std::vector<uint16_t> unacked_;
+};
+
+class SimAway
+{
+public:
+    /**
+     * @param batching false sends every frame on its own, as before batching.
+     */
+    SimAway(SimRadio &radio, ReplayMetrics &metrics, bool batching);
+
+    /**
+     * @brief A frame from the MCU link: queue_telemetry().
+     */
+    void telemetry(const TelemetryFrame &frame, uint64_t now_us);
+
+    /**
+     * @brief One loop(): drains the RX queue, flushes the batch at the start
+     * of the downlink slot, checks for link loss.
+     */
+    void loop(uint64_t now_us);
+
+private:
+    void handle(const SimRxPacket &packet, uint64_t now_us);
+    void flush(uint64_t now_us);
+
+    SimRadio &radio_;
+    ReplayMetrics &metrics_;
+    bool batching_;
+    TelemetryBatchEncoder batch_;
+    TelemetryFrame frames_[TELEMETRY_BATCH_MAX_FRAMES]; // Oldest first.
+    size_t frame_count_ = 0;
+    CommandReceiver receiver_;
+    TdmaSlot last_slot_ = TDMA_SLOT_BEACON;
+    uint64_t last_reception_us_ = 0;
+    bool idle_ = false;
+};
@@ -0,0 +1,165 @@
+/**
+ * @file sim_radio.cpp
+ * @brief Simulated radio link and air.
+ */
+#include "sim_radio.h"
+#include "airtime.h"
+#include <string.h>
+
+void SimRadio::begin(TdmaRole role, PhyProfileId profile, uint64_t now_us)
+{
+    role_ = role;
+    profile_ = profile;
+    for (size_t length = 0; length <= TX_PACKET_MAX_BYTES; length++)
+        airtime_us_[length] = lora_airtime_us(PHY_PROFILES[profile], length);
+
+    // Same budgets as RadioLink::apply_profile().
+    uint32_t budgets_us[TDMA_SLOT_COUNT];
+    budgets_us[TDMA_SLOT_BEACON] = airtime_us(sizeof(TdmaBeacon));
+    budgets_us[TDMA_SLOT_UPLINK] = airtime_us(TDMA_UPLINK_BYTES);
+    budgets_us[TDMA_SLOT_ACK] = airtime_us(TDMA_ACK_BYTES);
+    budgets_us[TDMA_SLOT_DOWNLINK] = airtime_us(TDMA_DOWNLINK_BYTES);
+    tdma_.begin(role, tdma_schedule(budgets_us), (uint32_t)now_us);
+}
+
+bool SimRadio::send(const uint8_t *data, size_t length, TxPriority priority, uint64_t now_us, uint32_t delay_ms)
+{
+    bool queued = tx_queue_.push(data, length, priority, (uint32_t)(now_us / 1000) + delay_ms);
+    if (!queued)
+        stats_.tx_dropped++;
+    return queued;
+}
+
+bool SimRadio::send_latest(const uint8_t *data, size_t length, TxPriority priority, uint64_t now_us)
+{
+    bool queued = tx_queue_.replace(data, length, priority, (uint32_t)(now_us / 1000));
+    if (!queued)
+        stats_.tx_dropped++;
+    return queued;
+}
+
+size_t SimRadio::fitting_length(uint32_t duration_us) const
+{
+    size_t low = 0;
+    size_t high = TX_PACKET_MAX_BYTES;
+    while (low < high)
+    {
+        size_t middle = (low + high + 1) / 2;
+        if (airtime_us_[middle] <= duration_us)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+size_t SimRadio::slot_capacity(TdmaSlot slot) const
+{
+    uint32_t slot_us = (uint32_t)tdma_.schedule().slot_ms[slot] * 1000;
+    uint32_t guard_us = TDMA_GUARD_MS * 1000;
+    return fitting_length(slot_us > guard_us ? slot_us - guard_us : 0);
+}
+
+SimRadioStats SimRadio::stats() const
+{
+    SimRadioStats stats = stats_;
+    stats.tx_dropped += tx_queue_.dropped();
+    stats.tx_superseded = tx_queue_.superseded();
+    return stats;
+}
+
+bool SimRadio::start(uint64_t now_us, TxPacket &packet)
+{
+    TdmaBeacon beacon = {};
+    if (tdma_.beacon_due((uint32_t)now_us, beacon))
+    {
+        beacon.profile = beacon.next_profile = profile_;
+        beacon.timestamp_us = (uint32_t)now_us;
+        tdma_beacon_seal(beacon);
+        memcpy(packet.data, &beacon, sizeof(beacon));
+        packet.length = sizeof(beacon);
+        stats_.beacons++;
+        return true;
+    }
+
+    uint32_t remaining_us;
+    uint8_t priorities = tdma_.may_transmit((uint32_t)now_us, remaining_us);
+    if (!priorities || !tx_queue_.pop((uint32_t)(now_us / 1000), packet, priorities, fitting_length(remaining_us)))
+        return false;
+    transmitted_.push(packet);
+    return true;
+}
+
+void SimRadio::deliver(const TxPacket &packet, uint64_t end_us)
+{
+    if (tdma_beacon_valid(packet.data, packet.length))
+    {
+        TdmaBeacon beacon;
+        memcpy(&beacon, packet.data, sizeof(beacon));
+        tdma_.on_beacon(beacon, (uint32_t)end_us, airtime_us(sizeof(TdmaBeacon)));
+        if (role_ == TDMA_AWAY)
+            stats_.beacons++;
+    }
+
+    SimRxPacket received;
+    memcpy(received.data, packet.data, packet.length);
+    received.data[packet.length] = '\0';
+    received.length = packet.length;
+    received.arrival_us = (uint32_t)end_us;
+    if (!rx_queue_.push(received))
+        stats_.rx_dropped++;
+}
+
+SimAir::SimAir(SimRadio &home, SimRadio &away, float loss, uint32_t seed)
+    : radios_{&home, &away}, loss_(loss), random_(seed ? seed : 1)
+{
+}
+
+bool SimAir::lose()
+{
+    // xorshift32: the same seed replays the same losses.
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_ < loss_ * 4294967295.0f;
+}
+
+void SimAir::service(uint64_t now_us)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        Transmission &tx = on_air_[side];
+        if (tx.active && now_us >= tx.end_us)
+        {
+            tx.active = false;
+            radios_[side]->stats_.tx_sent++;
+            if (tx.collided)
+                stats_.collisions++;
+            else if (lose())
+                stats_.lost++;
+            else
+            {
+                radios_[1 - side]->deliver(tx.packet, tx.end_us);
+                stats_.delivered++;
+            }
+        }
+    }
+
+    for (int side = 0; side < 2; side++)
+    {
+        Transmission &tx = on_air_[side];
+        if (tx.active || !radios_[side]->start(now_us, tx.packet))
+            continue;
+        uint32_t airtime_us = radios_[side]->airtime_us(tx.packet.length);
+        tx.active = true;
+        tx.collided = false;
+        tx.start_us = now_us;
+        tx.end_us = now_us + airtime_us;
+        radios_[side]->stats_.airtime_us += airtime_us;
+
+        // Half duplex: neither packet survives an overlap.
+        Transmission &other = on_air_[1 - side];
+        if (other.active)
+            tx.collided = other.collided = true;
+    }
+}
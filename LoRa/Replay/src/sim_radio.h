@@ -0,0 +1,140 @@
+/**
+ * @file sim_radio.h
+ * @brief Host model of RadioLink (lib/gina_radio) and the air between the
+ * two boards.
+ *
+ * SimRadio keeps RadioLink's TxQueue, TDMA clock, RX queue and slot-fitting
+ * rules, with airtime from airtime.h instead of the SX1262. SimAir carries
+ * packets between the two: one at a time per side, delivered at the end of
+ * its time on air unless it overlaps the other side's transmission
+ * (collision) or is dropped at random. PHY switching and time sync are not
+ * modelled; both sides stay on one profile.
+ */
+#pragma once
+
+#include <phy_profile.h>
+#include <ring_buffer.h>
+#include <stdint.h>
+#include <tdma.h>
+#include <tx_queue.h>
+
+// As in radio_link.h.
+const size_t SIM_TX_QUEUE_LENGTH = 8;
+const size_t SIM_RX_QUEUE_LENGTH = 8;
+
+struct SimRxPacket
+{
+    uint8_t data[TX_PACKET_MAX_BYTES + 1]; // NUL-terminated for text packets.
+    uint8_t length;
+    uint32_t arrival_us; // RX-done time.
+};
+
+struct SimRadioStats
+{
+    uint32_t tx_sent;
+    uint32_t tx_dropped; // Rejected or evicted from the TX queue.
+    uint32_t tx_superseded; // Replaced by newer ones before they went out.
+    uint32_t rx_dropped; // RX queue full.
+    uint32_t beacons;    // Sent (Home) or received (Away).
+    uint64_t airtime_us; // Time spent transmitting.
+};
+
+class SimRadio
+{
+public:
+    /**
+     * @param now_us Replay time. The TDMA clock takes it modulo 2^32, like
+     * esp_timer_get_time() on the boards; queue times use whole milliseconds.
+     */
+    void begin(TdmaRole role, PhyProfileId profile, uint64_t now_us);
+
+    /**
+     * @brief Queues a packet, as RadioLink::send().
+     */
+    bool send(const uint8_t *data, size_t length, TxPriority priority, uint64_t now_us, uint32_t delay_ms = 0);
+
+    /**
+     * @brief As RadioLink::send_latest().
+     */
+    bool send_latest(const uint8_t *data, size_t length, TxPriority priority, uint64_t now_us);
+
+    bool receive(SimRxPacket &packet) { return rx_queue_.pop(packet); }
+
+    /**
+     * @brief The next packet (not a beacon) that went on air, as RadioLink's
+     * on_transmit() callback would report it.
+     */
+    bool transmitted(TxPacket &packet) { return transmitted_.pop(packet); }
+
+    TdmaSlot slot(uint64_t now_us) { return tdma_.slot((uint32_t)now_us); }
+    size_t slot_capacity(TdmaSlot slot) const;
+    uint32_t airtime_us(size_t length) const
+    {
+        return airtime_us_[length < TX_PACKET_MAX_BYTES ? length : TX_PACKET_MAX_BYTES];
+    }
+    bool synced() const { return tdma_.synced(); }
+    const TdmaSchedule &schedule() const { return tdma_.schedule(); }
+    size_t queued() const { return tx_queue_.size(); }
+    SimRadioStats stats() const;
+
+private:
+    friend class SimAir;
+
+    size_t fitting_length(uint32_t duration_us) const;
+    // RadioLink::service(): the beacon or the next packet that fits the slot.
+    bool start(uint64_t now_us, TxPacket &packet);
+    // RadioLink::handle_irq() for a packet that arrived intact.
+    void deliver(const TxPacket &packet, uint64_t end_us);
+
+    TdmaRole role_ = TDMA_HOME;
+    PhyProfileId profile_ = PHY_STANDBY;
+    TxQueue<SIM_TX_QUEUE_LENGTH> tx_queue_;
+    RingBuffer<SimRxPacket, SIM_RX_QUEUE_LENGTH> rx_queue_;
+    RingBuffer<TxPacket, SIM_TX_QUEUE_LENGTH> transmitted_;
+    TdmaClock tdma_;
+    SimRadioStats stats_ = {};
+    uint32_t airtime_us_[TX_PACKET_MAX_BYTES + 1];
+};
+
+struct SimAirStats
+{
+    uint32_t delivered;
+    uint32_t lost;       // Dropped at random (--loss).
+    uint32_t collisions; // Packets lost with both sides on air at once.
+};
+
+class SimAir
+{
+public:
+    /**
+     * @param loss Probability 0..1 that a packet is lost.
+     * @param seed For the loss generator, so runs repeat exactly.
+     */
+    SimAir(SimRadio &home, SimRadio &away, float loss, uint32_t seed);
+
+    /**
+     * @brief Finishes transmissions that are done and starts new ones, as
+     * each board's service() call would. Call every tick.
+     */
+    void service(uint64_t now_us);
+
+    const SimAirStats &stats() const { return stats_; }
+
+private:
+    struct Transmission
+    {
+        bool active;
+        bool collided;
+        uint64_t start_us;
+        uint64_t end_us;
+        TxPacket packet;
+    };
+
+    bool lose();
+
+    SimRadio *radios_[2];
+    Transmission on_air_[2] = {};
+    float loss_;
+    uint32_t random_;
+    SimAirStats stats_ = {};
+};
@@ -0,0 +1,20 @@
+// Generated by scripts/generate_valves.py from config/valves.yaml. Do not edit.
+#pragma once
+
+// Valve numbers as used in commands (V1, V2, ...).
+enum ValveId : uint8_t
+{
+    VALVE_N2 = 1,
+    VALVE_RELEASE = 2,
+    VALVE_FUEL = 3,
+    VALVE_OX = 4,
+};
+
+constexpr int NUM_VALVES = 4;
+
+constexpr ValveDescriptor VALVES[NUM_VALVES] = {
+    {"n2", 12, {95, 150, 120}, VALVE_CLOSE, 0, 0},
+    {"release", 27, {82, 172, 130}, VALVE_CLOSE, 0, 0},
+    {"fuel", 25, {85, 170, 130}, VALVE_CLOSE, 0, 0},
+    {"ox", 32, {73, 150, 110}, VALVE_CLOSE, 0, 0},
+};
@@ -0,0 +1,16 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the Arduino core, native env only.
+ *
+ * Only what the host-built modules (see platformio.ini env:native) use: the C
+ * headers the core pulls in. Anything board-specific they need comes from a
+ * shim below, so a module that starts using more of the core fails to link
+ * on the host instead of silently testing a fake.
+ */
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
@@ -0,0 +1,50 @@
+/**
+ * @file hal_shim.cpp
+ * @brief Host stand-ins for the ESP-IDF and sampler calls of the host-built
+ * modules.
+ */
+#include "hal_shim.h"
+#include "adc_sampler.h"
+#include "esp_adc_cal.h"
+
+static const uint32_t ADC_MAX_COUNT = 4095;
+
+static uint32_t adc_full_scale_mv = 3300;
+static uint32_t adc_offset_mv = 0;
+static bool adc_efuse = false;
+static SensorScan latest_scan = {};
+
+void hal_shim_set_adc(uint32_t full_scale_mv, uint32_t offset_mv, bool efuse)
+{
+    adc_full_scale_mv = full_scale_mv;
+    adc_offset_mv = offset_mv;
+    adc_efuse = efuse;
+}
+
+void hal_shim_set_latest_scan(const SensorScan &scan)
+{
+    latest_scan = scan;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+                                             uint32_t default_vref, esp_adc_cal_characteristics_t *chars)
+{
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->coeff_a = (uint32_t)(((uint64_t)adc_full_scale_mv << 16) / ADC_MAX_COUNT);
+    chars->coeff_b = adc_offset_mv;
+    chars->vref = default_vref;
+    return adc_efuse ? ESP_ADC_CAL_VAL_EFUSE_VREF : ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars)
+{
+    // Same rounding as the IDF's linear characterization.
+    return (uint32_t)((((uint64_t)chars->coeff_a * adc_reading) + 32768) >> 16) + chars->coeff_b;
+}
+
+SensorScan adc_sampler_latest()
+{
+    return latest_scan;
+}
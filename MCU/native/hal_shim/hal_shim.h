@@ -0,0 +1,23 @@
+/**
+ * @file hal_shim.h
+ * @brief Controls for the host stand-ins, used by the native tests.
+ */
+#pragma once
+
+#include "adc_sampler.h"
+#include <stdint.h>
+
+/**
+ * @brief Sets the ADC line esp_adc_cal_raw_to_voltage() follows. Defaults to
+ * 0-3300 mV over 0-4095 counts with no eFuse data.
+ *
+ * @param full_scale_mv Voltage at count 4095, before the offset.
+ * @param offset_mv Voltage at count 0.
+ * @param efuse Whether characterization reports eFuse data (vs the default Vref).
+ */
+void hal_shim_set_adc(uint32_t full_scale_mv, uint32_t offset_mv, bool efuse);
+
+/**
+ * @brief What adc_sampler_latest() returns.
+ */
+void hal_shim_set_latest_scan(const SensorScan &scan);
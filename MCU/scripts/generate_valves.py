@@ -0,0 +1,128 @@
+"""
+Generates include/valves_generated.h from config/valves.yaml.
+
+Runs as a PlatformIO pre-build script (see platformio.ini) or standalone:
+    python scripts/generate_valves.py
+The header is only rewritten when its contents change, so unchanged YAML does
+not trigger a rebuild.
+"""
+
+import os
+import sys
+
+FIELDS = ("pin", "open", "closed", "neutral", "default")
+# Optional actuation profile fields and their defaults.
+OPTIONAL_FIELDS = {"slew": 0, "detach_ms": 0}
+STATES = {"open": "VALVE_OPEN", "closed": "VALVE_CLOSE", "neutral": "VALVE_NEUTRAL"}
+
+
+def parse_yaml(text: str) -> dict:
+    """
+    Reads the valves mapping. Uses PyYAML when installed, otherwise a minimal
+    parser for the two-level "name: {key: value}" layout of valves.yaml.
+    :param text: File contents.
+    :return: {name: {field: value}} in file order.
+    """
+    try:
+        import yaml
+
+        return yaml.safe_load(text)["valves"]
+    except ImportError:
+        pass
+
+    valves = {}
+    current = None
+    for raw in text.splitlines():
+        line = raw.split("#", 1)[0].rstrip()
+        if not line.strip():
+            continue
+        indent = len(line) - len(line.lstrip())
+        key, _, value = line.strip().partition(":")
+        value = value.strip()
+        if indent == 0:
+            if key != "valves":
+                raise ValueError(f"Unexpected top-level key '{key}'.")
+        elif not value:
+            current = valves.setdefault(key, {})
+        elif current is None:
+            raise ValueError(f"'{key}' is outside a valve.")
+        else:
+            current[key] = int(value) if value.lstrip("-").isdigit() else value
+    return valves
+
+
+def generate(valves: dict) -> str:
+    """
+    :param valves: Parsed valve table.
+    :return: Header source.
+    """
+    if not valves:
+        raise ValueError("No valves defined.")
+
+    ids = []
+    rows = []
+    for number, (name, valve) in enumerate(valves.items(), start=1):
+        for field in FIELDS:
+            if field not in valve:
+                raise ValueError(f"Valve '{name}' is missing '{field}'.")
+        for field in ("open", "closed", "neutral"):
+            angle = valve[field]
+            if not isinstance(angle, int) or not 0 <= angle <= 180:
+                raise ValueError(f"Valve '{name}' {field} angle must be 0-180, got {angle!r}.")
+        if not isinstance(valve["pin"], int) or not 0 <= valve["pin"] <= 39:
+            raise ValueError(f"Valve '{name}' pin is not a GPIO: {valve['pin']!r}.")
+        if valve["default"] not in STATES:
+            raise ValueError(f"Valve '{name}' default must be one of {', '.join(STATES)}.")
+        for field, default in OPTIONAL_FIELDS.items():
+            value = valve.setdefault(field, default)
+            if not isinstance(value, int) or not 0 <= value <= 65535:
+                raise ValueError(f"Valve '{name}' {field} must be 0-65535, got {value!r}.")
+
+        ids.append(f"    VALVE_{name.upper()} = {number},")
+        rows.append(
+            f'    {{"{name}", {valve["pin"]}, {{{valve["open"]}, {valve["closed"]}, '
+            f'{valve["neutral"]}}}, {STATES[valve["default"]]}, {valve["slew"]}, {valve["detach_ms"]}}},'
+        )
+
+    return "\n".join(
+        [
+            "// Generated by scripts/generate_valves.py from config/valves.yaml. Do not edit.",
+            "#pragma once",
+            "",
+            "// Valve numbers as used in commands (V1, V2, ...).",
+            "enum ValveId : uint8_t",
+            "{",
+            *ids,
+            "};",
+            "",
+            f"constexpr int NUM_VALVES = {len(rows)};",
+            "",
+            "constexpr ValveDescriptor VALVES[NUM_VALVES] = {",
+            *rows,
+            "};",
+            "",
+        ]
+    )
+
+
+def run(project_dir: str):
+    source = os.path.join(project_dir, "config", "valves.yaml")
+    target = os.path.join(project_dir, "include", "valves_generated.h")
+    with open(source) as f:
+        header = generate(parse_yaml(f.read()))
+
+    if os.path.exists(target):
+        with open(target) as f:
+            if f.read() == header:
+                return
+    with open(target, "w") as f:
+        f.write(header)
+    print(f"Generated {target}")
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO's SCons environment.
+    run(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        run(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))
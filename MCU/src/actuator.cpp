@@ -0,0 +1,134 @@
+/**
+ * @file actuator.cpp
+ * @brief Persistent servo PWM with slew profiles and timed detach.
+ */
+#include "actuator.h"
+#include "valves.h"
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include <esp_timer.h>
+
+struct ValveState
+{
+    int32_t position_mdeg; // Where the servo was last driven, millidegrees.
+    int32_t target_mdeg;
+    uint32_t settled_us;   // When the target was reached.
+    bool attached;
+};
+
+static Servo servos[NUM_VALVES];
+static ValveState states[NUM_VALVES];
+
+// Guards servos/states between callers and the profile timer.
+static SemaphoreHandle_t actuator_mutex = NULL;
+static esp_timer_handle_t profile_timer = NULL;
+
+static void drive(int index, int32_t position_mdeg)
+{
+    ValveState &state = states[index];
+    if (!state.attached)
+    {
+        servos[index].attach(VALVES[index].pin);
+        state.attached = true;
+    }
+    state.position_mdeg = position_mdeg;
+    servos[index].write((position_mdeg + 500) / 1000);
+}
+
+/**
+ * @brief Starts a move. Caller holds actuator_mutex.
+ */
+static void start_move(int index, uint8_t angle)
+{
+    ValveState &state = states[index];
+    state.target_mdeg = (int32_t)angle * 1000;
+    state.settled_us = (uint32_t)esp_timer_get_time();
+
+    // No profile: one duty update.
+    if (VALVES[index].slew_deg_s == 0)
+        drive(index, state.target_mdeg);
+    // Re-attach where it was left; the profile timer steps towards the target.
+    else if (!state.attached)
+        drive(index, state.position_mdeg);
+}
+
+/**
+ * @brief Once per PWM period: steps slewing valves and detaches settled ones.
+ */
+static void profile_tick(void *arg)
+{
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    for (int i = 0; i < NUM_VALVES; i++)
+    {
+        ValveState &state = states[i];
+        const ValveDescriptor &valve = VALVES[i];
+
+        if (state.position_mdeg != state.target_mdeg)
+        {
+            int32_t step = (int32_t)valve.slew_deg_s * (ACTUATOR_PERIOD_US / 1000);
+            int32_t error = state.target_mdeg - state.position_mdeg;
+            if (error > step)
+                error = step;
+            else if (error < -step)
+                error = -step;
+            drive(i, state.position_mdeg + error);
+            state.settled_us = now_us;
+        }
+        else if (state.attached && valve.detach_ms > 0 &&
+                 now_us - state.settled_us >= (uint32_t)valve.detach_ms * 1000)
+        {
+            servos[i].detach();
+            state.attached = false;
+        }
+    }
+    xSemaphoreGive(actuator_mutex);
+}
+
+void actuator_begin()
+{
+    actuator_mutex = xSemaphoreCreateMutex();
+
+    for (int i = 0; i < NUM_VALVES; i++)
+    {
+        states[i].attached = false;
+        drive(i, (int32_t)VALVES[i].angles[VALVES[i].default_state] * 1000);
+        states[i].target_mdeg = states[i].position_mdeg;
+        states[i].settled_us = (uint32_t)esp_timer_get_time();
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = profile_tick;
+    args.name = "actuator";
+    esp_timer_create(&args, &profile_timer);
+    esp_timer_start_periodic(profile_timer, ACTUATOR_PERIOD_US);
+}
+
+void actuator_move(uint8_t valve, uint8_t angle)
+{
+    ValveMove move = {valve, angle};
+    actuator_move_many(&move, 1);
+}
+
+void actuator_move_many(const ValveMove *moves, size_t count)
+{
+    xSemaphoreTake(actuator_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (moves[i].valve >= 1 && moves[i].valve <= NUM_VALVES)
+            start_move(moves[i].valve - 1, moves[i].angle);
+    }
+    xSemaphoreGive(actuator_mutex);
+}
+
+uint8_t actuator_target(uint8_t valve)
+{
+    return (uint8_t)(states[valve - 1].target_mdeg / 1000);
+}
+
+bool actuator_moving(uint8_t valve)
+{
+    const ValveState &state = states[valve - 1];
+    return state.position_mdeg != state.target_mdeg;
+}
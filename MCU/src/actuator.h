@@ -0,0 +1,51 @@
+/**
+ * @file actuator.h
+ * @brief Valve actuator layer over the ESP32 LEDC servo PWM.
+ *
+ * Every servo is attached once at boot. Moves only update the PWM duty, which
+ * the LEDC hardware latches at the next period boundary, so valves moved in
+ * one actuator_move_many() call change together within one 20 ms PWM period.
+ * Per-valve slew rates and timed detach come from config/valves.yaml.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Servo PWM period; profiles advance once per period.
+#define ACTUATOR_PERIOD_US 20000
+
+struct ValveMove
+{
+    uint8_t valve; // 1..NUM_VALVES.
+    uint8_t angle;
+};
+
+/**
+ * @brief Attaches every servo and drives it to its default state. Starts the
+ * profile timer.
+ */
+void actuator_begin();
+
+/**
+ * @brief Moves one valve. Safe from any task or esp_timer callback.
+ *
+ * @param valve 1..NUM_VALVES.
+ * @param angle 0-180.
+ */
+void actuator_move(uint8_t valve, uint8_t angle);
+
+/**
+ * @brief Moves several valves in the same PWM period.
+ */
+void actuator_move_many(const ValveMove *moves, size_t count);
+
+/**
+ * @brief Last commanded target angle.
+ */
+uint8_t actuator_target(uint8_t valve);
+
+/**
+ * @brief true while a valve is still slewing towards its target.
+ */
+bool actuator_moving(uint8_t valve);
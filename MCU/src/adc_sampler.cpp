@@ -0,0 +1,198 @@
+/**
+ * @file adc_sampler.cpp
+ * @brief Continuous ADC (I2S DMA) sampler for the registered sensors.
+ *
+ * The ESP32 ADC digital controller cannot convert slower than
+ * SOC_ADC_SAMPLE_FREQ_THRES_LOW (20 kHz total across all channels), so the
+ * hardware runs at an integer multiple of the requested rate and each output
+ * sample is the mean of OVERSAMPLE conversions per channel.
+ */
+#include "adc_sampler.h"
+#include "ring_buffer.h"
+#include "transducer.h"
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_timer.h>
+#include <profiler.h>
+
+// Bytes of conversion results handed over per DMA interrupt.
+static const uint32_t DMA_FRAME_BYTES = 256;
+// Size of the driver's internal DMA ring (several frames deep).
+static const uint32_t DMA_RING_BYTES = DMA_FRAME_BYTES * 8;
+
+// Reader task.
+static const uint32_t SAMPLER_TASK_STACK = 4096;
+static const UBaseType_t SAMPLER_TASK_PRIORITY = configMAX_PRIORITIES - 2;
+static const BaseType_t SAMPLER_TASK_CORE = 1;
+
+// ~2 s of samples at 1 kHz, enough to ride out the igniter delay.
+static RingBuffer<SensorScan, 2048> samples;
+
+static uint8_t adc_channels[SENSOR_COUNT];
+static_assert(SENSOR_COUNT <= SOC_ADC_PATT_LEN_MAX, "more sensors than ADC pattern entries");
+static uint32_t output_rate_hz = 0;
+static uint32_t oversample = 1;
+static volatile uint32_t dropped = 0;
+
+static SensorScan latest = {};
+static portMUX_TYPE latest_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Unpacking one DMA frame, not the wait for it.
+static ProfileSection profile_frame("adc_frame");
+
+/**
+ * @brief Unpacks DMA frames into averaged SensorScans. Runs forever.
+ *
+ * @param arg Unused.
+ */
+static void sampler_task(void *arg)
+{
+    uint8_t frame[DMA_FRAME_BYTES];
+    uint32_t sums[SENSOR_COUNT] = {};
+    uint32_t counts[SENSOR_COUNT] = {};
+    // Timestamps count samples from an anchor, so they do not jitter with
+    // task scheduling.
+    uint64_t sample_index = 0;
+    uint64_t start_us = esp_timer_get_time();
+
+    while (true)
+    {
+        uint32_t length = 0;
+        esp_err_t state = adc_digi_read_bytes(frame, sizeof(frame), &length, ADC_MAX_DELAY);
+        if (state == ESP_ERR_INVALID_STATE)
+        {
+            // Driver ring overflowed; frames were lost but the data returned is valid.
+            // How many is unknown, so count from now instead of from a start
+            // every later sample would be early against. This frame ends about
+            // now; samples still in the ring may be off by up to its depth.
+            dropped++;
+            uint32_t frame_samples = length / (SOC_ADC_DIGI_RESULT_BYTES * SENSOR_COUNT * oversample);
+            start_us = esp_timer_get_time() - (uint64_t)frame_samples * 1000000ULL / output_rate_hz;
+            sample_index = 0;
+            // A group split by the gap would average across it.
+            for (int ch = 0; ch < SENSOR_COUNT; ch++)
+                sums[ch] = counts[ch] = 0;
+        }
+        else if (state != ESP_OK)
+        {
+            continue;
+        }
+
+        ProfileScope scope(profile_frame);
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES)
+        {
+            adc_digi_output_data_t *result = (adc_digi_output_data_t *)&frame[i];
+            for (int ch = 0; ch < SENSOR_COUNT; ch++)
+            {
+                if (result->type1.channel == adc_channels[ch])
+                {
+                    sums[ch] += result->type1.data;
+                    counts[ch]++;
+                    break;
+                }
+            }
+
+            // Emit once every channel has a full oversample group.
+            bool complete = true;
+            for (int ch = 0; ch < SENSOR_COUNT; ch++)
+                complete &= counts[ch] >= oversample;
+            if (!complete)
+                continue;
+
+            SensorScan sample;
+            sample.timestamp_us = (uint32_t)(start_us + sample_index * 1000000ULL / output_rate_hz);
+            for (int ch = 0; ch < SENSOR_COUNT; ch++)
+            {
+                sample.raw[ch] = sums[ch] / counts[ch];
+                sums[ch] = 0;
+                counts[ch] = 0;
+            }
+            sample_index++;
+
+            portENTER_CRITICAL(&latest_mux);
+            latest = sample;
+            portEXIT_CRITICAL(&latest_mux);
+
+            if (!samples.push(sample))
+                dropped++;
+        }
+    }
+}
+
+bool adc_sampler_begin(uint32_t rate_hz)
+{
+    output_rate_hz = constrain(rate_hz, ADC_MIN_SAMPLE_RATE_HZ, ADC_MAX_SAMPLE_RATE_HZ);
+
+    // Smallest oversample factor that keeps the controller above its minimum rate.
+    const uint32_t frame_rate = output_rate_hz * SENSOR_COUNT;
+    oversample = (SOC_ADC_SAMPLE_FREQ_THRES_LOW + frame_rate - 1) / frame_rate;
+    if (oversample < 1)
+        oversample = 1;
+
+    adc_digi_init_config_t init_config = {};
+    init_config.max_store_buf_size = DMA_RING_BYTES;
+    init_config.conv_num_each_intr = DMA_FRAME_BYTES;
+    init_config.adc1_chan_mask = 0;
+    init_config.adc2_chan_mask = 0;
+
+    adc_digi_pattern_config_t pattern[SENSOR_COUNT] = {};
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+    {
+        int8_t channel = digitalPinToAnalogChannel(SENSORS[ch].pin);
+        // DMA mode on the ESP32 is ADC1 only (channels 0-7).
+        if (channel < 0 || channel > 7)
+            return false;
+
+        adc_channels[ch] = channel;
+        init_config.adc1_chan_mask |= BIT(channel);
+
+        pattern[ch].atten = ADC_ATTEN_DB_11;
+        pattern[ch].channel = channel;
+        pattern[ch].unit = 0; // ADC1.
+        pattern[ch].bit_width = ADC_RESOLUTION;
+    }
+
+    if (adc_digi_initialize(&init_config) != ESP_OK)
+        return false;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = 1; // Required on the ESP32.
+    config.conv_limit_num = 250;
+    config.pattern_num = SENSOR_COUNT;
+    config.adc_pattern = pattern;
+    config.sample_freq_hz = frame_rate * oversample;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    if (adc_digi_controller_configure(&config) != ESP_OK)
+        return false;
+    if (adc_digi_start() != ESP_OK)
+        return false;
+
+    xTaskCreatePinnedToCore(sampler_task, "adc_sampler", SAMPLER_TASK_STACK, NULL,
+                            SAMPLER_TASK_PRIORITY, NULL, SAMPLER_TASK_CORE);
+    return true;
+}
+
+size_t adc_sampler_read(SensorScan *out, size_t max_samples)
+{
+    return samples.pop(out, max_samples);
+}
+
+SensorScan adc_sampler_latest()
+{
+    portENTER_CRITICAL(&latest_mux);
+    SensorScan sample = latest;
+    portEXIT_CRITICAL(&latest_mux);
+    return sample;
+}
+
+uint32_t adc_sampler_rate()
+{
+    return output_rate_hz;
+}
+
+uint32_t adc_sampler_dropped()
+{
+    return dropped;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file adc_sampler.h
+ * @brief Continuous, DMA-driven ADC sampling of every registered sensor.
+ *
+ * The ADC digital controller scans the pin of every channel in SENSORS
+ * (sensors.h) in one pattern into the driver's DMA ring on its own clock. A
+ * small reader task unpacks finished DMA frames into SensorScans, one per scan
+ * of all channels, at a fixed per-channel rate, so sampling no longer depends
+ * on how busy loop() is.
+ */
+#pragma once
+
+#include "sensors.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-channel output rate limits.
+const uint32_t ADC_MIN_SAMPLE_RATE_HZ = 1000;
+const uint32_t ADC_MAX_SAMPLE_RATE_HZ = 10000;
+// Default per-channel output rate.
+const uint32_t ADC_SAMPLE_RATE_HZ = 1000;
+
+struct SensorScan
+{
+    uint32_t timestamp_us;      // Sample index at the configured rate; re-anchored after a DMA overflow.
+    uint16_t raw[SENSOR_COUNT]; // Raw 12-bit ADC counts, indexed like SENSORS.
+};
+
+/**
+ * @brief Configures the ADC DMA controller and starts the reader task.
+ *
+ * @param rate_hz Per-channel output rate, clamped to 1-10 kHz.
+ * @return true if the ADC driver started. false if a channel is not on ADC1.
+ */
+bool adc_sampler_begin(uint32_t rate_hz = ADC_SAMPLE_RATE_HZ);
+
+/**
+ * @brief Drains buffered scans of all channels, oldest first.
+ *
+ * @param out
+ * @param max_samples
+ * @return Number of samples written to out.
+ */
+size_t adc_sampler_read(SensorScan *out, size_t max_samples);
+
+/**
+ * @brief Returns the most recent sample without consuming anything.
+ *
+ * @return SensorScan
+ */
+SensorScan adc_sampler_latest();
+
+/**
+ * @brief Actual per-channel output rate in Hz.
+ */
+uint32_t adc_sampler_rate();
+
+/**
+ * @brief Samples lost because a buffer (DMA or output ring) overflowed.
+ */
+uint32_t adc_sampler_dropped();
@@ -0,0 +1,150 @@
+/**
+ * @file calibration.cpp
+ * @brief NVS-backed calibration with background re-measurement.
+ */
+#include "calibration.h"
+#include "load_cell.h"
+#include "transducer.h"
+#include <Preferences.h>
+
+#define CALIBRATION_NAMESPACE "gina"
+#define CALIBRATION_KEY "calibration"
+
+static Calibration current;
+
+// Running job. Only touched from the actuation task.
+static CalibrationJob job = CALIBRATION_IDLE;
+static uint32_t job_start_ms = 0;
+static int32_t job_grams = 0;
+static int64_t sensor_sum[SENSOR_COUNT];
+static uint32_t sensor_count = 0;
+static int64_t load_sum = 0;
+static uint32_t load_count = 0;
+static bool saved_ok = false;
+
+static void set_defaults()
+{
+    current.version = CALIBRATION_VERSION;
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+        current.tare_x10[ch] = 0;
+    current.load_offset = LOAD_CELL_OFFSET;
+    current.load_scale = LOAD_CELL_SCALE;
+}
+
+static bool save()
+{
+    Preferences preferences;
+    if (!preferences.begin(CALIBRATION_NAMESPACE, false))
+        return false;
+    bool saved = preferences.putBytes(CALIBRATION_KEY, &current, sizeof(current)) == sizeof(current);
+    preferences.end();
+    return saved;
+}
+
+static bool start(CalibrationJob next, uint32_t now_ms)
+{
+    if (job != CALIBRATION_IDLE)
+        return false;
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+        sensor_sum[ch] = 0;
+    sensor_count = 0;
+    load_sum = 0;
+    load_count = 0;
+    job_start_ms = now_ms;
+    job = next;
+    return true;
+}
+
+bool calibration_begin()
+{
+    set_defaults();
+
+    Preferences preferences;
+    if (!preferences.begin(CALIBRATION_NAMESPACE, true))
+        return false;
+    Calibration saved;
+    bool found = preferences.getBytes(CALIBRATION_KEY, &saved, sizeof(saved)) == sizeof(saved) &&
+                 saved.version == CALIBRATION_VERSION;
+    preferences.end();
+
+    if (found)
+        current = saved;
+    return found;
+}
+
+const Calibration &calibration()
+{
+    return current;
+}
+
+bool calibration_start_tare(uint32_t now_ms)
+{
+    return start(CALIBRATION_TARE, now_ms);
+}
+
+bool calibration_start_scale(uint32_t now_ms, int32_t grams)
+{
+    if (grams == 0)
+        return false;
+    job_grams = grams;
+    return start(CALIBRATION_SCALE, now_ms);
+}
+
+CalibrationJob calibration_job()
+{
+    return job;
+}
+
+void calibration_feed_sensors(const SensorScan &sample)
+{
+    if (job != CALIBRATION_TARE)
+        return;
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+        sensor_sum[ch] += rawToUnitsX10(ch, sample.raw[ch]);
+    sensor_count++;
+}
+
+void calibration_feed_load(int32_t raw)
+{
+    if (job == CALIBRATION_IDLE)
+        return;
+    load_sum += raw;
+    load_count++;
+}
+
+bool calibration_update(uint32_t now_ms)
+{
+    if (job == CALIBRATION_IDLE || now_ms - job_start_ms < CALIBRATION_WINDOW_MS)
+        return false;
+
+    if (job == CALIBRATION_TARE)
+    {
+        // A channel or the load cell with no samples keeps its old value.
+        if (sensor_count > 0)
+        {
+            for (int ch = 0; ch < SENSOR_COUNT; ch++)
+            {
+                if (SENSORS[ch].tare)
+                    current.tare_x10[ch] = (int32_t)(sensor_sum[ch] / sensor_count);
+            }
+        }
+        if (load_count > 0)
+            current.load_offset = (int32_t)(load_sum / load_count);
+    }
+    else if (load_count > 0)
+    {
+        float counts = (float)(load_sum / load_count - current.load_offset);
+        if (counts != 0)
+            current.load_scale = counts / job_grams;
+    }
+
+    job = CALIBRATION_IDLE;
+    load_cell_set_calibration(current.load_scale, current.load_offset);
+    saved_ok = save();
+    return true;
+}
+
+bool calibration_saved()
+{
+    return saved_ok;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file calibration.h
+ * @brief Sensor tares and load cell scale/offset, cached in NVS.
+ *
+ * setup() boots with the last saved calibration, so nothing blocks on taring.
+ * CMD:TARE and CMD:LC_CAL re-measure in the background from the samples the
+ * actuation task already drains, then save the result.
+ */
+#pragma once
+
+#include "adc_sampler.h"
+#include <stdint.h>
+
+#define CALIBRATION_VERSION 1
+// Length of a background tare or scale measurement.
+#define CALIBRATION_WINDOW_MS 1000
+
+struct Calibration
+{
+    uint16_t version;
+    int32_t tare_x10[SENSOR_COUNT]; // 0.1 units read at rest; 0 for untared channels.
+    int32_t load_offset;            // Raw HX711 counts at zero load.
+    float load_scale;               // Raw counts per gram.
+};
+
+enum CalibrationJob : uint8_t
+{
+    CALIBRATION_IDLE,
+    CALIBRATION_TARE,  // Zero every tared sensor and the load cell.
+    CALIBRATION_SCALE  // Known weight on the load cell.
+};
+
+/**
+ * @brief Loads the saved calibration, or the compile-time defaults.
+ *
+ * @return true if a saved calibration was found.
+ */
+bool calibration_begin();
+
+const Calibration &calibration();
+
+/**
+ * @brief Starts a background tare of the sensors with SensorChannel::tare
+ * set, and the load cell.
+ *
+ * @return false if a job is already running.
+ */
+bool calibration_start_tare(uint32_t now_ms);
+
+/**
+ * @brief Starts a background load cell scale measurement with a known weight
+ * on the cell. Uses the current offset.
+ *
+ * @return false if a job is already running or grams is 0.
+ */
+bool calibration_start_scale(uint32_t now_ms, int32_t grams);
+
+CalibrationJob calibration_job();
+
+/**
+ * @brief Feeds raw samples to a running job. No-ops when idle.
+ */
+void calibration_feed_sensors(const SensorScan &sample);
+void calibration_feed_load(int32_t raw);
+
+/**
+ * @brief Finishes a job once its window has passed and saves the result to
+ * NVS.
+ *
+ * @return true on the call that finished a job.
+ */
+bool calibration_update(uint32_t now_ms);
+
+/**
+ * @brief Whether the last finished job reached NVS.
+ */
+bool calibration_saved();
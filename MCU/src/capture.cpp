@@ -0,0 +1,192 @@
+/**
+ * @file capture.cpp
+ * @brief Pre-trigger capture of full-rate records around a burn.
+ */
+#include "capture.h"
+#include "pressure_filter.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+static const uint32_t CAPTURE_TASK_STACK = 4096;
+static const UBaseType_t CAPTURE_TASK_PRIORITY = 1;
+static const BaseType_t CAPTURE_TASK_CORE = 0;
+
+enum CaptureState
+{
+    CAPTURE_IDLE,      // No ring allocated.
+    CAPTURE_ARMED,     // Overwriting the oldest record.
+    CAPTURE_TRIGGERED, // Window start frozen, waiting for capture_end().
+    CAPTURE_TAIL,      // Capturing until tail_end_us.
+    CAPTURE_COMPLETE   // Waiting for the save task.
+};
+
+static Record *ring = NULL;
+static size_t capacity = 0;
+// Absolute record indices; ring slot is index % capacity.
+static size_t head = 0;
+static size_t window_start = 0;
+
+static volatile CaptureState state = CAPTURE_IDLE;
+static uint32_t pre_us = CAPTURE_PRE_TRIGGER_MS * 1000;
+static uint32_t tail_us = CAPTURE_TAIL_MS * 1000;
+static uint32_t trigger_us = 0;
+static uint32_t tail_end_us = 0;
+static portMUX_TYPE capture_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Writes a completed window to CAPTURE_PATH, unless an undumped one is
+ * there, then re-arms.
+ */
+static void save_capture()
+{
+    // ignition_start() does not trigger over an undumped capture; this
+    // catches a trigger that raced the previous save.
+    File file;
+    if (recorder_undumped(CAPTURE_PATH))
+    {
+        Serial.println("WARNING: " CAPTURE_PATH " was never dumped; new capture discarded.");
+    }
+    else if ((file = LittleFS.open(CAPTURE_PATH, FILE_WRITE)))
+    {
+        RecordingHeader header;
+        header.magic = RECORDING_MAGIC;
+        header.version = RECORDING_VERSION;
+        header.record_size = sizeof(Record);
+        header.pressure_rate_hz = pressure_filter_rate(FILTER_RECORD);
+        header.start_us = trigger_us;
+        file.write((const uint8_t *)&header, sizeof(header));
+
+        // At most two contiguous runs because of the wrap.
+        size_t index = window_start;
+        while (index < head)
+        {
+            size_t slot = index % capacity;
+            size_t run = min(head - index, capacity - slot);
+            file.write((const uint8_t *)&ring[slot], run * sizeof(Record));
+            index += run;
+        }
+        file.close();
+        recorder_set_undumped(CAPTURE_PATH, true);
+        Serial.printf("OKAY: Saved %u capture records to " CAPTURE_PATH ".\n", (unsigned)(head - window_start));
+    }
+    else
+    {
+        Serial.println("ERROR: Could not open " CAPTURE_PATH);
+    }
+
+    portENTER_CRITICAL(&capture_mux);
+    head = 0;
+    window_start = 0;
+    state = CAPTURE_ARMED;
+    portEXIT_CRITICAL(&capture_mux);
+}
+
+static void capture_task(void *arg)
+{
+    while (true)
+    {
+        if (state == CAPTURE_COMPLETE)
+            save_capture();
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+bool capture_begin()
+{
+    for (size_t records = CAPTURE_CAPACITY_RECORDS; records >= 256; records /= 2)
+    {
+        ring = (Record *)heap_caps_malloc(records * sizeof(Record), MALLOC_CAP_SPIRAM);
+        if (!ring)
+            ring = (Record *)heap_caps_malloc(records * sizeof(Record), MALLOC_CAP_8BIT);
+        if (ring)
+        {
+            capacity = records;
+            break;
+        }
+    }
+    if (!ring)
+        return false;
+
+    state = CAPTURE_ARMED;
+    xTaskCreatePinnedToCore(capture_task, "capture", CAPTURE_TASK_STACK, NULL,
+                            CAPTURE_TASK_PRIORITY, NULL, CAPTURE_TASK_CORE);
+    return true;
+}
+
+void capture_configure(uint32_t pre_ms, uint32_t tail_ms)
+{
+    portENTER_CRITICAL(&capture_mux);
+    pre_us = pre_ms * 1000;
+    tail_us = tail_ms * 1000;
+    portEXIT_CRITICAL(&capture_mux);
+}
+
+void capture_log(const Record &record)
+{
+    portENTER_CRITICAL(&capture_mux);
+    switch (state)
+    {
+    case CAPTURE_ARMED:
+        ring[head % capacity] = record;
+        head++;
+        break;
+    case CAPTURE_TRIGGERED:
+    case CAPTURE_TAIL:
+        // Never overwrite the frozen window; a full ring ends the capture.
+        if (head - window_start >= capacity)
+        {
+            state = CAPTURE_COMPLETE;
+            break;
+        }
+        ring[head % capacity] = record;
+        head++;
+        if (state == CAPTURE_TAIL && (int32_t)(record.timestamp_us - tail_end_us) >= 0)
+            state = CAPTURE_COMPLETE;
+        break;
+    default:
+        break;
+    }
+    portEXIT_CRITICAL(&capture_mux);
+}
+
+void capture_trigger()
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL(&capture_mux);
+    if (state == CAPTURE_ARMED)
+    {
+        trigger_us = now;
+        // Records are in time order: binary-search for the first one inside
+        // the pre-trigger window, a few ring reads under the lock instead of
+        // one per record in the window.
+        size_t low = head > capacity ? head - capacity : 0;
+        size_t high = head;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if ((int32_t)(now - ring[middle % capacity].timestamp_us) <= (int32_t)pre_us)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        window_start = low;
+        state = CAPTURE_TRIGGERED;
+    }
+    portEXIT_CRITICAL(&capture_mux);
+}
+
+void capture_end()
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL(&capture_mux);
+    if (state == CAPTURE_TRIGGERED)
+    {
+        tail_end_us = now + tail_us;
+        state = CAPTURE_TAIL;
+    }
+    portEXIT_CRITICAL(&capture_mux);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file capture.h
+ * @brief Pre-trigger capture of full-rate records around a burn.
+ *
+ * While armed, a RAM (PSRAM if present) ring continuously holds the latest
+ * records. capture_trigger() freezes the last pre_ms of history and keeps
+ * capturing until tail_ms after capture_end(). The window is then saved to
+ * CAPTURE_PATH in the recorder file format and the ring re-arms.
+ */
+#pragma once
+
+#include "recorder.h"
+#include <stdint.h>
+
+#define CAPTURE_PATH "/capture.bin"
+
+// Defaults, changeable with CMD:CAP_CFG:<pre_ms>:<tail_ms>.
+const uint32_t CAPTURE_PRE_TRIGGER_MS = 2000;
+const uint32_t CAPTURE_TAIL_MS = 1000;
+// Requested ring size; halved until the allocation succeeds.
+const size_t CAPTURE_CAPACITY_RECORDS = 8192;
+
+/**
+ * @brief Allocates the ring and starts the save task. Arms the capture.
+ *
+ * @return true if a ring could be allocated.
+ */
+bool capture_begin();
+
+void capture_configure(uint32_t pre_ms, uint32_t tail_ms);
+
+/**
+ * @brief Appends a record. Called for every recorder_log(), recording or not.
+ */
+void capture_log(const Record &record);
+
+/**
+ * @brief Freezes the pre-trigger window. Ignored unless armed.
+ */
+void capture_trigger();
+
+/**
+ * @brief Starts the tail countdown. The capture completes tail_ms later, or
+ * earlier if the ring fills.
+ */
+void capture_end();
@@ -0,0 +1,271 @@
+/**
+ * @file command_parser.cpp
+ * @brief Table-driven command parser.
+ */
+#include "command_parser.h"
+#include <string.h>
+
+// Parses the text after a keyword into command. Returns false if malformed.
+typedef bool (*ArgumentParser)(const char *text, Command &command);
+
+struct CommandEntry
+{
+    const char *keyword;
+    CommandOpcode opcode;
+    ArgumentParser parse_arguments; // NULL: keyword is a prefix, rest ignored.
+};
+
+/**
+ * @brief Parses an unsigned decimal integer and advances text past it.
+ *
+ * @return false if there are no digits or the value overflows.
+ */
+static bool parse_uint(const char *&text, int32_t &value)
+{
+    if (*text < '0' || *text > '9')
+        return false;
+
+    int64_t result = 0;
+    while (*text >= '0' && *text <= '9')
+    {
+        result = result * 10 + (*text++ - '0');
+        if (result > INT32_MAX)
+            return false;
+    }
+    value = (int32_t)result;
+    return true;
+}
+
+/**
+ * @brief V<valve>:<OPEN|CLOSE|NEUTRAL|angle>
+ */
+static bool parse_valve(const char *text, Command &command)
+{
+    int32_t valve;
+    if (!parse_uint(text, valve) || valve < 1 || valve > COMMAND_MAX_VALVE || *text++ != ':')
+        return false;
+    command.args[0] = valve;
+
+    if (strcmp(text, "OPEN") == 0)
+        command.position = VALVE_OPEN;
+    else if (strcmp(text, "CLOSE") == 0)
+        command.position = VALVE_CLOSE;
+    else if (strcmp(text, "NEUTRAL") == 0)
+        command.position = VALVE_NEUTRAL;
+    else
+    {
+        int32_t angle;
+        if (!parse_uint(text, angle) || *text != '\0' || angle > 180)
+            return false;
+        command.position = VALVE_ANGLE;
+        command.args[1] = angle;
+    }
+    return true;
+}
+
+/**
+ * @brief <pre_ms>:<tail_ms>
+ */
+static bool parse_capture_config(const char *text, Command &command)
+{
+    return parse_uint(text, command.args[0]) && *text++ == ':' && parse_uint(text, command.args[1]) &&
+           *text == '\0';
+}
+
+/**
+ * @brief <offset_ms>:R:<0|1> or <offset_ms>:V<valve>:<OPEN|CLOSE|NEUTRAL|angle>
+ */
+static bool parse_sequence_step(const char *text, Command &command)
+{
+    int32_t offset_ms;
+    if (!parse_uint(text, offset_ms) || offset_ms > 3600000 || *text++ != ':')
+        return false;
+
+    if (text[0] == 'R' && text[1] == ':')
+    {
+        text += 2;
+        int32_t state;
+        if (!parse_uint(text, state) || *text != '\0' || state > 1)
+            return false;
+        command.args[0] = offset_ms;
+        command.args[1] = STEP_RELAY;
+        command.args[2] = 0;
+        command.args[3] = state;
+        return true;
+    }
+
+    if (*text++ != 'V' || !parse_valve(text, command))
+        return false;
+    command.args[2] = command.args[0];
+    command.args[3] = command.args[1];
+    command.args[0] = offset_ms;
+    command.args[1] = STEP_VALVE;
+    return true;
+}
+
+/**
+ * @brief <FUEL|OX|IMBALANCE|LOAD>:<threshold>:<samples>
+ */
+static bool parse_redline(const char *text, Command &command)
+{
+    for (int rule = 0; rule < REDLINE_RULE_COUNT; rule++)
+    {
+        const char *name = redline_rule_name((RedlineRule)rule);
+        size_t length = strlen(name);
+        if (strncmp(text, name, length) != 0 || text[length] != ':')
+            continue;
+
+        text += length + 1;
+        command.args[0] = rule;
+        return parse_uint(text, command.args[1]) && *text++ == ':' && parse_uint(text, command.args[2]) &&
+               *text == '\0' && command.args[2] <= UINT16_MAX;
+    }
+    return false;
+}
+
+/**
+ * @brief <telemetry_hz>:<record_hz>:<redline_hz>:<iir_shift>
+ */
+static bool parse_filter_config(const char *text, Command &command)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (i > 0 && *text++ != ':')
+            return false;
+        if (!parse_uint(text, command.args[i]))
+            return false;
+    }
+    return *text == '\0' && command.args[0] > 0 && command.args[1] > 0 && command.args[2] > 0 &&
+           command.args[3] <= 15;
+}
+
+/**
+ * @brief <grams>
+ */
+static bool parse_grams(const char *text, Command &command)
+{
+    return parse_uint(text, command.args[0]) && *text == '\0' && command.args[0] > 0;
+}
+
+/**
+ * @brief <timeout_ms>, 0 or DEADMAN_MIN_TIMEOUT_MS..DEADMAN_MAX_TIMEOUT_MS
+ */
+static bool parse_deadman_config(const char *text, Command &command)
+{
+    return parse_uint(text, command.args[0]) && *text == '\0' &&
+           (command.args[0] == 0 ||
+            (command.args[0] >= DEADMAN_MIN_TIMEOUT_MS && command.args[0] <= DEADMAN_MAX_TIMEOUT_MS));
+}
+
+// Checked in order; a keyword must not be a prefix of a later one.
+static const CommandEntry COMMANDS[] = {
+    {"IGN", CMD_IGNITE, NULL},
+    {"OPEN_ALL", CMD_OPEN_ALL, NULL},
+    {"CLOSE_ALL", CMD_CLOSE_ALL, NULL},
+    {"CLOSE_VALVES", CMD_CLOSE_VALVES, NULL},
+    {"REC_START", CMD_REC_START, NULL},
+    {"REC_STOP", CMD_REC_STOP, NULL},
+    {"REC_DUMP", CMD_REC_DUMP, NULL},
+    {"CAP_DUMP", CMD_CAP_DUMP, NULL},
+    {"CAP_CFG:", CMD_CAP_CFG, parse_capture_config},
+    {"SEQ_ADD:", CMD_SEQ_ADD, parse_sequence_step},
+    {"SEQ_CLEAR", CMD_SEQ_CLEAR, NULL},
+    {"SEQ_DEFAULT", CMD_SEQ_DEFAULT, NULL},
+    {"SEQ_SHOW", CMD_SEQ_SHOW, NULL},
+    {"RL_SET:", CMD_RL_SET, parse_redline},
+    {"RL_SHOW", CMD_RL_SHOW, NULL},
+    {"RL_RESET", CMD_RL_RESET, NULL},
+    {"FLT_CFG:", CMD_FLT_CFG, parse_filter_config},
+    {"TARE", CMD_TARE, NULL},
+    {"LC_CAL:", CMD_LC_CAL, parse_grams},
+    {"DM_CFG:", CMD_DM_CFG, parse_deadman_config},
+    {"STATS_RESET", CMD_STATS_RESET, NULL},
+    {"STATS", CMD_STATS, NULL},
+    {"V", CMD_VALVE, parse_valve},
+};
+
+Command parse_command(const char *line)
+{
+    Command command = {};
+    command.opcode = CMD_NONE;
+
+    if (strncmp(line, "CMD:", 4) == 0)
+        line += 4;
+    if (*line == '\0')
+        return command;
+
+    for (const CommandEntry &entry : COMMANDS)
+    {
+        size_t length = strlen(entry.keyword);
+        if (strncmp(line, entry.keyword, length) != 0)
+            continue;
+
+        command.opcode = entry.opcode;
+        if (entry.parse_arguments && !entry.parse_arguments(line + length, command))
+            command.opcode = CMD_INVALID;
+        return command;
+    }
+
+    command.opcode = CMD_UNKNOWN;
+    return command;
+}
+
+const char *command_name(CommandOpcode opcode)
+{
+    switch (opcode)
+    {
+    case CMD_NONE:
+        return "NONE";
+    case CMD_INVALID:
+        return "INVALID";
+    case CMD_UNKNOWN:
+        return "UNKNOWN";
+    case CMD_IGNITE:
+        return "IGN";
+    case CMD_OPEN_ALL:
+        return "OPEN_ALL";
+    case CMD_CLOSE_ALL:
+        return "CLOSE_ALL";
+    case CMD_VALVE:
+        return "VALVE";
+    case CMD_REC_START:
+        return "REC_START";
+    case CMD_REC_STOP:
+        return "REC_STOP";
+    case CMD_REC_DUMP:
+        return "REC_DUMP";
+    case CMD_CAP_DUMP:
+        return "CAP_DUMP";
+    case CMD_CAP_CFG:
+        return "CAP_CFG";
+    case CMD_SEQ_ADD:
+        return "SEQ_ADD";
+    case CMD_SEQ_CLEAR:
+        return "SEQ_CLEAR";
+    case CMD_SEQ_DEFAULT:
+        return "SEQ_DEFAULT";
+    case CMD_SEQ_SHOW:
+        return "SEQ_SHOW";
+    case CMD_RL_SET:
+        return "RL_SET";
+    case CMD_RL_SHOW:
+        return "RL_SHOW";
+    case CMD_RL_RESET:
+        return "RL_RESET";
+    case CMD_FLT_CFG:
+        return "FLT_CFG";
+    case CMD_TARE:
+        return "TARE";
+    case CMD_LC_CAL:
+        return "LC_CAL";
+    case CMD_STATS:
+        return "STATS";
+    case CMD_STATS_RESET:
+        return "STATS_RESET";
+    case CMD_CLOSE_VALVES:
+        return "CLOSE_VALVES";
+    case CMD_DM_CFG:
+        return "DM_CFG";
+    }
+    return "?";
+}
@@ -0,0 +1,141 @@
+/**
+ * @file command_parser.h
+ * @brief Allocation-free line reader and table-driven command parser.
+ *
+ * Commands arrive as text lines ("CMD:V1:OPEN"). LineReader assembles them
+ * one byte at a time into a fixed buffer; parse_command() resolves a line to
+ * an opcode plus arguments without touching the heap. Keep this file free of
+ * Arduino includes so it builds on the host.
+ */
+#pragma once
+
+#include "deadman.h"
+#include "redline.h"
+#include "sequencer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+enum CommandOpcode : uint8_t
+{
+    CMD_NONE,    // Empty line.
+    CMD_INVALID, // Known command with bad arguments.
+    CMD_UNKNOWN, // "CMD:" with an unrecognised keyword.
+    CMD_IGNITE,
+    CMD_OPEN_ALL,
+    CMD_CLOSE_ALL,
+    CMD_VALVE,
+    CMD_REC_START,
+    CMD_REC_STOP,
+    CMD_REC_DUMP,
+    CMD_CAP_DUMP,
+    CMD_CAP_CFG,
+    CMD_SEQ_ADD,
+    CMD_SEQ_CLEAR,
+    CMD_SEQ_DEFAULT,
+    CMD_SEQ_SHOW,
+    CMD_RL_SET,
+    CMD_RL_SHOW,
+    CMD_RL_RESET,
+    CMD_FLT_CFG,
+    CMD_TARE,
+    CMD_LC_CAL,
+    CMD_STATS,
+    CMD_STATS_RESET,
+    CMD_CLOSE_VALVES, // Lora Away lost Lora Home.
+    CMD_DM_CFG
+};
+
+enum ValvePosition : uint8_t
+{
+    VALVE_OPEN,
+    VALVE_CLOSE,
+    VALVE_NEUTRAL,
+    VALVE_ANGLE // Raw angle in Command::args[1].
+};
+
+// Highest valve number accepted by the parser.
+#define COMMAND_MAX_VALVE 9
+// Most numeric arguments any command takes.
+#define COMMAND_MAX_ARGS 4
+
+struct Command
+{
+    CommandOpcode opcode;
+    ValvePosition position;          // CMD_VALVE and valve CMD_SEQ_ADD steps.
+    int32_t args[COMMAND_MAX_ARGS];  // CMD_VALVE: {valve, angle}. CMD_CAP_CFG: {pre_ms, tail_ms}.
+                                     // CMD_SEQ_ADD: {offset_ms, SequenceAction, valve, angle or relay}.
+                                     // CMD_RL_SET: {RedlineRule, threshold, samples}.
+                                     // CMD_FLT_CFG: {telemetry_hz, record_hz, redline_hz, iir_shift}.
+                                     // CMD_LC_CAL: {grams}.
+                                     // CMD_DM_CFG: {timeout_ms}.
+    int32_t trace;                   // Radio sequence for latency tracing (command_trace.h); -1 if none.
+    uint32_t received_us;            // When the link handed it over. Set by the caller, like trace.
+};
+
+/**
+ * @brief Parses one trimmed line.
+ *
+ * @param line NUL-terminated, with or without the "CMD:" header.
+ * @return Command. opcode is CMD_NONE/CMD_UNKNOWN/CMD_INVALID on failure.
+ */
+Command parse_command(const char *line);
+
+/**
+ * @brief Human-readable opcode name, for logs.
+ */
+const char *command_name(CommandOpcode opcode);
+
+/**
+ * @brief Assembles newline-terminated lines from a byte stream.
+ *
+ * Trailing whitespace and '\r' are trimmed. Lines longer than N - 1 bytes are
+ * discarded whole.
+ */
+template <size_t N>
+class LineReader
+{
+public:
+    /**
+     * @brief Consumes a byte.
+     *
+     * @return true when a complete line is ready in line().
+     */
+    bool feed(char c)
+    {
+        if (c == '\n')
+        {
+            bool complete = !overflow_ && length_ > 0;
+            while (length_ > 0 && (buffer_[length_ - 1] == ' ' || buffer_[length_ - 1] == '\r' ||
+                                   buffer_[length_ - 1] == '\t'))
+                length_--;
+            buffer_[length_] = '\0';
+            line_length_ = length_;
+            length_ = 0;
+            overflow_ = false;
+            return complete && line_length_ > 0;
+        }
+
+        if (overflow_ || (length_ == 0 && (c == ' ' || c == '\r' || c == '\t')))
+            return false;
+
+        if (length_ >= N - 1)
+        {
+            overflow_ = true;
+            return false;
+        }
+        buffer_[length_++] = c;
+        return false;
+    }
+
+    /**
+     * @brief The last complete line. Valid until the next feed().
+     */
+    const char *line() const { return buffer_; }
+    size_t length() const { return line_length_; }
+
+private:
+    char buffer_[N] = {};
+    size_t length_ = 0;
+    size_t line_length_ = 0;
+    bool overflow_ = false;
+};
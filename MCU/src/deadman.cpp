@@ -0,0 +1,72 @@
+/**
+ * @file deadman.cpp
+ * @brief Periodic esp_timer behind the deadman.
+ */
+#include "deadman.h"
+#include "actuator.h"
+#include "sequencer.h"
+#include "valves.h"
+#include <esp_timer.h>
+
+static DeadmanTimer deadman;
+static esp_timer_handle_t check_timer = NULL;
+static volatile bool trip_pending = false;
+
+static uint32_t now_ms()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief Every DEADMAN_CHECK_MS. Safes the stand from here, so a stuck comms
+ * or actuation task cannot delay it.
+ */
+static void check_tick(void *arg)
+{
+    if (!deadman.check(now_ms()))
+        return;
+
+    // Relay off first, then defaults over whatever the timeline closed.
+    sequencer_abort();
+    ValveMove moves[NUM_VALVES];
+    for (int valve = 1; valve <= NUM_VALVES; valve++)
+        moves[valve - 1] = {(uint8_t)valve, (uint8_t)valve_angle(valve, VALVES[valve - 1].default_state)};
+    actuator_move_many(moves, NUM_VALVES);
+    trip_pending = true;
+}
+
+void deadman_begin()
+{
+    deadman.feed(now_ms());
+
+    esp_timer_create_args_t args = {};
+    args.callback = check_tick;
+    args.name = "deadman";
+    esp_timer_create(&args, &check_timer);
+    esp_timer_start_periodic(check_timer, DEADMAN_CHECK_MS * 1000);
+}
+
+void deadman_feed()
+{
+    deadman.feed(now_ms());
+}
+
+void deadman_configure(uint32_t timeout_ms)
+{
+    // Counts from now, so a shorter timeout does not trip at once.
+    deadman.feed(now_ms());
+    deadman.configure(timeout_ms);
+}
+
+uint32_t deadman_timeout_ms()
+{
+    return deadman.timeout_ms();
+}
+
+bool deadman_take_trip()
+{
+    if (!trip_pending)
+        return false;
+    trip_pending = false;
+    return true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file deadman.h
+ * @brief Loss-of-link failsafe on the MCU itself.
+ *
+ * Every valid command from Lora Away or the GCS over UDP feeds the deadman.
+ * So do link heartbeats: SERIAL_HEARTBEAT, which Away sends whenever it hears
+ * from Lora Home, and the GCS's UDP keepalives. When nothing has fed it for
+ * the timeout, a periodic esp_timer aborts any burn and drives every valve to
+ * its config/valves.yaml default. This does not wait for Away's own 8 s
+ * CMD:CLOSE_VALVES, and it still works if Away or the Serial2 wire is dead.
+ *
+ * Feeds happen when comms_task reads a packet, about 1 ms after it arrives.
+ * Worst case from the last packet arriving to the servo PWM changing:
+ * timeout + one comms_task pass + DEADMAN_CHECK_MS + ACTUATOR_PERIOD_US, so
+ * about timeout + 31 ms, plus any slew profile.
+ * The trip latches until the next feed, so valves can be commanded again once
+ * a link is back. Keep this file free of Arduino includes so it builds on the
+ * host.
+ */
+#pragma once
+
+#include <stdint.h>
+
+// Override in platformio.ini build_flags, e.g. -DDEADMAN_TIMEOUT_MS=5000.
+#ifndef DEADMAN_TIMEOUT_MS
+#define DEADMAN_TIMEOUT_MS 10000
+#endif
+// Shortest and longest timeout CMD:DM_CFG accepts (0 disables). Below the
+// minimum, missed Lora beacons alone would trip it.
+#define DEADMAN_MIN_TIMEOUT_MS 1000
+#define DEADMAN_MAX_TIMEOUT_MS 600000
+// How often the timer checks.
+#define DEADMAN_CHECK_MS 10
+
+/**
+ * @brief The timeout logic, apart from the timer that runs it.
+ *
+ * feed() and check() may run on different tasks. Both take millis()-style
+ * times that may wrap.
+ */
+class DeadmanTimer
+{
+public:
+    explicit DeadmanTimer(uint32_t timeout_ms = DEADMAN_TIMEOUT_MS) : timeout_ms_(timeout_ms) {}
+
+    void feed(uint32_t now_ms) { last_feed_ms_ = now_ms; }
+
+    /**
+     * @param timeout_ms 0 disables.
+     */
+    void configure(uint32_t timeout_ms) { timeout_ms_ = timeout_ms; }
+    uint32_t timeout_ms() const { return timeout_ms_; }
+
+    /**
+     * @return true on the first check more than the timeout after the last
+     * feed. It returns true again only after another feed.
+     */
+    bool check(uint32_t now_ms)
+    {
+        uint32_t timeout_ms = timeout_ms_;
+        // Signed, so a feed stamped just after now_ms is not a huge silence.
+        int32_t silent_ms = (int32_t)(now_ms - last_feed_ms_);
+        if (timeout_ms == 0 || silent_ms < (int32_t)timeout_ms)
+        {
+            tripped_ = false;
+            return false;
+        }
+        if (tripped_)
+            return false;
+        tripped_ = true;
+        trips_++;
+        return true;
+    }
+
+    bool tripped() const { return tripped_; }
+    uint32_t trips() const { return trips_; }
+
+private:
+    volatile uint32_t timeout_ms_;
+    volatile uint32_t last_feed_ms_ = 0;
+    bool tripped_ = false;
+    uint32_t trips_ = 0;
+};
+
+/**
+ * @brief Starts the check timer, counting from now. Call after
+ * actuator_begin() and sequencer_begin().
+ */
+void deadman_begin();
+
+/**
+ * @brief A command or heartbeat arrived. Safe from any task.
+ */
+void deadman_feed();
+
+/**
+ * @param timeout_ms 0 disables.
+ */
+void deadman_configure(uint32_t timeout_ms);
+uint32_t deadman_timeout_ms();
+
+/**
+ * @brief true once after each trip, for the caller to log and record it.
+ */
+bool deadman_take_trip();
@@ -0,0 +1,133 @@
+/**
+ * @file decimator.h
+ * @brief Integer CIC decimator and one-pole IIR low-pass.
+ *
+ * No Arduino includes; builds on the host.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define CIC_MAX_ORDER 4
+
+/**
+ * @brief N-stage cascaded integrator-comb decimator (differential delay 1).
+ *
+ * Equivalent to N cascaded R-sample moving averages followed by keeping every
+ * Rth output, at N adds per input and N subtracts per output. Output is
+ * normalized by R^N, so the DC gain is 1. Group delay is N * (R - 1) / 2 input
+ * samples.
+ */
+class CicDecimator
+{
+public:
+    /**
+     * @param factor R, 1 passes every sample through.
+     * @param order N, 1..CIC_MAX_ORDER. 1 is a plain boxcar average.
+     */
+    void configure(uint16_t factor, uint8_t order)
+    {
+        factor_ = factor < 1 ? 1 : factor;
+        order_ = order < 1 ? 1 : order > CIC_MAX_ORDER ? CIC_MAX_ORDER : order;
+        gain_ = 1;
+        for (uint8_t i = 0; i < order_; i++)
+            gain_ *= factor_;
+        reset();
+    }
+
+    void reset()
+    {
+        for (uint8_t i = 0; i < CIC_MAX_ORDER; i++)
+        {
+            integrators_[i] = 0;
+            combs_[i] = 0;
+        }
+        phase_ = 0;
+    }
+
+    /**
+     * @brief Consumes one input sample.
+     *
+     * @param out Set when an output is ready.
+     * @return true every factor() inputs.
+     */
+    bool push(int32_t x, int32_t &out)
+    {
+        int64_t value = x;
+        for (uint8_t i = 0; i < order_; i++)
+        {
+            integrators_[i] += value;
+            value = integrators_[i];
+        }
+
+        if (++phase_ < factor_)
+            return false;
+        phase_ = 0;
+
+        for (uint8_t i = 0; i < order_; i++)
+        {
+            int64_t previous = combs_[i];
+            combs_[i] = value;
+            value -= previous;
+        }
+
+        // Round to nearest.
+        out = (int32_t)((value >= 0 ? value + gain_ / 2 : value - gain_ / 2) / gain_);
+        return true;
+    }
+
+    uint16_t factor() const { return factor_; }
+    uint8_t order() const { return order_; }
+
+    /**
+     * @brief Group delay in input samples, times two (exact for integer math).
+     */
+    uint32_t group_delay_x2() const { return (uint32_t)order_ * (factor_ - 1); }
+
+private:
+    int64_t integrators_[CIC_MAX_ORDER] = {};
+    int64_t combs_[CIC_MAX_ORDER] = {};
+    int64_t gain_ = 1;
+    uint16_t factor_ = 1;
+    uint16_t phase_ = 0;
+    uint8_t order_ = 1;
+};
+
+/**
+ * @brief y += (x - y) / 2^shift, with 16 fractional bits of state.
+ *
+ * shift 0 is a pass-through. DC group delay is 2^shift - 1 samples.
+ */
+class IirLowPass
+{
+public:
+    void configure(uint8_t shift)
+    {
+        shift_ = shift > 15 ? 15 : shift;
+        primed_ = false;
+    }
+
+    int32_t step(int32_t x)
+    {
+        if (shift_ == 0)
+            return x;
+
+        int64_t input = (int64_t)x << 16;
+        // Starts at the first input instead of ramping up from zero.
+        if (!primed_)
+        {
+            state_ = input;
+            primed_ = true;
+        }
+        state_ += (input - state_) >> shift_;
+        return (int32_t)((state_ + (1 << 15)) >> 16);
+    }
+
+    uint8_t shift() const { return shift_; }
+    uint32_t group_delay() const { return (1u << shift_) - 1; }
+
+private:
+    int64_t state_ = 0;
+    uint8_t shift_ = 0;
+    bool primed_ = false;
+};
@@ -0,0 +1,122 @@
+/**
+ * @file load_cell.cpp
+ * @brief Interrupt-driven HX711 load cell acquisition.
+ */
+#include "load_cell.h"
+#include "HX711.h"
+#include "ring_buffer.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <profiler.h>
+
+// Reader task. Shares the sampling core; shifting out 24 bits takes ~50 us.
+static const uint32_t LOAD_CELL_TASK_STACK = 4096;
+static const UBaseType_t LOAD_CELL_TASK_PRIORITY = configMAX_PRIORITIES - 2;
+static const BaseType_t LOAD_CELL_TASK_CORE = 1;
+
+// Load cell object.
+static HX711 load_cell;
+
+// ~3 s of conversions at 80 SPS.
+static RingBuffer<LoadSample, 256> samples;
+static volatile uint32_t dropped = 0;
+static volatile int32_t latest_raw = 0;
+
+static TaskHandle_t load_cell_task_handle = NULL;
+// Set while the task clocks data out; DT toggles with the data bits then.
+static volatile bool shifting = false;
+static volatile uint32_t ready_us = 0;
+
+static ProfileSection profile_isr("load_cell_isr");
+static ProfileSection profile_shift("load_cell_shift");
+
+/**
+ * @brief DT falling edge: a conversion is ready.
+ */
+static void IRAM_ATTR dt_isr()
+{
+    if (shifting)
+        return;
+
+    ProfileScope scope(profile_isr);
+    ready_us = (uint32_t)esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(load_cell_task_handle, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief Clocks out each conversion as soon as the ISR reports it.
+ *
+ * @param arg Unused.
+ */
+static void load_cell_task(void *arg)
+{
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Spurious wake (e.g. a latched edge from the previous shift-out).
+        if (digitalRead(DT_PIN) != LOW)
+            continue;
+
+        LoadSample sample;
+        sample.timestamp_us = ready_us;
+        shifting = true;
+        {
+            ProfileScope scope(profile_shift);
+            sample.raw = load_cell.read();
+        }
+        shifting = false;
+        // Drops edges seen during shift-out.
+        ulTaskNotifyTake(pdTRUE, 0);
+
+        latest_raw = sample.raw;
+        if (!samples.push(sample))
+            dropped++;
+    }
+}
+
+void load_cell_begin(float scale, int32_t offset, LoadCellRate rate)
+{
+    if (LOAD_CELL_RATE_PIN >= 0)
+    {
+        pinMode(LOAD_CELL_RATE_PIN, OUTPUT);
+        digitalWrite(LOAD_CELL_RATE_PIN, rate == LOAD_CELL_80_SPS ? HIGH : LOW);
+    }
+
+    load_cell.begin(DT_PIN, SCK_PIN);
+    load_cell_set_calibration(scale, offset);
+    latest_raw = offset;
+
+    xTaskCreatePinnedToCore(load_cell_task, "load_cell", LOAD_CELL_TASK_STACK, NULL,
+                            LOAD_CELL_TASK_PRIORITY, &load_cell_task_handle, LOAD_CELL_TASK_CORE);
+    attachInterrupt(digitalPinToInterrupt(DT_PIN), dt_isr, FALLING);
+}
+
+void load_cell_set_calibration(float scale, int32_t offset)
+{
+    load_cell.set_scale(scale);
+    load_cell.set_offset(offset);
+}
+
+size_t load_cell_read(LoadSample *out, size_t max_samples)
+{
+    return samples.pop(out, max_samples);
+}
+
+float load_cell_to_units(int32_t raw)
+{
+    return (raw - load_cell.get_offset()) / load_cell.get_scale();
+}
+
+float load_cell_latest_units()
+{
+    return load_cell_to_units(latest_raw);
+}
+
+uint32_t load_cell_dropped()
+{
+    return dropped;
+}
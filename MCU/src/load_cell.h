@@ -0,0 +1,72 @@
+/**
+ * @file load_cell.h
+ * @brief Interrupt-driven HX711 load cell acquisition.
+ *
+ * The HX711 pulls DT low when a conversion is ready. A falling-edge ISR
+ * timestamps it and wakes a dedicated task that clocks the 24 bits out, so
+ * every conversion lands in a ring buffer and nothing else ever busy-waits on
+ * the chip.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Load cell pins.
+#define DT_PIN 18
+#define SCK_PIN 5
+// HX711 RATE pin (LOW: 10 SPS, HIGH: 80 SPS). -1 if strapped on the board.
+#define LOAD_CELL_RATE_PIN -1
+
+// Default calibration, until one is saved (see calibration.h).
+const float LOAD_CELL_SCALE = 33.1656583;
+const long LOAD_CELL_OFFSET = -163065;
+
+enum LoadCellRate
+{
+    LOAD_CELL_10_SPS,
+    LOAD_CELL_80_SPS
+};
+
+struct LoadSample
+{
+    uint32_t timestamp_us; // When DT fell (conversion ready).
+    int32_t raw;           // Signed 24-bit HX711 counts.
+};
+
+/**
+ * @brief Configures the HX711 and starts ISR-driven acquisition. Does not
+ * tare; the offset comes from the cached calibration.
+ *
+ * @param rate Only takes effect if LOAD_CELL_RATE_PIN is wired.
+ */
+void load_cell_begin(float scale, int32_t offset, LoadCellRate rate = LOAD_CELL_80_SPS);
+
+/**
+ * @brief Replaces the scale (counts per gram) and zero offset.
+ */
+void load_cell_set_calibration(float scale, int32_t offset);
+
+/**
+ * @brief Drains buffered conversions, oldest first.
+ *
+ * @param out
+ * @param max_samples
+ * @return Number of samples written to out.
+ */
+size_t load_cell_read(LoadSample *out, size_t max_samples);
+
+/**
+ * @brief Converts raw counts to calibrated units (grams).
+ */
+float load_cell_to_units(int32_t raw);
+
+/**
+ * @brief Most recent conversion in calibrated units, without consuming.
+ */
+float load_cell_latest_units();
+
+/**
+ * @brief Conversions lost because the ring buffer was full.
+ */
+uint32_t load_cell_dropped();
@@ -8,14 +8,30 @@
  * @copyright Copyright (c) 2025
  *
  */
-#include "HX711.h"
+#include "actuator.h"
+#include "adc_sampler.h"
+#include "calibration.h"
+#include "capture.h"
+#include "command_parser.h"
+#include "command_trace.h"
+#include "deadman.h"
+#include "load_cell.h"
+#include "pressure_filter.h"
+#include "recorder.h"
+#include "redline.h"
+#include "sample_block.h"
+#include "sequencer.h"
+#include "server.h"
+#include "ring_buffer.h"
+#include "telemetry_frame.h"
 #include "transducer.h"
+#include "valves.h"
 #include <Arduino.h>
+#include <uart_link.h>
 #include <ArduinoJson.h>
-#include <EEPROM.h>
-#include <ESP32Servo.h>
-#include <WiFi.h>
 #include <cmath>
+#include <esp_timer.h>
+#include <profiler.h>
 
 enum LogType
 {
@@ -26,381 +42,1034 @@ enum LogType
 };
 
 // Function Headers
-void init_servo();
-void decode_valve_command(String);
+void decode_valve_command(const Command &);
 void servo_set(int, int);
+void servo_set_many(const ValveMove *, size_t);
 void log(const LogType, const String);
+void log(const LogType, const char *format, ...);
 void check_for_connections();
-void decodeCommand(String);
+void decodeCommand(const Command &);
 void close_all_valves();
+void default_all_valves();
 void open_all_valves();
 void ignition_sequence();
-int get_servo_angle(int valve_index, String angle);
 void ignition_start();
 void ignition_stop();
-
-// Load cell pins.
-#define DT_PIN 18
-#define SCK_PIN 5
-// Load cell object.
-HX711 load_cell;
-
-// Igniter relay pin.
-#define RELAY_PIN 22
+void decode_sequence_step(const Command &);
+void print_sequence();
+void redline_abort();
+void print_redlines();
+void handle_link_command(const SerialPacket &, const char *source);
+void handle_udp_command(const SerialPacket &);
+void send_sample_block();
+void report_link_health();
+void print_stats();
+void send_log(const char *text);
 
 /////////// VALVES ///////////////
-// Servo pins.
-#define VALVE_N2_PIN 12
-#define VALVE_RELEASE_PIN 27
-#define VALVE_FUEL_PIN 25
-#define VALVE_OX_PIN 32
-static const int NUM_VALVES = 4;
-Servo valve_n2;
-Servo valve_release;
-Servo valve_fuel;
-Servo valve_ox;
-
-// NITROGEN VALVE
-const int open_valve_n2 = 95;
-const int close_valve_n2 = 150;
-const int neutral_valve_n2 = 120;
-
-// RELEASE VALVE
-const int open_valve_release = 82;
-const int close_valve_release = 172;
-const int neutral_valve_release = 130;
-
-// FUEL VALVE
-const int open_valve_fuel = 85;
-const int close_valve_fuel = 170;
-const int neutral_valve_fuel = 130;
-
-// OX VALVE
-const int open_valve_ox = 73;
-const int close_valve_ox = 150;
-const int neutral_valve_ox = 110;
-
-// Array of servo pointers.
-Servo *valves[NUM_VALVES] = {&valve_n2, &valve_release, &valve_fuel, &valve_ox};
+// Pins and angles come from config/valves.yaml (see valves.h); servos are
+// driven through actuator.h.
 ////////////////////////////////////
 
-#define FUEL_PTD_INDEX 1
-#define OX_PTD_INDEX 2
-double pressure_count = 0;
-double fuel_pressure_sum = 0.0;
-double ox_pressure_sum = 0.0;
+// Latest decimated pressures in 0.1 PSI, tared (see pressure_filter.h).
+int32_t fuel_pressure_x10 = 0;
+int32_t ox_pressure_x10 = 0;
+uint32_t pressure_timestamp_us = 0;
+bool pressure_ready = false;
+double load_count = 0;
+double load_sum = 0.0;
 int last_load_reading = 0;
+// Timestamp of the newest load cell conversion, for the load loss redline.
+uint32_t last_load_us = 0;
 
-// Telemtry writing interval.
+// Telemetry is paced by the pressure filter's telemetry output (20 Hz by
+// default; Lora Away batches frames). If the sampler stalls, frames still go
+// out on this interval, flagged STATUS_PRESSURE_STALE.
 unsigned long lastDataSendTime = 0;
-const unsigned long dataSendInterval = 666;
+const unsigned long dataStallInterval = 200;
 
-// Ignition parameters.
-const unsigned long fire_length = 5000;
-unsigned long ignition_time = 0;
+// Ignition. The timeline itself runs in sequencer.cpp.
 bool firing = false;
 
+/////////// TASKS ///////////////
+// Sampling/actuation owns the valves and starts the ignition sequencer. Comms owns
+// the Lora Away and GCS UDP links. They only talk through the queues below.
+#define ACTUATION_CORE 1
+#define COMMS_CORE 0
+static const UBaseType_t ACTUATION_PRIORITY = configMAX_PRIORITIES - 3;
+static const UBaseType_t COMMS_PRIORITY = 2;
+static const uint32_t TASK_STACK = 8192;
+
+// Longest command line accepted from USB serial.
+#define COMMAND_LENGTH 64
+
+// Serial2 wire to Lora Away: COBS/CRC packets, baud negotiated up from 115200.
+#define LINK_RX_PIN 16
+#define LINK_TX_PIN 17
+UartLink away_link(UART_NUM_2, UART_LINK_LEADER);
+
+// Comms -> actuation. Commands are parsed by comms; actuation just dispatches.
+RingBuffer<Command, 16> command_queue;
+// Actuation -> comms. Comms seals (CRC) and writes the frames.
+RingBuffer<TelemetryFrame, 8> telemetry_queue;
+uint16_t telemetry_sequence = 0;
+
+// Actuation -> comms. Every record-filter scan, tared, for the UDP stream;
+// only filled while a GCS is on UDP. Comms packs them into sample blocks.
+struct StreamScan
+{
+    uint32_t timestamp_us;
+    int16_t values[SENSOR_COUNT]; // 0.1 units, sensors.h order.
+};
+RingBuffer<StreamScan, 256> stream_queue;
+SampleBlockBuilder sample_block;
+// Longest a scan waits in a block, so plots stay live at low record rates.
+static const uint32_t STREAM_MAX_AGE_US = 20000;
+
+// Latency tracing (command_trace.h). Actuation notes when each traced command
+// moved its servo and reports it with the next telemetry frame; comms returns
+// the CommandTiming to Lora Away.
+struct PendingTrace
+{
+    CommandTiming timing;
+    uint32_t executed_us;
+};
+PendingTrace pending_traces[4];
+size_t pending_trace_count = 0;
+// Set by servo_set()/servo_set_many() after the PWM write.
+uint32_t servo_written_us = 0;
+RingBuffer<CommandTiming, 8> timing_queue;
+
+// Any task -> comms. log() never touches a link outside comms: Serial, the
+// Serial2 TX ring and the UDP socket can all block. Producers (actuation, the
+// deadman timer, setup) share the write side, so pushes take log_mux. Sized
+// for a full SEQ_SHOW.
+struct LogLine
+{
+    char text[160];
+};
+RingBuffer<LogLine, 32> log_queue;
+portMUX_TYPE log_mux = portMUX_INITIALIZER_UNLOCKED;
+volatile uint32_t log_dropped = 0;
+TaskHandle_t comms_handle = NULL;
+
+// GCS UDP command sequences already handled, newest last. The GCS retries
+// until SERIAL_COMMAND_ACK; a retry whose ACK was lost is only re-ACKed.
+uint16_t udp_sequences[8];
+size_t udp_sequence_count = 0;
+
+// Transport health as last reported. The Lora Away path never turns off;
+// UDP is an addition whenever the GCS is in WiFi range.
+volatile bool udp_streaming = false;
+bool away_linked = false;
+
+// Hot-section timing (profiler.h), dumped by CMD:STATS. Each task records
+// only its own sections; the dump itself runs on comms so it cannot stretch
+// an actuation iteration.
+static ProfileSection profile_actuation("actuation");
+static ProfileSection profile_command("command");
+static ProfileSection profile_pressure("pressure_drain");
+static ProfileSection profile_comms("comms");
+volatile bool stats_requested = false;
+
+void actuation_task(void *);
+void comms_task(void *);
+bool queue_command(const char *line, int32_t trace = -1);
+void trace_command(const Command &command, uint32_t dispatch_us);
+void confirm_traces(uint16_t telemetry_sequence);
+////////////////////////////////////
+
 void setup()
 {
     Serial.begin(115200); // For debugging.
-    // Using GPIO 5 for RXD, 18 for TXD.
-    Serial2.begin(115200, SERIAL_8N1, 16, 17);
+    // Runs on its own task, next to comms.
+    if (!away_link.begin(LINK_RX_PIN, LINK_TX_PIN, UART_LINK_MAX_BAUD, COMMS_CORE))
+        Serial.println("ERROR: Lora Away UART link failed to start.");
+    // Joins the GCS access point in the background; the comms task serves it.
+    server_begin();
+
+    // Valves and relay first: after a brown-out reset mid-test they must be
+    // safe and controllable before anything slow runs.
+    // Attaches every servo once and drives it to its default state.
+    actuator_begin();
+    // Relay off; default ignition timeline until one is uploaded.
+    sequencer_begin();
+    // From here, a silent link puts the valves back to default.
+    deadman_begin();
+
+    // Last saved tares and load cell scale/offset. Nothing tares at boot.
+    bool calibrated = calibration_begin();
 
-    analogReadResolution(ADC_RESOLUTION);
+    // Calibrated raw-to-PSI tables.
+    if (!transducer_begin())
+        log(WARNING, "No ADC eFuse calibration; using nominal Vref.");
 
-    // Tare pressure.
-    tare_fuel_pressure = tarePressure(FUEL_PTD_INDEX);
-    tare_ox_pressure = tarePressure(OX_PTD_INDEX);
+    // Continuous PT sampling.
+    if (!adc_sampler_begin(ADC_SAMPLE_RATE_HZ))
+        log(ERROR, "ADC sampler failed to start.");
+    pressure_filter_begin(adc_sampler_rate());
 
-    load_cell.begin(DT_PIN, SCK_PIN);
-    // Tare load cell. NOTE: Values found manually and hardcoded.
-    load_cell.set_scale(33.1656583);
-    load_cell.set_offset(-163065.0);
-    load_cell.tare();
+    // Flash recorder. Recording starts on CMD:REC_START or ignition.
+    if (!recorder_begin())
+        log(ERROR, "Recorder filesystem failed to mount.");
 
-    pinMode(RELAY_PIN, OUTPUT);
+    // Rolling pre-trigger capture around ignition.
+    if (!capture_begin())
+        log(ERROR, "Capture ring could not be allocated.");
+
+    // Every conversion is read on DT interrupt.
+    load_cell_begin(calibration().load_scale, calibration().load_offset, LOAD_CELL_80_SPS);
+
+    // Onboard abort limits; checked on every sample by actuation_task.
+    redline_begin();
+
+    // First boot: measure in the background instead of blocking here.
+    if (!calibrated)
+    {
+        log(WARNING, "No saved calibration; taring in the background.");
+        calibration_start_tare(millis());
+    }
+
+    xTaskCreatePinnedToCore(actuation_task, "actuation", TASK_STACK, NULL,
+                            ACTUATION_PRIORITY, NULL, ACTUATION_CORE);
+    xTaskCreatePinnedToCore(comms_task, "comms", TASK_STACK, NULL,
+                            COMMS_PRIORITY, &comms_handle, COMMS_CORE);
 }
 
 void loop()
 {
-    unsigned long currentTime = millis();
+    // All work happens in actuation_task and comms_task.
+    vTaskDelete(NULL);
+}
 
-    // If Serial2 (command) is available.
-    if (Serial2.available())
+/**
+ * @brief Converts a filter output to tared sensor units.
+ *
+ * @return 0.1 units (PSI for the PTs).
+ */
+static int32_t tared_pressure_x10(int channel, const FilteredPressure &filtered)
+{
+    return countsToUnitsX10(channel, filtered.counts[channel], PRESSURE_FILTER_FRAC_BITS) -
+           calibration().tare_x10[channel];
+}
+
+/**
+ * @brief High-priority task: drains PT samples, runs queued commands and
+ * times the burn. Never blocks on the Lora Away link, so a slow link cannot delay
+ * ignition_stop().
+ *
+ * @param arg Unused.
+ */
+void actuation_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true)
     {
-        // Read command.
-        String message = Serial2.readStringUntil('\n');
-        // Crops whitespace, newline, etc.
-        message.trim();
-        Serial.println("Received from Serial2: " + message);
+        uint32_t iteration_start = profiler_cycles();
 
-        if (message.startsWith("CMD:"))
+        Command command;
+        while (command_queue.pop(command))
         {
-            decodeCommand(message);
+            uint32_t dispatch_us = (uint32_t)esp_timer_get_time();
+            servo_written_us = 0;
+            {
+                ProfileScope scope(profile_command);
+                decodeCommand(command);
+            }
+            if (command.trace >= 0)
+                trace_command(command, dispatch_us);
         }
-    }
 
-    // Read pressures.
-    float fuel_pressure = readPressure(FUEL_PTD_INDEX) - tare_fuel_pressure;
-    float ox_pressure = readPressure(OX_PTD_INDEX) - tare_ox_pressure;
+        // The deadman timer has already moved the valves; this records it.
+        if (deadman_take_trip())
+        {
+            for (int valve = 1; valve <= NUM_VALVES; valve++)
+                recorder_log_valve(valve, valve_angle(valve, VALVES[valve - 1].default_state));
+            // firing is still set: ignition_stop() runs below.
+            log(ERROR, "DEADMAN: no command or heartbeat for %u ms.%s Valves to default.",
+                (unsigned)deadman_timeout_ms(), firing ? " Burn aborted." : "");
+        }
 
-    pressure_count++;
-    fuel_pressure_sum += fuel_pressure;
-    ox_pressure_sum += ox_pressure;
+        // Drain pressures sampled since the last iteration.
+        uint32_t pressure_start = profiler_cycles();
+        SensorScan samples[64];
+        size_t sample_count = 0;
+        while ((sample_count = adc_sampler_read(samples, 64)) > 0)
+        {
+            for (size_t i = 0; i < sample_count; i++)
+            {
+                calibration_feed_sensors(samples[i]);
 
-    currentTime = millis();
+                FilteredPressure filtered[FILTER_OUTPUT_COUNT];
+                uint8_t ready = pressure_filter_push(samples[i], filtered);
 
-    // Sending telemetry every 300ms. Calculates averages.
-    if (currentTime - lastDataSendTime >= dataSendInterval)
-    {
-        float avg_fuel_pressure = fuel_pressure_sum / (float)pressure_count;
-        float avg_ox_pressure = ox_pressure_sum / (float)pressure_count;
+                if (ready & (1 << FILTER_REDLINE))
+                {
+                    const FilteredPressure &p = filtered[FILTER_REDLINE];
+                    int32_t fuel = tared_pressure_x10(SENSOR_FUEL, p);
+                    int32_t ox = tared_pressure_x10(SENSOR_OX, p);
+                    if (redline_check_pressure(fuel / 10.0f, ox / 10.0f, firing))
+                        redline_abort();
+                }
+
+                // Records keep raw ADC counts, two channels per record; bit-exact
+                // at the default full rate.
+                if (ready & (1 << FILTER_RECORD))
+                {
+                    const FilteredPressure &p = filtered[FILTER_RECORD];
+                    const int32_t half = 1 << (PRESSURE_FILTER_FRAC_BITS - 1);
+                    for (int ch = 0; ch < SENSOR_COUNT; ch += 2)
+                    {
+                        uint16_t a = (p.counts[ch] + half) >> PRESSURE_FILTER_FRAC_BITS;
+                        uint16_t b = ch + 1 < SENSOR_COUNT ? (p.counts[ch + 1] + half) >> PRESSURE_FILTER_FRAC_BITS : 0;
+                        recorder_log_pressure(p.timestamp_us, ch, a, b);
+                    }
+
+                    // Same rate live over UDP. A full queue leaves a gap,
+                    // which starts a new sample block.
+                    if (udp_streaming)
+                    {
+                        StreamScan scan;
+                        scan.timestamp_us = p.timestamp_us;
+                        for (int ch = 0; ch < SENSOR_COUNT; ch++)
+                            scan.values[ch] = telemetry_fixed16(tared_pressure_x10(ch, p), 1);
+                        stream_queue.push(scan);
+                    }
+                }
 
-        // Debugging, uncommented if needed.
-        // Serial.println(String(fuel_pressure_sum));
-        // Serial.println(String(ox_pressure_sum));
-        // Serial.println(String(pressure_count));
-        // Serial.print("Fuel tare: " + String(tare_fuel_pressure));
-        // Serial.print("Ox tare: " + String(tare_ox_pressure));
+                if (ready & (1 << FILTER_TELEMETRY))
+                {
+                    const FilteredPressure &p = filtered[FILTER_TELEMETRY];
+                    fuel_pressure_x10 = tared_pressure_x10(SENSOR_FUEL, p);
+                    ox_pressure_x10 = tared_pressure_x10(SENSOR_OX, p);
+                    pressure_timestamp_us = p.timestamp_us;
+                    pressure_ready = true;
+                }
+            }
+        }
+        profile_pressure.record(profiler_cycles() - pressure_start);
 
-        // Reset telemetry sums.
-        fuel_pressure_sum = 0.0;
-        ox_pressure_sum = 0.0;
-        pressure_count = 0.0;
+        // Drain every load cell conversion since the last iteration.
+        LoadSample loads[16];
+        size_t load_sample_count = 0;
+        while ((load_sample_count = load_cell_read(loads, 16)) > 0)
+        {
+            for (size_t i = 0; i < load_sample_count; i++)
+            {
+                load_count++;
+                load_sum += load_cell_to_units(loads[i].raw);
+                recorder_log_load(loads[i].timestamp_us, loads[i].raw);
+                calibration_feed_load(loads[i].raw);
+                last_load_us = loads[i].timestamp_us;
+            }
+        }
+        if (redline_check_load(((uint32_t)esp_timer_get_time() - last_load_us) / 1000, firing))
+            redline_abort();
 
-        String msg_psi_fuel = String(int(avg_fuel_pressure));
-        String msg_psi_ox = String(int(avg_ox_pressure));
+        unsigned long currentTime = millis();
 
-        if (load_cell.is_ready())
+        if (calibration_update(currentTime))
         {
-            int reading = int(load_cell.get_units(10));
-            last_load_reading = reading;
+            const Calibration &cal = calibration();
+            log(calibration_saved() ? OKAY : ERROR, "Calibration %s: fuel tare %d, ox tare %d (0.1 PSI), load offset %d, scale %.4f.",
+                calibration_saved() ? "saved" : "NOT saved", (int)cal.tare_x10[SENSOR_FUEL],
+                (int)cal.tare_x10[SENSOR_OX], (int)cal.load_offset, cal.load_scale);
         }
 
-        // Write via Serial2 to LoRa away.
-        String msg = "T" + msg_psi_fuel + ',' + msg_psi_ox + ',' + String(last_load_reading);
-        Serial2.println(msg);
+        // Hands a frame to comms for every telemetry filter output.
+        if (pressure_ready || currentTime - lastDataSendTime >= dataStallInterval)
+        {
+            TelemetryFrame telemetry;
+            telemetry.sequence = telemetry_sequence++;
+            // Aligned to the middle of the filter window (group delay removed).
+            telemetry.timestamp_us = pressure_ready ? pressure_timestamp_us : (uint32_t)esp_timer_get_time();
+            telemetry.fuel_psi_x10 = telemetry_fixed16(fuel_pressure_x10, 1);
+            telemetry.ox_psi_x10 = telemetry_fixed16(ox_pressure_x10, 1);
+            telemetry.status = 0;
+            if (!pressure_ready)
+                telemetry.status |= STATUS_PRESSURE_STALE;
+            if (firing)
+                telemetry.status |= STATUS_FIRING;
+            if (recorder_is_recording())
+                telemetry.status |= STATUS_RECORDING;
+            // Holds the last thrust if no conversion finished this interval.
+            if (load_count > 0)
+                last_load_reading = int(load_sum / load_count);
+            else
+                telemetry.status |= STATUS_LOAD_STALE;
+            if (redline_tripped())
+                telemetry.status |= STATUS_REDLINE;
+            if (udp_streaming)
+                telemetry.status |= STATUS_UDP_LINK;
+            telemetry.load_g = last_load_reading;
 
-        // DEBUG:
-        // Serial.print("Wrote Serial2: " + serialized_msg);
+            // Reset telemetry sums.
+            pressure_ready = false;
+            load_sum = 0.0;
+            load_count = 0.0;
 
-        lastDataSendTime = millis();
+            // If comms is behind, the oldest unsent frame wins; this one is dropped.
+            telemetry_queue.push(telemetry);
+            confirm_traces(telemetry.sequence);
+            lastDataSendTime = currentTime;
+        }
+
+        // IGNITION. The sequencer times every step; this only notices it ended.
+        if (firing && !sequencer_running())
+            ignition_stop();
+
+        profile_actuation.record(profiler_cycles() - iteration_start);
+        // 1 tick (1 ms) period.
+        vTaskDelayUntil(&last_wake, 1);
+    }
+}
+
+/**
+ * @brief Parses a command line and hands it to the actuation task.
+ *
+ * @param line
+ * @param trace Radio sequence number if Lora Away traces it, else -1.
+ * @return true if it was a valid command and was queued.
+ */
+bool queue_command(const char *line, int32_t trace)
+{
+    Command command = parse_command(line);
+    command.trace = trace;
+    command.received_us = (uint32_t)esp_timer_get_time();
+    if (command.opcode == CMD_UNKNOWN || command.opcode == CMD_INVALID)
+    {
+        log(ERROR, "%s command: \"%s\"", command_name(command.opcode), line);
+        return false;
     }
+    if (command.opcode == CMD_NONE)
+        return false;
 
-    // IGNITION. NOTE: make this blocking so nothing else holds ignition_stop.
-    if (firing)
+    if (!command_queue.push(command))
     {
-        currentTime = millis();
-        // If we have been firing for 5+ seconds, stop.
-        if (currentTime - ignition_time >= fire_length)
-        {
-            ignition_stop();
-        }
+        log(WARNING, "Command queue full. Dropped: %s", line);
+        return false;
     }
+    return true;
 }
 
 /**
- * @brief Takes a serial message, checks formatting, and sends a servo command
- * if correct.
+ * @brief Queues a command that arrived over the Lora Away or UDP link.
  *
- * @param message
+ * @param packet CRC-checked already.
+ * @param source For the log.
  */
-void decode_valve_command(String message)
+void handle_link_command(const SerialPacket &packet, const char *source)
 {
-    int valve_index = message.substring(1, 2).toInt();
-    // Serial.println("Decoding command:" + message);
-    if (valve_index < 1 || valve_index > NUM_VALVES)
+    int32_t trace = -1;
+    const char *line = (const char *)packet.payload;
+    if (packet.type == SERIAL_TRACED_COMMAND && packet.length > sizeof(uint16_t))
+    {
+        uint16_t sequence;
+        memcpy(&sequence, packet.payload, sizeof(sequence));
+        trace = sequence;
+        line += sizeof(sequence);
+    }
+    else if (packet.type != SERIAL_COMMAND)
     {
-        log(ERROR, "Invalid valve number. Message: " + message + ". Num: " + valve_index);
         return;
     }
 
-    int colon_pos = message.indexOf(':');
-    // If format is incorrect, or no command follows colon e.g. "V1:".
-    if (colon_pos == -1 || colon_pos + 1 >= message.length())
-    {
-        log(ERROR, "\"" + message + "\" Invalid format. Use V#:angle (e.g., V2:OPEN)");
+    Serial.printf("Received from %s: %s\n", source, line);
+    if (strncmp(line, "CMD:", 4) == 0 && queue_command(line, trace))
+        deadman_feed();
+}
+
+/**
+ * @brief Queues a GCS command from UDP once and acknowledges it every time.
+ * Its sequence is the GCS's own, not a radio trace id.
+ *
+ * @param packet SERIAL_TRACED_COMMAND, CRC-checked already.
+ */
+void handle_udp_command(const SerialPacket &packet)
+{
+    uint16_t sequence;
+    if (packet.length <= sizeof(sequence))
         return;
+    memcpy(&sequence, packet.payload, sizeof(sequence));
+    const char *line = (const char *)packet.payload + sizeof(sequence);
+
+    bool duplicate = false;
+    for (size_t i = 0; i < udp_sequence_count && !duplicate; i++)
+        duplicate = udp_sequences[i] == sequence;
+    if (!duplicate)
+    {
+        Serial.printf("Received from GCS UDP: %s\n", line);
+        if (strncmp(line, "CMD:", 4) == 0)
+            queue_command(line);
+
+        const size_t capacity = sizeof(udp_sequences) / sizeof(udp_sequences[0]);
+        if (udp_sequence_count == capacity)
+        {
+            memmove(udp_sequences, udp_sequences + 1, (capacity - 1) * sizeof(udp_sequences[0]));
+            udp_sequence_count--;
+        }
+        udp_sequences[udp_sequence_count++] = sequence;
     }
+    // Rejected commands are ACKed too: a retry would be rejected the same way,
+    // and the log already says why.
+    server_send(SERIAL_COMMAND_ACK, &sequence, sizeof(sequence));
+}
 
-    // Ex. V1:OPEN
-    message.trim();
-    String angle_string = message.substring(colon_pos + 1);
-    int servo_angle = get_servo_angle(valve_index, angle_string);
-    servo_set(valve_index, servo_angle);
+/**
+ * @brief Actuation side: a traced command has run; its timing goes out with
+ * the next telemetry frame.
+ *
+ * @param command
+ * @param dispatch_us When actuation popped it.
+ */
+void trace_command(const Command &command, uint32_t dispatch_us)
+{
+    if (pending_trace_count >= sizeof(pending_traces) / sizeof(pending_traces[0]))
+        return;
+
+    uint32_t executed_us = servo_written_us ? servo_written_us : (uint32_t)esp_timer_get_time();
+    PendingTrace &pending = pending_traces[pending_trace_count++];
+    pending.timing.trace = command.trace;
+    pending.timing.queue_us = dispatch_us - command.received_us;
+    pending.timing.execute_us = executed_us - dispatch_us;
+    pending.executed_us = executed_us;
 }
 
-void init_servo(int index)
-{ // TODO: Maybe init all servos on start?
-    switch (index)
+/**
+ * @brief Actuation side: the frame just queued is the first to show every
+ * pending traced command's effect.
+ *
+ * @param telemetry_sequence
+ */
+void confirm_traces(uint16_t telemetry_sequence)
+{
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    for (size_t i = 0; i < pending_trace_count; i++)
     {
-    case 1:
-        valve_n2.attach(VALVE_N2_PIN);
-        break;
-    case 2:
-        valve_release.attach(VALVE_RELEASE_PIN);
-        break;
-    case 3:
-        valve_fuel.attach(VALVE_FUEL_PIN);
-        break;
-    case 4:
-        valve_ox.attach(VALVE_OX_PIN);
-        break;
-    default:
-        log(WARNING, "Wrong servo index provided for pin attachment.");
-        break;
+        CommandTiming &timing = pending_traces[i].timing;
+        timing.confirm_us = now_us - pending_traces[i].executed_us;
+        timing.telemetry_sequence = telemetry_sequence;
+        timing_queue.push(timing);
     }
+    pending_trace_count = 0;
 }
 
-void servo_set(int index, int angle)
+/**
+ * @brief Sends the pending sample block over UDP.
+ */
+void send_sample_block()
 {
-    Servo *target_servo = valves[index - 1];
-    // Attach pin.
-    init_servo(index);
-    target_servo->write(angle);
-    // After a delay, attach so not draining power.
-    log(OKAY, "Writing angle " + String(angle) + " to servo " + String(index) + ".");
+    uint8_t payload[SERIAL_PACKET_MAX_PAYLOAD];
+    size_t length = sample_block.finish(payload);
+    if (length > 0)
+        server_send(SERIAL_SAMPLES, payload, length);
 }
 
-void decodeCommand(String command)
+/**
+ * @brief Logs whenever a transport comes up or goes down, and starts/stops the
+ * UDP sample stream with it.
+ */
+void report_link_health()
 {
-    // Crops "CMD:" header. Redundant check.
-    if (command.startsWith("CMD:"))
-        command = command.substring(4);
+    bool udp_up = server_connected();
+    if (udp_up != udp_streaming)
+    {
+        udp_streaming = udp_up;
+        if (udp_up)
+        {
+            log(OKAY, "GCS UDP link up (%s).", server_peer());
+        }
+        else
+        {
+            ServerStats stats = server_stats();
+            log(WARNING, "GCS UDP link lost (%u received, %u bad, %u send errors); Lora Away only.",
+                (unsigned)stats.received, (unsigned)stats.bad_datagrams, (unsigned)stats.send_errors);
+        }
+    }
 
-    if (command.startsWith("IGN"))
+    bool away_up = away_link.negotiated();
+    if (away_up != away_linked)
     {
-        // Will not start ignition again on a duplicate packet.
-        if (!firing)
-            ignition_start();
+        away_linked = away_up;
+        if (away_up)
+        {
+            log(OKAY, "Lora Away link up at %u baud.", (unsigned)away_link.baud());
+        }
+        else
+        {
+            UartLinkStats stats = away_link.stats();
+            log(WARNING, "Lora Away link lost (%u bad frames, %u fallbacks).", (unsigned)stats.bad_frames,
+                (unsigned)stats.fallbacks);
+        }
     }
-    else if (command.startsWith("OPEN_ALL"))
+}
+
+/**
+ * @brief Low-priority task: takes commands from the Lora Away and UDP links
+ * and writes telemetry to them.
+ *
+ * @param arg Unused.
+ */
+void comms_task(void *arg)
+{
+    LineReader<COMMAND_LENGTH> usb_reader;
+
+    while (true)
     {
-        open_all_valves();
+        uint32_t iteration_start = profiler_cycles();
+        server_update(millis());
+        report_link_health();
+        if (stats_requested)
+        {
+            stats_requested = false;
+            print_stats();
+        }
+
+        // Packets were already CRC-checked by the links; corrupted ones never
+        // get here. Either link may command the stand.
+        SerialPacket packet;
+        while (away_link.receive(packet))
+        {
+            // Away heard Lora Home.
+            if (packet.type == SERIAL_HEARTBEAT)
+                deadman_feed();
+            else
+                handle_link_command(packet, "Lora Away");
+        }
+        while (server_receive(packet))
+        {
+            // Fed per datagram, not from server_connected(): that stays true
+            // for SERVER_TIMEOUT_MS after the GCS goes quiet. The GCS sends a
+            // keepalive every 250 ms while it is up.
+            deadman_feed();
+            if (packet.type == SERIAL_TRACED_COMMAND)
+                handle_udp_command(packet);
+            else
+                handle_link_command(packet, "GCS UDP");
+        }
+
+        // USB serial only accepts recorder/capture commands (post-test download).
+        while (Serial.available())
+        {
+            if (!usb_reader.feed(Serial.read()))
+                continue;
+
+            const char *line = usb_reader.line();
+            if (strncmp(line, "CMD:REC_", 8) == 0 || strncmp(line, "CMD:CAP_", 8) == 0 ||
+                strncmp(line, "CMD:STATS", 9) == 0)
+                queue_command(line);
+        }
+
+        LogLine line;
+        while (log_queue.pop(line))
+            send_log(line.text);
+        static uint32_t log_dropped_reported = 0;
+        if (log_dropped != log_dropped_reported)
+        {
+            log_dropped_reported = log_dropped;
+            log(WARNING, "%u log lines dropped (queue full).", (unsigned)log_dropped_reported);
+        }
+
+        TelemetryFrame telemetry;
+        while (telemetry_queue.pop(telemetry))
+        {
+            // The frame keeps its own CRC; it travels on to the GCS as-is.
+            telemetry_frame_seal(telemetry);
+            away_link.send(SERIAL_TELEMETRY, &telemetry, sizeof(telemetry));
+            if (udp_streaming)
+                server_send(SERIAL_TELEMETRY, &telemetry, sizeof(telemetry));
+        }
+
+        // After the frames, so Away sees the confirming frame first.
+        CommandTiming timing;
+        while (timing_queue.pop(timing))
+            away_link.send(SERIAL_COMMAND_RESULT, &timing, sizeof(timing));
+
+        uint32_t record_hz = pressure_filter_rate(FILTER_RECORD);
+        uint32_t period_us = record_hz > 0 ? 1000000 / record_hz : 0;
+        StreamScan scan;
+        while (stream_queue.pop(scan))
+        {
+            if (!sample_block.add(scan.timestamp_us, scan.values, SENSOR_COUNT, period_us))
+            {
+                send_sample_block();
+                sample_block.add(scan.timestamp_us, scan.values, SENSOR_COUNT, period_us);
+            }
+        }
+        if (sample_block.count() > 0 &&
+            (uint32_t)esp_timer_get_time() - sample_block.first_timestamp_us() >= STREAM_MAX_AGE_US)
+            send_sample_block();
+
+        profile_comms.record(profiler_cycles() - iteration_start);
+        vTaskDelay(1);
     }
-    else if (command.startsWith("CLOSE_ALL"))
+}
+
+/**
+ * @brief Resolves a parsed valve command to an angle and moves the servo.
+ *
+ * @param command CMD_VALVE.
+ */
+void decode_valve_command(const Command &command)
+{
+    int valve_index = command.args[0];
+    if (valve_index < 1 || valve_index > NUM_VALVES)
     {
-        close_all_valves();
+        log(ERROR, "Invalid valve number: %d", valve_index);
+        return;
+    }
+
+    int servo_angle = command.position == VALVE_ANGLE ? command.args[1] : valve_angle(valve_index, command.position);
+    servo_set(valve_index, servo_angle);
+}
+
+void servo_set(int index, int angle)
+{
+    actuator_move(index, angle);
+    servo_written_us = (uint32_t)esp_timer_get_time();
+    recorder_log_valve(index, angle);
+    log(OKAY, "Writing angle %d to servo %d.", angle, index);
+}
+
+/**
+ * @brief Moves several valves in the same PWM period, then logs them.
+ *
+ * @param moves
+ * @param count
+ */
+void servo_set_many(const ValveMove *moves, size_t count)
+{
+    actuator_move_many(moves, count);
+    servo_written_us = (uint32_t)esp_timer_get_time();
+    for (size_t i = 0; i < count; i++)
+    {
+        recorder_log_valve(moves[i].valve, moves[i].angle);
+        log(OKAY, "Writing angle %d to servo %d.", moves[i].angle, moves[i].valve);
     }
-    else if (command.startsWith("V"))
+}
+
+void decodeCommand(const Command &command)
+{
+    switch (command.opcode)
     {
+    case CMD_IGNITE:
+        // Will not start ignition again on a duplicate packet.
+        if (redline_tripped())
+            log(ERROR, "Redline %s tripped. Send CMD:RL_RESET before IGN.",
+                redline_rule_name(redline_trip_rule()));
+        else if (!firing)
+            ignition_start();
+        break;
+    case CMD_OPEN_ALL:
+        open_all_valves();
+        break;
+    case CMD_CLOSE_VALVES:
+        // Away lost Home: the same safing as the deadman.
+        sequencer_abort();
+        default_all_valves();
+        log(WARNING, "Lora Away lost Lora Home.%s Valves to default.", firing ? " Burn aborted." : "");
+        break;
+    case CMD_CLOSE_ALL:
+        // Also aborts a burn: cuts the relay and cancels pending steps.
+        sequencer_abort();
+        close_all_valves();
+        break;
+    case CMD_REC_START:
+        if (recorder_undumped(RECORDING_PATH) && !recorder_is_recording())
+            log(WARNING, "Overwriting a recording that was never dumped.");
+        recorder_start();
+        redline_log_config();
+        break;
+    case CMD_REC_STOP:
+        recorder_stop();
+        break;
+    case CMD_REC_DUMP:
+        // Streams over USB serial; see GCS/download_recording.py.
+        recorder_request_dump(RECORDING_PATH);
+        break;
+    case CMD_CAP_DUMP:
+        recorder_request_dump(CAPTURE_PATH);
+        break;
+    case CMD_CAP_CFG:
+        capture_configure(command.args[0], command.args[1]);
+        break;
+    case CMD_VALVE:
         decode_valve_command(command);
+        break;
+    case CMD_SEQ_ADD:
+        decode_sequence_step(command);
+        break;
+    case CMD_SEQ_CLEAR:
+        if (!sequencer_clear())
+            log(ERROR, "Cannot edit the sequence while firing.");
+        break;
+    case CMD_SEQ_DEFAULT:
+        if (!sequencer_load_default())
+            log(ERROR, "Cannot edit the sequence while firing.");
+        break;
+    case CMD_SEQ_SHOW:
+        print_sequence();
+        break;
+    case CMD_RL_SET:
+        redline_configure((RedlineRule)command.args[0], command.args[1], command.args[2]);
+        print_redlines();
+        break;
+    case CMD_RL_SHOW:
+        print_redlines();
+        break;
+    case CMD_TARE:
+        // Zeroing with propellant pressure on the PTs would offset every reading.
+        if (firing)
+            log(ERROR, "Cannot tare while firing.");
+        else if (!calibration_start_tare(millis()))
+            log(ERROR, "Calibration already running.");
+        else
+            log(OKAY, "Taring for %d ms.", CALIBRATION_WINDOW_MS);
+        break;
+    case CMD_LC_CAL:
+        if (firing)
+            log(ERROR, "Cannot calibrate while firing.");
+        else if (!calibration_start_scale(millis(), command.args[0]))
+            log(ERROR, "Calibration already running.");
+        else
+            log(OKAY, "Measuring %d g for %d ms.", (int)command.args[0], CALIBRATION_WINDOW_MS);
+        break;
+    case CMD_FLT_CFG:
+        pressure_filter_configure(command.args[0], command.args[1], command.args[2], command.args[3]);
+        log(OKAY, "Filter: telemetry %u Hz (%u us), record %u Hz (%u us), redline %u Hz (%u us), IIR shift %u.",
+            (unsigned)pressure_filter_rate(FILTER_TELEMETRY), (unsigned)pressure_filter_delay_us(FILTER_TELEMETRY),
+            (unsigned)pressure_filter_rate(FILTER_RECORD), (unsigned)pressure_filter_delay_us(FILTER_RECORD),
+            (unsigned)pressure_filter_rate(FILTER_REDLINE), (unsigned)pressure_filter_delay_us(FILTER_REDLINE),
+            pressure_filter_iir_shift());
+        break;
+    case CMD_RL_RESET:
+        redline_reset();
+        log(OKAY, "Redlines reset.");
+        break;
+    case CMD_STATS:
+        stats_requested = true;
+        break;
+    case CMD_STATS_RESET:
+        profiler_reset_all();
+        log(OKAY, "Timing statistics reset.");
+        break;
+    case CMD_DM_CFG:
+        deadman_configure(command.args[0]);
+        if (command.args[0] == 0)
+            log(WARNING, "Deadman disabled.");
+        else
+            log(OKAY, "Deadman: valves to default after %u ms without a command or heartbeat.",
+                (unsigned)command.args[0]);
+        break;
+    default:
+        break;
     }
 }
 
 // SEQUENCES /////////////////////////////
 void close_all_valves()
 {
-    decode_valve_command("V1:CLOSE");
-    decode_valve_command("V2:CLOSE");
-    decode_valve_command("V3:CLOSE");
-    decode_valve_command("V4:CLOSE");
+    ValveMove moves[NUM_VALVES];
+    for (int valve = 1; valve <= NUM_VALVES; valve++)
+        moves[valve - 1] = {(uint8_t)valve, (uint8_t)valve_angle(valve, VALVE_CLOSE)};
+    servo_set_many(moves, NUM_VALVES);
+}
+
+/**
+ * @brief Every valve to its config/valves.yaml default state.
+ */
+void default_all_valves()
+{
+    ValveMove moves[NUM_VALVES];
+    for (int valve = 1; valve <= NUM_VALVES; valve++)
+        moves[valve - 1] = {(uint8_t)valve, (uint8_t)valve_angle(valve, VALVES[valve - 1].default_state)};
+    servo_set_many(moves, NUM_VALVES);
 }
 
 void open_all_valves()
 {
-    decode_valve_command("V1:OPEN");
-    decode_valve_command("V2:OPEN");
-    decode_valve_command("V3:OPEN");
-    decode_valve_command("V4:OPEN");
+    ValveMove moves[NUM_VALVES];
+    for (int valve = 1; valve <= NUM_VALVES; valve++)
+        moves[valve - 1] = {(uint8_t)valve, (uint8_t)valve_angle(valve, VALVE_OPEN)};
+    servo_set_many(moves, NUM_VALVES);
 }
 
 // IGNITION.
 void ignition_start()
 {
-    digitalWrite(RELAY_PIN, HIGH);
-    delay(1000);
-    decode_valve_command("V3:OPEN");
-    decode_valve_command("V4:OPEN");
-    ignition_time = millis();
+    // Every burn is recorded, even if the operator forgot REC_START, but never
+    // over a previous test that was not downloaded yet.
+    if (recorder_start(false))
+        redline_log_config();
+    else
+        log(WARNING, "Previous recording never dumped; this burn is not recorded. REC_DUMP it or REC_START.");
+    if (!recorder_undumped(CAPTURE_PATH))
+        capture_trigger();
+    else
+        log(WARNING, "Previous capture never dumped; this burn is not captured. CAP_DUMP it first.");
+    if (!sequencer_start())
+    {
+        log(ERROR, "Ignition sequence is empty.");
+        capture_end();
+        return;
+    }
     firing = true;
+    log(OKAY, "Ignition sequence started (%u steps).", (unsigned)sequencer_count());
 }
 
+/**
+ * @brief Called once the timeline has run out or been aborted.
+ */
 void ignition_stop()
 {
-    decode_valve_command("V3:CLOSE");
-    decode_valve_command("V4:CLOSE");
-    digitalWrite(RELAY_PIN, LOW);
+    capture_end();
     firing = false;
+    log(OKAY, "Ignition sequence finished.");
 }
-/////////////////////////////////////////////
 
 /**
- * @brief Returns the correct servo position for given command.
+ * @brief A redline tripped: same actions as CLOSE_ALL, straight from the
+ * sampling path.
+ */
+void redline_abort()
+{
+    sequencer_abort();
+    close_all_valves();
+    log(ERROR, "REDLINE %s tripped. Burn aborted, valves closed.", redline_rule_name(redline_trip_rule()));
+}
+
+/**
+ * @brief Logs every profiled section, one
+ * "STATS:<name>:<count>:<min>:<p50>:<p90>:<p99>:<max>:<mean>" line each (us).
+ */
+void print_stats()
+{
+    char line[96];
+    for (ProfileSection *section = profiler_first(); section; section = section->next())
+    {
+        profiler_format(*section, line, sizeof(line));
+        log(OKAY, "%s", line);
+    }
+}
+
+/**
+ * @brief Logs every rule: "RL:<rule>:<threshold>:<samples>".
+ */
+void print_redlines()
+{
+    for (int rule = 0; rule < REDLINE_RULE_COUNT; rule++)
+    {
+        const RedlineConfig &config = redline_config((RedlineRule)rule);
+        log(OKAY, "RL:%s:%d:%u%s", redline_rule_name((RedlineRule)rule), (int)config.threshold, config.samples,
+            config.samples == 0 ? " (off)" : "");
+    }
+}
+
+/**
+ * @brief Appends an uploaded step (CMD:SEQ_ADD) to the timeline.
  *
- * @param valve_index
- * @param angle
- * @return int
+ * @param command CMD_SEQ_ADD.
  */
-int get_servo_angle(int valve_index, String angle)
+void decode_sequence_step(const Command &command)
 {
-    switch (valve_index)
+    SequenceStep step;
+    step.offset_us = (uint32_t)command.args[0] * 1000;
+    step.action = (SequenceAction)command.args[1];
+    step.valve = command.args[2];
+    step.value = command.args[3];
+    if (step.action == STEP_VALVE)
     {
-    // Nitrogen
-    case 1:
-        if (angle.equals("OPEN"))
-            return open_valve_n2;
-        else if (angle.equals("CLOSE"))
-            return close_valve_n2;
-        else // NEUTRAL
-            return neutral_valve_n2;
-        break;
-    // Release
-    case 2:
-        if (angle.equals("OPEN"))
-            return open_valve_release;
-        else if (angle.equals("CLOSE"))
-            return close_valve_release;
-        else // NEUTRAL
-            return neutral_valve_release;
-        break;
-    // Fuel
-    case 3:
-        if (angle.equals("OPEN"))
-            return open_valve_fuel;
-        else if (angle.equals("CLOSE"))
-            return close_valve_fuel;
-        else // NEUTRAL
-            return neutral_valve_fuel;
-        break;
-    // Oxygen
-    case 4:
-        if (angle.equals("OPEN"))
-            return open_valve_ox;
-        else if (angle.equals("CLOSE"))
-            return close_valve_ox;
-        else // NEUTRAL
-            return neutral_valve_ox;
-        break;
-    default:
-        log(ERROR, "Wrong servo index provided for getting servo angle.");
-        return -999;
+        if (step.valve < 1 || step.valve > NUM_VALVES)
+        {
+            log(ERROR, "Invalid valve number: %d", step.valve);
+            return;
+        }
+        if (command.position != VALVE_ANGLE)
+            step.value = valve_angle(step.valve, command.position);
     }
+
+    if (!sequencer_add(step))
+        log(ERROR, "Sequence step rejected (firing or %d steps already).", SEQUENCE_MAX_STEPS);
 }
 
+/**
+ * @brief Logs the timeline: "SEQ:<offset_ms>:R:<state>" / "SEQ:<offset_ms>:V<n>:<angle>".
+ */
+void print_sequence()
+{
+    for (size_t i = 0; i < sequencer_count(); i++)
+    {
+        const SequenceStep &step = sequencer_step(i);
+        if (step.action == STEP_RELAY)
+            log(OKAY, "SEQ:%u:R:%u", (unsigned)(step.offset_us / 1000), step.value);
+        else
+            log(OKAY, "SEQ:%u:V%u:%u", (unsigned)(step.offset_us / 1000), step.valve, step.value);
+    }
+}
+/////////////////////////////////////////////
+
 void log(const LogType log_type, const String message)
 {
-    String text = "";
+    log(log_type, "%s", message.c_str());
+}
 
+/**
+ * @brief Writes a formatted line to USB serial, Lora Away and the GCS over
+ * UDP. Comms task only; may block.
+ */
+void send_log(const char *text)
+{
+    Serial.println(text);
+    away_link.send_text(SERIAL_LOG, text);
+    server_send_text(SERIAL_LOG, text);
+}
+
+/**
+ * @brief printf-style log to USB serial, Lora Away and the GCS over UDP.
+ * Formats into a stack buffer, so it does not allocate. Safe from any task
+ * (not from ISRs): outside comms it only queues the line, so it never blocks
+ * actuation.
+ *
+ * @param log_type
+ * @param format
+ */
+void log(const LogType log_type, const char *format, ...)
+{
+    const char *prefix = "";
     switch (log_type)
     {
     case WARNING:
-        text += "WARNING: ";
+        prefix = "WARNING: ";
         break;
     case TEST:
-        text += "TEST: ";
+        prefix = "TEST: ";
         break;
     case OKAY:
-        text += "OKAY: ";
+        prefix = "OKAY: ";
         break;
     case ERROR:
-        text += "ERROR: ";
+        prefix = "ERROR: ";
         break;
     default:
         break;
     }
-    text += message;
 
-    Serial.println(text);
-    Serial2.println(text);
-}
\ No newline at end of file
+    LogLine line;
+    int length = snprintf(line.text, sizeof(line.text), "%s", prefix);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line.text + length, sizeof(line.text) - length, format, args);
+    va_end(args);
+
+    if (comms_handle != NULL && xTaskGetCurrentTaskHandle() == comms_handle)
+    {
+        send_log(line.text);
+        return;
+    }
+
+    portENTER_CRITICAL(&log_mux);
+    if (!log_queue.push(line))
+        log_dropped++;
+    portEXIT_CRITICAL(&log_mux);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file pressure_filter.cpp
+ * @brief Per-sensor CIC/IIR decimation chains.
+ */
+#include "pressure_filter.h"
+#include "decimator.h"
+
+struct FilterChain
+{
+    CicDecimator cic[SENSOR_COUNT];
+    IirLowPass iir[SENSOR_COUNT];
+    uint32_t delay_us;
+};
+
+static FilterChain chains[FILTER_OUTPUT_COUNT];
+static uint32_t input_rate = ADC_SAMPLE_RATE_HZ;
+
+/**
+ * @param iir_shift FILTER_IIR_PER_CHANNEL for each channel's SensorChannel::iir_shift.
+ */
+static void configure_chain(FilterChain &chain, uint32_t rate_hz, int iir_shift)
+{
+    uint32_t factor = rate_hz == 0 ? input_rate : (input_rate + rate_hz / 2) / rate_hz;
+    if (factor < 1)
+        factor = 1;
+    if (factor > UINT16_MAX)
+        factor = UINT16_MAX;
+
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+    {
+        chain.cic[ch].configure(factor, FILTER_CIC_ORDER);
+        chain.iir[ch].configure(iir_shift == FILTER_IIR_PER_CHANNEL ? SENSORS[ch].iir_shift : iir_shift);
+    }
+
+    // CIC delay is in input samples; the IIR runs at the output rate. The
+    // timestamp follows channel 0 (fuel); slower channels lag it by their own
+    // low-pass delay.
+    const CicDecimator &cic = chain.cic[0];
+    uint64_t delay_x2_samples = cic.group_delay_x2() + 2ULL * chain.iir[0].group_delay() * cic.factor();
+    chain.delay_us = (uint32_t)(delay_x2_samples * 1000000ULL / (2ULL * input_rate));
+}
+
+void pressure_filter_begin(uint32_t input_rate_hz)
+{
+    input_rate = input_rate_hz > 0 ? input_rate_hz : ADC_SAMPLE_RATE_HZ;
+    pressure_filter_configure(FILTER_DEFAULT_TELEMETRY_HZ, FILTER_DEFAULT_RECORD_HZ, FILTER_DEFAULT_REDLINE_HZ,
+                              FILTER_IIR_PER_CHANNEL);
+}
+
+void pressure_filter_configure(uint32_t telemetry_hz, uint32_t record_hz, uint32_t redline_hz, int iir_shift)
+{
+    configure_chain(chains[FILTER_TELEMETRY], telemetry_hz, iir_shift);
+    configure_chain(chains[FILTER_RECORD], record_hz, 0);
+    configure_chain(chains[FILTER_REDLINE], redline_hz, 0);
+}
+
+uint8_t pressure_filter_push(const SensorScan &sample, FilteredPressure out[FILTER_OUTPUT_COUNT])
+{
+    uint8_t ready = 0;
+    for (int output = 0; output < FILTER_OUTPUT_COUNT; output++)
+    {
+        FilterChain &chain = chains[output];
+        bool done = false;
+        for (int ch = 0; ch < SENSOR_COUNT; ch++)
+        {
+            int32_t value;
+            // Channels share a sample clock, so they all finish together.
+            if (chain.cic[ch].push((int32_t)sample.raw[ch] << PRESSURE_FILTER_FRAC_BITS, value))
+            {
+                out[output].counts[ch] = chain.iir[ch].step(value);
+                done = true;
+            }
+        }
+        if (done)
+        {
+            out[output].timestamp_us = sample.timestamp_us - chain.delay_us;
+            ready |= 1 << output;
+        }
+    }
+    return ready;
+}
+
+uint32_t pressure_filter_rate(FilterOutput output)
+{
+    return input_rate / chains[output].cic[0].factor();
+}
+
+uint32_t pressure_filter_delay_us(FilterOutput output)
+{
+    return chains[output].delay_us;
+}
+
+uint8_t pressure_filter_iir_shift()
+{
+    return chains[FILTER_TELEMETRY].iir[0].shift();
+}
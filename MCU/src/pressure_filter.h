@@ -0,0 +1,76 @@
+/**
+ * @file pressure_filter.h
+ * @brief Decimation of sensor scans to the telemetry, record and redline rates.
+ *
+ * Each output is a CIC decimator per sensor channel, optionally followed by a
+ * one-pole IIR low-pass, run in integer math on raw ADC counts with
+ * PRESSURE_FILTER_FRAC_BITS of extra resolution. Output rates are derived
+ * from the sample clock, not from loop timing, so every output has a fixed
+ * window and a known group delay.
+ */
+#pragma once
+
+#include "adc_sampler.h"
+#include <stdint.h>
+
+enum FilterOutput : uint8_t
+{
+    FILTER_TELEMETRY,
+    FILTER_RECORD,
+    FILTER_REDLINE,
+    FILTER_OUTPUT_COUNT
+};
+
+// Filtered outputs carry raw ADC counts scaled by 2^PRESSURE_FILTER_FRAC_BITS.
+#define PRESSURE_FILTER_FRAC_BITS 4
+
+// Defaults. Record at full rate keeps raw samples in the recording.
+#define FILTER_DEFAULT_TELEMETRY_HZ 20
+#define FILTER_DEFAULT_RECORD_HZ ADC_SAMPLE_RATE_HZ
+#define FILTER_DEFAULT_REDLINE_HZ 500
+#define FILTER_CIC_ORDER 2
+// iir_shift value selecting each channel's SensorChannel::iir_shift.
+#define FILTER_IIR_PER_CHANNEL -1
+
+struct FilteredPressure
+{
+    uint32_t timestamp_us;        // Input timestamp minus group delay.
+    int32_t counts[SENSOR_COUNT]; // Raw ADC counts << PRESSURE_FILTER_FRAC_BITS, indexed like SENSORS.
+};
+
+/**
+ * @brief Sets up every output with the defaults: telemetry low-pass per
+ * SensorChannel::iir_shift, record and redline unfiltered.
+ *
+ * @param input_rate_hz Per-channel sample rate.
+ */
+void pressure_filter_begin(uint32_t input_rate_hz);
+
+/**
+ * @brief Changes the output rates. Rates are rounded to an integer division of
+ * the input rate. Resets filter state.
+ *
+ * @param iir_shift Telemetry low-pass for every channel, y += (x - y) / 2^shift.
+ * 0 disables. FILTER_IIR_PER_CHANNEL restores the sensors.h defaults.
+ */
+void pressure_filter_configure(uint32_t telemetry_hz, uint32_t record_hz, uint32_t redline_hz, int iir_shift);
+
+/**
+ * @brief Consumes one sample.
+ *
+ * @param out Written for each output that is ready.
+ * @return Bitmask of ready outputs (1 << FilterOutput).
+ */
+uint8_t pressure_filter_push(const SensorScan &sample, FilteredPressure out[FILTER_OUTPUT_COUNT]);
+
+/**
+ * @brief Actual output rate after rounding.
+ */
+uint32_t pressure_filter_rate(FilterOutput output);
+
+/**
+ * @brief Group delay of an output, CIC plus IIR.
+ */
+uint32_t pressure_filter_delay_us(FilterOutput output);
+
+uint8_t pressure_filter_iir_shift();
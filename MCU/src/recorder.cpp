@@ -0,0 +1,304 @@
+/**
+ * @file recorder.cpp
+ * @brief Full-rate test recorder on LittleFS.
+ *
+ * Producers only touch the RAM ring. All file work (open, batched writes,
+ * close, dump) happens in one low-priority writer task on the comms core, so
+ * a slow flash erase never stalls sampling.
+ */
+#include "recorder.h"
+#include "pressure_filter.h"
+#include "capture.h"
+#include "ring_buffer.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_timer.h>
+#include <mbedtls/base64.h>
+
+// Records per page write (4 KiB flash sector).
+static const size_t PAGE_RECORDS = 4096 / sizeof(Record);
+// Raw bytes per dump line (64 base64 characters).
+static const size_t DUMP_LINE_BYTES = 48;
+
+static const uint32_t WRITER_TASK_STACK = 8192;
+static const UBaseType_t WRITER_TASK_PRIORITY = 1;
+static const BaseType_t WRITER_TASK_CORE = 0;
+
+// ~2 s of PT and load cell samples at 1 kHz.
+static RingBuffer<Record, 2048> records;
+static portMUX_TYPE records_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t dropped = 0;
+
+static volatile bool recording = false;
+static volatile bool start_requested = false;
+static volatile bool stop_requested = false;
+static volatile bool dump_requested = false;
+static const char *dump_path = RECORDING_PATH;
+static volatile bool recording_undumped = false;
+static volatile bool capture_undumped = false;
+
+static File file;
+static Record page[PAGE_RECORDS];
+static size_t page_fill = 0;
+
+/**
+ * @brief Writes the page buffer to the open file.
+ */
+static void flush_page()
+{
+    if (page_fill == 0)
+        return;
+
+    size_t bytes = page_fill * sizeof(Record);
+    if (file.write((const uint8_t *)page, bytes) != bytes)
+    {
+        // Flash full. Keep draining so producers see drops, not stalls.
+        dropped += page_fill;
+    }
+    page_fill = 0;
+}
+
+/**
+ * @brief "<path>.dumped", present once path has been dumped.
+ */
+static void marker_path(const char *path, char *out, size_t size)
+{
+    snprintf(out, size, "%s.dumped", path);
+}
+
+static volatile bool &undumped_flag(const char *path)
+{
+    return strcmp(path, CAPTURE_PATH) == 0 ? capture_undumped : recording_undumped;
+}
+
+static void open_recording()
+{
+    recorder_set_undumped(RECORDING_PATH, true);
+    file = LittleFS.open(RECORDING_PATH, FILE_WRITE);
+    if (!file)
+    {
+        Serial.println("ERROR: Could not open " RECORDING_PATH);
+        recording = false;
+        return;
+    }
+
+    RecordingHeader header;
+    header.magic = RECORDING_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.record_size = sizeof(Record);
+    header.pressure_rate_hz = pressure_filter_rate(FILTER_RECORD);
+    header.start_us = (uint32_t)esp_timer_get_time();
+    file.write((const uint8_t *)&header, sizeof(header));
+}
+
+static void close_recording()
+{
+    Record record;
+    while (records.pop(record))
+    {
+        page[page_fill++] = record;
+        if (page_fill == PAGE_RECORDS)
+            flush_page();
+    }
+    flush_page();
+    if (file)
+        file.close();
+}
+
+/**
+ * @brief Streams a file as base64 lines so it survives interleaving with
+ * debug prints: REC:BEGIN:<size>, REC:<offset>:<data>..., REC:END.
+ *
+ * @param path
+ */
+static void dump_file(const char *path)
+{
+    File dump = LittleFS.open(path, FILE_READ);
+    if (!dump)
+    {
+        Serial.println("REC:NONE");
+        return;
+    }
+
+    Serial.printf("REC:BEGIN:%u\n", (unsigned)dump.size());
+    uint8_t raw[DUMP_LINE_BYTES];
+    unsigned char encoded[DUMP_LINE_BYTES * 4 / 3 + 4];
+    uint32_t offset = 0;
+    size_t length;
+    while ((length = dump.read(raw, sizeof(raw))) > 0)
+    {
+        size_t encoded_length = 0;
+        mbedtls_base64_encode(encoded, sizeof(encoded), &encoded_length, raw, length);
+        encoded[encoded_length] = '\0';
+        Serial.printf("REC:%u:%s\n", (unsigned)offset, (const char *)encoded);
+        offset += length;
+    }
+    Serial.println("REC:END");
+    dump.close();
+    recorder_set_undumped(path, false);
+}
+
+/**
+ * @brief Owns the file. Batches records into page writes.
+ *
+ * @param arg Unused.
+ */
+static void writer_task(void *arg)
+{
+    while (true)
+    {
+        if (stop_requested)
+        {
+            stop_requested = false;
+            close_recording();
+        }
+        if (start_requested)
+        {
+            start_requested = false;
+            open_recording();
+        }
+        if (dump_requested)
+        {
+            dump_requested = false;
+            dump_file(dump_path);
+        }
+
+        if (file)
+        {
+            Record record;
+            while (records.pop(record))
+            {
+                page[page_fill++] = record;
+                if (page_fill == PAGE_RECORDS)
+                    flush_page();
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+bool recorder_begin()
+{
+    // Formats the partition on first boot.
+    if (!LittleFS.begin(true))
+        return false;
+
+    const char *paths[] = {RECORDING_PATH, CAPTURE_PATH};
+    for (const char *path : paths)
+    {
+        char marker[32];
+        marker_path(path, marker, sizeof(marker));
+        undumped_flag(path) = LittleFS.exists(path) && !LittleFS.exists(marker);
+    }
+
+    xTaskCreatePinnedToCore(writer_task, "recorder", WRITER_TASK_STACK, NULL,
+                            WRITER_TASK_PRIORITY, NULL, WRITER_TASK_CORE);
+    return true;
+}
+
+bool recorder_start(bool force)
+{
+    if (recording)
+        return true;
+    if (!force && recording_undumped)
+        return false;
+    // Set now, not when the writer opens the file, so a second start cannot
+    // slip in first.
+    recording_undumped = true;
+    start_requested = true;
+    recording = true;
+    return true;
+}
+
+void recorder_stop()
+{
+    if (!recording)
+        return;
+    recording = false;
+    stop_requested = true;
+}
+
+bool recorder_is_recording()
+{
+    return recording;
+}
+
+void recorder_request_dump(const char *path)
+{
+    if (strcmp(path, RECORDING_PATH) == 0)
+        recorder_stop();
+    dump_path = path;
+    dump_requested = true;
+}
+
+bool recorder_undumped(const char *path)
+{
+    return undumped_flag(path);
+}
+
+void recorder_set_undumped(const char *path, bool undumped)
+{
+    char marker[32];
+    marker_path(path, marker, sizeof(marker));
+    if (undumped)
+        LittleFS.remove(marker);
+    else
+        LittleFS.open(marker, FILE_WRITE).close();
+    undumped_flag(path) = undumped;
+}
+
+void recorder_log(const Record &record)
+{
+    // The pre-trigger capture sees every record, recording or not.
+    capture_log(record);
+
+    if (!recording)
+        return;
+
+    portENTER_CRITICAL(&records_mux);
+    bool queued = records.push(record);
+    portEXIT_CRITICAL(&records_mux);
+    if (!queued)
+        dropped++;
+}
+
+void recorder_log_pressure(uint32_t timestamp_us, uint8_t channel, uint16_t raw_a, uint16_t raw_b)
+{
+    recorder_log({timestamp_us, RECORD_PRESSURE, channel, raw_a, raw_b});
+}
+
+void recorder_log_load(uint32_t timestamp_us, int32_t raw)
+{
+    recorder_log({timestamp_us, RECORD_LOAD, 0, 0, raw});
+}
+
+void recorder_log_valve(int valve, int angle)
+{
+    recorder_log({(uint32_t)esp_timer_get_time(), RECORD_VALVE, (uint8_t)valve, (uint16_t)angle, 0});
+}
+
+void recorder_log_igniter(bool on)
+{
+    recorder_log({(uint32_t)esp_timer_get_time(), RECORD_IGNITER, 0, (uint16_t)on, 0});
+}
+
+void recorder_log_marker(uint8_t code, int32_t argument)
+{
+    recorder_log({(uint32_t)esp_timer_get_time(), RECORD_MARKER, code, 0, argument});
+}
+
+void recorder_log_redline_config(int rule, uint16_t samples, int32_t threshold)
+{
+    recorder_log({(uint32_t)esp_timer_get_time(), RECORD_REDLINE_CONFIG, (uint8_t)rule, samples, threshold});
+}
+
+void recorder_log_redline_trip(int rule, uint16_t samples, int32_t value)
+{
+    recorder_log({(uint32_t)esp_timer_get_time(), RECORD_REDLINE_TRIP, (uint8_t)rule, samples, value});
+}
+
+uint32_t recorder_dropped()
+{
+    return dropped;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file recorder.h
+ * @brief Full-rate test recorder on the MCU's flash (LittleFS).
+ *
+ * Every raw PT and load cell sample, plus valve and igniter events, is queued
+ * in a RAM ring and written to RECORDING_PATH in batched page writes by a
+ * background task. After the test the file is downloaded over USB serial with
+ * CMD:REC_DUMP (see GCS/download_recording.py).
+ *
+ * A file that was written but never dumped is kept across reboots: ignition
+ * does not auto-start over it, and a new capture is not saved over an
+ * undumped CAPTURE_PATH. A "<path>.dumped" marker records a finished dump.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define RECORDING_PATH "/recording.bin"
+
+// File layout: RecordingHeader followed by Records, little-endian.
+#define RECORDING_MAGIC 0x43455247 // "GREC"
+#define RECORDING_VERSION 1
+
+enum RecordType : uint8_t
+{
+    RECORD_PRESSURE = 1,       // id: sensor channel n, value_a: raw ADC of n, value_b: raw ADC of n + 1.
+                               // id 0 is fuel/ox; see sensors.h.
+    RECORD_LOAD = 2,           // value_b: raw HX711 counts.
+    RECORD_VALVE = 3,          // id: valve number, value_a: angle.
+    RECORD_IGNITER = 4,        // value_a: relay state.
+    RECORD_MARKER = 5,         // id: marker code, value_b: argument.
+    RECORD_REDLINE_CONFIG = 6, // id: rule, value_a: samples (0 = off), value_b: threshold.
+    RECORD_REDLINE_TRIP = 7    // id: rule, value_a: consecutive samples, value_b: value.
+};
+
+struct __attribute__((packed)) RecordingHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t pressure_rate_hz;
+    uint32_t start_us;
+};
+
+struct __attribute__((packed)) Record
+{
+    uint32_t timestamp_us;
+    uint8_t type;
+    uint8_t id;
+    uint16_t value_a;
+    int32_t value_b;
+};
+
+/**
+ * @brief Mounts LittleFS and starts the writer task. Does not start recording.
+ *
+ * @return true if the filesystem mounted.
+ */
+bool recorder_begin();
+
+/**
+ * @brief Truncates RECORDING_PATH and starts recording.
+ *
+ * @param force Also overwrite a recording that was never dumped.
+ * @return false if refused because of an undumped recording. true if
+ * recording, including already.
+ */
+bool recorder_start(bool force = true);
+
+/**
+ * @brief Flushes buffered records and closes the file.
+ */
+void recorder_stop();
+
+bool recorder_is_recording();
+
+/**
+ * @brief Streams a recorder-format file over USB serial from the writer task.
+ * Stops any recording in progress first if path is RECORDING_PATH.
+ *
+ * @param path RECORDING_PATH or CAPTURE_PATH. Must outlive the dump.
+ */
+void recorder_request_dump(const char *path = RECORDING_PATH);
+
+/**
+ * @brief path (RECORDING_PATH or CAPTURE_PATH) holds data that has not been
+ * dumped since it was written. Cached in RAM; safe from any task.
+ */
+bool recorder_undumped(const char *path);
+
+/**
+ * @brief Updates the marker and cached flag for path. Writes flash; call from
+ * the writer or capture task.
+ */
+void recorder_set_undumped(const char *path, bool undumped);
+
+/**
+ * @brief Queues a record. Safe from any task (not from ISRs). Always fed to the
+ * pre-trigger capture; only queued for flash while recording.
+ */
+void recorder_log(const Record &record);
+
+void recorder_log_pressure(uint32_t timestamp_us, uint8_t channel, uint16_t raw_a, uint16_t raw_b);
+void recorder_log_load(uint32_t timestamp_us, int32_t raw);
+void recorder_log_valve(int valve, int angle);
+void recorder_log_igniter(bool on);
+void recorder_log_marker(uint8_t code, int32_t argument);
+void recorder_log_redline_config(int rule, uint16_t samples, int32_t threshold);
+void recorder_log_redline_trip(int rule, uint16_t samples, int32_t value);
+
+/**
+ * @brief Records lost because the RAM ring or flash was full.
+ */
+uint32_t recorder_dropped();
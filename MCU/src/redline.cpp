@@ -0,0 +1,102 @@
+/**
+ * @file redline.cpp
+ * @brief Consecutive-sample threshold rules.
+ */
+#include "redline.h"
+#include "recorder.h"
+
+static RedlineConfig rules[REDLINE_RULE_COUNT];
+static uint16_t over_count[REDLINE_RULE_COUNT];
+
+static volatile bool tripped = false;
+static RedlineRule trip_rule = REDLINE_FUEL_PSI;
+
+/**
+ * @brief Counts one check of a rule.
+ *
+ * @return true if this check trips it.
+ */
+static bool evaluate(RedlineRule rule, float value, bool firing)
+{
+    const RedlineConfig &config = rules[rule];
+    if (config.samples == 0 || (config.firing_only && !firing) || value <= config.threshold)
+    {
+        over_count[rule] = 0;
+        return false;
+    }
+
+    if (++over_count[rule] < config.samples)
+        return false;
+
+    tripped = true;
+    trip_rule = rule;
+    recorder_log_redline_trip(rule, over_count[rule], (int32_t)value);
+    return true;
+}
+
+void redline_begin()
+{
+    rules[REDLINE_FUEL_PSI] = {REDLINE_DEFAULT_FUEL_PSI, REDLINE_DEFAULT_PRESSURE_SAMPLES, false};
+    rules[REDLINE_OX_PSI] = {REDLINE_DEFAULT_OX_PSI, REDLINE_DEFAULT_PRESSURE_SAMPLES, false};
+    rules[REDLINE_IMBALANCE_PSI] = {REDLINE_DEFAULT_IMBALANCE_PSI, 0, true};
+    rules[REDLINE_LOAD_LOSS_MS] = {REDLINE_DEFAULT_LOAD_LOSS_MS, 0, true};
+    redline_reset();
+}
+
+void redline_configure(RedlineRule rule, int32_t threshold, uint16_t samples)
+{
+    if (rule >= REDLINE_RULE_COUNT)
+        return;
+    rules[rule].threshold = threshold;
+    rules[rule].samples = samples;
+    over_count[rule] = 0;
+    recorder_log_redline_config(rule, samples, threshold);
+}
+
+const RedlineConfig &redline_config(RedlineRule rule)
+{
+    return rules[rule];
+}
+
+void redline_log_config()
+{
+    for (int rule = 0; rule < REDLINE_RULE_COUNT; rule++)
+        recorder_log_redline_config(rule, rules[rule].samples, rules[rule].threshold);
+}
+
+bool redline_check_pressure(float fuel_psi, float ox_psi, bool firing)
+{
+    if (tripped)
+        return false;
+
+    float imbalance = ox_psi > fuel_psi ? ox_psi - fuel_psi : fuel_psi - ox_psi;
+    // Evaluate all rules so every counter stays current.
+    bool trip = evaluate(REDLINE_FUEL_PSI, fuel_psi, firing);
+    trip = evaluate(REDLINE_OX_PSI, ox_psi, firing) || trip;
+    trip = evaluate(REDLINE_IMBALANCE_PSI, imbalance, firing) || trip;
+    return trip;
+}
+
+bool redline_check_load(uint32_t age_ms, bool firing)
+{
+    if (tripped)
+        return false;
+    return evaluate(REDLINE_LOAD_LOSS_MS, (float)age_ms, firing);
+}
+
+bool redline_tripped()
+{
+    return tripped;
+}
+
+RedlineRule redline_trip_rule()
+{
+    return trip_rule;
+}
+
+void redline_reset()
+{
+    for (int rule = 0; rule < REDLINE_RULE_COUNT; rule++)
+        over_count[rule] = 0;
+    tripped = false;
+}
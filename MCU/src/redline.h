@@ -0,0 +1,84 @@
+/**
+ * @file redline.h
+ * @brief Onboard abort rules checked on every sample.
+ *
+ * Each rule trips after its threshold is exceeded for `samples` consecutive
+ * checks. A trip latches until CMD:RL_RESET; the caller aborts the burn and
+ * closes the valves the moment a check returns true. Configuration changes
+ * and trips are written to the recorder (RECORD_REDLINE_*).
+ */
+#pragma once
+
+#include <stdint.h>
+
+enum RedlineRule : uint8_t
+{
+    REDLINE_FUEL_PSI,      // Fuel PSI above threshold.
+    REDLINE_OX_PSI,        // Ox PSI above threshold.
+    REDLINE_IMBALANCE_PSI, // |ox - fuel| PSI above threshold, while firing.
+    REDLINE_LOAD_LOSS_MS,  // No load cell conversion for threshold ms, while firing.
+    REDLINE_RULE_COUNT
+};
+
+struct RedlineConfig
+{
+    int32_t threshold;
+    uint16_t samples; // Consecutive checks over threshold to trip. 0 disables.
+    bool firing_only;
+};
+
+// Defaults. Imbalance and load loss depend on the test and start disabled.
+#define REDLINE_DEFAULT_FUEL_PSI 900
+#define REDLINE_DEFAULT_OX_PSI 900
+#define REDLINE_DEFAULT_PRESSURE_SAMPLES 5
+#define REDLINE_DEFAULT_IMBALANCE_PSI 200
+#define REDLINE_DEFAULT_LOAD_LOSS_MS 250
+
+inline const char *redline_rule_name(RedlineRule rule)
+{
+    static const char *const NAMES[REDLINE_RULE_COUNT] = {"FUEL", "OX", "IMBALANCE", "LOAD"};
+    return rule < REDLINE_RULE_COUNT ? NAMES[rule] : "?";
+}
+
+/**
+ * @brief Loads the default rules.
+ */
+void redline_begin();
+
+/**
+ * @brief Changes a rule and records the new setting.
+ *
+ * @param samples 0 disables the rule.
+ */
+void redline_configure(RedlineRule rule, int32_t threshold, uint16_t samples);
+
+const RedlineConfig &redline_config(RedlineRule rule);
+
+/**
+ * @brief Writes every rule to the recorder, so each recording says which
+ * limits were armed.
+ */
+void redline_log_config();
+
+/**
+ * @brief Checks the pressure rules against one sample.
+ *
+ * @return true on the sample that trips a rule.
+ */
+bool redline_check_pressure(float fuel_psi, float ox_psi, bool firing);
+
+/**
+ * @brief Checks the load cell rule.
+ *
+ * @param age_ms Time since the last conversion.
+ * @return true on the check that trips it.
+ */
+bool redline_check_load(uint32_t age_ms, bool firing);
+
+bool redline_tripped();
+RedlineRule redline_trip_rule();
+
+/**
+ * @brief Clears a latched trip and the consecutive counters.
+ */
+void redline_reset();
@@ -0,0 +1,64 @@
+/**
+ * @file sensors.h
+ * @brief Registry of analog sensor channels.
+ *
+ * Every channel listed in SENSORS is scanned in the same ADC DMA pass (see
+ * adc_sampler.h), gets its own calibrated lookup table, tare and filter
+ * chains. Adding a sensor is one row here. Channels must be on ADC1 pins
+ * (GPIO 32-39); 32 is taken by the ox valve.
+ */
+#pragma once
+
+#include <stdint.h>
+
+enum SensorType : uint8_t
+{
+    SENSOR_PRESSURE,   // Units: PSI.
+    SENSOR_TEMPERATURE // Units: degrees C, e.g. a thermocouple amplifier.
+};
+
+/**
+ * @brief Linear analog sensor behind a voltage divider.
+ *
+ * units = (pin_volts / divider_ratio - zero_volts) * units_per_volt
+ */
+struct SensorChannel
+{
+    const char *name;
+    uint8_t pin;
+    SensorType type;
+    float divider_ratio;  // R2 / (R1 + R2); 1 if wired straight to the pin.
+    float zero_volts;     // Sensor output at 0 units.
+    float units_per_volt;
+    bool tare;            // Zeroed by CMD:TARE. Off for absolute sensors.
+    uint8_t iir_shift;    // Default telemetry low-pass (see pressure_filter.h).
+};
+
+// 5V 0-1000 PSI transducer (0.5-4.5 V) behind a 1k/2k divider.
+constexpr float PT_DIVIDER_RATIO = 2.0f / (1.0f + 2.0f);
+constexpr float PT_ZERO_VOLTS = 0.5f;
+constexpr float PT_PSI_PER_VOLT = 1000.0f / (4.5f - 0.5f);
+
+// AD8495 thermocouple amplifier: 1.25 V at 0 C, 5 mV/C.
+constexpr float TC_ZERO_VOLTS = 1.25f;
+constexpr float TC_C_PER_VOLT = 200.0f;
+
+constexpr SensorChannel SENSORS[] = {
+    {"fuel", 39, SENSOR_PRESSURE, PT_DIVIDER_RATIO, PT_ZERO_VOLTS, PT_PSI_PER_VOLT, true, 0},
+    {"ox", 34, SENSOR_PRESSURE, PT_DIVIDER_RATIO, PT_ZERO_VOLTS, PT_PSI_PER_VOLT, true, 0},
+    // Next stand:
+    // {"chamber", 36, SENSOR_PRESSURE, PT_DIVIDER_RATIO, PT_ZERO_VOLTS, PT_PSI_PER_VOLT, true, 0},
+    // {"tc_injector", 35, SENSOR_TEMPERATURE, 1.0f, TC_ZERO_VOLTS, TC_C_PER_VOLT, false, 2},
+    // {"tc_nozzle", 33, SENSOR_TEMPERATURE, 1.0f, TC_ZERO_VOLTS, TC_C_PER_VOLT, false, 2},
+};
+
+constexpr int SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+// Channels the firmware refers to by name (telemetry frame, redlines).
+enum SensorId : uint8_t
+{
+    SENSOR_FUEL = 0,
+    SENSOR_OX = 1
+};
+
+static_assert(SENSOR_COUNT > SENSOR_OX, "fuel and ox must stay registered");
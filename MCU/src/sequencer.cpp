@@ -0,0 +1,203 @@
+/**
+ * @file sequencer.cpp
+ * @brief One-shot esp_timer stepping through the ignition timeline.
+ */
+#include "sequencer.h"
+#include "actuator.h"
+#include "recorder.h"
+#include "valves.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+static SequenceStep steps[SEQUENCE_MAX_STEPS];
+static size_t step_count = 0;
+
+static esp_timer_handle_t step_timer = NULL;
+static volatile bool running = false;
+static size_t next_step = 0;
+static int64_t start_us = 0;
+// Held while steps run, so an abort cannot interleave with a step.
+static SemaphoreHandle_t sequencer_mutex = NULL;
+
+static bool relay_on = false;
+
+static void set_relay(bool on)
+{
+    digitalWrite(RELAY_PIN, on ? HIGH : LOW);
+    relay_on = on;
+    recorder_log_igniter(on);
+}
+
+/**
+ * @brief Closes every valve the timeline touches and is not already closed.
+ * Caller holds sequencer_mutex.
+ */
+static void close_sequence_valves()
+{
+    ValveMove moves[NUM_VALVES];
+    size_t move_count = 0;
+    for (int valve = 1; valve <= NUM_VALVES; valve++)
+    {
+        uint8_t closed = (uint8_t)valve_angle(valve, VALVE_CLOSE);
+        if (actuator_target(valve) == closed)
+            continue;
+        for (size_t i = 0; i < step_count; i++)
+        {
+            if (steps[i].action == STEP_VALVE && steps[i].valve == valve)
+            {
+                moves[move_count++] = {(uint8_t)valve, closed};
+                break;
+            }
+        }
+    }
+    actuator_move_many(moves, move_count);
+    for (size_t i = 0; i < move_count; i++)
+        recorder_log_valve(moves[i].valve, moves[i].angle);
+}
+
+/**
+ * @brief Runs every step that is due, then re-arms for the next one.
+ */
+static void step_callback(void *arg)
+{
+    ValveMove moves[SEQUENCE_MAX_STEPS];
+    size_t move_count = 0;
+
+    xSemaphoreTake(sequencer_mutex, portMAX_DELAY);
+    if (!running)
+    {
+        xSemaphoreGive(sequencer_mutex);
+        return;
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    for (; next_step < step_count && steps[next_step].offset_us <= elapsed_us; next_step++)
+    {
+        const SequenceStep &step = steps[next_step];
+        if (step.action == STEP_RELAY)
+            set_relay(step.value != 0);
+        else
+            moves[move_count++] = {step.valve, step.value};
+    }
+    if (move_count > 0)
+    {
+        actuator_move_many(moves, move_count);
+        for (size_t i = 0; i < move_count; i++)
+            recorder_log_valve(moves[i].valve, moves[i].angle);
+    }
+
+    if (next_step < step_count)
+    {
+        int64_t delay_us = steps[next_step].offset_us - (esp_timer_get_time() - start_us);
+        esp_timer_start_once(step_timer, delay_us > 0 ? delay_us : 0);
+    }
+    else
+    {
+        // An uploaded timeline may not end with R:0 or its closes; the burn
+        // never ends with the igniter on or a propellant valve open.
+        running = false;
+        if (relay_on)
+            set_relay(false);
+        close_sequence_valves();
+    }
+    xSemaphoreGive(sequencer_mutex);
+}
+
+void sequencer_begin()
+{
+    sequencer_mutex = xSemaphoreCreateMutex();
+    pinMode(RELAY_PIN, OUTPUT);
+    digitalWrite(RELAY_PIN, LOW);
+
+    esp_timer_create_args_t args = {};
+    args.callback = step_callback;
+    args.name = "sequencer";
+    esp_timer_create(&args, &step_timer);
+
+    sequencer_load_default();
+}
+
+bool sequencer_load_default()
+{
+    if (!sequencer_clear())
+        return false;
+
+    sequencer_add({0, STEP_RELAY, 0, 1});
+    sequencer_add({1000000, STEP_VALVE, VALVE_FUEL, (uint8_t)valve_angle(VALVE_FUEL, VALVE_OPEN)});
+    sequencer_add({1000000, STEP_VALVE, VALVE_OX, (uint8_t)valve_angle(VALVE_OX, VALVE_OPEN)});
+    sequencer_add({6000000, STEP_VALVE, VALVE_FUEL, (uint8_t)valve_angle(VALVE_FUEL, VALVE_CLOSE)});
+    sequencer_add({6000000, STEP_VALVE, VALVE_OX, (uint8_t)valve_angle(VALVE_OX, VALVE_CLOSE)});
+    sequencer_add({6000000, STEP_RELAY, 0, 0});
+    return true;
+}
+
+bool sequencer_clear()
+{
+    if (running)
+        return false;
+    step_count = 0;
+    return true;
+}
+
+bool sequencer_add(const SequenceStep &step)
+{
+    if (running || step_count >= SEQUENCE_MAX_STEPS)
+        return false;
+    if (step.action == STEP_VALVE && (step.valve < 1 || step.valve > NUM_VALVES))
+        return false;
+
+    size_t index = step_count;
+    while (index > 0 && steps[index - 1].offset_us > step.offset_us)
+    {
+        steps[index] = steps[index - 1];
+        index--;
+    }
+    steps[index] = step;
+    step_count++;
+    return true;
+}
+
+bool sequencer_start()
+{
+    xSemaphoreTake(sequencer_mutex, portMAX_DELAY);
+    if (running || step_count == 0)
+    {
+        xSemaphoreGive(sequencer_mutex);
+        return false;
+    }
+    running = true;
+    next_step = 0;
+    start_us = esp_timer_get_time();
+    xSemaphoreGive(sequencer_mutex);
+
+    step_callback(NULL);
+    return true;
+}
+
+void sequencer_abort()
+{
+    xSemaphoreTake(sequencer_mutex, portMAX_DELAY);
+    bool was_running = running;
+    running = false;
+    esp_timer_stop(step_timer);
+
+    set_relay(false);
+    if (was_running)
+        close_sequence_valves();
+    xSemaphoreGive(sequencer_mutex);
+}
+
+bool sequencer_running()
+{
+    return running;
+}
+
+size_t sequencer_count()
+{
+    return step_count;
+}
+
+const SequenceStep &sequencer_step(size_t index)
+{
+    return steps[index];
+}
@@ -0,0 +1,77 @@
+/**
+ * @file sequencer.h
+ * @brief esp_timer-driven ignition timeline.
+ *
+ * A sequence is a list of relay and valve steps at offsets from t0. Once
+ * started, each step fires from a one-shot esp_timer at its exact offset, so
+ * shutdown timing does not depend on what the actuation or comms tasks are
+ * doing. The timeline can be replaced over the command link (CMD:SEQ_*).
+ * When the last step has run, the relay is turned off and every valve the
+ * timeline touched is closed, whatever the steps said.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Igniter relay pin.
+#define RELAY_PIN 22
+
+#define SEQUENCE_MAX_STEPS 16
+
+enum SequenceAction : uint8_t
+{
+    STEP_RELAY, // value: 1 on, 0 off.
+    STEP_VALVE  // valve: 1..NUM_VALVES, value: angle.
+};
+
+struct SequenceStep
+{
+    uint32_t offset_us; // From sequencer_start().
+    SequenceAction action;
+    uint8_t valve;
+    uint8_t value;
+};
+
+/**
+ * @brief Creates the step timer and loads the default sequence.
+ */
+void sequencer_begin();
+
+/**
+ * @brief Relay on at t0, fuel and ox open at 1 s, all off after a 5 s burn.
+ *
+ * @return false while running.
+ */
+bool sequencer_load_default();
+
+/**
+ * @return false while running.
+ */
+bool sequencer_clear();
+
+/**
+ * @brief Inserts a step, keeping the timeline ordered by offset. Steps with
+ * the same offset run in the order added, and valve steps among them move in
+ * the same PWM period.
+ *
+ * @return false while running or if the timeline is full.
+ */
+bool sequencer_add(const SequenceStep &step);
+
+/**
+ * @brief Starts the timeline now. Steps at offset 0 run before this returns.
+ *
+ * @return false if already running or empty.
+ */
+bool sequencer_start();
+
+/**
+ * @brief Cancels pending steps, turns the relay off and closes every valve
+ * the timeline touches. Safe to call when idle.
+ */
+void sequencer_abort();
+
+bool sequencer_running();
+size_t sequencer_count();
+const SequenceStep &sequencer_step(size_t index);
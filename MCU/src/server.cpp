@@ -0,0 +1,172 @@
+/**
+ * @file server.cpp
+ * @brief WiFi/UDP link to the GCS.
+ */
+#include "server.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <clock_sync.h>
+#include <esp_timer.h>
+
+static WiFiUDP udp;
+// WiFiUDP is not thread-safe, and server_send() is documented safe from any task.
+static SemaphoreHandle_t server_mutex = NULL;
+static bool udp_started = false;
+
+// Whoever last sent a valid datagram.
+static IPAddress peer_ip;
+static uint16_t peer_port = 0;
+static char peer_text[24] = "";
+
+static volatile uint32_t last_rx_ms = 0;
+static volatile uint32_t last_tx_ms = 0;
+static uint32_t last_attempt_ms = 0;
+static ServerStats stats = {};
+
+void server_begin()
+{
+    server_mutex = xSemaphoreCreateMutex();
+    WiFi.mode(WIFI_STA);
+    // Modem sleep would hold every packet until the next AP beacon.
+    WiFi.setSleep(false);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(GCS_WIFI_SSID, GCS_WIFI_PASSWORD);
+    last_attempt_ms = millis();
+}
+
+void server_update(uint32_t now_ms)
+{
+    if (server_mutex == NULL)
+        return;
+
+    bool associated = WiFi.status() == WL_CONNECTED;
+    xSemaphoreTake(server_mutex, portMAX_DELAY);
+    if (associated && !udp_started)
+    {
+        udp_started = udp.begin(GCS_UDP_PORT);
+    }
+    else if (!associated && udp_started)
+    {
+        // The address may change on the next association.
+        udp.stop();
+        udp_started = false;
+        peer_port = 0;
+        peer_text[0] = '\0';
+    }
+    xSemaphoreGive(server_mutex);
+
+    if (!associated && now_ms - last_attempt_ms >= SERVER_RECONNECT_MS)
+    {
+        last_attempt_ms = now_ms;
+        stats.reconnects++;
+        WiFi.reconnect();
+    }
+
+    if (server_connected() && now_ms - last_tx_ms >= SERVER_KEEPALIVE_MS)
+        server_send(SERIAL_KEEPALIVE, NULL, 0);
+}
+
+/**
+ * @brief Sends one encoded packet to the peer. Caller holds server_mutex.
+ */
+static bool send_locked(const uint8_t *encoded, size_t encoded_length)
+{
+    if (!udp_started || peer_port == 0)
+        return false;
+
+    // The trailing delimiter is redundant in a datagram but keeps one decoder
+    // on the GCS.
+    bool sent = udp.beginPacket(peer_ip, peer_port) && udp.write(encoded, encoded_length) == encoded_length &&
+                udp.endPacket();
+    if (sent)
+    {
+        stats.sent++;
+        last_tx_ms = millis();
+    }
+    else
+    {
+        stats.send_errors++;
+    }
+    return sent;
+}
+
+bool server_send(SerialPacketType type, const void *payload, size_t length)
+{
+    uint8_t encoded[SERIAL_PACKET_MAX_ENCODED];
+    size_t encoded_length = serial_packet_encode(type, payload, length, encoded);
+    if (encoded_length == 0 || server_mutex == NULL)
+        return false;
+
+    xSemaphoreTake(server_mutex, portMAX_DELAY);
+    bool sent = send_locked(encoded, encoded_length);
+    xSemaphoreGive(server_mutex);
+    return sent;
+}
+
+bool server_send_text(SerialPacketType type, const char *text)
+{
+    return server_send(type, text, strlen(text));
+}
+
+bool server_receive(SerialPacket &packet)
+{
+    if (server_mutex == NULL)
+        return false;
+
+    xSemaphoreTake(server_mutex, portMAX_DELAY);
+    bool received = false;
+    while (udp_started && !received)
+    {
+        int size = udp.parsePacket();
+        if (size <= 0)
+            break;
+        uint32_t receive_us = (uint32_t)esp_timer_get_time();
+
+        uint8_t frame[SERIAL_PACKET_MAX_ENCODED];
+        int length = udp.read(frame, sizeof(frame));
+        if (length > 0 && frame[length - 1] == 0)
+            length--;
+        if (size > (int)sizeof(frame) || length <= 0 || !serial_packet_decode(frame, length, packet))
+        {
+            stats.bad_datagrams++;
+            continue;
+        }
+
+        stats.received++;
+        last_rx_ms = millis();
+        peer_ip = udp.remoteIP();
+        peer_port = udp.remotePort();
+        snprintf(peer_text, sizeof(peer_text), "%u.%u.%u.%u:%u", peer_ip[0], peer_ip[1], peer_ip[2], peer_ip[3],
+                 peer_port);
+
+        if (packet.type == SERIAL_TIME_REQUEST && packet.length == sizeof(uint32_t))
+        {
+            TimeSyncReply reply;
+            memcpy(&reply.origin_us, packet.payload, sizeof(reply.origin_us));
+            reply.receive_us = receive_us;
+            uint8_t encoded[SERIAL_PACKET_MAX_ENCODED];
+            reply.transmit_us = (uint32_t)esp_timer_get_time();
+            size_t encoded_length = serial_packet_encode(SERIAL_TIME_REPLY, &reply, sizeof(reply), encoded);
+            send_locked(encoded, encoded_length);
+        }
+        received = true;
+    }
+    xSemaphoreGive(server_mutex);
+    return received;
+}
+
+bool server_connected()
+{
+    return udp_started && peer_port != 0 && millis() - last_rx_ms < SERVER_TIMEOUT_MS;
+}
+
+const char *server_peer()
+{
+    return peer_text;
+}
+
+ServerStats server_stats()
+{
+    return stats;
+}
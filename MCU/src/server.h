@@ -0,0 +1,94 @@
+/**
+ * @file server.h
+ * @brief WiFi/UDP link to the GCS laptop, next to the Lora Away path.
+ *
+ * Joins GCS_WIFI_SSID as a station and listens on GCS_UDP_PORT. Every
+ * datagram is one packet encoded as on the Serial2 wire (serial_packet.h), so
+ * the GCS decodes both links the same way. The GCS announces itself with a
+ * SERIAL_KEEPALIVE every 250 ms (broadcast until it knows the MCU's address);
+ * the server sends to whoever last sent it a valid packet.
+ *
+ * Over UDP the MCU streams every record-filter sample (SERIAL_SAMPLES), the
+ * telemetry frames and log lines, and accepts commands. The GCS sends them as
+ * SERIAL_TRACED_COMMAND with its own sequence and retries until the MCU
+ * answers SERIAL_COMMAND_ACK; the MCU runs each sequence once. The Lora Away path
+ * runs unchanged next to it as the low-rate, safety-critical fallback: the
+ * GCS uses whichever link is healthy, and the MCU obeys commands from both.
+ * SERIAL_TIME_REQUEST is answered as soon as it is read, so the GCS can
+ * sync to the MCU clock directly (clock_sync.h).
+ *
+ * Only ADC1 pins can be sampled while WiFi is on; sensors.h already uses them.
+ */
+#pragma once
+
+#include <serial_packet.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Override in platformio.ini build_flags, e.g. -DGCS_WIFI_SSID=\"stand\".
+#ifndef GCS_WIFI_SSID
+#define GCS_WIFI_SSID "GINA-GCS"
+#endif
+#ifndef GCS_WIFI_PASSWORD
+#define GCS_WIFI_PASSWORD ""
+#endif
+#ifndef GCS_UDP_PORT
+#define GCS_UDP_PORT 5005
+#endif
+
+// The GCS counts as gone after this long without a valid datagram.
+const uint32_t SERVER_TIMEOUT_MS = 1000;
+// Sent to the GCS when nothing else was.
+const uint32_t SERVER_KEEPALIVE_MS = 250;
+// Between reconnect attempts while the access point is out of reach.
+const uint32_t SERVER_RECONNECT_MS = 5000;
+
+struct ServerStats
+{
+    uint32_t received;      // Valid datagrams.
+    uint32_t bad_datagrams; // Malformed or failed CRC.
+    uint32_t sent;          // Datagrams sent.
+    uint32_t send_errors;   // Dropped by the WiFi stack.
+    uint32_t reconnects;    // WiFi reconnect attempts.
+};
+
+/**
+ * @brief Starts joining the access point. Returns immediately.
+ */
+void server_begin();
+
+/**
+ * @brief Call from the comms task: retries WiFi and sends keepalives.
+ *
+ * @param now_ms millis().
+ */
+void server_update(uint32_t now_ms);
+
+/**
+ * @brief Sends a packet to the GCS, if one has been heard from. Safe from any
+ * task.
+ *
+ * @return false if there is no GCS or the datagram was dropped.
+ */
+bool server_send(SerialPacketType type, const void *payload, size_t length);
+bool server_send_text(SerialPacketType type, const char *text);
+
+/**
+ * @brief Reads the next valid datagram, keepalives included: each one shows
+ * the GCS is still up. SERIAL_TIME_REQUEST is answered here, then returned too.
+ *
+ * @return false if none are waiting.
+ */
+bool server_receive(SerialPacket &packet);
+
+/**
+ * @brief WiFi associated and the GCS heard from within SERVER_TIMEOUT_MS.
+ */
+bool server_connected();
+
+/**
+ * @brief GCS address as text, for logs. Empty if none.
+ */
+const char *server_peer();
+
+ServerStats server_stats();
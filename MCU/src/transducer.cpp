@@ -18,6 +18,8 @@
 
 
  #include <Arduino.h>
+ #include <esp_adc_cal.h>
+ #include "adc_sampler.h"
  #include "transducer.h"
 
 //  // CHANGEME: An ADC pin, baud rate, and ADC voltage/resolution.
@@ -40,61 +42,65 @@
 //  const float SENSOR_MAX_VOLTAGE = 4.5;
 //  const float MAX_PSI = 1000;
  
- // The tared pressure at atmospheric pressure, for calibration.
- float tare_fuel_pressure = 0;
- float tare_ox_pressure = 0;
+ int16_t sensor_lut[SENSOR_COUNT][SENSOR_LUT_SIZE];
+
+ // Used when the chip has no eFuse calibration.
+ const uint32_t DEFAULT_VREF_MV = 1100;
 
  /**
-  * Reads the pressure from the sensor.
-  * @param ptd_index 1:fuel, 2: oxygen
-  * @return The pressure in PSI.
+  * Converts an ADC pin voltage to sensor units through the channel's divider
+  * and range.
+  * @param pin_voltage Volts at the ADC pin.
+  * @return The reading in sensor units.
   */
- float readPressure(int ptd_index) {
+ static float pinVoltageToUnits(const SensorChannel &sensor, float pin_voltage) {
+   // Apply inverse voltage divider ratio to scale back to the sensor output.
+   float voltage = pin_voltage / sensor.divider_ratio;
+   return (voltage - sensor.zero_volts) * sensor.units_per_volt;
+ }
 
-   int adc_value = 0;
+ /**
+  * Builds the raw-to-units tables from the ADC1 eFuse characterization, which
+  * corrects the ESP32 ADC's gain and offset error. Tares are applied by the
+  * caller (see calibration.h).
+  * @return true if eFuse calibration data was found; false if the tables use
+  * the nominal reference voltage.
+  */
+ bool transducer_begin() {
+   esp_adc_cal_characteristics_t characteristics;
+   esp_adc_cal_value_t source = esp_adc_cal_characterize(
+       ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, DEFAULT_VREF_MV, &characteristics);
 
-   if (ptd_index == 1) // Read from fuel ptd.
-   {
-    adc_value = analogRead(FUEL_PTD_PIN);
-   }
-   else // Assuming oxygen.
-   {
-    adc_value = analogRead(OX_PTD_PIN);
+   for (int raw = 0; raw < SENSOR_LUT_SIZE; raw++) {
+     float pin_voltage = esp_adc_cal_raw_to_voltage(raw, &characteristics) / 1000.0;
+     // Every channel shares ADC1 and its attenuation, so one characterization.
+     for (int channel = 0; channel < SENSOR_COUNT; channel++) {
+       float units_x10 = pinVoltageToUnits(SENSORS[channel], pin_voltage) * 10;
+       sensor_lut[channel][raw] = units_x10 > INT16_MAX   ? INT16_MAX
+                                  : units_x10 < INT16_MIN ? INT16_MIN
+                                                          : (int16_t)lroundf(units_x10);
+     }
    }
-   
 
-  //  Serial.println(String(adc_value));
- 
-   // ADC value is an integer between 0 and 2^RESOLUTION - 1.
-   // To convert it to a voltage, we scale it back to ADC voltage.
-   // See:
-   // https://www.arduino.cc/reference/tr/language/functions/analog-io/analogread/
-   float voltage = (adc_value / ADC_MAX_VALUE) * ADC_MAX_VOLTAGE;
-   // Apply inverse voltage divider ratio to scale back to 0.5-4.5.
-   float r_1 = 1.0; // kOhm
-   float r_2 = 2.0; // kOhm
-   float voltage_divider_ratio = r_2/(r_1 + r_2);
-   voltage /= voltage_divider_ratio;
- 
-   // To convert the voltage to PSI, scale to the sensor's min and max
-   // voltage.
-   float psi = ((voltage - SENSOR_MIN_VOLTAGE) /
-                (SENSOR_MAX_VOLTAGE - SENSOR_MIN_VOLTAGE)) *
-               MAX_PSI;
- 
-   return psi;
+   return source != ESP_ADC_CAL_VAL_DEFAULT_VREF;
  }
- 
+
  /**
-  * Tares the sensor by taking multiple samples and averaging them.
-  * @return The tared pressure.
+  * Reads the latest value of a channel from the continuous sampler.
+  * @param channel Index into SENSORS.
+  * @return The reading in sensor units (untared).
   */
- float tarePressure(int ptd_index) {
-   float sum = 0;
-   for (int i = 0; i < TARE_SAMPLES; i++) {
-     sum += readPressure(ptd_index);
-     delay(TARE_DELAY_MS);
-   }
- 
-   return sum / TARE_SAMPLES;
- }
\ No newline at end of file
+ float readSensor(int channel) {
+   SensorScan sample = adc_sampler_latest();
+   return rawToUnits(channel, sample.raw[channel]);
+ }
+
+ /**
+  * Converts a raw ADC reading to sensor units.
+  * @param channel Index into SENSORS.
+  * @param adc_value Raw ADC counts, 0 to 2^RESOLUTION - 1.
+  * @return The reading in sensor units.
+  */
+ float rawToUnits(int channel, uint16_t adc_value) {
+   return rawToUnitsX10(channel, adc_value) / 10.0f;
+ }
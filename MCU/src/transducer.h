@@ -1,30 +1,50 @@
 #pragma once
 
+#include "adc_sampler.h"
+#include <stdint.h>
 
+bool transducer_begin();
+float readSensor(int channel);
+float rawToUnits(int channel, uint16_t adc_value);
 
-float readPressure(int ptd_index);
-float tarePressure(int ptd_index);
-
-extern float tare_fuel_pressure;
-extern float tare_ox_pressure;
-
- // CHANGEME: An ADC pin, baud rate, and ADC voltage/resolution.
- #define FUEL_PTD_PIN 39
- #define OX_PTD_PIN 34
+ // CHANGEME: Baud rate, and ADC voltage/resolution. Pins and sensor ranges
+ // are per channel in sensors.h.
  #define BAUD_RATE 115200
  #define ADC_MAX_VOLTAGE 3.3
  #define ADC_RESOLUTION 12
  
- // The number of samples to take when taring the sensor.
- const int TARE_SAMPLES = 100;
- // The delay between samples when taring the sensor.
- const int TARE_DELAY_MS = 10;
- 
  // The max ADC value. See:
  // https://www.arduino.cc/reference/tr/language/functions/analog-io/analogread/
  const float ADC_MAX_VALUE = (1 << ADC_RESOLUTION) - 1; // 2^RESOLUTION - 1
- 
- // Sensor info.
- const float SENSOR_MIN_VOLTAGE = 0.5;
- const float SENSOR_MAX_VOLTAGE = 4.5;
- const float MAX_PSI = 1000;
\ No newline at end of file
+
+ // Raw-to-units table per channel, one entry per ADC code, in 0.1 units
+ // (PSI, C). Built by transducer_begin() from the eFuse ADC characterization.
+ #define SENSOR_LUT_SIZE (1 << ADC_RESOLUTION)
+ extern int16_t sensor_lut[SENSOR_COUNT][SENSOR_LUT_SIZE];
+
+ /**
+  * Converts a raw ADC reading to sensor units with one table lookup.
+  * @param channel Index into SENSORS.
+  * @return The reading in 0.1 units.
+  */
+ inline int16_t rawToUnitsX10(int channel, uint16_t adc_value) {
+   return sensor_lut[channel][adc_value & (SENSOR_LUT_SIZE - 1)];
+ }
+
+ /**
+  * Converts a fractional ADC reading (e.g. a filter output) to sensor units,
+  * interpolating between table entries.
+  * @param counts Raw ADC counts << frac_bits.
+  * @return The reading in 0.1 units.
+  */
+ inline int32_t countsToUnitsX10(int channel, int32_t counts, int frac_bits) {
+   int32_t index = counts >> frac_bits;
+   int32_t fraction = counts & ((1 << frac_bits) - 1);
+   if (index < 0)
+     return sensor_lut[channel][0];
+   if (index >= SENSOR_LUT_SIZE - 1)
+     return sensor_lut[channel][SENSOR_LUT_SIZE - 1];
+   int32_t low = sensor_lut[channel][index];
+   int32_t high = sensor_lut[channel][index + 1];
+   return low + (((high - low) * fraction) >> frac_bits);
+ }
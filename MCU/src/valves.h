@@ -0,0 +1,37 @@
+/**
+ * @file valves.h
+ * @brief Compile-time valve table.
+ *
+ * VALVES is generated from config/valves.yaml before every build, so adding a
+ * valve is a YAML edit. Valve numbers are 1-based (V1 is VALVES[0]).
+ */
+#pragma once
+
+#include "command_parser.h"
+#include <stdint.h>
+
+struct ValveDescriptor
+{
+    const char *name;
+    uint8_t pin;
+    uint8_t angles[3]; // Indexed by ValvePosition: open, closed, neutral.
+    ValvePosition default_state;
+    uint16_t slew_deg_s; // 0: move in one step.
+    uint16_t detach_ms;  // 0: stay attached.
+};
+
+static_assert(VALVE_OPEN == 0 && VALVE_CLOSE == 1 && VALVE_NEUTRAL == 2,
+              "ValveDescriptor::angles is indexed by ValvePosition");
+
+#include "valves_generated.h"
+
+/**
+ * @brief Angle for a named position.
+ *
+ * @param valve 1..NUM_VALVES.
+ * @param position VALVE_OPEN, VALVE_CLOSE or VALVE_NEUTRAL.
+ */
+constexpr int valve_angle(int valve, ValvePosition position)
+{
+    return VALVES[valve - 1].angles[position];
+}
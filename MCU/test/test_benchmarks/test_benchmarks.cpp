@@ -0,0 +1,304 @@
+/**
+ * @file test_benchmarks.cpp
+ * @brief Host micro-benchmarks of the per-sample and per-packet hot paths.
+ *
+ * Each benchmark prints "BENCH:<name>:<ns/op>:<allocs/op>" (run with -v to
+ * see them) and fails if the operation allocates. Timings are for comparing
+ * runs, not pass/fail: over its budget (roughly 20x a desktop -O2 build) a
+ * benchmark only prints "BENCH_SLOW:", and it fails only at
+ * BENCH_GUARD_FACTOR times the budget, which takes an accidental O(n^2), not
+ * a busy or slow host. Host numbers only rank changes; the ESP32 runs ~10x
+ * slower.
+ */
+#include "command_parser.h"
+#include "hal_shim.h"
+#include "pressure_filter.h"
+#include "transducer.h"
+#include <chrono>
+#include <clock_sync.h>
+#include <command_window.h>
+#include <new>
+#include <radio_packet.h>
+#include <serial_packet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <telemetry_batch.h>
+#include <telemetry_stats.h>
+#include <unity.h>
+
+// Every operator new on the host, so allocations per op can be counted. The
+// firmware's own C allocations (Arduino String) do not build here at all.
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *pointer = malloc(size ? size : 1);
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+// Results land here so the optimizer cannot drop the work.
+static volatile uint32_t sink = 0;
+
+// Shortest timed run per benchmark.
+static const double BENCH_MIN_NS = 20e6;
+// Times the budget at which a benchmark fails.
+static const double BENCH_GUARD_FACTOR = 10;
+
+/**
+ * @brief Times op() in growing batches until a batch lasts BENCH_MIN_NS.
+ *
+ * @param budget_ns Expected ceiling per op; see BENCH_GUARD_FACTOR.
+ */
+template <typename Op>
+static void bench(const char *name, double budget_ns, Op op)
+{
+    typedef std::chrono::steady_clock Clock;
+    op(); // Warm caches and first-call state.
+
+    double elapsed_ns = 0;
+    size_t iterations = 1;
+    size_t allocated = 0;
+    while (true)
+    {
+        size_t before = allocations;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            op();
+        elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        allocated = allocations - before;
+        if (elapsed_ns >= BENCH_MIN_NS)
+            break;
+        iterations *= 2;
+    }
+
+    double ns_per_op = elapsed_ns / iterations;
+    double allocs_per_op = (double)allocated / iterations;
+    printf("BENCH:%s:%.1f:%.3f\n", name, ns_per_op, allocs_per_op);
+
+    if (ns_per_op > budget_ns)
+        printf("BENCH_SLOW:%s:%.1f ns/op over %.0f ns budget\n", name, ns_per_op, budget_ns);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %.1f ns/op over %.0fx the %.0f ns budget", name, ns_per_op,
+             BENCH_GUARD_FACTOR, budget_ns);
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(0, allocated, name);
+    TEST_ASSERT_TRUE_MESSAGE(ns_per_op <= BENCH_GUARD_FACTOR * budget_ns, message);
+}
+
+/**
+ * @brief A plausible frame: slowly rising pressures, 50 ms apart.
+ */
+static TelemetryFrame frame_at(uint16_t sequence)
+{
+    TelemetryFrame frame = {};
+    frame.sequence = sequence;
+    frame.timestamp_us = sequence * 50000u;
+    frame.fuel_psi_x10 = 4000 + sequence % 17;
+    frame.ox_psi_x10 = 4100 - sequence % 13;
+    frame.load_g = 12000 + sequence * 3;
+    frame.status = STATUS_RECORDING;
+    telemetry_frame_seal(frame);
+    return frame;
+}
+
+void setUp()
+{
+    allocations = 0;
+}
+
+void tearDown()
+{
+}
+
+void bench_parse_valve_command()
+{
+    bench("parse_command_valve", 2000, []() { sink += parse_command("CMD:V1:OPEN").opcode; });
+}
+
+void bench_parse_sequence_step()
+{
+    bench("parse_command_seq_add", 4000, []() { sink += parse_command("CMD:SEQ_ADD:6000:V2:CLOSE").args[2]; });
+}
+
+void bench_pressure_filter_push()
+{
+    pressure_filter_begin(ADC_SAMPLE_RATE_HZ);
+    SensorScan scan = {};
+    FilteredPressure out[FILTER_OUTPUT_COUNT];
+    bench("pressure_filter_push", 2000, [&]() {
+        scan.timestamp_us += 1000;
+        scan.raw[0] = 2000 + (scan.timestamp_us >> 10) % 32;
+        sink += pressure_filter_push(scan, out);
+    });
+}
+
+void bench_counts_to_units()
+{
+    hal_shim_set_adc(3300, 0, false);
+    transducer_begin();
+    int32_t counts = 0;
+    bench("counts_to_units_x10", 200, [&]() {
+        counts = (counts + 977) & ((SENSOR_LUT_SIZE << 4) - 1);
+        for (int ch = 0; ch < SENSOR_COUNT; ch++)
+            sink += countsToUnitsX10(ch, counts, PRESSURE_FILTER_FRAC_BITS);
+    });
+}
+
+void bench_telemetry_seal()
+{
+    TelemetryFrame frame = frame_at(1);
+    bench("telemetry_frame_seal", 2000, [&]() {
+        frame.sequence++;
+        telemetry_frame_seal(frame);
+        sink += telemetry_frame_valid((const uint8_t *)&frame, sizeof(frame));
+    });
+}
+
+void bench_serial_packet_encode()
+{
+    TelemetryFrame frame = frame_at(1);
+    uint8_t wire[SERIAL_PACKET_MAX_ENCODED];
+    bench("serial_packet_encode", 2000,
+          [&]() { sink += serial_packet_encode(SERIAL_TELEMETRY, &frame, sizeof(frame), wire); });
+}
+
+void bench_serial_packet_decode()
+{
+    TelemetryFrame frame = frame_at(1);
+    uint8_t wire[SERIAL_PACKET_MAX_ENCODED];
+    size_t length = serial_packet_encode(SERIAL_TELEMETRY, &frame, sizeof(frame), wire) - 1;
+    uint8_t copy[SERIAL_PACKET_MAX_ENCODED];
+    SerialPacket packet;
+    bench("serial_packet_decode", 2000, [&]() {
+        // Decodes in place, so each run starts from a fresh copy.
+        memcpy(copy, wire, length);
+        sink += serial_packet_decode(copy, length, packet);
+    });
+}
+
+void bench_telemetry_batch_encode()
+{
+    TelemetryBatchEncoder encoder;
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    uint16_t sequence = 0;
+    bench("telemetry_batch_encode", 40000, [&]() {
+        while (encoder.add(frame_at(sequence)))
+            sequence++;
+        sink += encoder.finish(packet);
+    });
+}
+
+void bench_telemetry_batch_decode()
+{
+    TelemetryBatchEncoder encoder;
+    uint8_t packet[TELEMETRY_BATCH_MAX_BYTES];
+    for (uint16_t sequence = 0; encoder.add(frame_at(sequence)); sequence++)
+        ;
+    size_t length = encoder.finish(packet);
+    TelemetryFrame frames[TELEMETRY_BATCH_MAX_FRAMES];
+    bench("telemetry_batch_decode", 40000,
+          [&]() { sink += telemetry_batch_decode(packet, length, frames, TELEMETRY_BATCH_MAX_FRAMES); });
+}
+
+void bench_radio_command_round_trip()
+{
+    OutgoingCommand command = {1234, 1230, 4321, false, "CMD:V1:OPEN", 0};
+    char packet[RADIO_PACKET_ID_LENGTH + COMMAND_TEXT_MAX + 20];
+    RadioCommand parsed;
+    bench("radio_command_format_parse", 8000, [&]() {
+        command.sequence++;
+        radio_packet_format_command(command, packet, sizeof(packet));
+        const char *message;
+        size_t length;
+        if (radio_packet_message(packet, message, length) == RADIO_PACKET_OK)
+            sink += radio_packet_parse_command(message, length, parsed);
+    });
+}
+
+void bench_command_receiver()
+{
+    CommandReceiver receiver;
+    uint16_t sequence = 100;
+    char text[COMMAND_TEXT_MAX];
+    bench("command_receiver_deliver", 2000, [&]() {
+        receiver.receive(sequence, sequence, 77, "CMD:V1:OPEN");
+        while (receiver.pop(text))
+            sink++;
+        sink += receiver.ack().cumulative;
+        sequence++;
+    });
+}
+
+void bench_clock_sync_add()
+{
+    ClockSync clock;
+    uint32_t t1 = 0;
+    bench("clock_sync_add", 2000, [&]() {
+        t1 += 1000000;
+        uint32_t jitter = (t1 >> 12) % 300;
+        clock.add(t1, t1 + 5000 + jitter, t1 + 5100 + jitter, t1 + 900 + jitter);
+        sink += clock.offset_us(t1);
+    });
+}
+
+void bench_telemetry_stats_frame()
+{
+    TelemetryStats stats;
+    uint16_t sequence = 0;
+    bench("telemetry_stats_frame", 1000, [&]() {
+        TelemetryFrame frame = {};
+        frame.sequence = sequence;
+        frame.timestamp_us = sequence * 50000u;
+        // Every 16th frame lost.
+        sequence += sequence % 16 == 15 ? 2 : 1;
+        sink += stats.frame(frame);
+        stats.signal(-80.0f, 7.5f);
+    });
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_parse_valve_command);
+    RUN_TEST(bench_parse_sequence_step);
+    RUN_TEST(bench_pressure_filter_push);
+    RUN_TEST(bench_counts_to_units);
+    RUN_TEST(bench_telemetry_seal);
+    RUN_TEST(bench_serial_packet_encode);
+    RUN_TEST(bench_serial_packet_decode);
+    RUN_TEST(bench_telemetry_batch_encode);
+    RUN_TEST(bench_telemetry_batch_decode);
+    RUN_TEST(bench_radio_command_round_trip);
+    RUN_TEST(bench_command_receiver);
+    RUN_TEST(bench_clock_sync_add);
+    RUN_TEST(bench_telemetry_stats_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+/**
+ * @file test_command_parser.cpp
+ * @brief Keyword table and argument parsing of "CMD:" lines.
+ */
+#include "command_parser.h"
+#include <string.h>
+#include <unity.h>
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_empty_lines_are_none()
+{
+    TEST_ASSERT_EQUAL_INT(CMD_NONE, parse_command("").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_NONE, parse_command("CMD:").opcode);
+}
+
+void test_unknown_keyword()
+{
+    TEST_ASSERT_EQUAL_INT(CMD_UNKNOWN, parse_command("CMD:BOGUS").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_UNKNOWN, parse_command("CMD:close_all").opcode);
+}
+
+void test_header_is_optional()
+{
+    TEST_ASSERT_EQUAL_INT(CMD_IGNITE, parse_command("CMD:IGN").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_IGNITE, parse_command("IGN").opcode);
+}
+
+void test_keywords_without_arguments()
+{
+    const struct
+    {
+        const char *line;
+        CommandOpcode opcode;
+    } cases[] = {
+        {"CMD:OPEN_ALL", CMD_OPEN_ALL},       {"CMD:CLOSE_ALL", CMD_CLOSE_ALL},
+        {"CMD:REC_START", CMD_REC_START},     {"CMD:REC_STOP", CMD_REC_STOP},
+        {"CMD:REC_DUMP", CMD_REC_DUMP},       {"CMD:CAP_DUMP", CMD_CAP_DUMP},
+        {"CMD:SEQ_CLEAR", CMD_SEQ_CLEAR},     {"CMD:SEQ_DEFAULT", CMD_SEQ_DEFAULT},
+        {"CMD:SEQ_SHOW", CMD_SEQ_SHOW},       {"CMD:RL_SHOW", CMD_RL_SHOW},
+        {"CMD:RL_RESET", CMD_RL_RESET},       {"CMD:TARE", CMD_TARE},
+        {"CMD:STATS", CMD_STATS},             {"CMD:STATS_RESET", CMD_STATS_RESET},
+        {"CMD:CLOSE_VALVES", CMD_CLOSE_VALVES},
+    };
+    for (const auto &c : cases)
+    {
+        Command command = parse_command(c.line);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(c.opcode, command.opcode, c.line);
+        // Every opcode has a name matching its keyword.
+        TEST_ASSERT_EQUAL_STRING(c.line + 4, command_name(command.opcode));
+    }
+}
+
+void test_valve_positions()
+{
+    Command command = parse_command("CMD:V1:OPEN");
+    TEST_ASSERT_EQUAL_INT(CMD_VALVE, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(1, command.args[0]);
+    TEST_ASSERT_EQUAL_INT(VALVE_OPEN, command.position);
+
+    TEST_ASSERT_EQUAL_INT(VALVE_CLOSE, parse_command("CMD:V2:CLOSE").position);
+    TEST_ASSERT_EQUAL_INT(VALVE_NEUTRAL, parse_command("CMD:V3:NEUTRAL").position);
+}
+
+void test_valve_angle()
+{
+    Command command = parse_command("CMD:V4:135");
+    TEST_ASSERT_EQUAL_INT(CMD_VALVE, command.opcode);
+    TEST_ASSERT_EQUAL_INT(VALVE_ANGLE, command.position);
+    TEST_ASSERT_EQUAL_INT32(4, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(135, command.args[1]);
+    TEST_ASSERT_EQUAL_INT32(180, parse_command("CMD:V4:180").args[1]);
+}
+
+void test_valve_rejects_bad_arguments()
+{
+    const char *lines[] = {"CMD:V0:OPEN",   "CMD:V10:OPEN", "CMD:V1:181", "CMD:V1:",
+                           "CMD:V1:OPENED", "CMD:V1:-5",    "CMD:V1",     "CMD:V99999999999:OPEN"};
+    for (const char *line : lines)
+        TEST_ASSERT_EQUAL_INT_MESSAGE(CMD_INVALID, parse_command(line).opcode, line);
+}
+
+void test_sequence_relay_step()
+{
+    Command command = parse_command("CMD:SEQ_ADD:1500:R:1");
+    TEST_ASSERT_EQUAL_INT(CMD_SEQ_ADD, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(1500, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(STEP_RELAY, command.args[1]);
+    TEST_ASSERT_EQUAL_INT32(1, command.args[3]);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:SEQ_ADD:1500:R:2").opcode);
+}
+
+void test_sequence_valve_step()
+{
+    Command command = parse_command("CMD:SEQ_ADD:6000:V2:CLOSE");
+    TEST_ASSERT_EQUAL_INT(CMD_SEQ_ADD, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(6000, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(STEP_VALVE, command.args[1]);
+    TEST_ASSERT_EQUAL_INT32(2, command.args[2]);
+    TEST_ASSERT_EQUAL_INT(VALVE_CLOSE, command.position);
+
+    command = parse_command("CMD:SEQ_ADD:0:V1:45");
+    TEST_ASSERT_EQUAL_INT(VALVE_ANGLE, command.position);
+    TEST_ASSERT_EQUAL_INT32(45, command.args[3]);
+}
+
+void test_sequence_rejects_long_offset()
+{
+    TEST_ASSERT_EQUAL_INT(CMD_SEQ_ADD, parse_command("CMD:SEQ_ADD:3600000:R:0").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:SEQ_ADD:3600001:R:0").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:SEQ_ADD:100:X:0").opcode);
+}
+
+void test_redline_rules()
+{
+    Command command = parse_command("CMD:RL_SET:IMBALANCE:150:3");
+    TEST_ASSERT_EQUAL_INT(CMD_RL_SET, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(REDLINE_IMBALANCE_PSI, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(150, command.args[1]);
+    TEST_ASSERT_EQUAL_INT32(3, command.args[2]);
+
+    TEST_ASSERT_EQUAL_INT32(REDLINE_LOAD_LOSS_MS, parse_command("CMD:RL_SET:LOAD:250:1").args[0]);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:RL_SET:CHAMBER:900:5").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:RL_SET:FUEL:900:70000").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:RL_SET:FUEL:900").opcode);
+}
+
+void test_filter_config()
+{
+    Command command = parse_command("CMD:FLT_CFG:20:1000:500:3");
+    TEST_ASSERT_EQUAL_INT(CMD_FLT_CFG, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(20, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(1000, command.args[1]);
+    TEST_ASSERT_EQUAL_INT32(500, command.args[2]);
+    TEST_ASSERT_EQUAL_INT32(3, command.args[3]);
+
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:FLT_CFG:0:1000:500:0").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:FLT_CFG:20:1000:500:16").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:FLT_CFG:20:1000:500").opcode);
+}
+
+void test_capture_and_load_cell_arguments()
+{
+    Command command = parse_command("CMD:CAP_CFG:2000:1000");
+    TEST_ASSERT_EQUAL_INT(CMD_CAP_CFG, command.opcode);
+    TEST_ASSERT_EQUAL_INT32(2000, command.args[0]);
+    TEST_ASSERT_EQUAL_INT32(1000, command.args[1]);
+
+    TEST_ASSERT_EQUAL_INT32(500, parse_command("CMD:LC_CAL:500").args[0]);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:LC_CAL:0").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:LC_CAL:5kg").opcode);
+}
+
+void test_deadman_config()
+{
+    TEST_ASSERT_EQUAL_INT32(5000, parse_command("CMD:DM_CFG:5000").args[0]);
+    TEST_ASSERT_EQUAL_INT(CMD_DM_CFG, parse_command("CMD:DM_CFG:0").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:DM_CFG:999").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:DM_CFG:600001").opcode);
+    TEST_ASSERT_EQUAL_INT(CMD_INVALID, parse_command("CMD:DM_CFG:").opcode);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_lines_are_none);
+    RUN_TEST(test_unknown_keyword);
+    RUN_TEST(test_header_is_optional);
+    RUN_TEST(test_keywords_without_arguments);
+    RUN_TEST(test_valve_positions);
+    RUN_TEST(test_valve_angle);
+    RUN_TEST(test_valve_rejects_bad_arguments);
+    RUN_TEST(test_sequence_relay_step);
+    RUN_TEST(test_sequence_valve_step);
+    RUN_TEST(test_sequence_rejects_long_offset);
+    RUN_TEST(test_redline_rules);
+    RUN_TEST(test_filter_config);
+    RUN_TEST(test_capture_and_load_cell_arguments);
+    RUN_TEST(test_deadman_config);
+    return UNITY_END();
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_deadman.cpp
+ * @brief Deadman timeout, latching and re-arming.
+ */
+#include "deadman.h"
+#include <unity.h>
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_trips_once_after_timeout()
+{
+    DeadmanTimer deadman(1000);
+    deadman.feed(5000);
+    TEST_ASSERT_FALSE(deadman.check(5999));
+    TEST_ASSERT_TRUE(deadman.check(6000));
+    TEST_ASSERT_TRUE(deadman.tripped());
+    // Latched: the valves are moved once per outage.
+    TEST_ASSERT_FALSE(deadman.check(6010));
+    TEST_ASSERT_FALSE(deadman.check(60000));
+    TEST_ASSERT_EQUAL_UINT32(1, deadman.trips());
+}
+
+void test_feeding_keeps_it_armed()
+{
+    DeadmanTimer deadman(1000);
+    for (uint32_t now = 0; now < 20000; now += 10)
+    {
+        if (now % 900 == 0)
+            deadman.feed(now);
+        TEST_ASSERT_FALSE(deadman.check(now));
+    }
+}
+
+void test_feed_rearms_after_trip()
+{
+    DeadmanTimer deadman(1000);
+    deadman.feed(0);
+    TEST_ASSERT_TRUE(deadman.check(1000));
+    deadman.feed(1500);
+    TEST_ASSERT_FALSE(deadman.check(1510));
+    TEST_ASSERT_FALSE(deadman.tripped());
+    TEST_ASSERT_TRUE(deadman.check(2500));
+    TEST_ASSERT_EQUAL_UINT32(2, deadman.trips());
+}
+
+void test_disabled_never_trips()
+{
+    DeadmanTimer deadman(0);
+    deadman.feed(0);
+    TEST_ASSERT_FALSE(deadman.check(1000000));
+    deadman.configure(1000);
+    TEST_ASSERT_TRUE(deadman.check(1000001));
+}
+
+void test_millis_wrap()
+{
+    DeadmanTimer deadman(1000);
+    deadman.feed(UINT32_MAX - 400);
+    TEST_ASSERT_FALSE(deadman.check(500));
+    TEST_ASSERT_TRUE(deadman.check(600));
+}
+
+void test_feed_stamped_after_check_time()
+{
+    // Another task fed it between reading the clock and checking.
+    DeadmanTimer deadman(1000);
+    deadman.feed(2001);
+    TEST_ASSERT_FALSE(deadman.check(2000));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_trips_once_after_timeout);
+    RUN_TEST(test_feeding_keeps_it_armed);
+    RUN_TEST(test_feed_rearms_after_trip);
+    RUN_TEST(test_disabled_never_trips);
+    RUN_TEST(test_millis_wrap);
+    RUN_TEST(test_feed_stamped_after_check_time);
+    return UNITY_END();
+}
@@ -0,0 +1,141 @@
+/**
+ * @file test_pressure_filter.cpp
+ * @brief CIC/IIR decimation: output rates, group delays and DC gain.
+ */
+#include "decimator.h"
+#include "pressure_filter.h"
+#include <unity.h>
+
+static SensorScan scan(uint32_t index, uint16_t raw)
+{
+    SensorScan sample;
+    sample.timestamp_us = index * (1000000 / ADC_SAMPLE_RATE_HZ);
+    for (int ch = 0; ch < SENSOR_COUNT; ch++)
+        sample.raw[ch] = raw + ch;
+    return sample;
+}
+
+void setUp()
+{
+    pressure_filter_begin(ADC_SAMPLE_RATE_HZ);
+}
+
+void tearDown()
+{
+}
+
+void test_default_rates_and_delays()
+{
+    TEST_ASSERT_EQUAL_UINT32(FILTER_DEFAULT_TELEMETRY_HZ, pressure_filter_rate(FILTER_TELEMETRY));
+    TEST_ASSERT_EQUAL_UINT32(ADC_SAMPLE_RATE_HZ, pressure_filter_rate(FILTER_RECORD));
+    TEST_ASSERT_EQUAL_UINT32(FILTER_DEFAULT_REDLINE_HZ, pressure_filter_rate(FILTER_REDLINE));
+
+    // N * (R - 1) / 2 input samples at 1 kHz.
+    TEST_ASSERT_EQUAL_UINT32(49000, pressure_filter_delay_us(FILTER_TELEMETRY));
+    TEST_ASSERT_EQUAL_UINT32(0, pressure_filter_delay_us(FILTER_RECORD));
+    TEST_ASSERT_EQUAL_UINT32(1000, pressure_filter_delay_us(FILTER_REDLINE));
+}
+
+void test_outputs_fire_at_their_rates()
+{
+    uint32_t counts[FILTER_OUTPUT_COUNT] = {};
+    FilteredPressure out[FILTER_OUTPUT_COUNT];
+    for (uint32_t i = 0; i < ADC_SAMPLE_RATE_HZ; i++)
+    {
+        uint8_t ready = pressure_filter_push(scan(i, 2000), out);
+        for (int output = 0; output < FILTER_OUTPUT_COUNT; output++)
+            counts[output] += (ready >> output) & 1;
+    }
+    TEST_ASSERT_EQUAL_UINT32(20, counts[FILTER_TELEMETRY]);
+    TEST_ASSERT_EQUAL_UINT32(1000, counts[FILTER_RECORD]);
+    TEST_ASSERT_EQUAL_UINT32(500, counts[FILTER_REDLINE]);
+}
+
+void test_dc_gain_is_one()
+{
+    FilteredPressure out[FILTER_OUTPUT_COUNT];
+    FilteredPressure last[FILTER_OUTPUT_COUNT];
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        uint8_t ready = pressure_filter_push(scan(i, 2000), out);
+        for (int output = 0; output < FILTER_OUTPUT_COUNT; output++)
+            if (ready & (1 << output))
+                last[output] = out[output];
+    }
+    for (int output = 0; output < FILTER_OUTPUT_COUNT; output++)
+        for (int ch = 0; ch < SENSOR_COUNT; ch++)
+            TEST_ASSERT_EQUAL_INT32((2000 + ch) << PRESSURE_FILTER_FRAC_BITS, last[output].counts[ch]);
+}
+
+void test_record_output_is_raw()
+{
+    FilteredPressure out[FILTER_OUTPUT_COUNT];
+    SensorScan sample = scan(7, 1234);
+    TEST_ASSERT_TRUE(pressure_filter_push(sample, out) & (1 << FILTER_RECORD));
+    TEST_ASSERT_EQUAL_INT32(1234 << PRESSURE_FILTER_FRAC_BITS, out[FILTER_RECORD].counts[0]);
+    TEST_ASSERT_EQUAL_UINT32(sample.timestamp_us, out[FILTER_RECORD].timestamp_us);
+}
+
+void test_timestamps_remove_group_delay()
+{
+    FilteredPressure out[FILTER_OUTPUT_COUNT];
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        SensorScan sample = scan(i + 1000, 2000);
+        if (pressure_filter_push(sample, out) & (1 << FILTER_TELEMETRY))
+            TEST_ASSERT_EQUAL_UINT32(sample.timestamp_us - 49000, out[FILTER_TELEMETRY].timestamp_us);
+    }
+}
+
+void test_configure_rounds_to_integer_factors()
+{
+    pressure_filter_configure(300, 1000, 250, 3);
+    // 1000 / 300 rounds to a factor of 3.
+    TEST_ASSERT_EQUAL_UINT32(333, pressure_filter_rate(FILTER_TELEMETRY));
+    TEST_ASSERT_EQUAL_UINT32(250, pressure_filter_rate(FILTER_REDLINE));
+    TEST_ASSERT_EQUAL_UINT8(3, pressure_filter_iir_shift());
+
+    pressure_filter_configure(20, 1000, 500, FILTER_IIR_PER_CHANNEL);
+    TEST_ASSERT_EQUAL_UINT8(SENSORS[0].iir_shift, pressure_filter_iir_shift());
+}
+
+void test_iir_step_settles_toward_input()
+{
+    IirLowPass iir;
+    iir.configure(2);
+    // Primed by the first input, then a quarter of the way per step.
+    TEST_ASSERT_EQUAL_INT32(0, iir.step(0));
+    TEST_ASSERT_EQUAL_INT32(400, iir.step(1600));
+    int32_t y = 0;
+    for (int i = 0; i < 64; i++)
+        y = iir.step(1600);
+    TEST_ASSERT_EQUAL_INT32(1600, y);
+}
+
+void test_cic_averages_a_step()
+{
+    CicDecimator cic;
+    cic.configure(4, 1);
+    int32_t out = 0;
+    // A boxcar of 4: half the window at 0, half at 100.
+    const int32_t inputs[] = {0, 0, 100, 100};
+    bool ready = false;
+    for (int32_t x : inputs)
+        ready = cic.push(x, out);
+    TEST_ASSERT_TRUE(ready);
+    TEST_ASSERT_EQUAL_INT32(50, out);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_rates_and_delays);
+    RUN_TEST(test_outputs_fire_at_their_rates);
+    RUN_TEST(test_dc_gain_is_one);
+    RUN_TEST(test_record_output_is_raw);
+    RUN_TEST(test_timestamps_remove_group_delay);
+    RUN_TEST(test_configure_rounds_to_integer_factors);
+    RUN_TEST(test_iir_step_settles_toward_input);
+    RUN_TEST(test_cic_averages_a_step);
+    return UNITY_END();
+}
@@ -0,0 +1,183 @@
+/**
+ * @file test_serial_packet.cpp
+ * @brief MCU-side framing: COBS/CRC serial packets, telemetry frames and UDP
+ * sample blocks.
+ */
+#include <cobs.h>
+#include <crc16.h>
+#include <sample_block.h>
+#include <serial_packet.h>
+#include <telemetry_frame.h>
+#include <unity.h>
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_crc_matches_ccitt_false()
+{
+    const char *check = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t *)check, 9));
+    // Continuing over two buffers gives the same CRC.
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t *)check + 4, 5, crc16((const uint8_t *)check, 4)));
+}
+
+void test_cobs_removes_every_zero()
+{
+    uint8_t data[300];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = i % 7 == 0 ? 0 : (uint8_t)i;
+
+    uint8_t encoded[COBS_MAX_ENCODED(sizeof(data))];
+    size_t length = cobs_encode(data, sizeof(data), encoded);
+    TEST_ASSERT_TRUE(length <= sizeof(encoded));
+    for (size_t i = 0; i < length; i++)
+        TEST_ASSERT_NOT_EQUAL(0, encoded[i]);
+
+    uint8_t decoded[sizeof(data)];
+    TEST_ASSERT_EQUAL_size_t(sizeof(data), cobs_decode(encoded, length, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, sizeof(data));
+}
+
+void test_cobs_long_run_without_zeros()
+{
+    // Splits into 254-byte groups.
+    uint8_t data[600];
+    memset(data, 0x55, sizeof(data));
+    uint8_t encoded[COBS_MAX_ENCODED(sizeof(data))];
+    size_t length = cobs_encode(data, sizeof(data), encoded);
+    uint8_t decoded[sizeof(data)];
+    TEST_ASSERT_EQUAL_size_t(sizeof(data), cobs_decode(encoded, length, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, sizeof(data));
+}
+
+void test_packet_round_trip()
+{
+    const char *text = "CMD:V1:OPEN";
+    uint8_t wire[SERIAL_PACKET_MAX_ENCODED];
+    size_t length = serial_packet_encode(SERIAL_COMMAND, text, strlen(text), wire);
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_EQUAL_UINT8(0, wire[length - 1]);
+
+    SerialPacket packet;
+    TEST_ASSERT_TRUE(serial_packet_decode(wire, length - 1, packet));
+    TEST_ASSERT_EQUAL_UINT8(SERIAL_COMMAND, packet.type);
+    TEST_ASSERT_EQUAL_STRING(text, (const char *)packet.payload);
+}
+
+void test_packet_empty_and_full_payloads()
+{
+    uint8_t wire[SERIAL_PACKET_MAX_ENCODED];
+    SerialPacket packet;
+    size_t length = serial_packet_encode(SERIAL_KEEPALIVE, NULL, 0, wire);
+    TEST_ASSERT_TRUE(serial_packet_decode(wire, length - 1, packet));
+    TEST_ASSERT_EQUAL_UINT8(0, packet.length);
+
+    uint8_t payload[SERIAL_PACKET_MAX_PAYLOAD + 1] = {};
+    length = serial_packet_encode(SERIAL_LOG, payload, SERIAL_PACKET_MAX_PAYLOAD, wire);
+    TEST_ASSERT_TRUE(length <= SERIAL_PACKET_MAX_ENCODED);
+    TEST_ASSERT_TRUE(serial_packet_decode(wire, length - 1, packet));
+    TEST_ASSERT_EQUAL_UINT8(SERIAL_PACKET_MAX_PAYLOAD, packet.length);
+
+    TEST_ASSERT_EQUAL_size_t(0, serial_packet_encode(SERIAL_LOG, payload, SERIAL_PACKET_MAX_PAYLOAD + 1, wire));
+}
+
+void test_packet_rejects_any_single_bit_error()
+{
+    TelemetryFrame frame = {};
+    frame.sequence = 42;
+    telemetry_frame_seal(frame);
+    uint8_t wire[SERIAL_PACKET_MAX_ENCODED];
+    size_t length = serial_packet_encode(SERIAL_TELEMETRY, &frame, sizeof(frame), wire) - 1;
+
+    for (size_t byte = 0; byte < length; byte++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            uint8_t copy[SERIAL_PACKET_MAX_ENCODED];
+            memcpy(copy, wire, length);
+            copy[byte] ^= 1 << bit;
+            // A flip to 0x00 would split the frame on the wire; skip it.
+            if (copy[byte] == 0)
+                continue;
+            SerialPacket packet;
+            TEST_ASSERT_FALSE(serial_packet_decode(copy, length, packet));
+        }
+    }
+}
+
+void test_telemetry_frame_seal_and_check()
+{
+    TelemetryFrame frame = {};
+    frame.sequence = 7;
+    frame.timestamp_us = 123456;
+    frame.fuel_psi_x10 = telemetry_fixed16(512.3f, 10);
+    frame.load_g = -250;
+    telemetry_frame_seal(frame);
+    TEST_ASSERT_EQUAL_UINT8(FRAME_TELEMETRY, frame.type);
+    TEST_ASSERT_TRUE(telemetry_frame_valid((const uint8_t *)&frame, sizeof(frame)));
+    TEST_ASSERT_FALSE(telemetry_frame_valid((const uint8_t *)&frame, sizeof(frame) - 1));
+
+    frame.ox_psi_x10 ^= 1;
+    TEST_ASSERT_FALSE(telemetry_frame_valid((const uint8_t *)&frame, sizeof(frame)));
+}
+
+void test_fixed16_saturates()
+{
+    TEST_ASSERT_EQUAL_INT16(5123, telemetry_fixed16(512.3f, 10));
+    TEST_ASSERT_EQUAL_INT16(INT16_MAX, telemetry_fixed16(1e6f, 10));
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, telemetry_fixed16(-1e6f, 10));
+}
+
+void test_sample_block_breaks_on_gaps()
+{
+    SampleBlockBuilder block;
+    int16_t values[2] = {100, -100};
+    TEST_ASSERT_TRUE(block.add(1000, values, 2, 1000));
+    TEST_ASSERT_TRUE(block.add(2000, values, 2, 1000));
+    // Jitter within half a period is fine; a missing scan is not.
+    TEST_ASSERT_TRUE(block.add(3400, values, 2, 1000));
+    TEST_ASSERT_FALSE(block.add(5000, values, 2, 1000));
+
+    uint8_t payload[SERIAL_PACKET_MAX_PAYLOAD];
+    size_t length = block.finish(payload);
+    TEST_ASSERT_EQUAL_size_t(sizeof(SampleBlockHeader) + 3 * 2 * sizeof(int16_t), length);
+    SampleBlockHeader header;
+    memcpy(&header, payload, sizeof(header));
+    TEST_ASSERT_EQUAL_UINT8(3, header.count);
+    TEST_ASSERT_EQUAL_UINT32(1000, header.timestamp_us);
+    TEST_ASSERT_EQUAL_size_t(0, block.count());
+}
+
+void test_sample_block_fills_one_packet()
+{
+    SampleBlockBuilder block;
+    int16_t values[2] = {1, 2};
+    size_t scans = 0;
+    while (block.add(scans * 1000, values, 2, 1000))
+        scans++;
+    TEST_ASSERT_EQUAL_size_t(SAMPLE_BLOCK_MAX_VALUES / 2, scans);
+
+    uint8_t payload[SERIAL_PACKET_MAX_PAYLOAD];
+    TEST_ASSERT_TRUE(block.finish(payload) <= SERIAL_PACKET_MAX_PAYLOAD);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_matches_ccitt_false);
+    RUN_TEST(test_cobs_removes_every_zero);
+    RUN_TEST(test_cobs_long_run_without_zeros);
+    RUN_TEST(test_packet_round_trip);
+    RUN_TEST(test_packet_empty_and_full_payloads);
+    RUN_TEST(test_packet_rejects_any_single_bit_error);
+    RUN_TEST(test_telemetry_frame_seal_and_check);
+    RUN_TEST(test_fixed16_saturates);
+    RUN_TEST(test_sample_block_breaks_on_gaps);
+    RUN_TEST(test_sample_block_fills_one_packet);
+    return UNITY_END();
+}
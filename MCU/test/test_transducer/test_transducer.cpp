@@ -0,0 +1,119 @@
+/**
+ * @file test_transducer.cpp
+ * @brief Raw ADC counts to sensor units: tables, interpolation, clamping.
+ */
+#include "hal_shim.h"
+#include "transducer.h"
+#include <unity.h>
+
+/**
+ * @brief What the fuel PT should read at a count, on the shim's default
+ * 0-3300 mV line, in 0.1 PSI.
+ */
+static float expected_psi_x10(uint16_t raw)
+{
+    float pin_volts = raw * 3.3f / 4095;
+    return (pin_volts / PT_DIVIDER_RATIO - PT_ZERO_VOLTS) * PT_PSI_PER_VOLT * 10;
+}
+
+void setUp()
+{
+    hal_shim_set_adc(3300, 0, false);
+    transducer_begin();
+}
+
+void tearDown()
+{
+}
+
+void test_reports_default_vref_without_efuse()
+{
+    TEST_ASSERT_FALSE(transducer_begin());
+    hal_shim_set_adc(3300, 0, true);
+    TEST_ASSERT_TRUE(transducer_begin());
+}
+
+void test_table_follows_divider_and_range()
+{
+    const uint16_t counts[] = {0, 414, 1000, 2048, 3000, 4095};
+    for (uint16_t raw : counts)
+    {
+        // The shim rounds to whole mV: 1.5 mV at the sensor, 0.4 PSI.
+        TEST_ASSERT_INT_WITHIN(5, (int)lroundf(expected_psi_x10(raw)), rawToUnitsX10(SENSOR_FUEL, raw));
+        TEST_ASSERT_EQUAL_INT(rawToUnitsX10(SENSOR_FUEL, raw), rawToUnitsX10(SENSOR_OX, raw));
+    }
+}
+
+void test_zero_psi_is_half_a_volt()
+{
+    // 0.5 V behind the 2/3 divider is 0.333 V at the pin, count ~414.
+    TEST_ASSERT_INT_WITHIN(5, 0, rawToUnitsX10(SENSOR_FUEL, 414));
+    TEST_ASSERT_TRUE(rawToUnitsX10(SENSOR_FUEL, 0) < 0);
+}
+
+void test_table_is_monotonic()
+{
+    for (int raw = 1; raw < SENSOR_LUT_SIZE; raw++)
+        TEST_ASSERT_TRUE(rawToUnitsX10(SENSOR_FUEL, raw) >= rawToUnitsX10(SENSOR_FUEL, raw - 1));
+}
+
+void test_raw_index_is_masked()
+{
+    TEST_ASSERT_EQUAL_INT(rawToUnitsX10(SENSOR_FUEL, 5), rawToUnitsX10(SENSOR_FUEL, SENSOR_LUT_SIZE + 5));
+}
+
+void test_float_conversion_matches_table()
+{
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, rawToUnitsX10(SENSOR_OX, 2500) / 10.0f, rawToUnits(SENSOR_OX, 2500));
+}
+
+void test_counts_interpolate_between_entries()
+{
+    const int bits = 4;
+    int32_t low = rawToUnitsX10(SENSOR_FUEL, 2000);
+    int32_t high = rawToUnitsX10(SENSOR_FUEL, 2001);
+    TEST_ASSERT_EQUAL_INT32(low, countsToUnitsX10(SENSOR_FUEL, 2000 << bits, bits));
+    TEST_ASSERT_EQUAL_INT32(low + (high - low) / 2, countsToUnitsX10(SENSOR_FUEL, (2000 << bits) + 8, bits));
+}
+
+void test_counts_clamp_to_table()
+{
+    TEST_ASSERT_EQUAL_INT32(rawToUnitsX10(SENSOR_FUEL, 0), countsToUnitsX10(SENSOR_FUEL, -100, 4));
+    TEST_ASSERT_EQUAL_INT32(rawToUnitsX10(SENSOR_FUEL, SENSOR_LUT_SIZE - 1),
+                            countsToUnitsX10(SENSOR_FUEL, SENSOR_LUT_SIZE << 4, 4));
+}
+
+void test_offset_line_shifts_every_entry()
+{
+    int16_t before = rawToUnitsX10(SENSOR_FUEL, 2000);
+    // +20 mV at the pin is +30 mV at the sensor, +7.5 PSI.
+    hal_shim_set_adc(3300, 20, false);
+    transducer_begin();
+    TEST_ASSERT_INT_WITHIN(1, before + 75, rawToUnitsX10(SENSOR_FUEL, 2000));
+}
+
+void test_read_sensor_uses_latest_scan()
+{
+    SensorScan scan = {};
+    scan.raw[SENSOR_FUEL] = 1200;
+    scan.raw[SENSOR_OX] = 3100;
+    hal_shim_set_latest_scan(scan);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, rawToUnits(SENSOR_OX, 3100), readSensor(SENSOR_OX));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, rawToUnits(SENSOR_FUEL, 1200), readSensor(SENSOR_FUEL));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reports_default_vref_without_efuse);
+    RUN_TEST(test_table_follows_divider_and_range);
+    RUN_TEST(test_zero_psi_is_half_a_volt);
+    RUN_TEST(test_table_is_monotonic);
+    RUN_TEST(test_raw_index_is_masked);
+    RUN_TEST(test_float_conversion_matches_table);
+    RUN_TEST(test_counts_interpolate_between_entries);
+    RUN_TEST(test_counts_clamp_to_table);
+    RUN_TEST(test_offset_line_shifts_every_entry);
+    RUN_TEST(test_read_sensor_uses_latest_scan);
+    return UNITY_END();
+}
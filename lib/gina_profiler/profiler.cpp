@@ -0,0 +1,127 @@
+/**
+ * @file profiler.cpp
+ * @brief Section registry, histogram bucketing and reports.
+ */
+#include "profiler.h"
+#include <stdio.h>
+
+// Constant-initialised, so sections in any translation unit can register
+// during static construction.
+static ProfileSection *sections = NULL;
+static ProfileSection *sections_tail = NULL;
+
+/**
+ * @brief Histogram bucket of a duration: exact below 4, then the top three
+ * significant bits.
+ */
+static inline size_t IRAM_ATTR bucket_of(uint32_t cycles)
+{
+    if (cycles < 4)
+        return cycles;
+    uint32_t msb = 31 - __builtin_clz(cycles);
+    return 4 * (msb - 1) + ((cycles >> (msb - 2)) & 3);
+}
+
+/**
+ * @brief Middle of a bucket's range; within 12.5 % of anything in it.
+ */
+static uint32_t bucket_middle(size_t bucket)
+{
+    if (bucket < 4)
+        return bucket;
+    uint32_t msb = bucket / 4 + 1;
+    uint32_t width = 1u << (msb - 2);
+    return (4 + bucket % 4) * width + width / 2;
+}
+
+ProfileSection::ProfileSection(const char *name) : name_(name), next_(NULL)
+{
+    // Report in registration order.
+    if (sections_tail)
+        sections_tail->next_ = this;
+    else
+        sections = this;
+    sections_tail = this;
+}
+
+void IRAM_ATTR ProfileSection::record(uint32_t cycles)
+{
+    if (reset_pending_)
+    {
+        count_ = 0;
+        total_ = 0;
+        for (size_t i = 0; i < PROFILE_BUCKETS; i++)
+            buckets_[i] = 0;
+        reset_pending_ = false;
+    }
+
+    if (count_ == 0 || cycles < min_)
+        min_ = cycles;
+    if (count_ == 0 || cycles > max_)
+        max_ = cycles;
+    count_++;
+    total_ += cycles;
+    buckets_[bucket_of(cycles)]++;
+}
+
+ProfileSummary ProfileSection::summary() const
+{
+    ProfileSummary summary = {};
+    uint32_t count = count_;
+    if (count == 0 || reset_pending_)
+        return summary;
+
+    const float cycles_per_us = getCpuFrequencyMhz();
+    uint32_t min_cycles = min_;
+    uint32_t max_cycles = max_;
+    summary.count = count;
+    summary.min_us = min_cycles / cycles_per_us;
+    summary.max_us = max_cycles / cycles_per_us;
+    summary.mean_us = (float)total_ / count / cycles_per_us;
+
+    const float quantiles[] = {0.50f, 0.90f, 0.99f};
+    float *results[] = {&summary.p50_us, &summary.p90_us, &summary.p99_us};
+    uint32_t seen = 0;
+    size_t next = 0;
+    for (size_t bucket = 0; bucket < PROFILE_BUCKETS && next < 3; bucket++)
+    {
+        seen += buckets_[bucket];
+        while (next < 3 && seen >= quantiles[next] * count)
+        {
+            // Never outside what was measured.
+            uint32_t cycles = bucket_middle(bucket);
+            cycles = cycles > max_cycles ? max_cycles : cycles < min_cycles ? min_cycles : cycles;
+            *results[next++] = cycles / cycles_per_us;
+        }
+    }
+    return summary;
+}
+
+ProfileSection *profiler_first()
+{
+    return sections;
+}
+
+void profiler_reset_all()
+{
+    for (ProfileSection *section = sections; section; section = section->next())
+        section->reset();
+}
+
+int profiler_format(const ProfileSection &section, char *out, size_t size)
+{
+    ProfileSummary summary = section.summary();
+    return snprintf(out, size, "STATS:%s:%u:%.1f:%.1f:%.1f:%.1f:%.1f:%.1f", section.name(),
+                    (unsigned)summary.count, summary.min_us, summary.p50_us, summary.p90_us, summary.p99_us,
+                    summary.max_us, summary.mean_us);
+}
+
+void profiler_print(Print &out)
+{
+    char line[96];
+    for (ProfileSection *section = sections; section; section = section->next())
+    {
+        profiler_format(*section, line, sizeof(line));
+        out.println(line);
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file profiler.h
+ * @brief Cycle-counter timing of named hot sections: count, min, max, mean
+ * and percentiles, cheap enough to leave on in flight builds.
+ *
+ * Each ProfileSection is a static object that registers itself at startup.
+ * Durations go into a log-scale histogram (4 buckets per power of two, so a
+ * percentile is within 12.5 %) in CPU cycles; nothing is converted or
+ * allocated until a report is asked for.
+ *
+ *   static ProfileSection profile_service("radio_service");
+ *   ...
+ *   {
+ *       ProfileScope scope(profile_service);
+ *       radio_link.service();
+ *   }
+ *
+ * A section must only be recorded from one task (or one ISR): updates are
+ * not atomic, and the cycle counter is per core. Reports read it from
+ * another task, so a summary may be off by the one sample in flight.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 4 exact buckets below 4 cycles, then 4 per octave up to 2^32.
+const size_t PROFILE_BUCKETS = 4 + 30 * 4;
+
+/**
+ * @brief A section's statistics in microseconds; all zero if never run.
+ */
+struct ProfileSummary
+{
+    uint32_t count;
+    float min_us;
+    float p50_us;
+    float p90_us;
+    float p99_us;
+    float max_us;
+    float mean_us;
+};
+
+class ProfileSection
+{
+public:
+    /**
+     * @param name Static string, used in reports. Keep it free of ':'.
+     */
+    explicit ProfileSection(const char *name);
+
+    /**
+     * @brief Adds one duration. IRAM-safe, so ISRs may call it.
+     *
+     * @param cycles CPU cycles, e.g. profiler_cycles() - start.
+     */
+    void record(uint32_t cycles);
+
+    /**
+     * @brief Clears the statistics. Takes effect on the next record(), from
+     * the recording task itself.
+     */
+    void reset() { reset_pending_ = true; }
+
+    ProfileSummary summary() const;
+
+    const char *name() const { return name_; }
+    ProfileSection *next() const { return next_; }
+
+private:
+    const char *name_;
+    ProfileSection *next_;
+    volatile bool reset_pending_ = false;
+    uint32_t count_ = 0;
+    uint32_t min_ = 0;
+    uint32_t max_ = 0;
+    uint64_t total_ = 0;
+    uint32_t buckets_[PROFILE_BUCKETS] = {};
+};
+
+/**
+ * @brief CPU cycles since boot; wraps every 2^32 cycles (~18 s at 240 MHz),
+ * so only differences are meaningful.
+ */
+inline uint32_t profiler_cycles()
+{
+    return ESP.getCycleCount();
+}
+
+/**
+ * @brief Times the enclosing scope into a section.
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileSection &section) : section_(section), start_(profiler_cycles()) {}
+    ~ProfileScope() { section_.record(profiler_cycles() - start_); }
+
+private:
+    ProfileSection &section_;
+    uint32_t start_;
+};
+
+/**
+ * @brief First registered section; walk the rest with next(). NULL if none.
+ */
+ProfileSection *profiler_first();
+
+/**
+ * @brief Resets every section (see ProfileSection::reset()).
+ */
+void profiler_reset_all();
+
+/**
+ * @brief Formats one section as
+ * "STATS:<name>:<count>:<min>:<p50>:<p90>:<p99>:<max>:<mean>", in us.
+ *
+ * @return Characters written (snprintf semantics).
+ */
+int profiler_format(const ProfileSection &section, char *out, size_t size);
+
+/**
+ * @brief Prints every section, one profiler_format() line each.
+ */
+void profiler_print(Print &out);
@@ -0,0 +1,276 @@
+/**
+ * @file clock_sync.h
+ * @brief Two-way (NTP-style) clock offset and drift between two boards.
+ *
+ * The MCU's esp_timer is the shared timebase: telemetry, samples and
+ * recorder events are already stamped with it. Each hop syncs to the next
+ * one closer to the MCU:
+ *
+ *   Lora Away -> MCU   SERIAL_TIME_REQUEST/REPLY, answered by UartLink
+ *   Lora Home -> Away  beacon timestamp, answered by a TimeSyncFrame that
+ *                      also carries Away's MCU offset
+ *   GCS -> Home        "SYNC:" lines over USB serial
+ *   GCS -> MCU         SERIAL_TIME_REQUEST/REPLY over UDP, when it is up
+ *
+ * One exchange gives t1 (request sent, local clock), t2 (request received,
+ * remote), t3 (reply sent, remote) and t4 (reply received, local):
+ *
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2    delay = (t4 - t1) - (t3 - t2)
+ *
+ * Queueing only ever adds delay, so of the last CLOCK_SYNC_WINDOW samples
+ * the one with the least delay (plus worst-case drift since it was taken)
+ * is trusted. Drift is the offset change between trusted samples at least
+ * CLOCK_SYNC_DRIFT_SPAN_US apart. A sample far off the prediction twice in a
+ * row means the remote rebooted: the estimate starts over.
+ *
+ * Times are wrapping uint32 microseconds, like TelemetryFrame::timestamp_us;
+ * offsets are modulo 2^32.
+ */
+#pragma once
+
+#include "crc16.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Exchanges kept for the minimum-delay pick.
+const size_t CLOCK_SYNC_WINDOW = 8;
+// Round trips longer than this are not used at all. A radio exchange waits
+// for Away's slot, up to a couple of TDMA frames.
+const uint32_t CLOCK_SYNC_MAX_RTT_US = 5000000;
+// Crystal tolerance assumed when ageing a sample, per clock pair.
+const float CLOCK_SYNC_MAX_DRIFT_PPM = 100.0f;
+// Shortest baseline for a drift measurement.
+const uint32_t CLOCK_SYNC_DRIFT_SPAN_US = 30000000;
+// Prediction error (beyond half the delay) that counts as a step.
+const uint32_t CLOCK_SYNC_STEP_US = 20000;
+const uint32_t CLOCK_SYNC_STEP_SAMPLES = 2;
+// How often each client starts an exchange.
+const uint32_t CLOCK_SYNC_INTERVAL_MS = 1000;
+
+/**
+ * @brief SERIAL_TIME_REPLY payload. The request is just origin_us.
+ */
+struct __attribute__((packed)) TimeSyncReply
+{
+    uint32_t origin_us;   // t1, echoed.
+    uint32_t receive_us;  // t2.
+    uint32_t transmit_us; // t3.
+};
+
+const uint8_t FRAME_TIME_SYNC = 0xA5;
+
+/**
+ * @brief Away -> Home, answering a beacon (whose timestamp_us is t1).
+ */
+struct __attribute__((packed)) TimeSyncFrame
+{
+    uint8_t type;                 // FRAME_TIME_SYNC.
+    uint32_t origin_us;           // The beacon's timestamp_us, Home clock.
+    uint32_t receive_us;          // The beacon's start on air, Away clock.
+    uint32_t transmit_us;         // This frame's TX start, Away clock. Set by RadioLink.
+    uint32_t reference_offset_us; // MCU clock - Away clock.
+    uint8_t reference_synced;     // reference_offset_us is valid.
+    uint16_t crc;
+};
+
+inline void time_sync_frame_seal(TimeSyncFrame &frame)
+{
+    frame.type = FRAME_TIME_SYNC;
+    frame.crc = crc16((const uint8_t *)&frame, offsetof(TimeSyncFrame, crc));
+}
+
+inline bool time_sync_frame_valid(const uint8_t *data, size_t length)
+{
+    if (length != sizeof(TimeSyncFrame) || data[0] != FRAME_TIME_SYNC)
+        return false;
+
+    uint16_t crc;
+    memcpy(&crc, data + offsetof(TimeSyncFrame, crc), sizeof(crc));
+    return crc == crc16(data, offsetof(TimeSyncFrame, crc));
+}
+
+/**
+ * @brief Writes the TX start time into a queued TimeSyncFrame and reseals it,
+ * just before it goes on air.
+ *
+ * @return false if the packet is not a TimeSyncFrame.
+ */
+inline bool time_sync_frame_stamp(uint8_t *data, size_t length, uint32_t transmit_us)
+{
+    if (length != sizeof(TimeSyncFrame) || data[0] != FRAME_TIME_SYNC)
+        return false;
+
+    TimeSyncFrame frame;
+    memcpy(&frame, data, sizeof(frame));
+    frame.transmit_us = transmit_us;
+    time_sync_frame_seal(frame);
+    memcpy(data, &frame, sizeof(frame));
+    return true;
+}
+
+struct ClockSample
+{
+    uint32_t local_us;  // Midpoint of the exchange, local clock.
+    uint32_t offset_us; // Remote - local.
+    uint32_t delay_us;  // Round trip minus the remote's hold time.
+};
+
+/**
+ * @brief Offset and drift of a remote clock, from two-way exchanges.
+ */
+class ClockSync
+{
+public:
+    /**
+     * @brief Adds one exchange.
+     *
+     * @param t1 Request sent, local clock.
+     * @param t2 Request received, remote clock.
+     * @param t3 Reply sent, remote clock.
+     * @param t4 Reply received, local clock.
+     * @return false if the sample was discarded (too slow or an outlier).
+     */
+    bool add(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4)
+    {
+        uint32_t round_trip_us = t4 - t1;
+        uint32_t hold_us = t3 - t2;
+        if (round_trip_us > CLOCK_SYNC_MAX_RTT_US || hold_us > round_trip_us + CLOCK_SYNC_STEP_US)
+            return false;
+
+        ClockSample sample;
+        sample.local_us = t1 + round_trip_us / 2;
+        // Clock rates differ slightly, so a fast turnaround can read negative.
+        sample.delay_us = round_trip_us > hold_us ? round_trip_us - hold_us : 0;
+        // offset = d1 - (d1 - d2) / 2; d1 - d2 is the delay, which stays small
+        // however far apart the clocks are.
+        uint32_t d1 = t2 - t1;
+        uint32_t d2 = t3 - t4;
+        sample.offset_us = d1 - (uint32_t)((int32_t)(d1 - d2) / 2);
+
+        if (count_ > 0)
+        {
+            int32_t error_us = (int32_t)(sample.offset_us - offset_us(sample.local_us));
+            uint32_t magnitude_us = error_us < 0 ? -error_us : error_us;
+            if (magnitude_us > CLOCK_SYNC_STEP_US + sample.delay_us / 2)
+            {
+                if (++outliers_ < CLOCK_SYNC_STEP_SAMPLES)
+                    return false;
+                reset();
+                steps_++;
+            }
+        }
+        outliers_ = 0;
+
+        samples_[head_] = sample;
+        head_ = (head_ + 1) % CLOCK_SYNC_WINDOW;
+        if (count_ < CLOCK_SYNC_WINDOW)
+            count_++;
+        exchanges_++;
+        choose(sample.local_us);
+        return true;
+    }
+
+    /**
+     * @brief Forgets every sample, e.g. when the link to the remote drops.
+     */
+    void reset()
+    {
+        count_ = head_ = 0;
+        outliers_ = 0;
+        has_anchor_ = has_drift_ = false;
+        drift_ = 0;
+    }
+
+    bool synced() const { return count_ > 0; }
+
+    /**
+     * @brief Remote - local at local_us (modulo 2^32).
+     */
+    uint32_t offset_us(uint32_t local_us) const
+    {
+        float elapsed_us = (float)(int32_t)(local_us - best_.local_us);
+        return best_.offset_us + (int32_t)(drift_ * elapsed_us);
+    }
+
+    uint32_t to_remote(uint32_t local_us) const { return local_us + offset_us(local_us); }
+
+    /**
+     * @brief Remote time to local; one fixed-point step is enough at ppm drift.
+     */
+    uint32_t to_local(uint32_t remote_us) const
+    {
+        uint32_t local_us = remote_us - best_.offset_us;
+        return remote_us - offset_us(local_us);
+    }
+
+    /**
+     * @brief Error bound at local_us: half the trusted delay, plus assumed
+     * worst-case drift since it was taken if drift is not measured yet.
+     */
+    uint32_t uncertainty_us(uint32_t local_us) const
+    {
+        float age_us = (float)(int32_t)(local_us - best_.local_us);
+        if (age_us < 0)
+            age_us = -age_us;
+        float drift_ppm = has_drift_ ? CLOCK_SYNC_MAX_DRIFT_PPM / 10 : CLOCK_SYNC_MAX_DRIFT_PPM;
+        return best_.delay_us / 2 + (uint32_t)(age_us * drift_ppm / 1e6f);
+    }
+
+    float drift_ppm() const { return drift_ * 1e6f; }
+    bool drift_known() const { return has_drift_; }
+    uint32_t delay_us() const { return best_.delay_us; }
+    uint32_t exchanges() const { return exchanges_; }
+    uint32_t steps() const { return steps_; }
+
+private:
+    /**
+     * @brief Picks the trusted sample and updates the drift from it.
+     */
+    void choose(uint32_t now_us)
+    {
+        const ClockSample *best = NULL;
+        float best_cost = 0;
+        for (size_t i = 0; i < count_; i++)
+        {
+            const ClockSample &sample = samples_[i];
+            float age_us = (float)(now_us - sample.local_us);
+            float cost = sample.delay_us / 2.0f + age_us * CLOCK_SYNC_MAX_DRIFT_PPM / 1e6f;
+            if (best == NULL || cost < best_cost)
+            {
+                best = &sample;
+                best_cost = cost;
+            }
+        }
+        best_ = *best;
+
+        if (!has_anchor_)
+        {
+            anchor_ = best_;
+            has_anchor_ = true;
+            return;
+        }
+        uint32_t span_us = best_.local_us - anchor_.local_us;
+        if (span_us < CLOCK_SYNC_DRIFT_SPAN_US || span_us > 0x80000000u)
+            return;
+        float measured = (float)(int32_t)(best_.offset_us - anchor_.offset_us) / (float)span_us;
+        // Asymmetric delay on either sample can fake a large drift.
+        const float limit = CLOCK_SYNC_MAX_DRIFT_PPM / 1e6f;
+        measured = measured > limit ? limit : measured < -limit ? -limit : measured;
+        drift_ = has_drift_ ? drift_ + (measured - drift_) / 4 : measured;
+        has_drift_ = true;
+        anchor_ = best_;
+    }
+
+    ClockSample samples_[CLOCK_SYNC_WINDOW];
+    size_t head_ = 0;
+    size_t count_ = 0;
+    ClockSample best_ = {};
+    ClockSample anchor_ = {};
+    bool has_anchor_ = false;
+    bool has_drift_ = false;
+    float drift_ = 0; // d(offset)/d(local): remote runs fast if positive.
+    uint32_t outliers_ = 0;
+    uint32_t exchanges_ = 0;
+    uint32_t steps_ = 0;
+};
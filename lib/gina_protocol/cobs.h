@@ -0,0 +1,80 @@
+/**
+ * @file cobs.h
+ * @brief Consistent Overhead Byte Stuffing.
+ *
+ * Encoded data never contains 0x00, so a zero byte can delimit frames on a
+ * byte stream. A receiver that joins mid-frame or sees a corrupted byte loses
+ * at most the frame in progress and resynchronises on the next 0x00.
+ * Overhead is one byte per 254 bytes of input, plus one.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Worst-case encoded size of n input bytes, without the delimiter.
+#define COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+/**
+ * @brief Encodes a buffer. Does not append the 0x00 delimiter.
+ *
+ * @param in
+ * @param length
+ * @param out At least COBS_MAX_ENCODED(length) bytes. Must not overlap in.
+ * @return Encoded length.
+ */
+inline size_t cobs_encode(const uint8_t *in, size_t length, uint8_t *out)
+{
+    size_t code_index = 0;
+    size_t write = 1;
+    uint8_t code = 1;
+
+    for (size_t read = 0; read < length; read++)
+    {
+        if (in[read] != 0)
+        {
+            out[write++] = in[read];
+            code++;
+        }
+        if (in[read] == 0 || code == 0xFF)
+        {
+            out[code_index] = code;
+            code = 1;
+            code_index = write++;
+        }
+    }
+    out[code_index] = code;
+    return write;
+}
+
+/**
+ * @brief Decodes one frame (delimiter already stripped).
+ *
+ * @param in
+ * @param length
+ * @param out At least length bytes. May be the same buffer as in.
+ * @return Decoded length, or 0 if the frame is malformed.
+ */
+inline size_t cobs_decode(const uint8_t *in, size_t length, uint8_t *out)
+{
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < length)
+    {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > length)
+            return 0;
+
+        for (uint8_t i = 1; i < code; i++)
+        {
+            if (in[read] == 0)
+                return 0;
+            out[write++] = in[read++];
+        }
+        // A full block (0xFF) has no implied zero; neither does the last block.
+        if (code != 0xFF && read < length)
+            out[write++] = 0;
+    }
+    return write;
+}
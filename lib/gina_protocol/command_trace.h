@@ -0,0 +1,47 @@
+/**
+ * @file command_trace.h
+ * @brief Per-stage latency of one radio command, GCS -> MCU -> GCS.
+ *
+ * The radio sequence number (command_window.h) doubles as the trace id. Each
+ * board only measures intervals on its own clock:
+ *
+ *   Home:  serial line -> first radio TX start (home), TX start -> ACK RX
+ *   Away:  radio RX -> ACK TX start (hold), radio RX -> Serial2 write (away),
+ *          Serial2 write -> CommandTiming RX
+ *   MCU:   Serial2 RX -> dispatch (queue), dispatch -> servo written
+ *          (execute), servo written -> next telemetry frame out (confirm)
+ *
+ * A one-way leg between two boards is a round trip minus the far side's
+ * hold time, halved: "radio" from Home's TX -> ACK, "uart" from Away's
+ * Serial2 round trip. Retransmitted commands have no radio leg (Karn).
+ *
+ * The MCU returns its intervals in a CommandTiming. Away appends them and its
+ * own to a second, extended ACK:
+ *
+ *   ACK:#<cum>:<mask>:LAT:<seq>:<hold>:<away>:<uart>:<queue>:<execute>:<confirm>:<tlm_seq>
+ *
+ * and Home prints one line per command for the GCS (microseconds, -1 if
+ * unknown):
+ *
+ *   LAT:<seq>:<home>:<radio>:<away>:<uart>:<queue>:<execute>:<confirm>:<tlm_seq>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands traced at once per board, indexed by sequence.
+const size_t COMMAND_TRACE_SLOTS = 8;
+
+/**
+ * @brief MCU -> Away (SERIAL_COMMAND_RESULT), once the command's telemetry
+ * frame is out.
+ */
+struct __attribute__((packed)) CommandTiming
+{
+    uint16_t trace;              // Radio sequence number.
+    uint32_t queue_us;           // Serial2 RX -> actuation dispatch.
+    uint32_t execute_us;         // Dispatch -> servo written (or command done).
+    uint32_t confirm_us;         // Servo written -> next telemetry frame queued.
+    uint16_t telemetry_sequence; // That frame.
+};
@@ -0,0 +1,469 @@
+/**
+ * @file command_window.h
+ * @brief Sliding-window ARQ for radio commands, Lora Home -> Lora Away.
+ *
+ * Home numbers every command and keeps up to COMMAND_WINDOW of them in
+ * flight; more wait in a FIFO instead of overwriting each other. Each
+ * outstanding command is retransmitted on its own timeout, derived from the
+ * measured round trip (RFC 6298, Karn's rule) and doubled per retry. The
+ * timer starts when the radio puts the command on air (transmitted()), not
+ * when it is handed to the TX queue: under TDMA it may wait most of a frame
+ * for the uplink slot.
+ *
+ * Away acknowledges with a CommandAck: everything up to `cumulative` has been
+ * delivered, and bit i of `mask` says cumulative + 1 + i arrived out of order
+ * and is held. Out-of-order commands are delivered in sequence order once the
+ * gap fills, so "V1:OPEN, V1:CLOSE" can never be applied backwards. The same
+ * CommandAck rides in every telemetry batch, so a lost ACK costs at most one
+ * batch interval instead of a retransmit.
+ *
+ * Aborts (command_is_abort()) do not wait behind anything. They go ahead of
+ * queued commands, evicting the newest ordinary one if the queue is full, and
+ * may use COMMAND_ABORT_SLOTS window slots beyond COMMAND_WINDOW. Away hands
+ * them over as soon as they arrive (COMMAND_URGENT) and skips them when the
+ * in-order delivery reaches their sequence number.
+ *
+ * Each command also carries Home's window base (oldest unacknowledged
+ * sequence) and a session number drawn at boot. Away resynchronises to the
+ * base on its first command and whenever the session changes, which covers a
+ * reset on either side. Home also starts at a random sequence, so ACKs still
+ * in the air from before a reset are ignored.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Commands in flight at once.
+const size_t COMMAND_WINDOW = 4;
+// Extra slots in flight only aborts may take. The ACK mask covers 16.
+const size_t COMMAND_ABORT_SLOTS = 4;
+static_assert(COMMAND_WINDOW + COMMAND_ABORT_SLOTS <= 16, "Commands in flight must fit the ACK mask.");
+// Commands waiting for a window slot.
+const size_t COMMAND_QUEUE_LENGTH = 8;
+// Longest command text, including the NUL.
+const size_t COMMAND_TEXT_MAX = 64;
+
+// Retransmit timeout bounds until CommandSender::set_frame_ms() derives them
+// from the TDMA frame.
+const uint32_t COMMAND_RTO_INITIAL_MS = 500;
+const uint32_t COMMAND_RTO_MIN_MS = 250;
+const uint32_t COMMAND_RTO_MAX_MS = 4000;
+
+struct CommandAck
+{
+    bool valid;          // false until Away has seen a command.
+    uint16_t cumulative; // Every sequence up to and including this one was delivered.
+    uint16_t mask;       // Bit i: cumulative + 1 + i is held for in-order delivery.
+};
+
+/**
+ * @brief Signed distance a - b on the wrapping 16-bit sequence space.
+ */
+inline int16_t command_sequence_diff(uint16_t a, uint16_t b)
+{
+    return (int16_t)(uint16_t)(a - b);
+}
+
+/**
+ * @brief Commands that safe the stand (CMD:CLOSE_ALL, CMD:CLOSE_VALVES), which
+ * bypass the queue and window ordering.
+ */
+inline bool command_is_abort(const char *text)
+{
+    return strncmp(text, "CMD:CLOSE", 9) == 0;
+}
+
+/**
+ * @brief True if ack covers sequence.
+ */
+inline bool command_ack_covers(const CommandAck &ack, uint16_t sequence)
+{
+    if (!ack.valid)
+        return false;
+    int16_t distance = command_sequence_diff(sequence, ack.cumulative);
+    if (distance <= 0)
+        return true;
+    return distance <= 16 && (ack.mask & (1u << (distance - 1)));
+}
+
+/**
+ * @brief Smoothed RTT and retransmit timeout, as in RFC 6298.
+ */
+class RttEstimator
+{
+public:
+    void sample(uint32_t rtt_ms)
+    {
+        if (samples_ == 0)
+        {
+            srtt_ms_ = rtt_ms;
+            rttvar_ms_ = rtt_ms / 2;
+        }
+        else
+        {
+            uint32_t error = srtt_ms_ > rtt_ms ? srtt_ms_ - rtt_ms : rtt_ms - srtt_ms_;
+            rttvar_ms_ = (3 * rttvar_ms_ + error) / 4;
+            srtt_ms_ = (7 * srtt_ms_ + rtt_ms) / 8;
+        }
+        samples_++;
+    }
+
+    void set_bounds(uint32_t initial_ms, uint32_t min_ms, uint32_t max_ms)
+    {
+        initial_ms_ = initial_ms;
+        min_ms_ = min_ms;
+        max_ms_ = max_ms;
+    }
+
+    uint32_t rto_ms() const
+    {
+        if (samples_ == 0)
+            return initial_ms_;
+        uint32_t rto = srtt_ms_ + 4 * rttvar_ms_;
+        if (rto < min_ms_)
+            return min_ms_;
+        if (rto > max_ms_)
+            return max_ms_;
+        return rto;
+    }
+
+    uint32_t max_ms() const { return max_ms_; }
+
+    uint32_t srtt_ms() const { return srtt_ms_; }
+    uint32_t rttvar_ms() const { return rttvar_ms_; }
+    uint32_t samples() const { return samples_; }
+
+private:
+    uint32_t srtt_ms_ = 0;
+    uint32_t rttvar_ms_ = 0;
+    uint32_t samples_ = 0;
+    uint32_t initial_ms_ = COMMAND_RTO_INITIAL_MS;
+    uint32_t min_ms_ = COMMAND_RTO_MIN_MS;
+    uint32_t max_ms_ = COMMAND_RTO_MAX_MS;
+};
+
+struct OutgoingCommand
+{
+    uint16_t sequence;
+    uint16_t base;    // Oldest unacknowledged sequence, for the receiver's resync.
+    uint16_t session; // Home's boot session.
+    bool retransmit;
+    const char *text; // Valid until the next call into the sender.
+    uint32_t tag;     // As given to push().
+};
+
+/**
+ * @brief Home side: numbering, window, retransmit timers.
+ */
+class CommandSender
+{
+public:
+    /**
+     * @param session Random at boot, so Away never mistakes a restarted Home
+     * for duplicates.
+     * @param first_sequence Random at boot, so stale ACKs miss.
+     */
+    void begin(uint16_t session, uint16_t first_sequence)
+    {
+        session_ = session;
+        next_sequence_ = first_sequence;
+        window_count_ = 0;
+        queue_head_ = queue_count_ = 0;
+    }
+
+    /**
+     * @brief Derives the retransmit bounds from the TDMA frame. The ACK for
+     * a command sent in the uplink slot comes back in the same frame (ACK
+     * slot or downlink batch), and a retransmit cannot go out before the
+     * next uplink slot anyway: start at one frame, never below half a frame
+     * and never above four. Call again when the schedule changes.
+     */
+    void set_frame_ms(uint32_t frame_ms) { rtt_.set_bounds(frame_ms, frame_ms / 2, 4 * frame_ms); }
+
+    /**
+     * @brief Queues a command for sending. Aborts go ahead of every ordinary
+     * command still waiting.
+     *
+     * @param text
+     * @param tag Returned with the command by poll(), e.g. when it was given.
+     * @return false if the text is too long or the queue is full. A full
+     * queue only refuses an abort if it holds nothing but aborts; otherwise
+     * the newest ordinary command is evicted (see evicted()).
+     */
+    bool push(const char *text, uint32_t tag = 0)
+    {
+        size_t length = strlen(text);
+        if (length == 0 || length >= COMMAND_TEXT_MAX)
+            return false;
+        bool abort = command_is_abort(text);
+        if (queue_count_ >= COMMAND_QUEUE_LENGTH)
+        {
+            // Aborts are queued first, so the newest is ordinary if any is.
+            if (!abort || command_is_abort(queue_at(queue_count_ - 1).text))
+                return false;
+            queue_count_--;
+            evicted_++;
+        }
+
+        size_t position = queue_count_;
+        while (abort && position > 0 && !command_is_abort(queue_at(position - 1).text))
+        {
+            queue_at(position) = queue_at(position - 1);
+            position--;
+        }
+        memcpy(queue_at(position).text, text, length + 1);
+        queue_at(position).tag = tag;
+        queue_count_++;
+        return true;
+    }
+
+    /**
+     * @brief Returns the next command due for (re)transmission. Call until it
+     * returns false, and transmitted() once each goes on air. One that never
+     * does (dropped from the TX queue) is handed out again after the longest
+     * timeout.
+     */
+    bool poll(uint32_t now_ms, OutgoingCommand &out)
+    {
+        // Admit queued commands into free window slots, aborts into the extra
+        // ones too.
+        while (queue_count_ > 0 &&
+               window_count_ < (command_is_abort(queue_at(0).text) ? COMMAND_WINDOW + COMMAND_ABORT_SLOTS : COMMAND_WINDOW))
+        {
+            Slot &slot = window_[window_count_++];
+            memcpy(slot.text, queue_[queue_head_].text, COMMAND_TEXT_MAX);
+            slot.tag = queue_[queue_head_].tag;
+            queue_head_ = (queue_head_ + 1) % COMMAND_QUEUE_LENGTH;
+            queue_count_--;
+            slot.sequence = next_sequence_++;
+            slot.sends = 0;
+            slot.acked = false;
+            slot.on_air = false;
+        }
+
+        for (size_t i = 0; i < window_count_; i++)
+        {
+            Slot &slot = window_[i];
+            if (slot.acked || (slot.sends > 0 && now_ms - slot.last_sent_ms <
+                                                     (slot.on_air ? timeout_ms(slot) : rtt_.max_ms())))
+                continue;
+
+            out.sequence = slot.sequence;
+            out.base = base();
+            out.session = session_;
+            out.retransmit = slot.sends > 0;
+            out.text = slot.text;
+            out.tag = slot.tag;
+            if (slot.sends > 0)
+                retransmits_++;
+            slot.sends++;
+            slot.on_air = false;
+            slot.last_sent_ms = now_ms;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief The radio started sending a command poll() returned: starts its
+     * retransmit timer and RTT measurement.
+     *
+     * @return false if it is not in flight (already acknowledged).
+     */
+    bool transmitted(uint16_t sequence, uint32_t now_ms)
+    {
+        for (size_t i = 0; i < window_count_; i++)
+        {
+            Slot &slot = window_[i];
+            if (slot.sequence != sequence || slot.acked || slot.on_air)
+                continue;
+            slot.on_air = true;
+            slot.last_sent_ms = now_ms;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Applies an ACK (standalone or from a telemetry batch).
+     *
+     * @return Commands newly acknowledged.
+     */
+    size_t acknowledge(const CommandAck &ack, uint32_t now_ms)
+    {
+        // Ignore acks for sequences never sent, and ones from before a reset.
+        if (!ack.valid || command_sequence_diff(ack.cumulative, next_sequence_) >= 0 ||
+            command_sequence_diff(ack.cumulative, (uint16_t)(base() - 1)) < -64)
+            return 0;
+
+        size_t newly = 0;
+        for (size_t i = 0; i < window_count_; i++)
+        {
+            Slot &slot = window_[i];
+            if (slot.acked || slot.sends == 0 || !command_ack_covers(ack, slot.sequence))
+                continue;
+            slot.acked = true;
+            newly++;
+            // Karn: a retransmitted command's RTT is ambiguous.
+            if (slot.sends == 1 && slot.on_air)
+                rtt_.sample(now_ms - slot.last_sent_ms);
+        }
+
+        // Slide past the acknowledged prefix.
+        size_t done = 0;
+        while (done < window_count_ && window_[done].acked)
+            done++;
+        if (done > 0)
+        {
+            memmove(window_, window_ + done, (window_count_ - done) * sizeof(Slot));
+            window_count_ -= done;
+        }
+        return newly;
+    }
+
+    uint16_t base() const { return window_count_ > 0 ? window_[0].sequence : next_sequence_; }
+    size_t in_flight() const { return window_count_; }
+    size_t queued() const { return queue_count_; }
+    bool idle() const { return window_count_ == 0 && queue_count_ == 0; }
+    uint32_t retransmits() const { return retransmits_; }
+    /**
+     * @brief Ordinary commands dropped from the queue to make room for aborts.
+     */
+    uint32_t evicted() const { return evicted_; }
+    const RttEstimator &rtt() const { return rtt_; }
+
+private:
+    struct Slot
+    {
+        uint16_t sequence;
+        uint8_t sends;
+        bool acked;
+        bool on_air;           // The last send has left the TX queue.
+        uint32_t last_sent_ms; // Handed out, then on air.
+        uint32_t tag;
+        char text[COMMAND_TEXT_MAX];
+    };
+
+    struct QueuedCommand
+    {
+        uint32_t tag;
+        char text[COMMAND_TEXT_MAX];
+    };
+
+    // Exponential backoff per retry, capped.
+    uint32_t timeout_ms(const Slot &slot) const
+    {
+        uint32_t timeout = rtt_.rto_ms();
+        for (uint8_t i = 1; i < slot.sends && timeout < rtt_.max_ms(); i++)
+            timeout *= 2;
+        return timeout < rtt_.max_ms() ? timeout : rtt_.max_ms();
+    }
+
+    QueuedCommand &queue_at(size_t index) { return queue_[(queue_head_ + index) % COMMAND_QUEUE_LENGTH]; }
+
+    Slot window_[COMMAND_WINDOW + COMMAND_ABORT_SLOTS];
+    size_t window_count_ = 0;
+    QueuedCommand queue_[COMMAND_QUEUE_LENGTH];
+    size_t queue_head_ = 0;
+    size_t queue_count_ = 0;
+    uint16_t session_ = 0;
+    uint16_t next_sequence_ = 0;
+    uint32_t retransmits_ = 0;
+    uint32_t evicted_ = 0;
+    RttEstimator rtt_;
+};
+
+enum CommandVerdict : uint8_t
+{
+    COMMAND_ACCEPTED,  // New; pop() it (possibly after earlier gaps fill).
+    COMMAND_URGENT,    // New abort; deliver its text now. pop() skips it.
+    COMMAND_DUPLICATE, // Already delivered or held; just re-ACK.
+    COMMAND_REJECTED   // Outside the window or too long.
+};
+
+/**
+ * @brief Away side: duplicate suppression and in-order delivery.
+ */
+class CommandReceiver
+{
+public:
+    CommandVerdict receive(uint16_t sequence, uint16_t base, uint16_t session, const char *text)
+    {
+        // First command or a new Home session. A base past anything delivered
+        // only happens if state was lost, so resynchronise on that too.
+        if (!synced_ || session != session_ || command_sequence_diff(base, next_) > 0)
+        {
+            synced_ = true;
+            session_ = session;
+            next_ = base;
+            held_mask_ = 0;
+            urgent_mask_ = 0;
+        }
+
+        int16_t distance = command_sequence_diff(sequence, next_);
+        if (distance < 0)
+            return COMMAND_DUPLICATE;
+        if (command_is_abort(text) && distance < (int16_t)(COMMAND_WINDOW + COMMAND_ABORT_SLOTS))
+        {
+            if (held_mask_ & (1u << distance))
+                return COMMAND_DUPLICATE;
+            held_mask_ |= 1u << distance;
+            urgent_mask_ |= 1u << distance;
+            return COMMAND_URGENT;
+        }
+        if (distance >= (int16_t)COMMAND_WINDOW || strlen(text) >= COMMAND_TEXT_MAX)
+            return COMMAND_REJECTED;
+
+        size_t slot = sequence % COMMAND_WINDOW;
+        if (held_mask_ & (1u << distance))
+            return COMMAND_DUPLICATE;
+        strcpy(held_[slot], text);
+        held_mask_ |= 1u << distance;
+        return COMMAND_ACCEPTED;
+    }
+
+    /**
+     * @brief Pops the next command in sequence order, if it has arrived.
+     *
+     * @param text At least COMMAND_TEXT_MAX bytes.
+     * @param sequence Optional. The command's sequence number.
+     */
+    bool pop(char *text, uint16_t *sequence = NULL)
+    {
+        // Aborts already went out when they arrived.
+        while (urgent_mask_ & 1)
+        {
+            held_mask_ >>= 1;
+            urgent_mask_ >>= 1;
+            next_++;
+        }
+        if (!(held_mask_ & 1))
+            return false;
+        strcpy(text, held_[next_ % COMMAND_WINDOW]);
+        if (sequence)
+            *sequence = next_;
+        held_mask_ >>= 1;
+        urgent_mask_ >>= 1;
+        next_++;
+        return true;
+    }
+
+    CommandAck ack() const
+    {
+        CommandAck ack;
+        ack.valid = synced_;
+        ack.cumulative = (uint16_t)(next_ - 1);
+        ack.mask = (uint16_t)held_mask_;
+        return ack;
+    }
+
+private:
+    bool synced_ = false;
+    uint16_t session_ = 0;
+    uint16_t next_ = 0;
+    uint32_t held_mask_ = 0;   // Bit i: next_ + i is held.
+    uint32_t urgent_mask_ = 0; // Bit i: next_ + i was an abort, already delivered.
+    char held_[COMMAND_WINDOW][COMMAND_TEXT_MAX];
+};
@@ -0,0 +1,29 @@
+/**
+ * @file crc16.h
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), shared by every link.
+ *
+ * Matches Python's binascii.crc_hqx(data, 0xFFFF) on the GCS side.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Computes (or continues) a CRC-16/CCITT-FALSE.
+ *
+ * @param data
+ * @param length
+ * @param crc Previous CRC when computing over several buffers.
+ * @return uint16_t
+ */
+inline uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file phy_profile.h
+ * @brief Named LoRa PHY profiles and the link-quality rule that picks one.
+ *
+ * STANDBY is the long-range default (RadioLib's SF9/125 kHz/4:7). BURN is
+ * SF7/500 kHz/4:5 for the short, clear path to the stand during a test:
+ * roughly 15x less time on air, so the TDMA frame shrinks from about 2.2 s to
+ * about 0.17 s.
+ *
+ * Switching is a handshake carried by the TDMA beacon (tdma.h): Home
+ * announces the next profile and the frame it takes effect in, Away answers
+ * every announcing beacon with a PhyAck in its ACK slot, and the last beacon
+ * before the switch only keeps the announcement if an ACK arrived. Both sides
+ * drop back to STANDBY on their own after PHY_FALLBACK_MS without a good
+ * packet, so a mismatched switch heals itself.
+ */
+#pragma once
+
+#include "crc16.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum PhyProfileId : uint8_t
+{
+    PHY_STANDBY,
+    PHY_BURN,
+    PHY_PROFILE_COUNT
+};
+
+struct PhyProfile
+{
+    const char *name;
+    float bandwidth_khz;
+    uint8_t spreading_factor;
+    uint8_t coding_rate; // Denominator of 4/x, as RadioLib takes it.
+};
+
+constexpr PhyProfile PHY_PROFILES[PHY_PROFILE_COUNT] = {
+    {"STANDBY", 125.0f, 9, 7},
+    {"BURN", 500.0f, 7, 5},
+};
+
+// Beacons announcing a switch before it happens.
+const uint16_t PHY_SWITCH_LEAD_FRAMES = 3;
+// No good packet for this long on a faster profile: back to STANDBY.
+const uint32_t PHY_FALLBACK_MS = 3000;
+
+// Link quality (as heard by Home) to move up to BURN, sustained...
+const float PHY_UP_SNR_DB = 5.0f;
+const float PHY_UP_RSSI_DBM = -95.0f;
+const uint32_t PHY_UP_SAMPLES = 8;
+// ...and to give it up. BW 500 kHz reads about 6 dB lower SNR for the same
+// signal, which doubles as hysteresis.
+const float PHY_DOWN_SNR_DB = -3.0f;
+const float PHY_DOWN_RSSI_DBM = -105.0f;
+const uint32_t PHY_DOWN_SAMPLES = 4;
+
+const uint8_t FRAME_PHY_ACK = 0xA4;
+
+/**
+ * @brief Away -> Home: ready to switch to profile at switch_frame.
+ */
+struct __attribute__((packed)) PhyAck
+{
+    uint8_t type; // FRAME_PHY_ACK.
+    uint8_t profile;
+    uint16_t switch_frame;
+    uint16_t crc;
+};
+
+inline void phy_ack_seal(PhyAck &ack)
+{
+    ack.type = FRAME_PHY_ACK;
+    ack.crc = crc16((const uint8_t *)&ack, offsetof(PhyAck, crc));
+}
+
+inline bool phy_ack_valid(const uint8_t *data, size_t length)
+{
+    if (length != sizeof(PhyAck) || data[0] != FRAME_PHY_ACK)
+        return false;
+
+    uint16_t crc;
+    memcpy(&crc, data + offsetof(PhyAck, crc), sizeof(crc));
+    return crc == crc16(data, offsetof(PhyAck, crc));
+}
+
+/**
+ * @brief Smooths RSSI/SNR of received packets and picks a profile.
+ */
+class PhySelector
+{
+public:
+    void sample(float rssi_dbm, float snr_db)
+    {
+        if (samples_ == 0)
+        {
+            rssi_dbm_ = rssi_dbm;
+            snr_db_ = snr_db;
+        }
+        else
+        {
+            rssi_dbm_ += (rssi_dbm - rssi_dbm_) / 8;
+            snr_db_ += (snr_db - snr_db_) / 8;
+        }
+        samples_++;
+    }
+
+    /**
+     * @brief Forget history, e.g. after the profile changed.
+     */
+    void reset() { samples_ = 0; }
+
+    PhyProfileId choose(PhyProfileId current) const
+    {
+        if (current == PHY_STANDBY && samples_ >= PHY_UP_SAMPLES && snr_db_ >= PHY_UP_SNR_DB &&
+            rssi_dbm_ >= PHY_UP_RSSI_DBM)
+            return PHY_BURN;
+        if (current == PHY_BURN && samples_ >= PHY_DOWN_SAMPLES &&
+            (snr_db_ < PHY_DOWN_SNR_DB || rssi_dbm_ < PHY_DOWN_RSSI_DBM))
+            return PHY_STANDBY;
+        return current;
+    }
+
+    float rssi_dbm() const { return rssi_dbm_; }
+    float snr_db() const { return snr_db_; }
+
+private:
+    float rssi_dbm_ = 0;
+    float snr_db_ = 0;
+    uint32_t samples_ = 0;
+};
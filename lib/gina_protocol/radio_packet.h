@@ -0,0 +1,103 @@
+/**
+ * @file radio_packet.h
+ * @brief Text packets on the radio: "DC=<message>\n".
+ *
+ * Commands carry their window numbers after a '#':
+ * "DC=CMD:V1:OPEN#<sequence>:<base>:<session>\n". ACKs are
+ * "DC=ACK:#<cumulative>:<mask>[...]\n". Binary frames (telemetry, beacons)
+ * are told apart by their first byte and never reach this parser.
+ */
+#pragma once
+
+#include "command_window.h"
+#include <stdio.h>
+#include <string.h>
+
+const char RADIO_PACKET_ID[] = "DC=";
+const size_t RADIO_PACKET_ID_LENGTH = sizeof(RADIO_PACKET_ID) - 1;
+
+enum RadioPacketStatus
+{
+    RADIO_PACKET_OK,
+    RADIO_PACKET_FOREIGN,     // No "DC=" header: another team's packet.
+    RADIO_PACKET_UNTERMINATED // Ours, but cut short before the newline.
+};
+
+/**
+ * @brief Finds the message in a NUL-terminated packet.
+ *
+ * @param message Set to the text after the header.
+ * @param length Set to the message length, without the newline.
+ */
+inline RadioPacketStatus radio_packet_message(const char *packet, const char *&message, size_t &length)
+{
+    if (strncmp(packet, RADIO_PACKET_ID, RADIO_PACKET_ID_LENGTH) != 0)
+        return RADIO_PACKET_FOREIGN;
+
+    message = packet + RADIO_PACKET_ID_LENGTH;
+    const char *newline = strchr(message, '\n');
+    if (newline == NULL)
+        return RADIO_PACKET_UNTERMINATED;
+    length = newline - message;
+    return RADIO_PACKET_OK;
+}
+
+/**
+ * @brief Formats a command packet.
+ *
+ * @return Characters written, or 0 if it does not fit in size.
+ */
+inline size_t radio_packet_format_command(const OutgoingCommand &command, char *out, size_t size)
+{
+    int length = snprintf(out, size, "%s%s#%u:%u:%u\n", RADIO_PACKET_ID, command.text, (unsigned)command.sequence,
+                          (unsigned)command.base, (unsigned)command.session);
+    return length > 0 && (size_t)length < size ? length : 0;
+}
+
+struct RadioCommand
+{
+    char text[COMMAND_TEXT_MAX]; // Without the '#' suffix.
+    uint16_t sequence;
+    uint16_t base;
+    uint16_t session;
+};
+
+/**
+ * @brief Splits "CMD:...#<sequence>:<base>:<session>" (a message, see
+ * radio_packet_message()).
+ *
+ * @return false if the numbers are missing or the text is too long.
+ */
+inline bool radio_packet_parse_command(const char *message, size_t length, RadioCommand &command)
+{
+    const char *hash = (const char *)memchr(message, '#', length);
+    if (hash == NULL || (size_t)(hash - message) >= COMMAND_TEXT_MAX)
+        return false;
+
+    unsigned sequence, base, session;
+    if (sscanf(hash + 1, "%u:%u:%u", &sequence, &base, &session) != 3)
+        return false;
+    memcpy(command.text, message, hash - message);
+    command.text[hash - message] = '\0';
+    command.sequence = sequence;
+    command.base = base;
+    command.session = session;
+    return true;
+}
+
+/**
+ * @brief Parses "ACK:#<cumulative>:<mask>", ignoring any extension after it.
+ *
+ * @return false (and ack.valid false) if it is not an ACK.
+ */
+inline bool radio_packet_parse_ack(const char *message, CommandAck &ack)
+{
+    unsigned cumulative, mask;
+    ack.valid = strncmp(message, "ACK:#", 5) == 0 && sscanf(message + 5, "%u:%u", &cumulative, &mask) == 2;
+    if (ack.valid)
+    {
+        ack.cumulative = cumulative;
+        ack.mask = mask;
+    }
+    return ack.valid;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file ring_buffer.h
+ * @brief Fixed-size, single-producer/single-consumer ring buffer.
+ *
+ * Lock-free: one task (or ISR) pushes, one task pops. Capacity must be a power
+ * of two so indices wrap with a mask. When full, push() fails and the caller
+ * decides whether to count the drop.
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class RingBuffer
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two.");
+
+public:
+    /**
+     * @brief Pushes an item. Producer side only.
+     *
+     * @return false if the buffer was full and the item was dropped.
+     */
+    bool push(const T &item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= N)
+            return false;
+
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pops the oldest item. Consumer side only.
+     *
+     * @return false if the buffer was empty.
+     */
+    bool pop(T &item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        if (tail == head)
+            return false;
+
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pops up to max_items into out. Consumer side only.
+     *
+     * @return Number of items popped.
+     */
+    size_t pop(T *out, size_t max_items)
+    {
+        size_t count = 0;
+        while (count < max_items && pop(out[count]))
+            count++;
+        return count;
+    }
+
+    size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T items_[N];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
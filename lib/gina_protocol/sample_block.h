@@ -0,0 +1,86 @@
+/**
+ * @file sample_block.h
+ * @brief Full-rate sensor samples, MCU -> GCS over UDP (SERIAL_SAMPLES).
+ *
+ * One block is a run of evenly spaced scans: a header, then count scans of
+ * `channels` int16 values each (tared, 0.1 units, sensors.h order). Sample
+ * times are implied by timestamp_us + i * period_us, so a dropped sample or
+ * a rate change starts a new block instead of being encoded.
+ */
+#pragma once
+
+#include "serial_packet.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct __attribute__((packed)) SampleBlockHeader
+{
+    uint8_t channels;
+    uint8_t count;         // Scans in the block.
+    uint32_t timestamp_us; // First scan.
+    uint32_t period_us;    // Between scans.
+};
+
+// int16 values that fit one packet after the header.
+const size_t SAMPLE_BLOCK_MAX_VALUES = (SERIAL_PACKET_MAX_PAYLOAD - sizeof(SampleBlockHeader)) / sizeof(int16_t);
+
+class SampleBlockBuilder
+{
+public:
+    /**
+     * @brief Appends a scan.
+     *
+     * @param period_us Current spacing; a change starts a new block.
+     * @return false if the scan does not continue this block (full, gap or
+     * new rate). finish() the block and add it again.
+     */
+    bool add(uint32_t timestamp_us, const int16_t *values, uint8_t channels, uint32_t period_us)
+    {
+        if (header_.count == 0)
+        {
+            if (channels == 0 || channels > SAMPLE_BLOCK_MAX_VALUES)
+                return false;
+            header_.channels = channels;
+            header_.timestamp_us = timestamp_us;
+            header_.period_us = period_us;
+        }
+        else
+        {
+            uint32_t expected_us = header_.timestamp_us + (uint32_t)header_.count * header_.period_us;
+            int32_t error_us = (int32_t)(timestamp_us - expected_us);
+            int32_t tolerance_us = period_us / 2;
+            if (channels != header_.channels || period_us != header_.period_us ||
+                (size_t)(header_.count + 1) * channels > SAMPLE_BLOCK_MAX_VALUES || error_us > tolerance_us ||
+                error_us < -tolerance_us)
+                return false;
+        }
+        memcpy(&values_[header_.count * channels], values, channels * sizeof(int16_t));
+        header_.count++;
+        return true;
+    }
+
+    /**
+     * @brief Writes the block and starts an empty one.
+     *
+     * @param out At least SERIAL_PACKET_MAX_PAYLOAD bytes.
+     * @return Payload length; 0 if the block was empty.
+     */
+    size_t finish(uint8_t *out)
+    {
+        if (header_.count == 0)
+            return 0;
+        size_t values_length = (size_t)header_.count * header_.channels * sizeof(int16_t);
+        memcpy(out, &header_, sizeof(header_));
+        memcpy(out + sizeof(header_), values_, values_length);
+        header_.count = 0;
+        return sizeof(header_) + values_length;
+    }
+
+    size_t count() const { return header_.count; }
+    uint32_t first_timestamp_us() const { return header_.timestamp_us; }
+
+private:
+    SampleBlockHeader header_ = {};
+    int16_t values_[SAMPLE_BLOCK_MAX_VALUES];
+};
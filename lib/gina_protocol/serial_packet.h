@@ -0,0 +1,103 @@
+/**
+ * @file serial_packet.h
+ * @brief Packets on the wired MCU <-> Lora Away link (Serial2), also used
+ * one per datagram on the MCU <-> GCS UDP link (MCU/src/server.h).
+ *
+ * On the wire: COBS(type, payload, crc16 little-endian), then 0x00. The CRC
+ * covers the type and payload. Every byte on the link belongs to a packet, so
+ * a line glitch costs one packet, is counted, and never reaches a command
+ * parser. Text payloads (commands, logs) carry no newline or NUL.
+ */
+#pragma once
+
+#include "cobs.h"
+#include "crc16.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum SerialPacketType : uint8_t
+{
+    SERIAL_TELEMETRY = 1,      // MCU -> Away. A sealed TelemetryFrame.
+    SERIAL_COMMAND = 2,        // Away -> MCU. "CMD:..." text.
+    SERIAL_LOG = 3,            // MCU -> Away. Log line text.
+    SERIAL_HELLO = 4,          // Leader -> follower. uint32 highest baud the leader supports.
+    SERIAL_BAUD = 5,           // Follower -> leader. uint32 baud both switch to.
+    SERIAL_KEEPALIVE = 6,      // Either way, when nothing else was sent. No payload.
+    SERIAL_SAMPLES = 7,        // MCU -> GCS over UDP only. A sample_block.h block.
+    SERIAL_TRACED_COMMAND = 8, // Away/GCS -> MCU. uint16 radio (or GCS UDP) sequence, then "CMD:..." text.
+    SERIAL_COMMAND_RESULT = 9, // MCU -> Away. A CommandTiming (command_trace.h).
+    SERIAL_TIME_REQUEST = 10,  // Away/GCS -> MCU. uint32 origin_us (clock_sync.h).
+    SERIAL_TIME_REPLY = 11,    // MCU -> Away/GCS. A TimeSyncReply.
+    SERIAL_HEARTBEAT = 12,     // Away -> MCU. Lora Home was heard (MCU deadman.h). No payload.
+    SERIAL_COMMAND_ACK = 13    // MCU -> GCS over UDP only. uint16 sequence of a traced command it has.
+};
+
+// Longest payload. Fits a 160-byte log line and a telemetry frame.
+const size_t SERIAL_PACKET_MAX_PAYLOAD = 192;
+// Type + payload + CRC.
+const size_t SERIAL_PACKET_MAX_RAW = SERIAL_PACKET_MAX_PAYLOAD + 3;
+// Encoded packet including the 0x00 delimiter.
+const size_t SERIAL_PACKET_MAX_ENCODED = COBS_MAX_ENCODED(SERIAL_PACKET_MAX_RAW) + 1;
+
+struct SerialPacket
+{
+    SerialPacketType type;
+    uint8_t length;                                 // Payload bytes.
+    uint8_t payload[SERIAL_PACKET_MAX_PAYLOAD + 1]; // NUL-terminated for text packets.
+};
+
+/**
+ * @brief Builds one delimited packet.
+ *
+ * @param type
+ * @param payload
+ * @param length At most SERIAL_PACKET_MAX_PAYLOAD.
+ * @param out At least SERIAL_PACKET_MAX_ENCODED bytes.
+ * @return Bytes to write, or 0 if the payload is too long.
+ */
+inline size_t serial_packet_encode(SerialPacketType type, const void *payload, size_t length, uint8_t *out)
+{
+    if (length > SERIAL_PACKET_MAX_PAYLOAD)
+        return 0;
+
+    uint8_t raw[SERIAL_PACKET_MAX_RAW];
+    raw[0] = type;
+    if (length > 0)
+        memcpy(raw + 1, payload, length);
+    uint16_t crc = crc16(raw, length + 1);
+    raw[length + 1] = crc & 0xFF;
+    raw[length + 2] = crc >> 8;
+
+    size_t encoded = cobs_encode(raw, length + 3, out);
+    out[encoded++] = 0;
+    return encoded;
+}
+
+/**
+ * @brief Decodes one frame, delimiter stripped.
+ *
+ * @param frame Decoded in place.
+ * @param length
+ * @param packet
+ * @return false if the frame is malformed, too long or fails its CRC.
+ */
+inline bool serial_packet_decode(uint8_t *frame, size_t length, SerialPacket &packet)
+{
+    if (length > COBS_MAX_ENCODED(SERIAL_PACKET_MAX_RAW))
+        return false;
+
+    size_t raw_length = cobs_decode(frame, length, frame);
+    if (raw_length < 3 || raw_length - 3 > SERIAL_PACKET_MAX_PAYLOAD)
+        return false;
+
+    uint16_t crc = frame[raw_length - 2] | (uint16_t)frame[raw_length - 1] << 8;
+    if (crc != crc16(frame, raw_length - 2))
+        return false;
+
+    packet.type = (SerialPacketType)frame[0];
+    packet.length = raw_length - 3;
+    memcpy(packet.payload, frame + 1, packet.length);
+    packet.payload[packet.length] = '\0';
+    return true;
+}
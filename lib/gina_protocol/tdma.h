@@ -0,0 +1,278 @@
+/**
+ * @file tdma.h
+ * @brief Beacon-synchronised TDMA frame shared by the two radios.
+ *
+ * Home is the time master. Every frame starts with its beacon, which carries
+ * the slot lengths, so Away never needs its own copy of the schedule:
+ *
+ *   | BEACON (Home) | UPLINK (Home) | ACK (Away) | DOWNLINK (Away) |
+ *
+ * UPLINK carries commands, ACK carries Away's command ACKs and other control
+ * packets right after them (short RTT), DOWNLINK carries one telemetry batch.
+ * A packet may only start if its time on air plus TDMA_GUARD_MS fits in the
+ * rest of a slot its side owns, so the two half-duplex radios never talk over
+ * each other. Worst-case command latency is one frame plus the packet's time
+ * on air, and its ACK comes back in the same frame's ACK slot:
+ *
+ *   profile  frame    to Away (full / short command)   ACK back at Home
+ *   STANDBY  2237 ms  2.95 s / 2.52 s                  3.3 s
+ *   BURN      170 ms  0.21 s / 0.19 s                  0.25 s
+ *
+ * The downlink is sized for half a full batch: at STANDBY telemetry is
+ * already thinned to what fits, and a 255-byte downlink would stretch every
+ * frame, and so every command's wait, to 3040 ms. The uplink fits one
+ * full-length command or two short ones (~28 bytes, "CMD:V1:OPEN").
+ *
+ * Away derives the frame start from the beacon's RX-done time minus its
+ * airtime, and keeps transmitting on that clock for TDMA_SYNC_LOSS_FRAMES
+ * frames without a beacon; after that it stays silent until it hears one.
+ *
+ * The beacon also carries the PHY profile handshake (phy_profile.h) and
+ * Home's clock for time sync (clock_sync.h).
+ */
+#pragma once
+
+#include "crc16.h"
+#include "tx_queue.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t FRAME_BEACON = 0xA3;
+
+enum TdmaSlot : uint8_t
+{
+    TDMA_SLOT_BEACON,
+    TDMA_SLOT_UPLINK,
+    TDMA_SLOT_ACK,
+    TDMA_SLOT_DOWNLINK,
+    TDMA_SLOT_COUNT
+};
+
+enum TdmaRole : uint8_t
+{
+    TDMA_HOME, // Sends beacons and owns BEACON/UPLINK.
+    TDMA_AWAY  // Follows beacons and owns ACK/DOWNLINK.
+};
+
+// Radio turnaround plus clock error, at the end of every slot.
+const uint32_t TDMA_GUARD_MS = 10;
+// Away stops transmitting after this many frames without a beacon.
+const uint32_t TDMA_SYNC_LOSS_FRAMES = 4;
+
+// Packet budgets each slot is sized for.
+const size_t TDMA_UPLINK_BYTES = 96;    // One full-length command packet.
+const size_t TDMA_ACK_BYTES = 32;       // One ACK.
+const size_t TDMA_DOWNLINK_BYTES = 128; // Half a full telemetry batch; see above.
+
+struct __attribute__((packed)) TdmaBeacon
+{
+    uint8_t type;                      // FRAME_BEACON.
+    uint16_t frame;                    // Increments every frame, wraps.
+    uint16_t slot_ms[TDMA_SLOT_COUNT]; // Slot lengths, in frame order.
+    uint16_t tx_delay_us;              // Beacon TX start after the frame boundary.
+    uint8_t profile;                   // PhyProfileId in use.
+    uint8_t next_profile;              // Announced PhyProfileId; == profile if none.
+    uint16_t switch_frame;             // First frame on next_profile.
+    uint32_t timestamp_us;             // Home esp_timer time at TX start (clock_sync.h).
+    uint16_t crc;                      // crc16() of all preceding bytes.
+};
+
+inline void tdma_beacon_seal(TdmaBeacon &beacon)
+{
+    beacon.type = FRAME_BEACON;
+    beacon.crc = crc16((const uint8_t *)&beacon, offsetof(TdmaBeacon, crc));
+}
+
+inline bool tdma_beacon_valid(const uint8_t *data, size_t length)
+{
+    if (length != sizeof(TdmaBeacon) || data[0] != FRAME_BEACON)
+        return false;
+
+    uint16_t crc;
+    memcpy(&crc, data + offsetof(TdmaBeacon, crc), sizeof(crc));
+    return crc == crc16(data, offsetof(TdmaBeacon, crc));
+}
+
+struct TdmaSchedule
+{
+    uint16_t slot_ms[TDMA_SLOT_COUNT];
+
+    uint32_t frame_ms() const
+    {
+        uint32_t total = 0;
+        for (int slot = 0; slot < TDMA_SLOT_COUNT; slot++)
+            total += slot_ms[slot];
+        return total;
+    }
+};
+
+/**
+ * @brief Sizes every slot for its packet budget at the current PHY.
+ *
+ * @param airtime_us Time on air of each slot's budget, e.g. from the radio.
+ */
+inline TdmaSchedule tdma_schedule(const uint32_t airtime_us[TDMA_SLOT_COUNT])
+{
+    TdmaSchedule schedule;
+    for (int slot = 0; slot < TDMA_SLOT_COUNT; slot++)
+    {
+        uint32_t ms = (airtime_us[slot] + 999) / 1000 + TDMA_GUARD_MS;
+        schedule.slot_ms[slot] = ms > UINT16_MAX ? UINT16_MAX : ms;
+    }
+    return schedule;
+}
+
+/**
+ * @brief Side that owns a slot.
+ */
+inline TdmaRole tdma_slot_owner(TdmaSlot slot)
+{
+    return slot == TDMA_SLOT_BEACON || slot == TDMA_SLOT_UPLINK ? TDMA_HOME : TDMA_AWAY;
+}
+
+/**
+ * @brief TxPriority bitmask that may use an owned slot. The ACK slot is kept
+ * for control packets so ACKs never wait behind telemetry.
+ */
+inline uint8_t tdma_slot_priorities(TdmaSlot slot)
+{
+    switch (slot)
+    {
+    case TDMA_SLOT_UPLINK:
+    case TDMA_SLOT_DOWNLINK:
+        return 0xFF;
+    case TDMA_SLOT_ACK:
+        return 1 << TX_PRIORITY_CONTROL;
+    default:
+        return 0; // BEACON: the beacon only.
+    }
+}
+
+/**
+ * @brief Where in the frame "now" is, for either side.
+ */
+class TdmaClock
+{
+public:
+    /**
+     * @param role
+     * @param schedule Home's schedule. Away's is replaced by every beacon.
+     * @param now_us Home: the first frame starts here.
+     */
+    void begin(TdmaRole role, const TdmaSchedule &schedule, uint32_t now_us)
+    {
+        role_ = role;
+        schedule_ = schedule;
+        frame_start_us_ = now_us;
+        last_beacon_frame_ = frame_ = 0;
+        synced_ = role == TDMA_HOME;
+        beacon_sent_ = false;
+    }
+
+    /**
+     * @brief Replaces the schedule from the current frame on. Call at
+     * its start, e.g. right after a PHY change.
+     */
+    void set_schedule(const TdmaSchedule &schedule) { schedule_ = schedule; }
+
+    /**
+     * @brief Away: aligns to a received beacon.
+     *
+     * @param end_us RX-done time.
+     * @param airtime_us Beacon time on air.
+     */
+    void on_beacon(const TdmaBeacon &beacon, uint32_t end_us, uint32_t airtime_us)
+    {
+        if (role_ != TDMA_AWAY)
+            return;
+        memcpy(schedule_.slot_ms, beacon.slot_ms, sizeof(schedule_.slot_ms));
+        frame_start_us_ = end_us - airtime_us - beacon.tx_delay_us;
+        frame_ = last_beacon_frame_ = beacon.frame;
+        synced_ = true;
+    }
+
+    /**
+     * @brief Advances to the frame containing now_us and returns the slot.
+     *
+     * @param remaining_us Optional. Time left in the slot.
+     */
+    TdmaSlot slot(uint32_t now_us, uint32_t *remaining_us = NULL)
+    {
+        // A timestamp taken just before the last resync reads as frame start.
+        if ((int32_t)(now_us - frame_start_us_) < 0)
+            now_us = frame_start_us_;
+
+        uint32_t frame_us = schedule_.frame_ms() * 1000;
+        uint32_t elapsed_frames = frame_us > 0 ? (now_us - frame_start_us_) / frame_us : 0;
+        if (elapsed_frames > 0)
+        {
+            frame_start_us_ += elapsed_frames * frame_us;
+            frame_ += elapsed_frames;
+            beacon_sent_ = false;
+        }
+        if (role_ == TDMA_AWAY && (uint16_t)(frame_ - last_beacon_frame_) >= TDMA_SYNC_LOSS_FRAMES)
+            synced_ = false;
+
+        uint32_t offset_us = now_us - frame_start_us_;
+        uint32_t end_us = 0;
+        for (int slot = 0; slot < TDMA_SLOT_COUNT; slot++)
+        {
+            end_us += schedule_.slot_ms[slot] * 1000;
+            if (offset_us < end_us)
+            {
+                if (remaining_us)
+                    *remaining_us = end_us - offset_us;
+                return (TdmaSlot)slot;
+            }
+        }
+        if (remaining_us)
+            *remaining_us = 0;
+        return TDMA_SLOT_DOWNLINK;
+    }
+
+    /**
+     * @brief Home: true once per frame, during the beacon slot. Fills in the
+     * beacon's timing; the caller adds the PHY fields and seals it.
+     */
+    bool beacon_due(uint32_t now_us, TdmaBeacon &beacon)
+    {
+        if (role_ != TDMA_HOME || beacon_sent_ || slot(now_us) != TDMA_SLOT_BEACON)
+            return false;
+        beacon_sent_ = true;
+        beacon.frame = frame_;
+        memcpy(beacon.slot_ms, schedule_.slot_ms, sizeof(beacon.slot_ms));
+        uint32_t delay_us = now_us - frame_start_us_;
+        beacon.tx_delay_us = delay_us > UINT16_MAX ? UINT16_MAX : delay_us;
+        return true;
+    }
+
+    /**
+     * @brief Whether this side may start a packet now.
+     *
+     * @param remaining_us Time left in the slot, if it is ours.
+     * @return TxPriority bitmask allowed now; 0 if none.
+     */
+    uint8_t may_transmit(uint32_t now_us, uint32_t &remaining_us)
+    {
+        TdmaSlot current = slot(now_us, &remaining_us);
+        if (!synced_ || tdma_slot_owner(current) != role_)
+            return 0;
+        uint32_t guard_us = TDMA_GUARD_MS * 1000;
+        remaining_us = remaining_us > guard_us ? remaining_us - guard_us : 0;
+        return tdma_slot_priorities(current);
+    }
+
+    bool synced() const { return synced_; }
+    uint16_t frame() const { return frame_; }
+    const TdmaSchedule &schedule() const { return schedule_; }
+
+private:
+    TdmaRole role_ = TDMA_HOME;
+    TdmaSchedule schedule_ = {};
+    uint32_t frame_start_us_ = 0;
+    uint16_t frame_ = 0;
+    uint16_t last_beacon_frame_ = 0;
+    bool synced_ = false;
+    bool beacon_sent_ = false;
+};
@@ -0,0 +1,194 @@
+/**
+ * @file telemetry_batch.cpp
+ * @brief Delta-encoded telemetry batches.
+ */
+#include "telemetry_batch.h"
+#include <string.h>
+
+// Worst case per delta frame: five 5-byte varints plus status.
+static const size_t MAX_DELTA_BYTES = 5 * 5 + 1;
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t put_varint(uint8_t *out, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+/**
+ * @return false if the varint ran past end or is longer than 5 bytes.
+ */
+static bool get_varint(const uint8_t *&data, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (data >= end)
+            return false;
+        uint8_t byte = *data++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+TelemetryBatchEncoder::TelemetryBatchEncoder(size_t max_bytes)
+    : max_bytes_(max_bytes < TELEMETRY_BATCH_MAX_BYTES ? max_bytes : TELEMETRY_BATCH_MAX_BYTES)
+{
+    reset();
+}
+
+void TelemetryBatchEncoder::reset()
+{
+    buffer_[0] = FRAME_TELEMETRY_BATCH;
+    buffer_[1] = 0;
+    // ACK bytes are filled in by finish().
+    memset(buffer_ + 2, 0, TELEMETRY_BATCH_HEADER_BYTES - 2);
+    length_ = TELEMETRY_BATCH_HEADER_BYTES;
+    count_ = 0;
+    previous_interval_ = 0;
+}
+
+bool TelemetryBatchEncoder::add(const TelemetryFrame &frame)
+{
+    if (count_ >= TELEMETRY_BATCH_MAX_FRAMES)
+        return false;
+
+    uint8_t encoded[MAX_DELTA_BYTES];
+    size_t length = 0;
+    int32_t interval = 0;
+
+    if (count_ == 0)
+    {
+        // First frame in full, same field order as TelemetryFrame.
+        memcpy(encoded, (const uint8_t *)&frame + 1, TELEMETRY_BATCH_FIRST_BYTES);
+        length = TELEMETRY_BATCH_FIRST_BYTES;
+    }
+    else
+    {
+        interval = (int32_t)(frame.timestamp_us - previous_.timestamp_us);
+        length += put_varint(encoded + length, zigzag((int16_t)(frame.sequence - previous_.sequence - 1)));
+        length += put_varint(encoded + length, zigzag(interval - previous_interval_));
+        length += put_varint(encoded + length, zigzag(frame.fuel_psi_x10 - previous_.fuel_psi_x10));
+        length += put_varint(encoded + length, zigzag(frame.ox_psi_x10 - previous_.ox_psi_x10));
+        length += put_varint(encoded + length, zigzag(frame.load_g - previous_.load_g));
+        encoded[length++] = frame.status;
+    }
+
+    // Room for the CRC.
+    if (length_ + length + 2 > max_bytes_)
+        return false;
+
+    memcpy(buffer_ + length_, encoded, length);
+    length_ += length;
+    count_++;
+    buffer_[1] = (uint8_t)count_;
+    previous_ = frame;
+    previous_interval_ = interval;
+    return true;
+}
+
+size_t TelemetryBatchEncoder::add_latest(const TelemetryFrame *frames, size_t count)
+{
+    size_t start = count > TELEMETRY_BATCH_MAX_FRAMES ? count - TELEMETRY_BATCH_MAX_FRAMES : 0;
+    while (true)
+    {
+        reset();
+        size_t added = 0;
+        while (start + added < count && add(frames[start + added]))
+            added++;
+        if (start + added == count)
+            return added;
+        // Deltas differ a little from frame to frame: the last `added` frames
+        // nearly always fit, otherwise one fewer.
+        size_t next = count - added;
+        start = next > start ? next : start + 1;
+    }
+}
+
+size_t TelemetryBatchEncoder::finish(uint8_t *out, const CommandAck &ack)
+{
+    if (count_ == 0)
+        return 0;
+
+    buffer_[2] = ack.valid ? 1 : 0;
+    memcpy(buffer_ + 3, &ack.cumulative, sizeof(ack.cumulative));
+    memcpy(buffer_ + 5, &ack.mask, sizeof(ack.mask));
+
+    uint16_t crc = crc16(buffer_, length_);
+    memcpy(out, buffer_, length_);
+    memcpy(out + length_, &crc, sizeof(crc));
+    size_t length = length_ + sizeof(crc);
+    reset();
+    return length;
+}
+
+size_t telemetry_batch_decode(const uint8_t *data, size_t length, TelemetryFrame *out, size_t max_frames,
+                              CommandAck *ack)
+{
+    if (length < TELEMETRY_BATCH_MIN_BYTES || data[0] != FRAME_TELEMETRY_BATCH)
+        return 0;
+
+    uint16_t crc;
+    memcpy(&crc, data + length - sizeof(crc), sizeof(crc));
+    if (crc != crc16(data, length - sizeof(crc)))
+        return 0;
+
+    size_t count = data[1];
+    if (count == 0 || count > max_frames)
+        return 0;
+
+    if (ack)
+    {
+        ack->valid = data[2] & 1;
+        memcpy(&ack->cumulative, data + 3, sizeof(ack->cumulative));
+        memcpy(&ack->mask, data + 5, sizeof(ack->mask));
+    }
+
+    const uint8_t *cursor = data + TELEMETRY_BATCH_HEADER_BYTES;
+    const uint8_t *end = data + length - sizeof(crc);
+
+    TelemetryFrame frame;
+    memcpy((uint8_t *)&frame + 1, cursor, TELEMETRY_BATCH_FIRST_BYTES);
+    cursor += TELEMETRY_BATCH_FIRST_BYTES;
+    telemetry_frame_seal(frame);
+    out[0] = frame;
+
+    int32_t interval = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        uint32_t sequence, interval_delta, fuel, ox, load;
+        if (!get_varint(cursor, end, sequence) || !get_varint(cursor, end, interval_delta) ||
+            !get_varint(cursor, end, fuel) || !get_varint(cursor, end, ox) ||
+            !get_varint(cursor, end, load) || cursor >= end)
+            return 0;
+
+        interval += unzigzag(interval_delta);
+        frame.sequence += 1 + unzigzag(sequence);
+        frame.timestamp_us += interval;
+        frame.fuel_psi_x10 += unzigzag(fuel);
+        frame.ox_psi_x10 += unzigzag(ox);
+        frame.load_g += unzigzag(load);
+        frame.status = *cursor++;
+        telemetry_frame_seal(frame);
+        out[i] = frame;
+    }
+
+    return cursor == end ? count : 0;
+}
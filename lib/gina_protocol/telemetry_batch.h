@@ -0,0 +1,101 @@
+/**
+ * @file telemetry_batch.h
+ * @brief Several TelemetryFrames in one radio packet, delta-encoded.
+ *
+ * Layout: type (FRAME_TELEMETRY_BATCH), frame count, Away's command ACK
+ * (valid flag, cumulative and mask, see command_window.h), the first frame's
+ * fields in full, then for each following frame zigzag varints of
+ *   sequence delta - 1, timestamp delta-of-delta, fuel/ox/load deltas
+ * plus the raw status byte, then a CRC-16 over everything before it. At a
+ * steady rate most frames cost about 6 bytes instead of 18.
+ */
+#pragma once
+
+#include "command_window.h"
+#include "telemetry_frame.h"
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t FRAME_TELEMETRY_BATCH = 0xA2;
+
+// SX1262 maximum payload.
+const size_t TELEMETRY_BATCH_MAX_BYTES = 255;
+// Type, count and command ACK.
+const size_t TELEMETRY_BATCH_HEADER_BYTES = 2 + 5;
+// The first frame in full: every field but type and CRC.
+const size_t TELEMETRY_BATCH_FIRST_BYTES = offsetof(TelemetryFrame, crc) - 1;
+// Header, first frame in full and CRC.
+const size_t TELEMETRY_BATCH_MIN_BYTES = TELEMETRY_BATCH_HEADER_BYTES + TELEMETRY_BATCH_FIRST_BYTES + 2;
+// Small enough to fit a worst-case batch on the stack.
+const size_t TELEMETRY_BATCH_MAX_FRAMES = 64;
+
+class TelemetryBatchEncoder
+{
+public:
+    /**
+     * @param max_bytes Packet size limit, at most TELEMETRY_BATCH_MAX_BYTES.
+     */
+    explicit TelemetryBatchEncoder(size_t max_bytes = TELEMETRY_BATCH_MAX_BYTES);
+
+    void reset();
+
+    /**
+     * @brief Changes the packet size limit (e.g. to fit a TDMA slot). Takes
+     * effect for frames added after the call.
+     */
+    void set_max_bytes(size_t max_bytes)
+    {
+        max_bytes_ = max_bytes < TELEMETRY_BATCH_MAX_BYTES ? max_bytes : TELEMETRY_BATCH_MAX_BYTES;
+    }
+
+    /**
+     * @brief Appends a frame if the packet still fits.
+     *
+     * @return false if it would not fit; finish() the batch and add it again.
+     */
+    bool add(const TelemetryFrame &frame);
+
+    /**
+     * @brief Starts the batch over with the newest frames that fit, so a
+     * link slower than the telemetry drops the oldest instead of falling
+     * behind.
+     *
+     * @param frames Oldest first.
+     * @param count
+     * @return Number of frames added, from the end of frames.
+     */
+    size_t add_latest(const TelemetryFrame *frames, size_t count);
+
+    /**
+     * @brief Writes the packet (with CRC) and resets the encoder.
+     *
+     * @param out At least max_bytes long.
+     * @param ack Command ACK to piggyback.
+     * @return Packet length, 0 if the batch was empty.
+     */
+    size_t finish(uint8_t *out, const CommandAck &ack = CommandAck());
+
+    size_t count() const { return count_; }
+    size_t size() const { return length_ + 2; }
+
+private:
+    uint8_t buffer_[TELEMETRY_BATCH_MAX_BYTES];
+    size_t max_bytes_;
+    size_t length_;
+    size_t count_;
+    TelemetryFrame previous_;
+    int32_t previous_interval_;
+};
+
+/**
+ * @brief Decodes a batch packet back into frames (sealed, CRC filled in).
+ *
+ * @param data
+ * @param length
+ * @param out
+ * @param max_frames
+ * @param ack Optional. Receives the piggybacked command ACK.
+ * @return Number of frames decoded, 0 if the packet is not a valid batch.
+ */
+size_t telemetry_batch_decode(const uint8_t *data, size_t length, TelemetryFrame *out, size_t max_frames,
+                              CommandAck *ack = NULL);
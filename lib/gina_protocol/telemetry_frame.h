@@ -0,0 +1,81 @@
+/**
+ * @file telemetry_frame.h
+ * @brief Fixed-layout binary telemetry frame, used end to end:
+ * MCU -> Serial2 -> Lora Away -> LoRa -> Lora Home -> GCS.
+ *
+ * Little-endian, packed, CRC-16 over every byte before the CRC. The type byte
+ * is outside the ASCII range so frames can share a link with text lines
+ * ("DC=..." packets, log messages). Home forwards frames to the GCS as
+ * "TLM:<hex>" lines; GCS/telemetry.py must be kept in sync with this file.
+ */
+#pragma once
+
+#include "crc16.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t FRAME_TELEMETRY = 0xA1;
+
+// Status bits.
+const uint8_t STATUS_FIRING = 1 << 0;         // Igniter relay on / burn in progress.
+const uint8_t STATUS_RECORDING = 1 << 1;      // Flash recorder running.
+const uint8_t STATUS_LOAD_STALE = 1 << 2;     // No load cell conversion this interval.
+const uint8_t STATUS_REDLINE = 1 << 3;        // An onboard redline tripped; IGN refused.
+const uint8_t STATUS_PRESSURE_STALE = 1 << 4; // No new PT sample; pressures repeat.
+const uint8_t STATUS_UDP_LINK = 1 << 5;       // The GCS is also reachable over WiFi/UDP.
+
+struct __attribute__((packed)) TelemetryFrame
+{
+    uint8_t type;          // FRAME_TELEMETRY.
+    uint16_t sequence;     // Increments every frame, wraps.
+    uint32_t timestamp_us; // MCU esp_timer time at the end of the interval.
+    int16_t fuel_psi_x10;  // 0.1 psi.
+    int16_t ox_psi_x10;    // 0.1 psi.
+    int32_t load_g;        // Grams.
+    uint8_t status;        // STATUS_* bits.
+    uint16_t crc;          // crc16() of all preceding bytes.
+};
+
+static_assert(sizeof(TelemetryFrame) == 18, "TelemetryFrame layout changed.");
+
+/**
+ * @brief Fills in the type and CRC.
+ *
+ * @param frame
+ */
+inline void telemetry_frame_seal(TelemetryFrame &frame)
+{
+    frame.type = FRAME_TELEMETRY;
+    frame.crc = crc16((const uint8_t *)&frame, offsetof(TelemetryFrame, crc));
+}
+
+/**
+ * @brief Checks that a buffer holds exactly one valid frame.
+ *
+ * @param data
+ * @param length
+ * @return true if type, length and CRC match.
+ */
+inline bool telemetry_frame_valid(const uint8_t *data, size_t length)
+{
+    if (length != sizeof(TelemetryFrame) || data[0] != FRAME_TELEMETRY)
+        return false;
+
+    uint16_t crc;
+    memcpy(&crc, data + offsetof(TelemetryFrame, crc), sizeof(crc));
+    return crc == crc16(data, offsetof(TelemetryFrame, crc));
+}
+
+/**
+ * @brief Saturating conversion for fixed-point channels.
+ */
+inline int16_t telemetry_fixed16(float value, float scale)
+{
+    float scaled = value * scale;
+    if (scaled > INT16_MAX)
+        return INT16_MAX;
+    if (scaled < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file telemetry_stats.h
+ * @brief Receive-side telemetry accounting: delivered, lost and corrupted
+ * frames, frame rate and signal quality.
+ *
+ * Losses come from gaps in TelemetryFrame::sequence, so they include frames
+ * dropped anywhere upstream (MCU queue, Serial2, Away's TX queue, the air),
+ * not only at the radio. An MCU reboot restarts both sequence and timestamp;
+ * it is counted as a reset, not as 65k lost frames.
+ */
+#pragma once
+
+#include "telemetry_frame.h"
+#include <stdint.h>
+
+// A frame at most this far behind the expected sequence is late or repeated.
+// Further back with an earlier MCU timestamp, the MCU rebooted.
+const int16_t TELEMETRY_REORDER_WINDOW = 32;
+
+/**
+ * @brief One reporting interval; all zero if nothing was received.
+ */
+struct TelemetryWindow
+{
+    float frame_rate_hz; // Telemetry frames delivered.
+    float rssi_dbm;      // Mean over every packet.
+    float snr_db;
+    float min_rssi_dbm;
+    float min_snr_db;
+};
+
+class TelemetryStats
+{
+public:
+    /**
+     * @brief Counts a frame that passed its CRC.
+     *
+     * @return false if it is a duplicate or arrived out of order (already
+     * counted as lost).
+     */
+    bool frame(const TelemetryFrame &frame)
+    {
+        if (received_ > 0)
+        {
+            int16_t gap = (int16_t)(uint16_t)(frame.sequence - expected_);
+            int32_t elapsed_us = (int32_t)(frame.timestamp_us - last_timestamp_us_);
+            if (gap < 0 && (gap >= -TELEMETRY_REORDER_WINDOW || elapsed_us >= 0))
+            {
+                late_++;
+                return false;
+            }
+            else if (gap < 0)
+            {
+                resets_++;
+            }
+            else
+            {
+                lost_ += gap;
+            }
+        }
+
+        received_++;
+        window_frames_++;
+        expected_ = frame.sequence + 1;
+        last_timestamp_us_ = frame.timestamp_us;
+        return true;
+    }
+
+    /**
+     * @brief Counts a frame or batch that failed its CRC after the radio's
+     * own check passed.
+     */
+    void crc_failed() { crc_failures_++; }
+
+    /**
+     * @brief Adds the signal of any received packet to the current window.
+     */
+    void signal(float rssi_dbm, float snr_db)
+    {
+        if (window_packets_ == 0 || rssi_dbm < min_rssi_dbm_)
+            min_rssi_dbm_ = rssi_dbm;
+        if (window_packets_ == 0 || snr_db < min_snr_db_)
+            min_snr_db_ = snr_db;
+        rssi_sum_ += rssi_dbm;
+        snr_sum_ += snr_db;
+        window_packets_++;
+    }
+
+    /**
+     * @brief Ends the current reporting window and returns its averages.
+     *
+     * @param elapsed_ms Length of the window.
+     */
+    TelemetryWindow take_window(uint32_t elapsed_ms)
+    {
+        TelemetryWindow window = {};
+        if (elapsed_ms > 0)
+            window.frame_rate_hz = window_frames_ * 1000.0f / elapsed_ms;
+        if (window_packets_ > 0)
+        {
+            window.rssi_dbm = rssi_sum_ / window_packets_;
+            window.snr_db = snr_sum_ / window_packets_;
+            window.min_rssi_dbm = min_rssi_dbm_;
+            window.min_snr_db = min_snr_db_;
+        }
+        window_frames_ = window_packets_ = 0;
+        rssi_sum_ = snr_sum_ = 0;
+        return window;
+    }
+
+    uint32_t received() const { return received_; }
+    uint32_t lost() const { return lost_; }
+    uint32_t late() const { return late_; }
+    uint32_t crc_failures() const { return crc_failures_; }
+    uint32_t resets() const { return resets_; }
+
+    /**
+     * @brief Lost / (received + lost), 0..1.
+     */
+    float loss_ratio() const
+    {
+        uint32_t expected = received_ + lost_;
+        return expected ? (float)lost_ / expected : 0;
+    }
+
+private:
+    uint32_t received_ = 0;
+    uint32_t lost_ = 0;
+    uint32_t late_ = 0;
+    uint32_t crc_failures_ = 0;
+    uint32_t resets_ = 0;
+    uint16_t expected_ = 0;
+    uint32_t last_timestamp_us_ = 0;
+
+    uint32_t window_frames_ = 0;
+    uint32_t window_packets_ = 0;
+    float rssi_sum_ = 0;
+    float snr_sum_ = 0;
+    float min_rssi_dbm_ = 0;
+    float min_snr_db_ = 0;
+};
@@ -0,0 +1,162 @@
+/**
+ * @file tx_queue.h
+ * @brief Fixed-capacity priority queue of outgoing radio packets.
+ *
+ * Higher priorities always go first; within a priority, packets leave in the
+ * order they were queued. Each packet may carry a not-before time, so repeats
+ * (e.g. ACKs) are scheduled instead of slept through. When full, a new packet
+ * evicts the oldest packet of strictly lower priority, if any. replace()
+ * keeps only the newest of a kind waiting, e.g. one telemetry batch however
+ * far the downlink falls behind.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum TxPriority : uint8_t
+{
+    TX_PRIORITY_TELEMETRY = 0, // Telemetry and pings. First to be evicted.
+    TX_PRIORITY_COMMAND = 1,   // Valve/sequence commands.
+    TX_PRIORITY_CONTROL = 2    // ACKs and aborts.
+};
+
+const size_t TX_PACKET_MAX_BYTES = 255;
+
+struct TxPacket
+{
+    uint8_t data[TX_PACKET_MAX_BYTES];
+    uint8_t length;
+    TxPriority priority;
+    uint32_t due_ms; // Not sent before this time.
+    uint32_t order;  // Queue order, for FIFO within a priority.
+};
+
+template <size_t N>
+class TxQueue
+{
+public:
+    /**
+     * @brief Queues a packet.
+     *
+     * @param data
+     * @param length At most TX_PACKET_MAX_BYTES.
+     * @param priority
+     * @param due_ms Earliest send time (same clock as pop()'s now_ms).
+     * @return false if the packet was too long or no slot could be freed.
+     */
+    bool push(const uint8_t *data, size_t length, TxPriority priority, uint32_t due_ms)
+    {
+        if (length == 0 || length > TX_PACKET_MAX_BYTES)
+            return false;
+
+        int slot = -1;
+        if (count_ < N)
+        {
+            slot = count_++;
+        }
+        else
+        {
+            // Evict the oldest, lowest-priority packet below this priority.
+            for (size_t i = 0; i < N; i++)
+            {
+                if (packets_[i].priority >= priority)
+                    continue;
+                if (slot < 0 || packets_[i].priority < packets_[slot].priority ||
+                    (packets_[i].priority == packets_[slot].priority && before(packets_[i].order, packets_[slot].order)))
+                    slot = i;
+            }
+            if (slot < 0)
+                return false;
+            dropped_++;
+        }
+
+        TxPacket &packet = packets_[slot];
+        memcpy(packet.data, data, length);
+        packet.length = length;
+        packet.priority = priority;
+        packet.due_ms = due_ms;
+        packet.order = next_order_++;
+        return true;
+    }
+
+    /**
+     * @brief Queues a packet in place of a queued one with the same priority
+     * and first byte (frame type), which keeps its place in line. Otherwise
+     * as push().
+     */
+    bool replace(const uint8_t *data, size_t length, TxPriority priority, uint32_t due_ms)
+    {
+        int slot = find(priority, length > 0 ? data[0] : 0);
+        if (slot < 0 || length == 0 || length > TX_PACKET_MAX_BYTES)
+            return push(data, length, priority, due_ms);
+
+        TxPacket &packet = packets_[slot];
+        memcpy(packet.data, data, length);
+        packet.length = length;
+        packet.due_ms = due_ms;
+        superseded_++;
+        return true;
+    }
+
+    /**
+     * @brief Removes the next packet that is due.
+     *
+     * @param now_ms
+     * @param out
+     * @param priorities Bitmask (1 << TxPriority) of priorities that may go.
+     * @param max_length Longer packets wait (e.g. for a longer TDMA slot).
+     * @return false if nothing is due.
+     */
+    bool pop(uint32_t now_ms, TxPacket &out, uint8_t priorities = 0xFF, size_t max_length = TX_PACKET_MAX_BYTES)
+    {
+        int best = -1;
+        for (size_t i = 0; i < count_; i++)
+        {
+            if ((int32_t)(now_ms - packets_[i].due_ms) < 0)
+                continue;
+            if (!(priorities & (1 << packets_[i].priority)) || packets_[i].length > max_length)
+                continue;
+            if (best < 0 || packets_[i].priority > packets_[best].priority ||
+                (packets_[i].priority == packets_[best].priority && before(packets_[i].order, packets_[best].order)))
+                best = i;
+        }
+        if (best < 0)
+            return false;
+
+        out = packets_[best];
+        packets_[best] = packets_[--count_];
+        return true;
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    /**
+     * @brief Packets evicted to make room for higher priorities.
+     */
+    uint32_t dropped() const { return dropped_; }
+
+    /**
+     * @brief Packets overwritten by replace() before they went out.
+     */
+    uint32_t superseded() const { return superseded_; }
+
+private:
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    int find(TxPriority priority, uint8_t type) const
+    {
+        for (size_t i = 0; i < count_; i++)
+            if (packets_[i].priority == priority && packets_[i].data[0] == type)
+                return i;
+        return -1;
+    }
+
+    TxPacket packets_[N];
+    size_t count_ = 0;
+    uint32_t next_order_ = 0;
+    uint32_t dropped_ = 0;
+    uint32_t superseded_ = 0;
+};
@@ -0,0 +1,448 @@
+/**
+ * @file radio_link.cpp
+ * @brief Non-blocking SX1262 packet link.
+ */
+#include "radio_link.h"
+#include <esp_timer.h>
+#include <profiler.h>
+
+static const uint32_t RADIO_TASK_STACK = 4096;
+static const UBaseType_t RADIO_TASK_PRIORITY = configMAX_PRIORITIES - 2;
+
+// Only one radio per board.
+static TaskHandle_t radio_task_handle = NULL;
+static volatile uint32_t irq_us = 0;
+
+static ProfileSection profile_isr("radio_isr");
+static ProfileSection profile_irq("radio_irq");
+static ProfileSection profile_service("radio_service");
+
+void IRAM_ATTR RadioLink::on_dio1()
+{
+    ProfileScope scope(profile_isr);
+    irq_us = (uint32_t)esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(radio_task_handle, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+void RadioLink::radio_task(void *arg)
+{
+    RadioLink *link = (RadioLink *)arg;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        link->handle_irq();
+    }
+}
+
+RadioLink::RadioLink(SX1262 &radio) : radio_(radio)
+{
+}
+
+int RadioLink::begin(TdmaRole role)
+{
+    mutex_ = xSemaphoreCreateMutex();
+    role_ = role;
+
+    int state = apply_profile(PHY_STANDBY);
+    if (state != RADIOLIB_ERR_NONE)
+        return state;
+    last_rx_us_ = (uint32_t)esp_timer_get_time();
+    tdma_.begin(role, tdma_.schedule(), last_rx_us_);
+
+    // Same core as loop(), but preempts it as soon as DIO1 fires.
+    xTaskCreatePinnedToCore(radio_task, "radio", RADIO_TASK_STACK, this, RADIO_TASK_PRIORITY,
+                            &radio_task_handle, ARDUINO_RUNNING_CORE);
+
+    radio_.setDio1Action(on_dio1);
+    return radio_.startReceive();
+}
+
+int RadioLink::apply_profile(PhyProfileId profile)
+{
+    const PhyProfile &phy = PHY_PROFILES[profile];
+
+    // Modulation only changes in standby; a packet in flight is lost.
+    radio_.standby();
+    transmitting_ = false;
+    int state = radio_.setBandwidth(phy.bandwidth_khz);
+    if (state == RADIOLIB_ERR_NONE)
+        state = radio_.setSpreadingFactor(phy.spreading_factor);
+    if (state == RADIOLIB_ERR_NONE)
+        state = radio_.setCodingRate(phy.coding_rate);
+    if (state != RADIOLIB_ERR_NONE)
+        return state;
+    profile_ = profile;
+
+    // Slot lengths follow from the PHY; the table keeps getTimeOnAir() out
+    // of service().
+    for (size_t length = 0; length <= TX_PACKET_MAX_BYTES; length++)
+        airtime_us_[length] = radio_.getTimeOnAir(length);
+    uint32_t budgets_us[TDMA_SLOT_COUNT];
+    budgets_us[TDMA_SLOT_BEACON] = airtime_us(sizeof(TdmaBeacon));
+    budgets_us[TDMA_SLOT_UPLINK] = airtime_us(TDMA_UPLINK_BYTES);
+    budgets_us[TDMA_SLOT_ACK] = airtime_us(TDMA_ACK_BYTES);
+    budgets_us[TDMA_SLOT_DOWNLINK] = airtime_us(TDMA_DOWNLINK_BYTES);
+    // Away computes the same schedule Home will announce in the next beacon.
+    tdma_.set_schedule(tdma_schedule(budgets_us));
+    return RADIOLIB_ERR_NONE;
+}
+
+void RadioLink::update_profile(uint32_t now_us)
+{
+    // Advances the frame counter to now.
+    tdma_.slot(now_us);
+
+    PhyProfileId target = profile_;
+    if (switch_pending_ && (int16_t)(uint16_t)(tdma_.frame() - switch_frame_) >= 0)
+    {
+        switch_pending_ = false;
+        if (!switch_ready_)
+            return;
+        target = next_profile_;
+        stats_.phy_switches++;
+    }
+    else if (profile_ != PHY_STANDBY && now_us - last_rx_us_ >= PHY_FALLBACK_MS * 1000)
+    {
+        // The other side is gone or switched without us; it falls back too.
+        switch_pending_ = false;
+        target = PHY_STANDBY;
+        stats_.phy_fallbacks++;
+    }
+    else
+    {
+        return;
+    }
+
+    int state = apply_profile(target);
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.print(F("PHY change failed, code "));
+        Serial.println(state);
+        apply_profile(PHY_STANDBY);
+    }
+    // Gives the new PHY a full fallback period.
+    last_rx_us_ = now_us;
+    radio_.startReceive();
+}
+
+bool RadioLink::request_profile(PhyProfileId profile)
+{
+    if (role_ != TDMA_HOME || profile >= PHY_PROFILE_COUNT)
+        return false;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool accepted = !switch_pending_ && profile != profile_;
+    if (accepted)
+    {
+        // This frame's beacon may be gone already; the next ones announce.
+        tdma_.slot((uint32_t)esp_timer_get_time());
+        switch_pending_ = true;
+        switch_ready_ = false;
+        next_profile_ = profile;
+        switch_frame_ = tdma_.frame() + PHY_SWITCH_LEAD_FRAMES + 1;
+    }
+    xSemaphoreGive(mutex_);
+    return accepted;
+}
+
+void RadioLink::on_beacon_profile(const TdmaBeacon &beacon)
+{
+    if (beacon.next_profile == profile_ || beacon.next_profile >= PHY_PROFILE_COUNT)
+    {
+        // Nothing announced, or Home withdrew it.
+        switch_pending_ = false;
+        // Something for Home's fallback timer to hear when there is no
+        // telemetry.
+        if (profile_ != PHY_STANDBY)
+            send_phy_ack(profile_, beacon.frame);
+        return;
+    }
+
+    switch_pending_ = true;
+    next_profile_ = (PhyProfileId)beacon.next_profile;
+    switch_frame_ = beacon.switch_frame;
+    // Home keeps the announcement in the last beacon before the switch only
+    // if it has our PhyAck.
+    switch_ready_ = (uint16_t)(beacon.switch_frame - 1) == beacon.frame;
+    if (!switch_ready_)
+        send_phy_ack(next_profile_, switch_frame_);
+}
+
+void RadioLink::send_phy_ack(PhyProfileId profile, uint16_t switch_frame)
+{
+    PhyAck ack;
+    ack.profile = profile;
+    ack.switch_frame = switch_frame;
+    phy_ack_seal(ack);
+    if (!tx_queue_.push((const uint8_t *)&ack, sizeof(ack), TX_PRIORITY_CONTROL, millis()))
+        stats_.tx_dropped++;
+}
+
+void RadioLink::on_beacon_time(const TdmaBeacon &beacon, uint32_t start_us)
+{
+    if (start_us - last_time_sync_us_ < CLOCK_SYNC_INTERVAL_MS * 1000)
+        return;
+    last_time_sync_us_ = start_us;
+
+    TimeSyncFrame frame;
+    frame.origin_us = beacon.timestamp_us;
+    frame.receive_us = start_us;
+    frame.transmit_us = 0; // Stamped by service().
+    frame.reference_offset_us = reference_offset_us_;
+    frame.reference_synced = reference_synced_;
+    time_sync_frame_seal(frame);
+    if (tx_queue_.push((const uint8_t *)&frame, sizeof(frame), TX_PRIORITY_CONTROL, millis()))
+        stats_.time_syncs++;
+    else
+        stats_.tx_dropped++;
+}
+
+void RadioLink::on_time_sync(const TimeSyncFrame &frame, uint32_t start_us)
+{
+    if (clock_.add(frame.origin_us, frame.receive_us, frame.transmit_us, start_us))
+        stats_.time_syncs++;
+    reference_offset_us_ = frame.reference_offset_us;
+    reference_synced_ = frame.reference_synced;
+}
+
+void RadioLink::handle_irq()
+{
+    // Includes waiting for the mutex, i.e. for service() on the other side.
+    ProfileScope scope(profile_irq);
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    uint32_t flags = radio_.getIrqFlags();
+    if (flags & RADIOLIB_SX126X_IRQ_TX_DONE)
+    {
+        radio_.finishTransmit();
+        transmitting_ = false;
+        stats_.tx_sent++;
+        // Begin receiving again. NOTE: DO NOT REMOVE.
+        radio_.startReceive();
+    }
+    else if (flags & RADIOLIB_SX126X_IRQ_RX_DONE)
+    {
+        RxPacket packet;
+        packet.arrival_us = irq_us;
+        packet.length = radio_.getPacketLength();
+        int state = radio_.readData(packet.data, packet.length);
+        packet.data[packet.length] = '\0';
+        packet.rssi = radio_.getRSSI();
+        packet.snr = radio_.getSNR();
+
+        if (state == RADIOLIB_ERR_NONE)
+        {
+            stats_.received++;
+            last_rx_us_ = packet.arrival_us;
+            if (tdma_beacon_valid(packet.data, packet.length))
+            {
+                TdmaBeacon beacon;
+                memcpy(&beacon, packet.data, sizeof(beacon));
+                tdma_.on_beacon(beacon, packet.arrival_us, airtime_us(sizeof(TdmaBeacon)));
+                if (role_ == TDMA_AWAY)
+                {
+                    on_beacon_profile(beacon);
+                    on_beacon_time(beacon, packet.arrival_us - airtime_us(sizeof(TdmaBeacon)));
+                }
+                stats_.beacons++;
+            }
+            else if (role_ == TDMA_HOME && time_sync_frame_valid(packet.data, packet.length))
+            {
+                TimeSyncFrame frame;
+                memcpy(&frame, packet.data, sizeof(frame));
+                on_time_sync(frame, packet.arrival_us - airtime_us(sizeof(TimeSyncFrame)));
+            }
+            else if (phy_ack_valid(packet.data, packet.length))
+            {
+                PhyAck ack;
+                memcpy(&ack, packet.data, sizeof(ack));
+                if (role_ == TDMA_HOME && switch_pending_ && ack.profile == next_profile_ &&
+                    ack.switch_frame == switch_frame_)
+                    switch_ready_ = true;
+            }
+            if (!rx_queue_.push(packet))
+                stats_.rx_dropped++;
+        }
+        else if (state == RADIOLIB_ERR_CRC_MISMATCH)
+        {
+            stats_.crc_errors++;
+        }
+    }
+    else
+    {
+        // Header error, RX timeout or a CRC error without RX_DONE. Nothing
+        // above clears them, and DIO1 would stay high: the ISR only sees
+        // rising edges, so reception would stop for good.
+        if (flags != 0)
+            stats_.rx_errors++;
+        radio_.clearIrqFlags(RADIOLIB_SX126X_IRQ_ALL);
+        radio_.startReceive();
+    }
+
+    xSemaphoreGive(mutex_);
+}
+
+bool RadioLink::send(const uint8_t *data, size_t length, TxPriority priority, uint32_t delay_ms)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool queued = tx_queue_.push(data, length, priority, millis() + delay_ms);
+    if (!queued)
+        stats_.tx_dropped++;
+    xSemaphoreGive(mutex_);
+
+    if (!queued)
+        Serial.println(F("TX queue full or packet too long, dropped."));
+    return queued;
+}
+
+bool RadioLink::send(const String &packet, TxPriority priority, uint32_t delay_ms)
+{
+    return send((const uint8_t *)packet.c_str(), packet.length(), priority, delay_ms);
+}
+
+bool RadioLink::send_latest(const uint8_t *data, size_t length, TxPriority priority)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool queued = tx_queue_.replace(data, length, priority, millis());
+    if (!queued)
+        stats_.tx_dropped++;
+    xSemaphoreGive(mutex_);
+
+    if (!queued)
+        Serial.println(F("TX queue full or packet too long, dropped."));
+    return queued;
+}
+
+void RadioLink::service()
+{
+    ProfileScope scope(profile_service);
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    update_profile(now_us);
+
+    TdmaBeacon beacon;
+    TxPacket packet;
+    bool ready = false;
+    bool is_beacon = false;
+    bool started = false;
+    // The beacon goes first in its slot; anything else must fit what is left
+    // of a slot this side owns.
+    if (!transmitting_ && tdma_.beacon_due(now_us, beacon))
+    {
+        // The last beacon before a switch withdraws it unless Away agreed.
+        if (switch_pending_ && !switch_ready_ && (uint16_t)(switch_frame_ - 1) == beacon.frame)
+            switch_pending_ = false;
+        beacon.profile = profile_;
+        beacon.next_profile = switch_pending_ ? next_profile_ : profile_;
+        beacon.switch_frame = switch_frame_;
+        beacon.timestamp_us = now_us;
+        tdma_beacon_seal(beacon);
+        memcpy(packet.data, &beacon, sizeof(beacon));
+        packet.length = sizeof(beacon);
+        ready = true;
+        is_beacon = true;
+        stats_.beacons++;
+    }
+    else if (!transmitting_)
+    {
+        uint32_t remaining_us;
+        uint8_t priorities = tdma_.may_transmit(now_us, remaining_us);
+        ready = priorities && tx_queue_.pop(millis(), packet, priorities, fitting_length(remaining_us));
+        if (ready)
+            time_sync_frame_stamp(packet.data, packet.length, now_us);
+    }
+
+    if (ready)
+    {
+        int state = radio_.startTransmit(packet.data, packet.length);
+        if (state == RADIOLIB_ERR_NONE)
+        {
+            transmitting_ = true;
+            started = !is_beacon;
+        }
+        else
+        {
+            Serial.print(F("Failed transmission, code "));
+            Serial.println(state);
+            stats_.tx_dropped++;
+            radio_.startReceive();
+        }
+    }
+    xSemaphoreGive(mutex_);
+
+    if (started && on_transmit_)
+        on_transmit_(packet.data, packet.length, now_us);
+}
+
+bool RadioLink::receive(RxPacket &packet)
+{
+    return rx_queue_.pop(packet);
+}
+
+size_t RadioLink::fitting_length(uint32_t duration_us) const
+{
+    // Time on air grows with length.
+    size_t low = 0;
+    size_t high = TX_PACKET_MAX_BYTES;
+    while (low < high)
+    {
+        size_t middle = (low + high + 1) / 2;
+        if (airtime_us_[middle] <= duration_us)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+size_t RadioLink::slot_capacity(TdmaSlot slot) const
+{
+    uint32_t slot_us = (uint32_t)tdma_.schedule().slot_ms[slot] * 1000;
+    uint32_t guard_us = TDMA_GUARD_MS * 1000;
+    return fitting_length(slot_us > guard_us ? slot_us - guard_us : 0);
+}
+
+TdmaSlot RadioLink::slot()
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    TdmaSlot current = tdma_.slot((uint32_t)esp_timer_get_time());
+    xSemaphoreGive(mutex_);
+    return current;
+}
+
+RadioLinkStats RadioLink::stats() const
+{
+    RadioLinkStats stats = stats_;
+    stats.tx_dropped += tx_queue_.dropped();
+    stats.tx_superseded = tx_queue_.superseded();
+    return stats;
+}
+
+void RadioLink::set_reference(uint32_t offset_us, bool synced)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    reference_offset_us_ = offset_us;
+    reference_synced_ = synced;
+    xSemaphoreGive(mutex_);
+}
+
+bool RadioLink::to_reference(uint32_t local_us, uint32_t &reference_us) const
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool synced = reference_synced_ && (role_ == TDMA_AWAY || clock_.synced());
+    uint32_t away_us = role_ == TDMA_AWAY ? local_us : clock_.to_remote(local_us);
+    reference_us = away_us + reference_offset_us_;
+    xSemaphoreGive(mutex_);
+    return synced;
+}
+
+ClockSync RadioLink::clock() const
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    ClockSync clock = clock_;
+    xSemaphoreGive(mutex_);
+    return clock;
+}
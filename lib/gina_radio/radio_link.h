@@ -0,0 +1,214 @@
+/**
+ * @file radio_link.h
+ * @brief Non-blocking SX1262 packet link shared by Lora Home and Lora Away.
+ *
+ * Outgoing packets go through a TxQueue and are sent with startTransmit().
+ * Every DIO1 interrupt wakes a high-priority radio task that reads the IRQ
+ * flags: TX-done returns the radio to receive, RX-done copies the packet,
+ * RSSI, SNR and arrival time into an RX queue at once, so back-to-back packets
+ * are not overwritten in the radio's single buffer. loop() only drains the RX
+ * queue and calls service().
+ *
+ * Transmissions follow the TDMA frame in tdma.h: service() only starts a
+ * packet whose time on air fits in a slot this side owns, and Home sends the
+ * beacon itself. Beacons are also handed to loop() as ordinary packets.
+ *
+ * The link owns the PHY profile (phy_profile.h): Home picks one with
+ * request_profile(), the beacon announces it, and both sides switch at the
+ * same frame boundary, recomputing airtime and slot lengths. PhyAcks reach
+ * loop() like beacons, for their RSSI/SNR.
+ *
+ * Time sync (clock_sync.h) also runs inside the link: each beacon carries
+ * Home's TX start time, and Away answers one beacon per
+ * CLOCK_SYNC_INTERVAL_MS with a TimeSyncFrame that service() stamps as it
+ * goes on air. Home chains Away's clock with the MCU offset Away reports,
+ * so to_reference() gives MCU time on either board. Both sides take RX
+ * times as RX-done minus time on air, i.e. the start of the packet.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <RadioLib.h>
+#include <clock_sync.h>
+#include <phy_profile.h>
+#include <ring_buffer.h>
+#include <tdma.h>
+#include <tx_queue.h>
+
+// Slots in the TX queue.
+const size_t RADIO_TX_QUEUE_LENGTH = 8;
+// Packets buffered between the radio task and loop().
+const size_t RADIO_RX_QUEUE_LENGTH = 8;
+
+struct RxPacket
+{
+    uint8_t data[RADIOLIB_SX126X_MAX_PACKET_LENGTH + 1]; // NUL-terminated for text packets.
+    uint8_t length;
+    float rssi;          // dBm.
+    float snr;           // dB.
+    uint32_t arrival_us; // esp_timer time of the RX-done interrupt.
+};
+
+/**
+ * @brief Called from service() when a packet (not a beacon) has started on
+ * the air, outside the link's lock.
+ */
+typedef void (*RadioTransmitCallback)(const uint8_t *data, size_t length, uint32_t start_us);
+
+struct RadioLinkStats
+{
+    uint32_t received;      // Packets read without error.
+    uint32_t crc_errors;    // Packets that failed the radio's CRC.
+    uint32_t rx_errors;     // Header errors and RX timeouts, cleared and restarted.
+    uint32_t rx_dropped;    // Good packets lost because the RX queue was full.
+    uint32_t tx_sent;       // Packets transmitted.
+    uint32_t tx_dropped;    // Packets rejected or evicted from the TX queue.
+    uint32_t tx_superseded; // Packets replaced by newer ones before they went out.
+    uint32_t beacons;       // Beacons sent (Home) or received (Away).
+    uint32_t phy_switches;  // Coordinated profile changes.
+    uint32_t phy_fallbacks; // Drops to PHY_STANDBY after silence.
+    uint32_t time_syncs;    // TimeSyncFrames sent (Away) or used (Home).
+};
+
+class RadioLink
+{
+public:
+    explicit RadioLink(SX1262 &radio);
+
+    /**
+     * @brief Applies PHY_STANDBY, starts the radio task, installs the DIO1
+     * handler and starts receiving. Call after radio.begin() and
+     * setFrequency().
+     *
+     * @param role Home sizes the TDMA schedule and sends beacons; Away follows.
+     * @return RadioLib status code.
+     */
+    int begin(TdmaRole role);
+
+    /**
+     * @brief Home: announces a switch to profile, PHY_SWITCH_LEAD_FRAMES
+     * frames ahead. It only happens if Away acknowledges in time.
+     *
+     * @return false if it is already in use, a switch is pending or this is
+     * Away.
+     */
+    bool request_profile(PhyProfileId profile);
+
+    /**
+     * @brief Queues a packet.
+     *
+     * @param data
+     * @param length
+     * @param priority
+     * @param delay_ms Earliest send time, relative to now.
+     * @return false if the packet was dropped (too long or queue full).
+     */
+    bool send(const uint8_t *data, size_t length, TxPriority priority, uint32_t delay_ms = 0);
+    bool send(const String &packet, TxPriority priority, uint32_t delay_ms = 0);
+
+    /**
+     * @brief Queues a packet in place of a waiting one with the same priority
+     * and first byte (TxQueue::replace()), so at most one of them waits.
+     *
+     * @return false if the packet was dropped.
+     */
+    bool send_latest(const uint8_t *data, size_t length, TxPriority priority);
+
+    /**
+     * @brief Call every loop. Starts the beacon or the next due packet that
+     * fits the current TDMA slot, if the radio is idle. Never blocks on the
+     * air.
+     */
+    void service();
+
+    /**
+     * @brief Optional. Home starts command retransmit timers from it, and
+     * traces latency (command_trace.h).
+     */
+    void on_transmit(RadioTransmitCallback callback) { on_transmit_ = callback; }
+
+    /**
+     * @brief Away: the MCU clock relative to this board's, from the Serial2
+     * sync. Passed on to Home in every TimeSyncFrame.
+     *
+     * @param offset_us MCU time - local time.
+     * @param synced false until the Serial2 sync has a sample.
+     */
+    void set_reference(uint32_t offset_us, bool synced);
+
+    /**
+     * @brief Converts a local esp_timer time to the MCU's clock.
+     *
+     * @return false until both hops are synced.
+     */
+    bool to_reference(uint32_t local_us, uint32_t &reference_us) const;
+
+    /**
+     * @brief Home: estimate of Away's clock. Empty on Away.
+     */
+    ClockSync clock() const;
+
+    /**
+     * @brief Pops the oldest received packet.
+     *
+     * @return false if none are queued.
+     */
+    bool receive(RxPacket &packet);
+
+    /**
+     * @brief Longest packet that fits in one of the schedule's slots.
+     */
+    size_t slot_capacity(TdmaSlot slot) const;
+
+    /**
+     * @brief Time on air of a packet at the current PHY.
+     */
+    uint32_t airtime_us(size_t length) const { return airtime_us_[length < TX_PACKET_MAX_BYTES ? length : TX_PACKET_MAX_BYTES]; }
+
+    TdmaSlot slot();
+    bool synced() const { return tdma_.synced(); }
+    PhyProfileId profile() const { return profile_; }
+    bool profile_pending() const { return switch_pending_; }
+    const TdmaSchedule &schedule() const { return tdma_.schedule(); }
+    bool transmitting() const { return transmitting_; }
+    size_t queued() const { return tx_queue_.size(); }
+    RadioLinkStats stats() const;
+
+private:
+    static void on_dio1();
+    static void radio_task(void *arg);
+    void handle_irq();
+    size_t fitting_length(uint32_t duration_us) const;
+    int apply_profile(PhyProfileId profile);
+    void update_profile(uint32_t now_us);
+    void on_beacon_profile(const TdmaBeacon &beacon);
+    void send_phy_ack(PhyProfileId profile, uint16_t switch_frame);
+    void on_beacon_time(const TdmaBeacon &beacon, uint32_t start_us);
+    void on_time_sync(const TimeSyncFrame &frame, uint32_t start_us);
+
+    SX1262 &radio_;
+    SemaphoreHandle_t mutex_ = NULL;
+    TxQueue<RADIO_TX_QUEUE_LENGTH> tx_queue_;
+    RingBuffer<RxPacket, RADIO_RX_QUEUE_LENGTH> rx_queue_;
+    volatile bool transmitting_ = false;
+    RadioLinkStats stats_ = {};
+    TdmaClock tdma_;
+    TdmaRole role_ = TDMA_HOME;
+    PhyProfileId profile_ = PHY_STANDBY;
+    // Announced switch: to next_profile_ at the start of switch_frame_.
+    // Home needs Away's PhyAck (confirmed); Away needs the last beacon before
+    // it to still announce it (committed).
+    bool switch_pending_ = false;
+    bool switch_ready_ = false;
+    PhyProfileId next_profile_ = PHY_STANDBY;
+    uint16_t switch_frame_ = 0;
+    volatile uint32_t last_rx_us_ = 0;
+    RadioTransmitCallback on_transmit_ = NULL;
+    // Home: Away's clock. Both: MCU - Away, as Away last reported it.
+    ClockSync clock_;
+    uint32_t reference_offset_us_ = 0;
+    bool reference_synced_ = false;
+    uint32_t last_time_sync_us_ = 0;
+    // Time on air per length, 0..TX_PACKET_MAX_BYTES, at the current PHY.
+    uint32_t airtime_us_[TX_PACKET_MAX_BYTES + 1];
+};
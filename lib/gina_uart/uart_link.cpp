@@ -0,0 +1,286 @@
+/**
+ * @file uart_link.cpp
+ * @brief Event-driven, packetised UART link.
+ */
+#include "uart_link.h"
+#include <esp_timer.h>
+#include <profiler.h>
+
+static const uint32_t LINK_TASK_STACK = 4096;
+static const UBaseType_t LINK_TASK_PRIORITY = configMAX_PRIORITIES - 4;
+static const int UART_RX_BUFFER = 2048;
+static const int UART_TX_BUFFER = 2048;
+static const int UART_EVENT_QUEUE_LENGTH = 20;
+// Event wait, so keepalives and timeouts run without traffic.
+static const uint32_t LINK_POLL_MS = 50;
+
+// Only the link task records it.
+static ProfileSection profile_event("uart_event");
+
+UartLink::UartLink(uart_port_t port, UartLinkRole role) : port_(port), role_(role)
+{
+}
+
+bool UartLink::begin(int rx_pin, int tx_pin, uint32_t max_baud, BaseType_t core)
+{
+    max_baud_ = max_baud < UART_LINK_BASE_BAUD ? UART_LINK_BASE_BAUD : max_baud;
+    baud_ = UART_LINK_BASE_BAUD;
+
+    uart_config_t config = {};
+    config.baud_rate = UART_LINK_BASE_BAUD;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_APB;
+
+    if (uart_driver_install(port_, UART_RX_BUFFER, UART_TX_BUFFER, UART_EVENT_QUEUE_LENGTH, &events_, 0) != ESP_OK)
+        return false;
+    if (uart_param_config(port_, &config) != ESP_OK ||
+        uart_set_pin(port_, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK)
+    {
+        uart_driver_delete(port_);
+        return false;
+    }
+
+    last_rx_ms_ = last_tx_ms_ = millis();
+    started_ = true;
+    xTaskCreatePinnedToCore(link_task, "uart_link", LINK_TASK_STACK, this, LINK_TASK_PRIORITY, NULL, core);
+    return true;
+}
+
+void UartLink::link_task(void *arg)
+{
+    UartLink *link = (UartLink *)arg;
+    uart_event_t event;
+    while (true)
+    {
+        if (xQueueReceive(link->events_, &event, pdMS_TO_TICKS(LINK_POLL_MS)))
+            link->handle_event(event);
+        link->supervise(millis());
+    }
+}
+
+void UartLink::handle_event(const uart_event_t &event)
+{
+    ProfileScope scope(profile_event);
+    switch (event.type)
+    {
+    case UART_DATA:
+    {
+        uint8_t buffer[128];
+        size_t remaining = event.size;
+        while (remaining > 0)
+        {
+            int count = uart_read_bytes(port_, buffer, remaining < sizeof(buffer) ? remaining : sizeof(buffer), 0);
+            if (count <= 0)
+                break;
+            for (int i = 0; i < count; i++)
+                feed(buffer[i]);
+            remaining -= count;
+        }
+        break;
+    }
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+        // Bytes are gone; resync on the next delimiter.
+        stats_.overflows++;
+        uart_flush_input(port_);
+        xQueueReset(events_);
+        frame_fill_ = 0;
+        frame_overflow_ = true;
+        break;
+    case UART_FRAME_ERR:
+    case UART_PARITY_ERR:
+        stats_.line_errors++;
+        break;
+    default:
+        break;
+    }
+}
+
+void UartLink::feed(uint8_t byte)
+{
+    if (byte == 0)
+    {
+        if (!frame_overflow_ && frame_fill_ > 0)
+        {
+            SerialPacket packet;
+            if (serial_packet_decode(frame_, frame_fill_, packet))
+                handle_packet(packet);
+            else
+                stats_.bad_frames++;
+        }
+        frame_fill_ = 0;
+        frame_overflow_ = false;
+        return;
+    }
+
+    if (frame_overflow_)
+        return;
+    if (frame_fill_ >= sizeof(frame_))
+    {
+        // Longer than any valid packet: drop it whole.
+        stats_.bad_frames++;
+        frame_overflow_ = true;
+        return;
+    }
+    frame_[frame_fill_++] = byte;
+}
+
+void UartLink::handle_packet(const SerialPacket &packet)
+{
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    stats_.received++;
+    last_rx_ms_ = millis();
+
+    uint32_t baud;
+    TimeSyncReply reply;
+    switch (packet.type)
+    {
+    case SERIAL_HELLO:
+        if (role_ != UART_LINK_FOLLOWER || packet.length != sizeof(baud))
+            return;
+        memcpy(&baud, packet.payload, sizeof(baud));
+        if (baud > max_baud_)
+            baud = max_baud_;
+        if (baud < UART_LINK_BASE_BAUD)
+            baud = UART_LINK_BASE_BAUD;
+        // Answer at the old rate, then switch once it is on the wire.
+        send(SERIAL_BAUD, &baud, sizeof(baud));
+        set_baud(baud);
+        negotiated_ = true;
+        return;
+    case SERIAL_BAUD:
+        if (role_ != UART_LINK_LEADER || packet.length != sizeof(baud))
+            return;
+        memcpy(&baud, packet.payload, sizeof(baud));
+        if (baud < UART_LINK_BASE_BAUD || baud > max_baud_)
+            return;
+        set_baud(baud);
+        negotiated_ = true;
+        return;
+    case SERIAL_KEEPALIVE:
+        return;
+    case SERIAL_TIME_REQUEST:
+        if (packet.length != sizeof(reply.origin_us))
+            return;
+        memcpy(&reply.origin_us, packet.payload, sizeof(reply.origin_us));
+        reply.receive_us = now_us;
+        reply.transmit_us = (uint32_t)esp_timer_get_time();
+        send(SERIAL_TIME_REPLY, &reply, sizeof(reply));
+        stats_.time_syncs++;
+        return;
+    case SERIAL_TIME_REPLY:
+        if (role_ != UART_LINK_FOLLOWER || packet.length != sizeof(reply))
+            return;
+        memcpy(&reply, packet.payload, sizeof(reply));
+        {
+            // Only this task writes clock_. The float math runs on a copy; the
+            // lock only keeps readers from seeing half an update.
+            ClockSync clock = clock_;
+            if (clock.add(reply.origin_us, reply.receive_us, reply.transmit_us, now_us))
+                stats_.time_syncs++;
+            portENTER_CRITICAL(&clock_lock_);
+            clock_ = clock;
+            portEXIT_CRITICAL(&clock_lock_);
+        }
+        return;
+    default:
+        if (!rx_queue_.push(packet))
+            stats_.rx_dropped++;
+        return;
+    }
+}
+
+void UartLink::supervise(uint32_t now_ms)
+{
+    if (now_ms - last_rx_ms_ >= UART_LINK_TIMEOUT_MS)
+    {
+        // Peer reset or the high rate does not work on this wiring.
+        if (baud_ != UART_LINK_BASE_BAUD)
+        {
+            set_baud(UART_LINK_BASE_BAUD);
+            stats_.fallbacks++;
+        }
+        negotiated_ = false;
+        last_rx_ms_ = now_ms;
+        // The leader may come back with a new clock.
+        portENTER_CRITICAL(&clock_lock_);
+        clock_.reset();
+        portEXIT_CRITICAL(&clock_lock_);
+    }
+
+    if (role_ == UART_LINK_LEADER && !negotiated_ && now_ms - last_hello_ms_ >= UART_LINK_HELLO_MS)
+    {
+        last_hello_ms_ = now_ms;
+        send(SERIAL_HELLO, &max_baud_, sizeof(max_baud_));
+    }
+    else if (role_ == UART_LINK_FOLLOWER && negotiated_ && now_ms - last_time_request_ms_ >= CLOCK_SYNC_INTERVAL_MS)
+    {
+        last_time_request_ms_ = now_ms;
+        uint32_t origin_us = (uint32_t)esp_timer_get_time();
+        send(SERIAL_TIME_REQUEST, &origin_us, sizeof(origin_us));
+    }
+    else if (now_ms - last_tx_ms_ >= UART_LINK_KEEPALIVE_MS)
+    {
+        send(SERIAL_KEEPALIVE, NULL, 0);
+    }
+}
+
+void UartLink::set_baud(uint32_t baud)
+{
+    if (baud == baud_)
+        return;
+    // A packet half-sent at the old rate would be garbled on the other end.
+    uart_wait_tx_done(port_, pdMS_TO_TICKS(50));
+    uart_set_baudrate(port_, baud);
+    baud_ = baud;
+    frame_fill_ = 0;
+    frame_overflow_ = true;
+}
+
+bool UartLink::send(SerialPacketType type, const void *payload, size_t length)
+{
+    uint8_t encoded[SERIAL_PACKET_MAX_ENCODED];
+    size_t encoded_length = started_ ? serial_packet_encode(type, payload, length, encoded) : 0;
+    if (encoded_length == 0)
+    {
+        portENTER_CRITICAL(&stats_lock_);
+        stats_.tx_dropped++;
+        portEXIT_CRITICAL(&stats_lock_);
+        return false;
+    }
+
+    // One write per packet; the driver serialises writers. A single 32-bit
+    // store, so racing senders only decide which time is kept.
+    uart_write_bytes(port_, (const char *)encoded, encoded_length);
+    last_tx_ms_ = millis();
+    return true;
+}
+
+bool UartLink::send_text(SerialPacketType type, const char *text)
+{
+    return send(type, text, strlen(text));
+}
+
+bool UartLink::receive(SerialPacket &packet)
+{
+    return rx_queue_.pop(packet);
+}
+
+UartLinkStats UartLink::stats() const
+{
+    portENTER_CRITICAL(&stats_lock_);
+    UartLinkStats stats = stats_;
+    portEXIT_CRITICAL(&stats_lock_);
+    return stats;
+}
+
+ClockSync UartLink::clock() const
+{
+    portENTER_CRITICAL(&clock_lock_);
+    ClockSync clock = clock_;
+    portEXIT_CRITICAL(&clock_lock_);
+    return clock;
+}
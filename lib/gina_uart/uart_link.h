@@ -0,0 +1,137 @@
+/**
+ * @file uart_link.h
+ * @brief Event-driven, packetised UART link between the MCU and Lora Away.
+ *
+ * Runs on the ESP-IDF UART driver instead of HardwareSerial. A task blocks on
+ * the driver's event queue, so bytes are consumed as soon as the driver has
+ * them and neither board's main loop ever waits on the wire. Bytes are split
+ * at 0x00 delimiters, COBS-decoded and CRC-checked (serial_packet.h); good
+ * packets land in an RX queue, bad ones are counted and dropped.
+ *
+ * Both ends start at UART_LINK_BASE_BAUD. The leader (MCU) offers its highest
+ * baud in SERIAL_HELLO; the follower (Lora Away) answers with SERIAL_BAUD and
+ * both switch. Each end sends SERIAL_KEEPALIVE when idle, and drops back to the
+ * base baud when no good packet has arrived for UART_LINK_TIMEOUT_MS, so a
+ * reset on either side renegotiates by itself.
+ *
+ * The follower also keeps a ClockSync of the leader's clock (clock_sync.h):
+ * it sends SERIAL_TIME_REQUEST every CLOCK_SYNC_INTERVAL_MS and the leader
+ * answers from the link task, so neither side's loop adds to the delay.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <clock_sync.h>
+#include <driver/uart.h>
+#include <ring_buffer.h>
+#include <serial_packet.h>
+
+// Both ends start (and fall back) here.
+const uint32_t UART_LINK_BASE_BAUD = 115200;
+// Default ceiling offered during negotiation. Short wires on the stand.
+const uint32_t UART_LINK_MAX_BAUD = 921600;
+// Leader retries SERIAL_HELLO this often until answered.
+const uint32_t UART_LINK_HELLO_MS = 200;
+// SERIAL_KEEPALIVE after this long without sending anything.
+const uint32_t UART_LINK_KEEPALIVE_MS = 250;
+// No good packet for this long: back to the base baud.
+const uint32_t UART_LINK_TIMEOUT_MS = 1000;
+// Packets buffered between the UART task and the consumer.
+const size_t UART_LINK_RX_QUEUE_LENGTH = 16;
+
+enum UartLinkRole : uint8_t
+{
+    UART_LINK_LEADER,  // Offers a baud rate.
+    UART_LINK_FOLLOWER // Accepts one.
+};
+
+struct UartLinkStats
+{
+    uint32_t received;    // Good packets, control packets included.
+    uint32_t bad_frames;  // COBS, length or CRC failures.
+    uint32_t line_errors; // UART framing/parity errors (e.g. baud mismatch).
+    uint32_t overflows;   // Driver FIFO or RX buffer overruns.
+    uint32_t rx_dropped;  // Good packets lost because the RX queue was full.
+    uint32_t tx_dropped;  // Packets too long to send, or sent before begin().
+    uint32_t fallbacks;   // Drops back to the base baud after a timeout.
+    uint32_t time_syncs;  // Time exchanges answered (leader) or used (follower).
+};
+
+class UartLink
+{
+public:
+    UartLink(uart_port_t port, UartLinkRole role);
+
+    /**
+     * @brief Installs the UART driver at the base baud and starts the link
+     * task.
+     *
+     * @param rx_pin
+     * @param tx_pin
+     * @param max_baud Highest baud this end accepts.
+     * @param core Core for the link task.
+     * @return false if the driver could not be installed.
+     */
+    bool begin(int rx_pin, int tx_pin, uint32_t max_baud = UART_LINK_MAX_BAUD, BaseType_t core = tskNO_AFFINITY);
+
+    /**
+     * @brief Encodes and writes one packet. Safe from any task. Copies into
+     * the driver's 2 KB TX ring and blocks while it is full: up to about
+     * 20 ms at 921600 baud, 180 ms at 115200. Keep it off tasks with timing
+     * to hold.
+     *
+     * @return false if the payload is too long or the link is not started.
+     */
+    bool send(SerialPacketType type, const void *payload, size_t length);
+    bool send_text(SerialPacketType type, const char *text);
+
+    /**
+     * @brief Pops the oldest received data packet (control packets are handled
+     * by the link). Single consumer.
+     *
+     * @return false if none are queued.
+     */
+    bool receive(SerialPacket &packet);
+
+    uint32_t baud() const { return baud_; }
+    bool negotiated() const { return negotiated_; }
+    UartLinkStats stats() const;
+
+    /**
+     * @brief Follower: estimate of the leader's clock. Empty on the leader.
+     */
+    ClockSync clock() const;
+
+private:
+    static void link_task(void *arg);
+    void handle_event(const uart_event_t &event);
+    void feed(uint8_t byte);
+    void handle_packet(const SerialPacket &packet);
+    void supervise(uint32_t now_ms);
+    void set_baud(uint32_t baud);
+
+    uart_port_t port_;
+    UartLinkRole role_;
+    QueueHandle_t events_ = NULL;
+    uint32_t max_baud_ = UART_LINK_BASE_BAUD;
+    volatile uint32_t baud_ = UART_LINK_BASE_BAUD;
+    volatile bool negotiated_ = false;
+    volatile bool started_ = false;
+    volatile uint32_t last_rx_ms_ = 0;
+    volatile uint32_t last_tx_ms_ = 0;
+    uint32_t last_hello_ms_ = 0;
+    uint32_t last_time_request_ms_ = 0;
+    ClockSync clock_;
+    mutable portMUX_TYPE clock_lock_ = portMUX_INITIALIZER_UNLOCKED;
+
+    // Bytes since the last delimiter. Only touched by the link task.
+    uint8_t frame_[SERIAL_PACKET_MAX_ENCODED];
+    size_t frame_fill_ = 0;
+    bool frame_overflow_ = false;
+
+    RingBuffer<SerialPacket, UART_LINK_RX_QUEUE_LENGTH> rx_queue_;
+    // Written by the link task only, except tx_dropped: send() runs on any
+    // task, so that one is counted under stats_lock_.
+    UartLinkStats stats_ = {};
+    mutable portMUX_TYPE stats_lock_ = portMUX_INITIALIZER_UNLOCKED;
+};